@@ -289,6 +289,9 @@ public:
 	bool is_empty() const;
 
 	Vector<uint8_t> get_data() const;
+	// Direct access to the pixels, for code that fills an image in place.
+	const uint8_t *ptr() const;
+	uint8_t *ptrw();
 
 	Error load(const String &p_path);
 	Error save_png(const String &p_path) const;
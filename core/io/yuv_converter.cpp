@@ -0,0 +1,604 @@
+/*************************************************************************/
+/*  yuv_converter.cpp                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "yuv_converter.h"
+
+#include "core/error/error_macros.h"
+#include "core/math/math_funcs.h"
+#include "core/string/ustring.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YUV_SSE2_ENABLED
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define YUV_AVX2_ENABLED
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define YUV_TARGET_AVX2
+#else
+#define YUV_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define YUV_NEON_ENABLED
+#include <arm_neon.h>
+#endif
+
+// All implementations use the same 16-bit fixed point math with 6 fractional bits, so they
+// produce identical results. Luma is scaled with a 16x16 bit multiply keeping the high half,
+// chroma with a plain 16-bit multiply. Sums saturate, which only happens for results that
+// are clamped to 0 or 255 anyway.
+struct YUVCoefficients {
+	uint16_t y_mul; // applied to Y << 8, keeping the high 16 bits of the product
+	int16_t y_sub; // luma offset, less the rounding term
+	int16_t rv; // Cr to red
+	int16_t gu; // Cb to green, subtracted
+	int16_t gv; // Cr to green, subtracted
+	int16_t bu; // Cb to blue
+};
+
+static YUVCoefficients _get_coefficients(YUVConverter::ColorSpace p_color_space, YUVConverter::Range p_range) {
+	double kr = p_color_space == YUVConverter::COLOR_SPACE_BT709 ? 0.2126 : 0.299;
+	double kb = p_color_space == YUVConverter::COLOR_SPACE_BT709 ? 0.0722 : 0.114;
+	double kg = 1.0 - kr - kb;
+
+	bool limited = p_range == YUVConverter::RANGE_LIMITED;
+	double y_scale = limited ? 255.0 / 219.0 : 1.0;
+	double c_scale = limited ? 255.0 / 224.0 : 1.0;
+	double y_offset = limited ? 16.0 : 0.0;
+
+	YUVCoefficients c;
+	c.y_mul = (uint16_t)Math::round(y_scale * 64.0 * 256.0);
+	c.y_sub = (int16_t)(Math::round(y_offset * y_scale * 64.0) - 32);
+	c.rv = (int16_t)Math::round(2.0 * (1.0 - kr) * c_scale * 64.0);
+	c.gu = (int16_t)Math::round(2.0 * (1.0 - kb) * kb / kg * c_scale * 64.0);
+	c.gv = (int16_t)Math::round(2.0 * (1.0 - kr) * kr / kg * c_scale * 64.0);
+	c.bu = (int16_t)Math::round(2.0 * (1.0 - kb) * c_scale * 64.0);
+	return c;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Scalar
+
+static _FORCE_INLINE_ uint8_t _clamp_channel(int p_value) {
+	return p_value < 0 ? 0 : (p_value > 255 ? 255 : p_value);
+}
+
+static _FORCE_INLINE_ void _pixel(const YUVCoefficients &p_c, int p_y, int p_u, int p_v, uint8_t *p_dst) {
+	int y = (int)(((uint32_t)(p_y << 8) * p_c.y_mul) >> 16) - p_c.y_sub;
+	int u = p_u - 128;
+	int v = p_v - 128;
+	p_dst[0] = _clamp_channel((y + v * p_c.rv) >> 6);
+	p_dst[1] = _clamp_channel((y - u * p_c.gu - v * p_c.gv) >> 6);
+	p_dst[2] = _clamp_channel((y + u * p_c.bu) >> 6);
+	p_dst[3] = 255;
+}
+
+// Rows start at pixel p_from, so vector implementations can finish a row with these.
+static void _row_packed422_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c, int p_y_ofs) {
+	int c_ofs = 1 - p_y_ofs;
+	for (int x = p_from; x < p_width; x++) {
+		const uint8_t *macropixel = p_src[0] + (x >> 1) * 4;
+		_pixel(p_c, macropixel[p_y_ofs + (x & 1) * 2], macropixel[c_ofs], macropixel[c_ofs + 2], p_dst + x * 4);
+	}
+}
+
+static void _row_yuyv_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	_row_packed422_scalar(p_src, p_dst, p_from, p_width, p_c, 0);
+}
+
+static void _row_uyvy_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	_row_packed422_scalar(p_src, p_dst, p_from, p_width, p_c, 1);
+}
+
+static void _row_nv12_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	for (int x = p_from; x < p_width; x++) {
+		const uint8_t *cbcr = p_src[1] + (x >> 1) * 2;
+		_pixel(p_c, p_src[0][x], cbcr[0], cbcr[1], p_dst + x * 4);
+	}
+}
+
+static void _row_planar_half_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	for (int x = p_from; x < p_width; x++) {
+		_pixel(p_c, p_src[0][x], p_src[1][x >> 1], p_src[2][x >> 1], p_dst + x * 4);
+	}
+}
+
+static void _row_planar_full_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	for (int x = p_from; x < p_width; x++) {
+		_pixel(p_c, p_src[0][x], p_src[1][x], p_src[2][x], p_dst + x * 4);
+	}
+}
+
+static void _row_rgb24_scalar(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	for (int x = p_from; x < p_width; x++) {
+		const uint8_t *src = p_src[0] + x * 3;
+		uint8_t *dst = p_dst + x * 4;
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = 255;
+	}
+}
+
+typedef void (*RowFunc)(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c);
+
+static const RowFunc _rows_scalar[YUVConverter::SOURCE_MAX] = {
+	_row_yuyv_scalar,
+	_row_uyvy_scalar,
+	_row_nv12_scalar,
+	_row_planar_half_scalar, // I420
+	_row_planar_half_scalar, // YUV422P
+	_row_planar_full_scalar,
+	_row_rgb24_scalar,
+};
+
+/////////////////////////////////////////////////////////////////////////
+// SSE2, 16 pixels at a time
+
+#ifdef YUV_SSE2_ENABLED
+
+struct YUVCoefficientsSSE2 {
+	__m128i y_mul;
+	__m128i y_sub;
+	__m128i rv;
+	__m128i gu;
+	__m128i gv;
+	__m128i bu;
+
+	YUVCoefficientsSSE2(const YUVCoefficients &p_c) {
+		y_mul = _mm_set1_epi16((short)p_c.y_mul);
+		y_sub = _mm_set1_epi16(p_c.y_sub);
+		rv = _mm_set1_epi16(p_c.rv);
+		gu = _mm_set1_epi16(p_c.gu);
+		gv = _mm_set1_epi16(p_c.gv);
+		bu = _mm_set1_epi16(p_c.bu);
+	}
+};
+
+// Spreads 8 interleaved CbCr pairs over 16 pixels.
+static _FORCE_INLINE_ void _expand_cbcr_sse2(__m128i p_cbcr, __m128i &r_u, __m128i &r_v) {
+	__m128i u = _mm_and_si128(p_cbcr, _mm_set1_epi16(0x00ff));
+	__m128i v = _mm_srli_epi16(p_cbcr, 8);
+	r_u = _mm_or_si128(u, _mm_slli_epi16(u, 8));
+	r_v = _mm_or_si128(v, _mm_slli_epi16(v, 8));
+}
+
+static _FORCE_INLINE_ void _load_packed422_sse2(const uint8_t *p_src, bool p_uyvy, __m128i &r_y, __m128i &r_u, __m128i &r_v) {
+	__m128i a = _mm_loadu_si128((const __m128i *)p_src);
+	__m128i b = _mm_loadu_si128((const __m128i *)(p_src + 16));
+	__m128i mask = _mm_set1_epi16(0x00ff);
+	__m128i low = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+	__m128i high = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+	r_y = p_uyvy ? high : low;
+	_expand_cbcr_sse2(p_uyvy ? low : high, r_u, r_v);
+}
+
+// Loads 16 pixels of a row as per pixel Y, Cb and Cr.
+static _FORCE_INLINE_ void _load16_sse2(YUVConverter::SourceFormat p_format, const uint8_t *const *p_src, int p_x, __m128i &r_y, __m128i &r_u, __m128i &r_v) {
+	switch (p_format) {
+		case YUVConverter::SOURCE_YUYV:
+		case YUVConverter::SOURCE_UYVY: {
+			_load_packed422_sse2(p_src[0] + p_x * 2, p_format == YUVConverter::SOURCE_UYVY, r_y, r_u, r_v);
+		} break;
+		case YUVConverter::SOURCE_NV12: {
+			r_y = _mm_loadu_si128((const __m128i *)(p_src[0] + p_x));
+			_expand_cbcr_sse2(_mm_loadu_si128((const __m128i *)(p_src[1] + p_x)), r_u, r_v);
+		} break;
+		case YUVConverter::SOURCE_I420:
+		case YUVConverter::SOURCE_YUV422P: {
+			r_y = _mm_loadu_si128((const __m128i *)(p_src[0] + p_x));
+			__m128i u = _mm_loadl_epi64((const __m128i *)(p_src[1] + p_x / 2));
+			__m128i v = _mm_loadl_epi64((const __m128i *)(p_src[2] + p_x / 2));
+			r_u = _mm_unpacklo_epi8(u, u);
+			r_v = _mm_unpacklo_epi8(v, v);
+		} break;
+		default: {
+			r_y = _mm_loadu_si128((const __m128i *)(p_src[0] + p_x));
+			r_u = _mm_loadu_si128((const __m128i *)(p_src[1] + p_x));
+			r_v = _mm_loadu_si128((const __m128i *)(p_src[2] + p_x));
+		} break;
+	}
+}
+
+// Converts 8 pixels held in 16-bit lanes, Y is already shifted left by 8.
+static _FORCE_INLINE_ void _convert8_sse2(__m128i p_y, __m128i p_u, __m128i p_v, const YUVCoefficientsSSE2 &p_c, __m128i &r_r, __m128i &r_g, __m128i &r_b) {
+	__m128i bias = _mm_set1_epi16(128);
+	__m128i y = _mm_sub_epi16(_mm_mulhi_epu16(p_y, p_c.y_mul), p_c.y_sub);
+	__m128i u = _mm_sub_epi16(p_u, bias);
+	__m128i v = _mm_sub_epi16(p_v, bias);
+	r_r = _mm_srai_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(v, p_c.rv)), 6);
+	r_g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(y, _mm_mullo_epi16(u, p_c.gu)), _mm_mullo_epi16(v, p_c.gv)), 6);
+	r_b = _mm_srai_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(u, p_c.bu)), 6);
+}
+
+static _FORCE_INLINE_ void _convert16_sse2(__m128i p_y, __m128i p_u, __m128i p_v, const YUVCoefficientsSSE2 &p_c, uint8_t *p_dst) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+	_convert8_sse2(_mm_unpacklo_epi8(zero, p_y), _mm_unpacklo_epi8(p_u, zero), _mm_unpacklo_epi8(p_v, zero), p_c, r_lo, g_lo, b_lo);
+	_convert8_sse2(_mm_unpackhi_epi8(zero, p_y), _mm_unpackhi_epi8(p_u, zero), _mm_unpackhi_epi8(p_v, zero), p_c, r_hi, g_hi, b_hi);
+
+	__m128i r = _mm_packus_epi16(r_lo, r_hi);
+	__m128i g = _mm_packus_epi16(g_lo, g_hi);
+	__m128i b = _mm_packus_epi16(b_lo, b_hi);
+	__m128i a = _mm_set1_epi8((char)0xff);
+
+	__m128i rg_lo = _mm_unpacklo_epi8(r, g);
+	__m128i rg_hi = _mm_unpackhi_epi8(r, g);
+	__m128i ba_lo = _mm_unpacklo_epi8(b, a);
+	__m128i ba_hi = _mm_unpackhi_epi8(b, a);
+	_mm_storeu_si128((__m128i *)p_dst, _mm_unpacklo_epi16(rg_lo, ba_lo));
+	_mm_storeu_si128((__m128i *)(p_dst + 16), _mm_unpackhi_epi16(rg_lo, ba_lo));
+	_mm_storeu_si128((__m128i *)(p_dst + 32), _mm_unpacklo_epi16(rg_hi, ba_hi));
+	_mm_storeu_si128((__m128i *)(p_dst + 48), _mm_unpackhi_epi16(rg_hi, ba_hi));
+}
+
+template <YUVConverter::SourceFormat FORMAT>
+static void _row_sse2(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	YUVCoefficientsSSE2 c(p_c);
+	int x = p_from;
+	for (; x + 16 <= p_width; x += 16) {
+		__m128i y, u, v;
+		_load16_sse2(FORMAT, p_src, x, y, u, v);
+		_convert16_sse2(y, u, v, c, p_dst + x * 4);
+	}
+	_rows_scalar[FORMAT](p_src, p_dst, x, p_width, p_c);
+}
+
+static const RowFunc _rows_sse2[YUVConverter::SOURCE_MAX] = {
+	_row_sse2<YUVConverter::SOURCE_YUYV>,
+	_row_sse2<YUVConverter::SOURCE_UYVY>,
+	_row_sse2<YUVConverter::SOURCE_NV12>,
+	_row_sse2<YUVConverter::SOURCE_I420>,
+	_row_sse2<YUVConverter::SOURCE_YUV422P>,
+	_row_sse2<YUVConverter::SOURCE_YUV444P>,
+	_row_rgb24_scalar, // needs byte shuffles, which SSE2 doesn't have
+};
+
+#endif // YUV_SSE2_ENABLED
+
+/////////////////////////////////////////////////////////////////////////
+// AVX2, 32 pixels at a time
+
+#ifdef YUV_AVX2_ENABLED
+
+static YUV_TARGET_AVX2 _FORCE_INLINE_ __m256i _combine_avx2(__m128i p_low, __m128i p_high) {
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(p_low), p_high, 1);
+}
+
+// Same as _convert8_sse2, but for 16 pixels.
+static YUV_TARGET_AVX2 _FORCE_INLINE_ void _convert16_avx2(__m256i p_y, __m256i p_u, __m256i p_v, const YUVCoefficients &p_c, __m256i &r_r, __m256i &r_g, __m256i &r_b) {
+	__m256i bias = _mm256_set1_epi16(128);
+	__m256i y = _mm256_sub_epi16(_mm256_mulhi_epu16(p_y, _mm256_set1_epi16((short)p_c.y_mul)), _mm256_set1_epi16(p_c.y_sub));
+	__m256i u = _mm256_sub_epi16(p_u, bias);
+	__m256i v = _mm256_sub_epi16(p_v, bias);
+	r_r = _mm256_srai_epi16(_mm256_adds_epi16(y, _mm256_mullo_epi16(v, _mm256_set1_epi16(p_c.rv))), 6);
+	r_g = _mm256_srai_epi16(_mm256_subs_epi16(_mm256_subs_epi16(y, _mm256_mullo_epi16(u, _mm256_set1_epi16(p_c.gu))), _mm256_mullo_epi16(v, _mm256_set1_epi16(p_c.gv))), 6);
+	r_b = _mm256_srai_epi16(_mm256_adds_epi16(y, _mm256_mullo_epi16(u, _mm256_set1_epi16(p_c.bu))), 6);
+}
+
+static YUV_TARGET_AVX2 _FORCE_INLINE_ void _convert32_avx2(__m256i p_y, __m256i p_u, __m256i p_v, const YUVCoefficients &p_c, uint8_t *p_dst) {
+	// unpacking and packing work within 128-bit lanes, the pack undoes the unpack
+	__m256i zero = _mm256_setzero_si256();
+	__m256i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+	_convert16_avx2(_mm256_unpacklo_epi8(zero, p_y), _mm256_unpacklo_epi8(p_u, zero), _mm256_unpacklo_epi8(p_v, zero), p_c, r_lo, g_lo, b_lo);
+	_convert16_avx2(_mm256_unpackhi_epi8(zero, p_y), _mm256_unpackhi_epi8(p_u, zero), _mm256_unpackhi_epi8(p_v, zero), p_c, r_hi, g_hi, b_hi);
+
+	__m256i r = _mm256_packus_epi16(r_lo, r_hi);
+	__m256i g = _mm256_packus_epi16(g_lo, g_hi);
+	__m256i b = _mm256_packus_epi16(b_lo, b_hi);
+	__m256i a = _mm256_set1_epi8((char)0xff);
+
+	// pixels 0-7 and 16-23 in rg_lo, 8-15 and 24-31 in rg_hi
+	__m256i rg_lo = _mm256_unpacklo_epi8(r, g);
+	__m256i rg_hi = _mm256_unpackhi_epi8(r, g);
+	__m256i ba_lo = _mm256_unpacklo_epi8(b, a);
+	__m256i ba_hi = _mm256_unpackhi_epi8(b, a);
+	__m256i p0 = _mm256_unpacklo_epi16(rg_lo, ba_lo); // 0-3, 16-19
+	__m256i p1 = _mm256_unpackhi_epi16(rg_lo, ba_lo); // 4-7, 20-23
+	__m256i p2 = _mm256_unpacklo_epi16(rg_hi, ba_hi); // 8-11, 24-27
+	__m256i p3 = _mm256_unpackhi_epi16(rg_hi, ba_hi); // 12-15, 28-31
+	_mm256_storeu_si256((__m256i *)p_dst, _mm256_permute2x128_si256(p0, p1, 0x20));
+	_mm256_storeu_si256((__m256i *)(p_dst + 32), _mm256_permute2x128_si256(p2, p3, 0x20));
+	_mm256_storeu_si256((__m256i *)(p_dst + 64), _mm256_permute2x128_si256(p0, p1, 0x31));
+	_mm256_storeu_si256((__m256i *)(p_dst + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+template <YUVConverter::SourceFormat FORMAT>
+static YUV_TARGET_AVX2 void _row_avx2(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	int x = p_from;
+	for (; x + 32 <= p_width; x += 32) {
+		// gathering is cheap next to the math, reuse the SSE2 loads
+		__m128i y0, u0, v0, y1, u1, v1;
+		_load16_sse2(FORMAT, p_src, x, y0, u0, v0);
+		_load16_sse2(FORMAT, p_src, x + 16, y1, u1, v1);
+		_convert32_avx2(_combine_avx2(y0, y1), _combine_avx2(u0, u1), _combine_avx2(v0, v1), p_c, p_dst + x * 4);
+	}
+	_row_sse2<FORMAT>(p_src, p_dst, x, p_width, p_c);
+}
+
+static YUV_TARGET_AVX2 void _row_rgb24_avx2(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+	int x = p_from;
+	// every load reads 16 bytes for 4 pixels, stop early enough not to read past the row
+	for (; x + 6 <= p_width; x += 4) {
+		__m128i rgb = _mm_loadu_si128((const __m128i *)(p_src[0] + x * 3));
+		_mm_storeu_si128((__m128i *)(p_dst + x * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+	}
+	_row_rgb24_scalar(p_src, p_dst, x, p_width, p_c);
+}
+
+static const RowFunc _rows_avx2[YUVConverter::SOURCE_MAX] = {
+	_row_avx2<YUVConverter::SOURCE_YUYV>,
+	_row_avx2<YUVConverter::SOURCE_UYVY>,
+	_row_avx2<YUVConverter::SOURCE_NV12>,
+	_row_avx2<YUVConverter::SOURCE_I420>,
+	_row_avx2<YUVConverter::SOURCE_YUV422P>,
+	_row_avx2<YUVConverter::SOURCE_YUV444P>,
+	_row_rgb24_avx2,
+};
+
+static bool _cpu_has_avx2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	// the OS has to save the AVX registers too
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // YUV_AVX2_ENABLED
+
+/////////////////////////////////////////////////////////////////////////
+// NEON, 16 pixels at a time
+
+#ifdef YUV_NEON_ENABLED
+
+static _FORCE_INLINE_ uint8x16_t _double_neon(uint8x8_t p_values) {
+	uint8x8x2_t zipped = vzip_u8(p_values, p_values);
+	return vcombine_u8(zipped.val[0], zipped.val[1]);
+}
+
+static _FORCE_INLINE_ void _load16_neon(YUVConverter::SourceFormat p_format, const uint8_t *const *p_src, int p_x, uint8x16_t &r_y, uint8x16_t &r_u, uint8x16_t &r_v) {
+	switch (p_format) {
+		case YUVConverter::SOURCE_YUYV:
+		case YUVConverter::SOURCE_UYVY: {
+			uint8x8x4_t packed = vld4_u8(p_src[0] + p_x * 2);
+			int y_ofs = p_format == YUVConverter::SOURCE_UYVY ? 1 : 0;
+			uint8x8x2_t y = vzip_u8(packed.val[y_ofs], packed.val[y_ofs + 2]);
+			r_y = vcombine_u8(y.val[0], y.val[1]);
+			r_u = _double_neon(packed.val[1 - y_ofs]);
+			r_v = _double_neon(packed.val[3 - y_ofs]);
+		} break;
+		case YUVConverter::SOURCE_NV12: {
+			r_y = vld1q_u8(p_src[0] + p_x);
+			uint8x8x2_t cbcr = vld2_u8(p_src[1] + p_x);
+			r_u = _double_neon(cbcr.val[0]);
+			r_v = _double_neon(cbcr.val[1]);
+		} break;
+		case YUVConverter::SOURCE_I420:
+		case YUVConverter::SOURCE_YUV422P: {
+			r_y = vld1q_u8(p_src[0] + p_x);
+			r_u = _double_neon(vld1_u8(p_src[1] + p_x / 2));
+			r_v = _double_neon(vld1_u8(p_src[2] + p_x / 2));
+		} break;
+		default: {
+			r_y = vld1q_u8(p_src[0] + p_x);
+			r_u = vld1q_u8(p_src[1] + p_x);
+			r_v = vld1q_u8(p_src[2] + p_x);
+		} break;
+	}
+}
+
+static _FORCE_INLINE_ void _convert8_neon(uint8x8_t p_y, uint8x8_t p_u, uint8x8_t p_v, const YUVCoefficients &p_c, uint8x8_t &r_r, uint8x8_t &r_g, uint8x8_t &r_b) {
+	// the high half of (Y << 8) * y_mul
+	uint16x8_t y8 = vshll_n_u8(p_y, 8);
+	uint16x4_t y_low = vshrn_n_u32(vmull_n_u16(vget_low_u16(y8), p_c.y_mul), 16);
+	uint16x4_t y_high = vshrn_n_u32(vmull_n_u16(vget_high_u16(y8), p_c.y_mul), 16);
+	int16x8_t y = vsubq_s16(vreinterpretq_s16_u16(vcombine_u16(y_low, y_high)), vdupq_n_s16(p_c.y_sub));
+
+	uint8x8_t bias = vdup_n_u8(128);
+	int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(p_u, bias));
+	int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(p_v, bias));
+
+	r_r = vqmovun_s16(vshrq_n_s16(vqaddq_s16(y, vmulq_n_s16(v, p_c.rv)), 6));
+	r_g = vqmovun_s16(vshrq_n_s16(vqsubq_s16(vqsubq_s16(y, vmulq_n_s16(u, p_c.gu)), vmulq_n_s16(v, p_c.gv)), 6));
+	r_b = vqmovun_s16(vshrq_n_s16(vqaddq_s16(y, vmulq_n_s16(u, p_c.bu)), 6));
+}
+
+template <YUVConverter::SourceFormat FORMAT>
+static void _row_neon(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	int x = p_from;
+	for (; x + 16 <= p_width; x += 16) {
+		uint8x16_t y, u, v;
+		_load16_neon(FORMAT, p_src, x, y, u, v);
+
+		uint8x8_t r_low, g_low, b_low, r_high, g_high, b_high;
+		_convert8_neon(vget_low_u8(y), vget_low_u8(u), vget_low_u8(v), p_c, r_low, g_low, b_low);
+		_convert8_neon(vget_high_u8(y), vget_high_u8(u), vget_high_u8(v), p_c, r_high, g_high, b_high);
+
+		uint8x16x4_t rgba;
+		rgba.val[0] = vcombine_u8(r_low, r_high);
+		rgba.val[1] = vcombine_u8(g_low, g_high);
+		rgba.val[2] = vcombine_u8(b_low, b_high);
+		rgba.val[3] = vdupq_n_u8(255);
+		vst4q_u8(p_dst + x * 4, rgba);
+	}
+	_rows_scalar[FORMAT](p_src, p_dst, x, p_width, p_c);
+}
+
+static void _row_rgb24_neon(const uint8_t *const *p_src, uint8_t *p_dst, int p_from, int p_width, const YUVCoefficients &p_c) {
+	int x = p_from;
+	for (; x + 16 <= p_width; x += 16) {
+		uint8x16x3_t rgb = vld3q_u8(p_src[0] + x * 3);
+		uint8x16x4_t rgba;
+		rgba.val[0] = rgb.val[0];
+		rgba.val[1] = rgb.val[1];
+		rgba.val[2] = rgb.val[2];
+		rgba.val[3] = vdupq_n_u8(255);
+		vst4q_u8(p_dst + x * 4, rgba);
+	}
+	_row_rgb24_scalar(p_src, p_dst, x, p_width, p_c);
+}
+
+static const RowFunc _rows_neon[YUVConverter::SOURCE_MAX] = {
+	_row_neon<YUVConverter::SOURCE_YUYV>,
+	_row_neon<YUVConverter::SOURCE_UYVY>,
+	_row_neon<YUVConverter::SOURCE_NV12>,
+	_row_neon<YUVConverter::SOURCE_I420>,
+	_row_neon<YUVConverter::SOURCE_YUV422P>,
+	_row_neon<YUVConverter::SOURCE_YUV444P>,
+	_row_rgb24_neon,
+};
+
+#endif // YUV_NEON_ENABLED
+
+/////////////////////////////////////////////////////////////////////////
+// YUVConverter
+
+bool YUVConverter::is_implementation_supported(Implementation p_implementation) {
+	switch (p_implementation) {
+		case IMPLEMENTATION_AUTO:
+		case IMPLEMENTATION_SCALAR:
+			return true;
+#ifdef YUV_SSE2_ENABLED
+		case IMPLEMENTATION_SSE2:
+			return true;
+#endif
+#ifdef YUV_AVX2_ENABLED
+		case IMPLEMENTATION_AVX2: {
+			static bool has_avx2 = _cpu_has_avx2();
+			return has_avx2;
+		}
+#endif
+#ifdef YUV_NEON_ENABLED
+		case IMPLEMENTATION_NEON:
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+YUVConverter::Implementation YUVConverter::get_best_implementation() {
+	static const Implementation preferred[] = { IMPLEMENTATION_AVX2, IMPLEMENTATION_NEON, IMPLEMENTATION_SSE2 };
+	for (int i = 0; i < 3; i++) {
+		if (is_implementation_supported(preferred[i])) {
+			return preferred[i];
+		}
+	}
+	return IMPLEMENTATION_SCALAR;
+}
+
+const char *YUVConverter::get_implementation_name(Implementation p_implementation) {
+	static const char *names[IMPLEMENTATION_MAX] = {
+		"Auto",
+		"Scalar",
+		"SSE2",
+		"AVX2",
+		"NEON",
+	};
+	ERR_FAIL_INDEX_V(p_implementation, IMPLEMENTATION_MAX, "");
+	return names[p_implementation];
+}
+
+void YUVConverter::convert_to_rgba8(const Source &p_source, uint8_t *p_dst, int p_dst_stride, Implementation p_implementation) {
+	ERR_FAIL_INDEX(p_source.format, SOURCE_MAX);
+	ERR_FAIL_COND(p_source.width <= 0 || p_source.height <= 0);
+	ERR_FAIL_NULL(p_dst);
+	ERR_FAIL_COND_MSG(!is_implementation_supported(p_implementation), "The " + String(get_implementation_name(p_implementation)) + " implementation isn't supported on this CPU.");
+
+	int plane_count = 3;
+	if (p_source.format == SOURCE_NV12) {
+		plane_count = 2;
+	} else if (p_source.format == SOURCE_YUYV || p_source.format == SOURCE_UYVY || p_source.format == SOURCE_RGB24) {
+		plane_count = 1;
+	}
+	for (int i = 0; i < plane_count; i++) {
+		ERR_FAIL_NULL(p_source.planes[i]);
+	}
+
+	if (p_implementation == IMPLEMENTATION_AUTO) {
+		static Implementation best = get_best_implementation();
+		p_implementation = best;
+	}
+
+	RowFunc row = _rows_scalar[p_source.format];
+	switch (p_implementation) {
+#ifdef YUV_SSE2_ENABLED
+		case IMPLEMENTATION_SSE2:
+			row = _rows_sse2[p_source.format];
+			break;
+#endif
+#ifdef YUV_AVX2_ENABLED
+		case IMPLEMENTATION_AVX2:
+			row = _rows_avx2[p_source.format];
+			break;
+#endif
+#ifdef YUV_NEON_ENABLED
+		case IMPLEMENTATION_NEON:
+			row = _rows_neon[p_source.format];
+			break;
+#endif
+		default:
+			break;
+	}
+
+	YUVCoefficients coefficients = _get_coefficients(p_source.color_space, p_source.range);
+	bool half_height_chroma = p_source.format == SOURCE_NV12 || p_source.format == SOURCE_I420;
+	if (p_dst_stride == 0) {
+		p_dst_stride = p_source.width * 4;
+	}
+
+	for (int y = 0; y < p_source.height; y++) {
+		int chroma_y = half_height_chroma ? y >> 1 : y;
+		const uint8_t *rows[3] = {
+			p_source.planes[0] + (int64_t)y * p_source.strides[0],
+			plane_count > 1 ? p_source.planes[1] + (int64_t)chroma_y * p_source.strides[1] : nullptr,
+			plane_count > 2 ? p_source.planes[2] + (int64_t)chroma_y * p_source.strides[2] : nullptr,
+		};
+		row(rows, p_dst + (int64_t)y * p_dst_stride, 0, p_source.width, coefficients);
+	}
+}
@@ -0,0 +1,92 @@
+/*************************************************************************/
+/*  yuv_converter.h                                                      */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef YUV_CONVERTER_H
+#define YUV_CONVERTER_H
+
+#include "core/typedefs.h"
+
+// Converts video frames to RGBA8 on the CPU, used by video playback and by
+// cameras when frames can't be converted on the GPU. The conversion uses the
+// widest vector instructions the CPU supports, every implementation gives
+// exactly the same result.
+class YUVConverter {
+public:
+	enum SourceFormat {
+		SOURCE_YUYV, // packed 4:2:2, Y0 Cb Y1 Cr
+		SOURCE_UYVY, // packed 4:2:2, Cb Y0 Cr Y1
+		SOURCE_NV12, // Y plane followed by an interleaved CbCr plane at half resolution
+		SOURCE_I420, // Y, Cb and Cr planes, chroma at half resolution
+		SOURCE_YUV422P, // Y, Cb and Cr planes, chroma at half horizontal resolution
+		SOURCE_YUV444P, // Y, Cb and Cr planes at full resolution
+		SOURCE_RGB24, // packed R G B
+		SOURCE_MAX
+	};
+
+	enum ColorSpace {
+		COLOR_SPACE_BT601, // standard definition video and most webcams
+		COLOR_SPACE_BT709, // high definition video
+	};
+
+	enum Range {
+		RANGE_LIMITED, // luma from 16 to 235, chroma from 16 to 240
+		RANGE_FULL, // all channels from 0 to 255
+	};
+
+	enum Implementation {
+		IMPLEMENTATION_AUTO, // the fastest the CPU supports
+		IMPLEMENTATION_SCALAR,
+		IMPLEMENTATION_SSE2,
+		IMPLEMENTATION_AVX2,
+		IMPLEMENTATION_NEON,
+		IMPLEMENTATION_MAX
+	};
+
+	// The planes of a source frame. Packed formats only use the first plane, NV12 the first two.
+	struct Source {
+		SourceFormat format = SOURCE_MAX;
+		const uint8_t *planes[3] = {};
+		int strides[3] = {}; // bytes from the start of one row to the next
+		int width = 0;
+		int height = 0;
+		ColorSpace color_space = COLOR_SPACE_BT601;
+		Range range = RANGE_LIMITED;
+	};
+
+	// Writes p_source.width * p_source.height RGBA8 pixels to p_dst, which must not overlap the
+	// source. A p_dst_stride of 0 means the rows follow each other directly.
+	static void convert_to_rgba8(const Source &p_source, uint8_t *p_dst, int p_dst_stride = 0, Implementation p_implementation = IMPLEMENTATION_AUTO);
+
+	static bool is_implementation_supported(Implementation p_implementation);
+	static Implementation get_best_implementation();
+	static const char *get_implementation_name(Implementation p_implementation);
+};
+
+#endif // YUV_CONVERTER_H
@@ -105,6 +105,11 @@ public:
 		return value.fetch_sub(p_value, std::memory_order_acq_rel);
 	}
 
+	// Returns the original value
+	_ALWAYS_INLINE_ T exchange(T p_value) {
+		return value.exchange(p_value, std::memory_order_acq_rel);
+	}
+
 	_ALWAYS_INLINE_ T exchange_if_greater(T p_value) {
 		while (true) {
 			T tmp = value.load(std::memory_order_acquire);
@@ -242,6 +247,13 @@ public:
 		return old;
 	}
 
+	// Returns the original value
+	_ALWAYS_INLINE_ T exchange(T p_value) {
+		T old = value;
+		value = p_value;
+		return old;
+	}
+
 	_ALWAYS_INLINE_ T exchange_if_greater(T p_value) {
 		if (value < p_value) {
 			value = p_value;
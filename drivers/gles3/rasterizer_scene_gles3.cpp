@@ -202,6 +202,9 @@ void RasterizerSceneGLES3::environment_set_bg_energy(RID p_env, float p_energy)
 void RasterizerSceneGLES3::environment_set_canvas_max_layer(RID p_env, int p_max_layer) {
 }
 
+void RasterizerSceneGLES3::environment_set_camera_feed(RID p_env, RID p_texture, const Transform2D &p_transform) {
+}
+
 void RasterizerSceneGLES3::environment_set_ambient_light(RID p_env, const Color &p_color, RS::EnvironmentAmbientSource p_ambient, float p_energy, float p_sky_contribution, RS::EnvironmentReflectionSource p_reflection_source) {
 }
 
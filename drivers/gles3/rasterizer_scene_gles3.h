@@ -114,6 +114,7 @@ public:
 	void environment_set_bg_color(RID p_env, const Color &p_color) override;
 	void environment_set_bg_energy(RID p_env, float p_energy) override;
 	void environment_set_canvas_max_layer(RID p_env, int p_max_layer) override;
+	void environment_set_camera_feed(RID p_env, RID p_texture, const Transform2D &p_transform) override;
 	void environment_set_ambient_light(RID p_env, const Color &p_color, RS::EnvironmentAmbientSource p_ambient = RS::ENV_AMBIENT_SOURCE_BG, float p_energy = 1.0, float p_sky_contribution = 0.0, RS::EnvironmentReflectionSource p_reflection_source = RS::ENV_REFLECTION_SOURCE_BG) override;
 
 	void environment_set_glow(RID p_env, bool p_enable, Vector<float> p_levels, float p_intensity, float p_strength, float p_mix, float p_bloom_threshold, RS::EnvironmentGlowBlendMode p_blend_mode, float p_hdr_bleed_threshold, float p_hdr_bleed_scale, float p_hdr_luminance_cap) override;
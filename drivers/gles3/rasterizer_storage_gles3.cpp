@@ -566,6 +566,33 @@ void RasterizerStorageGLES3::texture_2d_update(RID p_texture, const Ref<Image> &
 	texture_set_data(p_texture, p_image);
 }
 
+void RasterizerStorageGLES3::texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	Texture *tex = texture_owner.get_or_null(p_texture);
+	if (tex && p_data) {
+		// no direct path yet, pack the rows into an image
+		int row_size = Image::get_image_data_size(tex->width, 1, p_format, false);
+		Vector<uint8_t> data;
+		data.resize(row_size * tex->height);
+		uint8_t *w = data.ptrw();
+		for (int y = 0; y < tex->height; y++) {
+			memcpy(w + y * row_size, p_data + y * p_row_pitch, row_size);
+		}
+		Ref<Image> image;
+		image.instantiate();
+		image->create(tex->width, tex->height, false, p_format, data);
+		texture_set_data(p_texture, image);
+	}
+
+	if (p_release) {
+		p_release(p_userdata);
+	}
+}
+
+void RasterizerStorageGLES3::texture_2d_update_raw_region(RID p_texture, const Rect2i &p_region, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	// no partial updates yet, the whole texture is updated
+	texture_2d_update_raw(p_texture, p_data, p_row_pitch, p_format, p_release, p_userdata);
+}
+
 void RasterizerStorageGLES3::texture_2d_placeholder_initialize(RID p_texture) {
 }
 
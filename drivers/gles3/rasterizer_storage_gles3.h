@@ -475,7 +475,18 @@ public:
 
 	void texture_2d_update(RID p_texture, const Ref<Image> &p_image, int p_layer = 0) override;
 	void texture_3d_update(RID p_texture, const Vector<Ref<Image>> &p_data) override {}
+	void texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) override;
+	void texture_2d_update_raw_region(RID p_texture, const Rect2i &p_region, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) override;
 	void texture_proxy_update(RID p_proxy, RID p_base) override {}
+	RID texture_2d_dmabuf_create(int p_fd, uint64_t p_offset, int p_width, int p_height, int p_row_pitch, Image::Format p_format) override { return RID(); }
+	void texture_2d_ycbcr_resolve(RID p_texture, RID p_ycbcr, RID p_cbcr, bool p_full_range) override {}
+
+	RID luma_pyramid_allocate() override { return RID(); }
+	void luma_pyramid_initialize(RID p_rid) override {}
+	void luma_pyramid_set_callback(RID p_pyramid, RS::LumaPyramidReadbackCallback p_callback, void *p_userdata) override {}
+	void luma_pyramid_add_readback(RID p_pyramid, int p_level, const Rect2i &p_region) override {}
+	void luma_pyramid_clear_readbacks(RID p_pyramid) override {}
+	void luma_pyramid_update(RID p_pyramid, RID p_texture, int64_t p_sequence) override {}
 
 	void texture_2d_placeholder_initialize(RID p_texture) override;
 	void texture_2d_layered_placeholder_initialize(RID p_texture, RenderingServer::TextureLayeredType p_layered_type) override;
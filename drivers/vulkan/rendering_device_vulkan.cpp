@@ -41,6 +41,10 @@
 #include "thirdparty/misc/smolv.h"
 #include "thirdparty/spirv-reflect/spirv_reflect.h"
 
+#ifdef UNIX_ENABLED
+#include <unistd.h>
+#endif
+
 //#define FORCE_FULL_BARRIER
 
 // Get the Vulkan object information and possible stage access types (bitwise OR'd with incoming values)
@@ -2039,12 +2043,220 @@ RID RenderingDeviceVulkan::texture_create(const TextureFormat &p_format, const T
 
 	if (p_data.size()) {
 		for (uint32_t i = 0; i < image_create_info.arrayLayers; i++) {
-			_texture_update(id, i, p_data[i], RD::BARRIER_MASK_ALL, true);
+			_texture_update(id, i, p_data[i].ptr(), p_data[i].size(), 0, RD::BARRIER_MASK_ALL, Rect2i(), nullptr, 0, true);
 		}
 	}
 	return id;
 }
 
+RID RenderingDeviceVulkan::texture_create_from_dmabuf(const TextureFormat &p_format, const TextureView &p_view, int p_fd, uint64_t p_offset, uint32_t p_row_pitch) {
+	_THREAD_SAFE_METHOD_
+
+#ifndef UNIX_ENABLED
+	return RID(); //dmabuf only exists on Linux
+#else
+	if (get_memory_fd_properties == nullptr) {
+		return RID(); //not supported, the caller is expected to fall back to uploading
+	}
+
+	ERR_FAIL_COND_V(p_fd < 0, RID());
+	ERR_FAIL_COND_V_MSG(p_format.texture_type != TEXTURE_TYPE_2D, RID(), "Only 2D textures can be created from a dmabuf.");
+	ERR_FAIL_COND_V_MSG(p_format.mipmaps != 1 || p_format.array_layers != 1 || p_format.samples != TEXTURE_SAMPLES_1, RID(),
+			"Textures created from a dmabuf can't have mipmaps, layers or multiple samples.");
+	ERR_FAIL_COND_V_MSG(p_format.usage_bits != TEXTURE_USAGE_SAMPLING_BIT, RID(), "Textures created from a dmabuf can only be sampled.");
+	ERR_FAIL_COND_V(p_format.width < 1 || p_format.height < 1, RID());
+	ERR_FAIL_INDEX_V(p_format.format, DATA_FORMAT_MAX, RID());
+	ERR_FAIL_INDEX_V(p_view.swizzle_r, TEXTURE_SWIZZLE_MAX, RID());
+	ERR_FAIL_INDEX_V(p_view.swizzle_g, TEXTURE_SWIZZLE_MAX, RID());
+	ERR_FAIL_INDEX_V(p_view.swizzle_b, TEXTURE_SWIZZLE_MAX, RID());
+	ERR_FAIL_INDEX_V(p_view.swizzle_a, TEXTURE_SWIZZLE_MAX, RID());
+
+	VkFormat vk_format = vulkan_formats[p_format.format];
+
+	{
+		// the memory is laid out by whoever exported it, so only linear tiling is possible
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(context->get_physical_device(), vk_format, &properties);
+		if (!(properties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+			return RID();
+		}
+	}
+
+	VkExternalMemoryImageCreateInfo external_create_info;
+	external_create_info.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO;
+	external_create_info.pNext = nullptr;
+	external_create_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+
+	VkImageCreateInfo image_create_info;
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.pNext = &external_create_info;
+	image_create_info.flags = 0;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = vk_format;
+	image_create_info.extent.width = p_format.width;
+	image_create_info.extent.height = p_format.height;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_LINEAR;
+	image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.queueFamilyIndexCount = 0;
+	image_create_info.pQueueFamilyIndices = nullptr;
+	// the exported buffer already holds data, so it must not be discarded by a layout transition
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+
+	Texture texture;
+
+	VkResult err = vkCreateImage(device, &image_create_info, nullptr, &texture.image);
+	ERR_FAIL_COND_V_MSG(err, RID(), "vkCreateImage failed with error " + itos(err) + ".");
+
+	{
+		// the rows must be where the exporter put them
+		VkImageSubresource subresource;
+		subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		subresource.mipLevel = 0;
+		subresource.arrayLayer = 0;
+		VkSubresourceLayout layout;
+		vkGetImageSubresourceLayout(device, texture.image, &subresource, &layout);
+		if (layout.offset != 0 || (p_row_pitch != 0 && layout.rowPitch != p_row_pitch)) {
+			vkDestroyImage(device, texture.image, nullptr);
+			return RID();
+		}
+	}
+
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements(device, texture.image, &memory_requirements);
+
+	VkMemoryFdPropertiesKHR fd_properties;
+	fd_properties.sType = VK_STRUCTURE_TYPE_MEMORY_FD_PROPERTIES_KHR;
+	fd_properties.pNext = nullptr;
+	err = get_memory_fd_properties(device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT, p_fd, &fd_properties);
+	if (err) {
+		vkDestroyImage(device, texture.image, nullptr);
+		return RID();
+	}
+
+	uint32_t memory_type_bits = memory_requirements.memoryTypeBits & fd_properties.memoryTypeBits;
+	uint64_t fd_size = lseek(p_fd, 0, SEEK_END);
+	if (memory_type_bits == 0 || (p_offset % memory_requirements.alignment) != 0 || fd_size == (uint64_t)-1 || p_offset + memory_requirements.size > fd_size) {
+		vkDestroyImage(device, texture.image, nullptr);
+		return RID();
+	}
+
+	// on success Vulkan owns the descriptor, so import a duplicate
+	int import_fd = dup(p_fd);
+	if (import_fd < 0) {
+		vkDestroyImage(device, texture.image, nullptr);
+		return RID();
+	}
+
+	VkImportMemoryFdInfoKHR import_info;
+	import_info.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR;
+	import_info.pNext = nullptr;
+	import_info.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+	import_info.fd = import_fd;
+
+	VkMemoryAllocateInfo allocate_info;
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.pNext = &import_info;
+	allocate_info.allocationSize = fd_size;
+	allocate_info.memoryTypeIndex = 0;
+	while (!(memory_type_bits & (1 << allocate_info.memoryTypeIndex))) {
+		allocate_info.memoryTypeIndex++;
+	}
+
+	err = vkAllocateMemory(device, &allocate_info, nullptr, &texture.imported_memory);
+	if (err) {
+		::close(import_fd);
+		vkDestroyImage(device, texture.image, nullptr);
+		return RID();
+	}
+
+	err = vkBindImageMemory(device, texture.image, texture.imported_memory, p_offset);
+	if (err) {
+		vkFreeMemory(device, texture.imported_memory, nullptr);
+		vkDestroyImage(device, texture.image, nullptr);
+		return RID();
+	}
+
+	texture.type = TEXTURE_TYPE_2D;
+	texture.format = p_format.format;
+	texture.width = p_format.width;
+	texture.height = p_format.height;
+	texture.depth = 1;
+	texture.layers = 1;
+	texture.mipmaps = 1;
+	texture.base_mipmap = 0;
+	texture.base_layer = 0;
+	texture.usage_flags = p_format.usage_bits;
+	texture.samples = TEXTURE_SAMPLES_1;
+	texture.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	texture.read_aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT;
+	texture.barrier_aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT;
+	texture.bound = false;
+
+	VkImageViewCreateInfo image_view_create_info;
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.pNext = nullptr;
+	image_view_create_info.flags = 0;
+	image_view_create_info.image = texture.image;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	image_view_create_info.format = vk_format;
+
+	static const VkComponentSwizzle component_swizzles[TEXTURE_SWIZZLE_MAX] = {
+		VK_COMPONENT_SWIZZLE_IDENTITY,
+		VK_COMPONENT_SWIZZLE_ZERO,
+		VK_COMPONENT_SWIZZLE_ONE,
+		VK_COMPONENT_SWIZZLE_R,
+		VK_COMPONENT_SWIZZLE_G,
+		VK_COMPONENT_SWIZZLE_B,
+		VK_COMPONENT_SWIZZLE_A
+	};
+
+	image_view_create_info.components.r = component_swizzles[p_view.swizzle_r];
+	image_view_create_info.components.g = component_swizzles[p_view.swizzle_g];
+	image_view_create_info.components.b = component_swizzles[p_view.swizzle_b];
+	image_view_create_info.components.a = component_swizzles[p_view.swizzle_a];
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_view_create_info.subresourceRange.baseMipLevel = 0;
+	image_view_create_info.subresourceRange.levelCount = 1;
+	image_view_create_info.subresourceRange.baseArrayLayer = 0;
+	image_view_create_info.subresourceRange.layerCount = 1;
+
+	err = vkCreateImageView(device, &image_view_create_info, nullptr, &texture.view);
+	if (err) {
+		vkFreeMemory(device, texture.imported_memory, nullptr);
+		vkDestroyImage(device, texture.image, nullptr);
+		ERR_FAIL_V_MSG(RID(), "vkCreateImageView failed with error " + itos(err) + ".");
+	}
+
+	//barrier to set layout, keeping what the exporter wrote
+	{
+		VkImageMemoryBarrier image_memory_barrier;
+		image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_memory_barrier.pNext = nullptr;
+		image_memory_barrier.srcAccessMask = 0;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+		image_memory_barrier.newLayout = texture.layout;
+		image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.image = texture.image;
+		image_memory_barrier.subresourceRange.aspectMask = texture.barrier_aspect_mask;
+		image_memory_barrier.subresourceRange.baseMipLevel = 0;
+		image_memory_barrier.subresourceRange.levelCount = 1;
+		image_memory_barrier.subresourceRange.baseArrayLayer = 0;
+		image_memory_barrier.subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(frames[frame].setup_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+	}
+
+	return texture_owner.make_rid(texture);
+#endif
+}
+
 RID RenderingDeviceVulkan::texture_create_shared(const TextureView &p_view, RID p_with_texture) {
 	_THREAD_SAFE_METHOD_
 
@@ -2290,10 +2502,17 @@ RID RenderingDeviceVulkan::texture_create_shared_from_slice(const TextureView &p
 }
 
 Error RenderingDeviceVulkan::texture_update(RID p_texture, uint32_t p_layer, const Vector<uint8_t> &p_data, uint32_t p_post_barrier) {
-	return _texture_update(p_texture, p_layer, p_data, p_post_barrier, false);
+	return _texture_update(p_texture, p_layer, p_data.ptr(), p_data.size(), 0, p_post_barrier, Rect2i(), nullptr, 0, false);
+}
+
+Error RenderingDeviceVulkan::texture_update_raw(RID p_texture, uint32_t p_layer, const uint8_t *p_data, uint32_t p_data_size, uint32_t p_row_pitch, uint32_t p_post_barrier, const Rect2i &p_region, TextureRowConversion p_convert, uint32_t p_source_pixel_size) {
+	ERR_FAIL_NULL_V(p_data, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V_MSG(p_convert && (p_row_pitch == 0 || p_source_pixel_size == 0), ERR_INVALID_PARAMETER,
+			"Converting texture updates requires a row pitch and the pixel size of the data.");
+	return _texture_update(p_texture, p_layer, p_data, p_data_size, p_row_pitch, p_post_barrier, p_region, p_convert, p_source_pixel_size, false);
 }
 
-Error RenderingDeviceVulkan::_texture_update(RID p_texture, uint32_t p_layer, const Vector<uint8_t> &p_data, uint32_t p_post_barrier, bool p_use_setup_queue) {
+Error RenderingDeviceVulkan::_texture_update(RID p_texture, uint32_t p_layer, const uint8_t *p_data, uint32_t p_data_size, uint32_t p_row_pitch, uint32_t p_post_barrier, const Rect2i &p_region, TextureRowConversion p_convert, uint32_t p_source_pixel_size, bool p_use_setup_queue) {
 	_THREAD_SAFE_METHOD_
 
 	ERR_FAIL_COND_V_MSG((draw_list || compute_list) && !p_use_setup_queue, ERR_INVALID_PARAMETER,
@@ -2331,12 +2550,37 @@ Error RenderingDeviceVulkan::_texture_update(RID p_texture, uint32_t p_layer, co
 		required_align *= 4;
 	}
 
-	ERR_FAIL_COND_V_MSG(required_size != (uint32_t)p_data.size(), ERR_INVALID_PARAMETER,
-			"Required size for texture update (" + itos(required_size) + ") does not match data supplied size (" + itos(p_data.size()) + ").");
+	if (p_row_pitch == 0) {
+		ERR_FAIL_COND_V_MSG(required_size != p_data_size, ERR_INVALID_PARAMETER,
+				"Required size for texture update (" + itos(required_size) + ") does not match data supplied size (" + itos(p_data_size) + ").");
+	} else {
+		// Rows with padding at the end, as handed out by video capture or decoders.
+		uint32_t block_w, block_h;
+		get_compressed_image_format_block_dimensions(texture->format, block_w, block_h);
+		ERR_FAIL_COND_V_MSG(block_w != 1 || block_h != 1 || texture->mipmaps != 1 || texture->depth != 1, ERR_INVALID_PARAMETER,
+				"A row pitch can only be used to update uncompressed 2D textures without mipmaps.");
+
+		uint32_t row_size = texture->width * (p_convert ? p_source_pixel_size : get_image_format_pixel_size(texture->format));
+		ERR_FAIL_COND_V_MSG(p_row_pitch < row_size, ERR_INVALID_PARAMETER,
+				"Row pitch for texture update (" + itos(p_row_pitch) + ") is smaller than a row of the texture (" + itos(row_size) + ").");
+		ERR_FAIL_COND_V_MSG(p_data_size < p_row_pitch * (texture->height - 1) + row_size, ERR_INVALID_PARAMETER,
+				"Data supplied for texture update (" + itos(p_data_size) + ") is too small for the texture with a row pitch of " + itos(p_row_pitch) + ".");
+	}
+
+	bool partial = !p_region.has_no_area();
+	if (partial) {
+		// Only the tiles within the region are copied, the rest of the texture keeps its contents.
+		uint32_t block_w, block_h;
+		get_compressed_image_format_block_dimensions(texture->format, block_w, block_h);
+		ERR_FAIL_COND_V_MSG(block_w != 1 || block_h != 1 || texture->mipmaps != 1 || texture->depth != 1, ERR_INVALID_PARAMETER,
+				"A region can only be updated in uncompressed 2D textures without mipmaps.");
+		ERR_FAIL_COND_V_MSG(!Rect2i(0, 0, texture->width, texture->height).encloses(p_region), ERR_INVALID_PARAMETER,
+				"Region for texture update is outside of the texture.");
+	}
 
 	uint32_t region_size = texture_upload_region_size_px;
 
-	const uint8_t *r = p_data.ptr();
+	const uint8_t *r = p_data;
 
 	VkCommandBuffer command_buffer = p_use_setup_queue ? frames[frame].setup_command_buffer : frames[frame].draw_command_buffer;
 
@@ -2378,13 +2622,20 @@ Error RenderingDeviceVulkan::_texture_update(RID p_texture, uint32_t p_layer, co
 
 			const uint8_t *read_ptr = read_ptr_mipmap + image_size * z / depth;
 
-			for (uint32_t x = 0; x < width; x += region_size) {
-				for (uint32_t y = 0; y < height; y += region_size) {
-					uint32_t region_w = MIN(region_size, width - x);
-					uint32_t region_h = MIN(region_size, height - y);
+			uint32_t from_x = partial ? p_region.position.x : 0;
+			uint32_t from_y = partial ? p_region.position.y : 0;
+			uint32_t to_x = partial ? p_region.get_end().x : width;
+			uint32_t to_y = partial ? p_region.get_end().y : height;
+			uint32_t logic_to_x = partial ? to_x : logic_width;
+			uint32_t logic_to_y = partial ? to_y : logic_height;
+
+			for (uint32_t x = from_x; x < to_x; x += region_size) {
+				for (uint32_t y = from_y; y < to_y; y += region_size) {
+					uint32_t region_w = MIN(region_size, to_x - x);
+					uint32_t region_h = MIN(region_size, to_y - y);
 
-					uint32_t region_logic_w = MIN(region_size, logic_width - x);
-					uint32_t region_logic_h = MIN(region_size, logic_height - y);
+					uint32_t region_logic_w = MIN(region_size, logic_to_x - x);
+					uint32_t region_logic_h = MIN(region_size, logic_to_y - y);
 
 					uint32_t pixel_size = get_image_format_pixel_size(texture->format);
 					uint32_t to_allocate = region_w * region_h * pixel_size;
@@ -2435,16 +2686,18 @@ Error RenderingDeviceVulkan::_texture_update(RID p_texture, uint32_t p_layer, co
 
 					} else {
 						//regular image (pixels)
-						//must copy a pixel region
-
-						for (uint32_t xr = 0; xr < region_w; xr++) {
-							for (uint32_t yr = 0; yr < region_h; yr++) {
-								uint32_t src_offset = ((yr + y) * width + xr + x) * pixel_size;
-								uint32_t dst_offset = (yr * region_w + xr) * pixel_size;
-								//copy block
-								for (uint32_t i = 0; i < pixel_size; i++) {
-									write_ptr[dst_offset + i] = read_ptr[src_offset + i];
-								}
+						//must copy a pixel region, row by row
+
+						uint32_t src_pitch = p_row_pitch ? p_row_pitch : width * pixel_size;
+						uint32_t src_pixel_size = p_convert ? p_source_pixel_size : pixel_size;
+						uint32_t region_pitch = region_w * pixel_size;
+						for (uint32_t yr = 0; yr < region_h; yr++) {
+							uint32_t src_offset = (yr + y) * src_pitch + x * src_pixel_size;
+							uint32_t dst_offset = yr * region_pitch;
+							if (p_convert) {
+								p_convert(read_ptr + src_offset, write_ptr + dst_offset, region_w);
+							} else {
+								memcpy(write_ptr + dst_offset, read_ptr + src_offset, region_pitch);
 							}
 						}
 					}
@@ -2936,6 +3189,102 @@ Error RenderingDeviceVulkan::texture_copy(RID p_from_texture, RID p_to_texture,
 	return OK;
 }
 
+Error RenderingDeviceVulkan::texture_copy_to_readback_buffer(RID p_texture, const Rect2i &p_region, RID p_buffer, uint32_t p_offset) {
+	_THREAD_SAFE_METHOD_
+
+	ERR_FAIL_COND_V_MSG(draw_list || compute_list, ERR_INVALID_PARAMETER,
+			"Copying textures is forbidden during creation of a draw or compute list");
+
+	Texture *src_tex = texture_owner.get_or_null(p_texture);
+	ERR_FAIL_COND_V(!src_tex, ERR_INVALID_PARAMETER);
+
+	ERR_FAIL_COND_V_MSG(src_tex->bound, ERR_INVALID_PARAMETER,
+			"Source texture can't be copied while a render pass that uses it is being created. Ensure render pass is finalized (and that it was created with RENDER_PASS_CONTENTS_FINISH) to unbind this texture.");
+	ERR_FAIL_COND_V_MSG(!(src_tex->usage_flags & TEXTURE_USAGE_CAN_COPY_FROM_BIT), ERR_INVALID_PARAMETER,
+			"Source texture requires the TEXTURE_USAGE_CAN_COPY_FROM_BIT in order to be retrieved.");
+	ERR_FAIL_COND_V_MSG(src_tex->read_aspect_mask != VK_IMAGE_ASPECT_COLOR_BIT || get_compressed_image_format_block_byte_size(src_tex->format) != 1, ERR_INVALID_PARAMETER,
+			"Only uncompressed color textures can be copied to a readback buffer.");
+
+	ERR_FAIL_COND_V(p_region.position.x < 0 || p_region.position.y < 0 || p_region.size.x <= 0 || p_region.size.y <= 0, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(uint32_t(p_region.position.x + p_region.size.x) > src_tex->width || uint32_t(p_region.position.y + p_region.size.y) > src_tex->height, ERR_INVALID_PARAMETER);
+
+	ReadbackBuffer *readback_buffer = readback_buffer_owner.get_or_null(p_buffer);
+	ERR_FAIL_COND_V(!readback_buffer, ERR_INVALID_PARAMETER);
+
+	uint32_t size = p_region.size.x * p_region.size.y * get_image_format_pixel_size(src_tex->format);
+	ERR_FAIL_COND_V_MSG(uint64_t(p_offset) + size > readback_buffer->buffer.size, ERR_INVALID_PARAMETER,
+			"Region doesn't fit into the readback buffer at offset " + itos(p_offset) + ".");
+
+	VkCommandBuffer command_buffer = frames[frame].draw_command_buffer;
+
+	{
+		VkImageMemoryBarrier image_memory_barrier;
+		image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_memory_barrier.pNext = nullptr;
+		image_memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		image_memory_barrier.oldLayout = src_tex->layout;
+		image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.image = src_tex->image;
+		image_memory_barrier.subresourceRange.aspectMask = src_tex->barrier_aspect_mask;
+		image_memory_barrier.subresourceRange.baseMipLevel = 0;
+		image_memory_barrier.subresourceRange.levelCount = 1;
+		image_memory_barrier.subresourceRange.baseArrayLayer = 0;
+		image_memory_barrier.subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+	}
+
+	{
+		VkBufferImageCopy buffer_image_copy;
+		buffer_image_copy.bufferOffset = p_offset;
+		buffer_image_copy.bufferRowLength = 0; // tightly packed
+		buffer_image_copy.bufferImageHeight = 0;
+		buffer_image_copy.imageSubresource.aspectMask = src_tex->read_aspect_mask;
+		buffer_image_copy.imageSubresource.mipLevel = 0;
+		buffer_image_copy.imageSubresource.baseArrayLayer = 0;
+		buffer_image_copy.imageSubresource.layerCount = 1;
+		buffer_image_copy.imageOffset.x = p_region.position.x;
+		buffer_image_copy.imageOffset.y = p_region.position.y;
+		buffer_image_copy.imageOffset.z = 0;
+		buffer_image_copy.imageExtent.width = p_region.size.x;
+		buffer_image_copy.imageExtent.height = p_region.size.y;
+		buffer_image_copy.imageExtent.depth = 1;
+
+		vkCmdCopyImageToBuffer(command_buffer, src_tex->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffer->buffer.buffer, 1, &buffer_image_copy);
+	}
+
+	{ //restore src
+		VkImageMemoryBarrier image_memory_barrier;
+		image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_memory_barrier.pNext = nullptr;
+		image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		image_memory_barrier.newLayout = src_tex->layout;
+		image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_memory_barrier.image = src_tex->image;
+		image_memory_barrier.subresourceRange.aspectMask = src_tex->barrier_aspect_mask;
+		image_memory_barrier.subresourceRange.baseMipLevel = 0;
+		image_memory_barrier.subresourceRange.levelCount = 1;
+		image_memory_barrier.subresourceRange.baseArrayLayer = 0;
+		image_memory_barrier.subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+	}
+
+	// make the copy visible to the host once the frame's fence signals
+	_buffer_memory_barrier(readback_buffer->buffer.buffer, p_offset, size, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT, true);
+
+	readback_buffer->copied_in_frame = frames_drawn;
+
+	return OK;
+}
+
 Error RenderingDeviceVulkan::texture_resolve_multisample(RID p_from_texture, RID p_to_texture, uint32_t p_post_barrier) {
 	_THREAD_SAFE_METHOD_
 
@@ -6118,6 +6467,54 @@ Vector<uint8_t> RenderingDeviceVulkan::buffer_get_data(RID p_buffer) {
 	return buffer_data;
 }
 
+RID RenderingDeviceVulkan::readback_buffer_create(uint32_t p_size_bytes) {
+	_THREAD_SAFE_METHOD_
+
+	ERR_FAIL_COND_V(p_size_bytes == 0, RID());
+
+	ReadbackBuffer readback_buffer;
+	// host visible and cached, the CPU reads it without another copy
+	Error err = _buffer_allocate(&readback_buffer.buffer, p_size_bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+	ERR_FAIL_COND_V(err != OK, RID());
+
+	return readback_buffer_owner.make_rid(readback_buffer);
+}
+
+bool RenderingDeviceVulkan::readback_buffer_is_ready(RID p_buffer) {
+	_THREAD_SAFE_METHOD_
+
+	ReadbackBuffer *readback_buffer = readback_buffer_owner.get_or_null(p_buffer);
+	ERR_FAIL_COND_V(!readback_buffer, false);
+
+	// the fence of a frame was waited for once its slot comes around again
+	return readback_buffer->copied_in_frame + frame_count <= frames_drawn;
+}
+
+Error RenderingDeviceVulkan::readback_buffer_get_data(RID p_buffer, uint32_t p_offset, uint32_t p_size, uint8_t *r_data) {
+	_THREAD_SAFE_METHOD_
+
+	ReadbackBuffer *readback_buffer = readback_buffer_owner.get_or_null(p_buffer);
+	ERR_FAIL_COND_V(!readback_buffer, ERR_INVALID_PARAMETER);
+	ERR_FAIL_NULL_V(r_data, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(uint64_t(p_offset) + p_size > readback_buffer->buffer.size, ERR_INVALID_PARAMETER);
+
+	if (readback_buffer->copied_in_frame + frame_count > frames_drawn) {
+		return ERR_BUSY; // never stall for it
+	}
+
+	void *buffer_mem;
+	VkResult vkerr = vmaMapMemory(allocator, readback_buffer->buffer.allocation, &buffer_mem);
+	ERR_FAIL_COND_V_MSG(vkerr, ERR_CANT_ACQUIRE_RESOURCE, "vmaMapMemory failed with error " + itos(vkerr) + ".");
+	// memory that isn't coherent has to be invalidated to see what the GPU wrote
+	vmaInvalidateAllocation(allocator, readback_buffer->buffer.allocation, p_offset, p_size);
+
+	memcpy(r_data, (const uint8_t *)buffer_mem + p_offset, p_size);
+
+	vmaUnmapMemory(allocator, readback_buffer->buffer.allocation);
+
+	return OK;
+}
+
 /*************************/
 /**** RENDER PIPELINE ****/
 /*************************/
@@ -8425,6 +8822,10 @@ void RenderingDeviceVulkan::_free_internal(RID p_id) {
 		Buffer *storage_buffer = storage_buffer_owner.get_or_null(p_id);
 		frames[frame].buffers_to_dispose_of.push_back(*storage_buffer);
 		storage_buffer_owner.free(p_id);
+	} else if (readback_buffer_owner.owns(p_id)) {
+		ReadbackBuffer *readback_buffer = readback_buffer_owner.get_or_null(p_id);
+		frames[frame].buffers_to_dispose_of.push_back(readback_buffer->buffer);
+		readback_buffer_owner.free(p_id);
 	} else if (uniform_set_owner.owns(p_id)) {
 		UniformSet *uniform_set = uniform_set_owner.get_or_null(p_id);
 		frames[frame].uniform_sets_to_dispose_of.push_back(*uniform_set);
@@ -8491,6 +8892,9 @@ void RenderingDeviceVulkan::set_resource_name(RID p_id, const String p_name) {
 	} else if (storage_buffer_owner.owns(p_id)) {
 		Buffer *storage_buffer = storage_buffer_owner.get_or_null(p_id);
 		context->set_object_name(VK_OBJECT_TYPE_BUFFER, uint64_t(storage_buffer->buffer), p_name);
+	} else if (readback_buffer_owner.owns(p_id)) {
+		ReadbackBuffer *readback_buffer = readback_buffer_owner.get_or_null(p_id);
+		context->set_object_name(VK_OBJECT_TYPE_BUFFER, uint64_t(readback_buffer->buffer.buffer), p_name);
 	} else if (uniform_set_owner.owns(p_id)) {
 		UniformSet *uniform_set = uniform_set_owner.get_or_null(p_id);
 		context->set_object_name(VK_OBJECT_TYPE_DESCRIPTOR_SET, uint64_t(uniform_set->descriptor_set), p_name);
@@ -8716,8 +9120,13 @@ void RenderingDeviceVulkan::_free_pending_resources(int p_frame) {
 		vkDestroyImageView(device, texture->view, nullptr);
 		if (texture->owner.is_null()) {
 			//actually owns the image and the allocation too
-			image_memory -= texture->allocation_info.size;
-			vmaDestroyImage(allocator, texture->image, texture->allocation);
+			if (texture->imported_memory != VK_NULL_HANDLE) {
+				vkDestroyImage(device, texture->image, nullptr);
+				vkFreeMemory(device, texture->imported_memory, nullptr);
+			} else {
+				image_memory -= texture->allocation_info.size;
+				vmaDestroyImage(allocator, texture->image, texture->allocation);
+			}
 		}
 		frames[p_frame].textures_to_dispose_of.pop_front();
 	}
@@ -8836,6 +9245,10 @@ void RenderingDeviceVulkan::initialize(VulkanContext *p_context, bool p_local_de
 	limits = p_context->get_device_limits();
 	max_timestamp_query_elements = 256;
 
+	if (p_context->is_external_memory_dma_buf_supported()) {
+		get_memory_fd_properties = (PFN_vkGetMemoryFdPropertiesKHR)vkGetDeviceProcAddr(device, "vkGetMemoryFdPropertiesKHR");
+	}
+
 	{ //initialize allocator
 
 		VmaAllocatorCreateInfo allocatorInfo;
@@ -9089,6 +9502,8 @@ uint64_t RenderingDeviceVulkan::get_driver_resource(DriverResource p_resource, R
 				buffer = &texture_buffer_owner.get_or_null(p_rid)->buffer;
 			} else if (storage_buffer_owner.owns(p_rid)) {
 				buffer = storage_buffer_owner.get_or_null(p_rid);
+			} else if (readback_buffer_owner.owns(p_rid)) {
+				buffer = &readback_buffer_owner.get_or_null(p_rid)->buffer;
 			}
 
 			ERR_FAIL_NULL_V(buffer, 0);
@@ -9258,6 +9673,7 @@ void RenderingDeviceVulkan::finalize() {
 	_free_rids(uniform_set_owner, "UniformSet");
 	_free_rids(texture_buffer_owner, "TextureBuffer");
 	_free_rids(storage_buffer_owner, "StorageBuffer");
+	_free_rids(readback_buffer_owner, "ReadbackBuffer");
 	_free_rids(uniform_buffer_owner, "UniformBuffer");
 	_free_rids(shader_owner, "Shader");
 	_free_rids(index_array_owner, "IndexArray");
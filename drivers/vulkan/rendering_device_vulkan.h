@@ -127,6 +127,7 @@ class RenderingDeviceVulkan : public RenderingDevice {
 		VkImage image = VK_NULL_HANDLE;
 		VmaAllocation allocation = nullptr;
 		VmaAllocationInfo allocation_info;
+		VkDeviceMemory imported_memory = VK_NULL_HANDLE; //set instead of allocation when wrapping external memory
 		VkImageView view = VK_NULL_HANDLE;
 
 		TextureType type;
@@ -159,8 +160,10 @@ class RenderingDeviceVulkan : public RenderingDevice {
 	RID_Owner<Texture, true> texture_owner;
 	uint32_t texture_upload_region_size_px = 0;
 
+	PFN_vkGetMemoryFdPropertiesKHR get_memory_fd_properties = nullptr; //only set when dmabuf import is supported
+
 	Vector<uint8_t> _texture_get_data_from_image(Texture *tex, VkImage p_image, VmaAllocation p_allocation, uint32_t p_layer, bool p_2d = false);
-	Error _texture_update(RID p_texture, uint32_t p_layer, const Vector<uint8_t> &p_data, uint32_t p_post_barrier, bool p_use_setup_queue);
+	Error _texture_update(RID p_texture, uint32_t p_layer, const uint8_t *p_data, uint32_t p_data_size, uint32_t p_row_pitch, uint32_t p_post_barrier, const Rect2i &p_region, TextureRowConversion p_convert, uint32_t p_source_pixel_size, bool p_use_setup_queue);
 
 	/*****************/
 	/**** SAMPLER ****/
@@ -711,6 +714,14 @@ class RenderingDeviceVulkan : public RenderingDevice {
 	RID_Owner<Buffer, true> uniform_buffer_owner;
 	RID_Owner<Buffer, true> storage_buffer_owner;
 
+	// written by the GPU for the CPU to read, see texture_copy_to_readback_buffer()
+	struct ReadbackBuffer {
+		Buffer buffer;
+		uint64_t copied_in_frame = 0; // frames_drawn when a copy into it was last recorded
+	};
+
+	RID_Owner<ReadbackBuffer, true> readback_buffer_owner;
+
 	//texture buffer needs a view
 	struct TextureBuffer {
 		Buffer buffer;
@@ -1036,9 +1047,11 @@ class RenderingDeviceVulkan : public RenderingDevice {
 public:
 	virtual RID texture_create(const TextureFormat &p_format, const TextureView &p_view, const Vector<Vector<uint8_t>> &p_data = Vector<Vector<uint8_t>>());
 	virtual RID texture_create_shared(const TextureView &p_view, RID p_with_texture);
+	virtual RID texture_create_from_dmabuf(const TextureFormat &p_format, const TextureView &p_view, int p_fd, uint64_t p_offset, uint32_t p_row_pitch);
 
 	virtual RID texture_create_shared_from_slice(const TextureView &p_view, RID p_with_texture, uint32_t p_layer, uint32_t p_mipmap, TextureSliceType p_slice_type = TEXTURE_SLICE_2D);
 	virtual Error texture_update(RID p_texture, uint32_t p_layer, const Vector<uint8_t> &p_data, uint32_t p_post_barrier = BARRIER_MASK_ALL);
+	virtual Error texture_update_raw(RID p_texture, uint32_t p_layer, const uint8_t *p_data, uint32_t p_data_size, uint32_t p_row_pitch, uint32_t p_post_barrier = BARRIER_MASK_ALL, const Rect2i &p_region = Rect2i(), TextureRowConversion p_convert = nullptr, uint32_t p_source_pixel_size = 0);
 	virtual Vector<uint8_t> texture_get_data(RID p_texture, uint32_t p_layer);
 
 	virtual bool texture_is_format_supported_for_usage(DataFormat p_format, uint32_t p_usage) const;
@@ -1049,6 +1062,7 @@ public:
 	virtual Error texture_copy(RID p_from_texture, RID p_to_texture, const Vector3 &p_from, const Vector3 &p_to, const Vector3 &p_size, uint32_t p_src_mipmap, uint32_t p_dst_mipmap, uint32_t p_src_layer, uint32_t p_dst_layer, uint32_t p_post_barrier = BARRIER_MASK_ALL);
 	virtual Error texture_clear(RID p_texture, const Color &p_color, uint32_t p_base_mipmap, uint32_t p_mipmaps, uint32_t p_base_layer, uint32_t p_layers, uint32_t p_post_barrier = BARRIER_MASK_ALL);
 	virtual Error texture_resolve_multisample(RID p_from_texture, RID p_to_texture, uint32_t p_post_barrier = BARRIER_MASK_ALL);
+	virtual Error texture_copy_to_readback_buffer(RID p_texture, const Rect2i &p_region, RID p_buffer, uint32_t p_offset);
 
 	/*********************/
 	/**** FRAMEBUFFER ****/
@@ -1112,6 +1126,10 @@ public:
 	virtual Error buffer_clear(RID p_buffer, uint32_t p_offset, uint32_t p_size, uint32_t p_post_barrier = BARRIER_MASK_ALL);
 	virtual Vector<uint8_t> buffer_get_data(RID p_buffer);
 
+	virtual RID readback_buffer_create(uint32_t p_size_bytes);
+	virtual bool readback_buffer_is_ready(RID p_buffer);
+	virtual Error readback_buffer_get_data(RID p_buffer, uint32_t p_offset, uint32_t p_size, uint8_t *r_data);
+
 	/*************************/
 	/**** RENDER PIPELINE ****/
 	/*************************/
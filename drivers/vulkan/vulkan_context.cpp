@@ -790,6 +790,34 @@ Error VulkanContext::_create_physical_device() {
 			}
 		}
 
+		{
+			// Importing dmabuf file descriptors (such as exported camera
+			// buffers) needs all three, they are only enabled together.
+			static const char *dmabuf_extensions[] = {
+				VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+				VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+				VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME
+			};
+			const uint32_t dmabuf_extension_count = sizeof(dmabuf_extensions) / sizeof(dmabuf_extensions[0]);
+
+			uint32_t found = 0;
+			for (uint32_t i = 0; i < dmabuf_extension_count; i++) {
+				for (uint32_t j = 0; j < device_extension_count; j++) {
+					if (!strcmp(dmabuf_extensions[i], device_extensions[j].extensionName)) {
+						found++;
+						break;
+					}
+				}
+			}
+
+			if (found == dmabuf_extension_count && enabled_extension_count + dmabuf_extension_count < MAX_EXTENSIONS) {
+				for (uint32_t i = 0; i < dmabuf_extension_count; i++) {
+					extension_names[enabled_extension_count++] = dmabuf_extensions[i];
+				}
+				VK_EXT_external_memory_dma_buf_enabled = true;
+			}
+		}
+
 		if (VK_KHR_incremental_present_enabled) {
 			// Even though the user "enabled" the extension via the command
 			// line, we must make sure that it's enumerated for use with the
@@ -156,6 +156,7 @@ private:
 
 	bool VK_KHR_incremental_present_enabled = true;
 	bool VK_GOOGLE_display_timing_enabled = true;
+	bool VK_EXT_external_memory_dma_buf_enabled = false;
 	uint32_t enabled_extension_count = 0;
 	const char *extension_names[MAX_EXTENSIONS];
 	bool enabled_debug_utils = false;
@@ -239,6 +240,7 @@ public:
 	uint32_t get_vulkan_minor() const { return vulkan_minor; };
 	SubgroupCapabilities get_subgroup_capabilities() const { return subgroup_capabilities; };
 	MultiviewCapabilities get_multiview_capabilities() const { return multiview_capabilities; };
+	bool is_external_memory_dma_buf_supported() const { return VK_EXT_external_memory_dma_buf_enabled; };
 
 	VkDevice get_device();
 	VkPhysicalDevice get_physical_device();
@@ -35,6 +35,7 @@
 #include "scene/main/node.h"
 #include "scene/main/scene_tree.h"
 #include "servers/audio_server.h"
+#include "servers/camera_server.h"
 #include "servers/physics_server_2d.h"
 #include "servers/physics_server_3d.h"
 #include "servers/rendering_server.h"
@@ -73,6 +74,9 @@ void Performance::_bind_methods() {
 	BIND_ENUM_CONSTANT(PHYSICS_3D_COLLISION_PAIRS);
 	BIND_ENUM_CONSTANT(PHYSICS_3D_ISLAND_COUNT);
 	BIND_ENUM_CONSTANT(AUDIO_OUTPUT_LATENCY);
+	BIND_ENUM_CONSTANT(CAMERA_FPS);
+	BIND_ENUM_CONSTANT(CAMERA_LATENCY);
+	BIND_ENUM_CONSTANT(CAMERA_DROPPED_FRAMES);
 
 	BIND_ENUM_CONSTANT(MONITOR_MAX);
 }
@@ -112,6 +116,9 @@ String Performance::get_monitor_name(Monitor p_monitor) const {
 		"physics_3d/collision_pairs",
 		"physics_3d/islands",
 		"audio/driver/output_latency",
+		"camera/fps",
+		"camera/latency",
+		"camera/dropped_frames",
 
 	};
 
@@ -166,6 +173,22 @@ double Performance::get_monitor(Monitor p_monitor) const {
 			return PhysicsServer3D::get_singleton()->get_process_info(PhysicsServer3D::INFO_ISLAND_COUNT);
 		case AUDIO_OUTPUT_LATENCY:
 			return AudioServer::get_singleton()->get_output_latency();
+		case CAMERA_FPS:
+		case CAMERA_LATENCY:
+		case CAMERA_DROPPED_FRAMES: {
+			double fps = 0.0;
+			double latency = 0.0;
+			uint64_t dropped_frames = 0;
+			if (CameraServer::get_singleton()) {
+				CameraServer::get_singleton()->get_frame_statistics(fps, latency, dropped_frames);
+			}
+			if (p_monitor == CAMERA_FPS) {
+				return fps;
+			} else if (p_monitor == CAMERA_LATENCY) {
+				return latency;
+			}
+			return dropped_frames;
+		}
 
 		default: {
 		}
@@ -201,6 +224,9 @@ Performance::MonitorType Performance::get_monitor_type(Monitor p_monitor) const
 		MONITOR_TYPE_QUANTITY,
 		MONITOR_TYPE_QUANTITY,
 		MONITOR_TYPE_TIME,
+		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_TIME,
+		MONITOR_TYPE_QUANTITY,
 
 	};
 
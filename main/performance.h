@@ -87,6 +87,9 @@ public:
 		PHYSICS_3D_ISLAND_COUNT,
 		//physics
 		AUDIO_OUTPUT_LATENCY,
+		CAMERA_FPS,
+		CAMERA_LATENCY,
+		CAMERA_DROPPED_FRAMES,
 		MONITOR_MAX
 	};
 
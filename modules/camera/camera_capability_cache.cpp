@@ -0,0 +1,146 @@
+/*************************************************************************/
+/*  camera_capability_cache.cpp                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_capability_cache.h"
+
+#include "core/io/dir_access.h"
+
+String CameraCapabilityCache::make_key(const std::string &p_dev_name, const struct v4l2_capability &p_cap, bool p_libv4l2, const std::vector<__u32> &p_formats) {
+	// the bus info tells devices of the same model apart, the driver version and
+	// capabilities change when the kernel or the firmware does
+	String key = vformat("%s|%s|%s|%s", String(p_dev_name.c_str()), String((const char *)p_cap.driver), String((const char *)p_cap.card), String((const char *)p_cap.bus_info));
+	key += vformat("|%x|%x|%x", (int64_t)p_cap.version, (int64_t)p_cap.capabilities, (int64_t)p_cap.device_caps);
+	// libv4l2 offers converted formats the device itself lacks, and a build without
+	// the jpg module can't take MJPEG, either picks a different mode
+	key += p_libv4l2 ? "|libv4l2" : "|raw";
+	for (size_t i = 0; i < p_formats.size(); i++) {
+		key += vformat("|%x", (int64_t)p_formats[i]);
+	}
+	// section names of the file can't hold every character a card name might
+	return key.md5_text();
+}
+
+void CameraCapabilityCache::load(const String &p_path) {
+	MutexLock lock(mutex);
+	path = p_path;
+	config.instantiate();
+	dirty = false;
+
+	Error err = config->load(path);
+	if (err != OK && err != ERR_FILE_NOT_FOUND && err != ERR_FILE_CANT_OPEN) {
+		// a damaged cache is probed again and rewritten
+		WARN_PRINT("Camera capability cache " + path + " can't be read, probing all cameras.");
+		config->clear();
+	} else if ((int)config->get_value("cache", "version", 0) != CACHE_VERSION) {
+		config->clear();
+	}
+}
+
+void CameraCapabilityCache::save() {
+	MutexLock lock(mutex);
+	if (!dirty || config.is_null() || path.is_empty()) {
+		return;
+	}
+
+	config->set_value("cache", "version", CACHE_VERSION);
+
+	DirAccessRef dir = DirAccess::create(DirAccess::ACCESS_FILESYSTEM);
+	if (dir->make_dir_recursive(path.get_base_dir()) != OK || config->save(path) != OK) {
+		WARN_PRINT("Camera capability cache " + path + " can't be written.");
+		return;
+	}
+	dirty = false;
+}
+
+bool CameraCapabilityCache::lookup(const String &p_key, Entry &r_entry) {
+	MutexLock lock(mutex);
+	if (config.is_null() || !config->has_section(p_key)) {
+		return false;
+	}
+
+	r_entry = Entry();
+	r_entry.usable = config->get_value(p_key, "usable", false);
+	if (!r_entry.usable) {
+		return true;
+	}
+
+	r_entry.io_type = config->get_value(p_key, "io_type", 0);
+	r_entry.pix.width = (int64_t)config->get_value(p_key, "width", 0);
+	r_entry.pix.height = (int64_t)config->get_value(p_key, "height", 0);
+	r_entry.pix.pixelformat = (int64_t)config->get_value(p_key, "pixelformat", 0);
+	r_entry.pix.field = (int64_t)config->get_value(p_key, "field", 0);
+	r_entry.pix.bytesperline = (int64_t)config->get_value(p_key, "bytesperline", 0);
+	r_entry.pix.sizeimage = (int64_t)config->get_value(p_key, "sizeimage", 0);
+	r_entry.pix.colorspace = (int64_t)config->get_value(p_key, "colorspace", 0);
+	r_entry.pix.ycbcr_enc = (int64_t)config->get_value(p_key, "ycbcr_enc", 0);
+	r_entry.pix.quantization = (int64_t)config->get_value(p_key, "quantization", 0);
+	r_entry.pix.xfer_func = (int64_t)config->get_value(p_key, "xfer_func", 0);
+	r_entry.buffer_size = (int64_t)config->get_value(p_key, "buffer_size", 0);
+
+	// entries from another version of the engine may lack what we need
+	return r_entry.pix.width > 0 && r_entry.pix.height > 0 && r_entry.pix.pixelformat != 0 && r_entry.buffer_size > 0;
+}
+
+void CameraCapabilityCache::erase(const String &p_key) {
+	MutexLock lock(mutex);
+	if (config.is_null() || !config->has_section(p_key)) {
+		return;
+	}
+
+	config->erase_section(p_key);
+	dirty = true;
+}
+
+void CameraCapabilityCache::store(const String &p_key, const Entry &p_entry) {
+	MutexLock lock(mutex);
+	if (config.is_null()) {
+		return;
+	}
+
+	if (config->has_section(p_key)) {
+		config->erase_section(p_key);
+	}
+	config->set_value(p_key, "usable", p_entry.usable);
+	if (p_entry.usable) {
+		config->set_value(p_key, "io_type", p_entry.io_type);
+		config->set_value(p_key, "width", (int64_t)p_entry.pix.width);
+		config->set_value(p_key, "height", (int64_t)p_entry.pix.height);
+		config->set_value(p_key, "pixelformat", (int64_t)p_entry.pix.pixelformat);
+		config->set_value(p_key, "field", (int64_t)p_entry.pix.field);
+		config->set_value(p_key, "bytesperline", (int64_t)p_entry.pix.bytesperline);
+		config->set_value(p_key, "sizeimage", (int64_t)p_entry.pix.sizeimage);
+		config->set_value(p_key, "colorspace", (int64_t)p_entry.pix.colorspace);
+		config->set_value(p_key, "ycbcr_enc", (int64_t)p_entry.pix.ycbcr_enc);
+		config->set_value(p_key, "quantization", (int64_t)p_entry.pix.quantization);
+		config->set_value(p_key, "xfer_func", (int64_t)p_entry.pix.xfer_func);
+		config->set_value(p_key, "buffer_size", (int64_t)p_entry.buffer_size);
+	}
+	dirty = true;
+}
@@ -0,0 +1,81 @@
+/*************************************************************************/
+/*  camera_capability_cache.h                                            */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_CAPABILITY_CACHE_H
+#define CAMERA_CAPABILITY_CACHE_H
+
+#include "core/io/config_file.h"
+#include "core/os/mutex.h"
+
+#include <linux/videodev2.h>
+#include <string>
+#include <vector>
+
+// Remembers what probing the V4L2 nodes found on earlier runs, so a warm start doesn't open
+// every node through libv4l2 and try its formats again. Entries are keyed by what
+// VIDIOC_QUERYCAP reports for the node, which changes along with the device behind it,
+// and by what decides which of its modes we pick.
+class CameraCapabilityCache {
+public:
+	struct Entry {
+		bool usable = false; // false for nodes that can't capture, such as metadata nodes
+		int io_type = 0; // an IOType
+		struct v4l2_pix_format pix = {};
+		unsigned int buffer_size = 0;
+	};
+
+private:
+	enum {
+		// entries of other versions are dropped, such as when more pixel formats became usable
+		CACHE_VERSION = 2,
+	};
+
+	Mutex mutex;
+	String path;
+	Ref<ConfigFile> config;
+	bool dirty = false;
+
+public:
+	// p_libv4l2 tells whether the node is opened through libv4l2, which converts formats, and
+	// p_formats are the pixel formats we can capture in, which depend on the modules built in.
+	static String make_key(const std::string &p_dev_name, const struct v4l2_capability &p_cap, bool p_libv4l2, const std::vector<__u32> &p_formats);
+
+	// Reads the entries saved at p_path, a missing file is an empty cache.
+	void load(const String &p_path);
+	// Writes the entries back if any changed since they were loaded.
+	void save();
+
+	bool lookup(const String &p_key, Entry &r_entry);
+	void store(const String &p_key, const Entry &p_entry);
+	// For entries the device doesn't agree with anymore, such as a format it no longer accepts.
+	void erase(const String &p_key);
+};
+
+#endif // CAMERA_CAPABILITY_CACHE_H
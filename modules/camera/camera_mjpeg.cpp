@@ -0,0 +1,285 @@
+/*************************************************************************/
+/*  camera_mjpeg.cpp                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_mjpeg.h"
+
+#include "core/os/os.h"
+
+#include <jpgd.h>
+#include <string.h>
+
+// Many UVC cameras leave out the huffman tables in their MJPEG frames
+// and expect the decoder to use the standard tables from the JPEG
+// specification (ITU T.81, Annex K.3).
+
+static const uint8_t default_dht[] = {
+	// DHT marker and the length of the segment without the marker
+	0xff, 0xc4, 0x01, 0xa2,
+	// DC luminance: table class and destination, the code counts per length, the values
+	0x00,
+	0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+	// DC chrominance: table class and destination, the code counts per length, the values
+	0x01,
+	0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+	// AC luminance: table class and destination, the code counts per length, the values
+	0x10,
+	0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7d,
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+	0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+	0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+	0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+	0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+	0xf9, 0xfa,
+	// AC chrominance: table class and destination, the code counts per length, the values
+	0x11,
+	0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77,
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+	0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+	0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+	0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+	0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+	0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+	0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+	0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+	0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+	0xf9, 0xfa,
+};
+static_assert(sizeof(default_dht) == 2 + 0x01a2, "The DHT length doesn't match the tables.");
+
+bool CameraMJPEGDecoder::_needs_dht(const uint8_t *p_data, int p_size, int &r_sos_offset) {
+	// walk the markers up to the start of scan
+	r_sos_offset = -1;
+	if (p_size < 4 || p_data[0] != 0xFF || p_data[1] != 0xD8) {
+		return false;
+	}
+	int pos = 2;
+	while (pos + 4 <= p_size) {
+		if (p_data[pos] != 0xFF) {
+			return false;
+		}
+		uint8_t marker = p_data[pos + 1];
+		if (marker == 0xFF) {
+			// fill byte
+			pos++;
+			continue;
+		}
+		if (marker == 0xC4) {
+			return false;
+		}
+		if (marker == 0xDA) {
+			r_sos_offset = pos;
+			return true;
+		}
+		pos += 2 + ((p_data[pos + 2] << 8) | p_data[pos + 3]);
+	}
+	return false;
+}
+
+bool CameraMJPEGDecoder::_decode(Worker *p_worker, int &r_width, int &r_height) {
+	const uint8_t *data = p_worker->src.ptr();
+	int size = p_worker->src.size();
+
+	int sos_offset;
+	if (_needs_dht(data, size, sos_offset)) {
+		p_worker->src_dht.resize(size + sizeof(default_dht));
+		uint8_t *w = p_worker->src_dht.ptrw();
+		memcpy(w, data, sos_offset);
+		memcpy(w + sos_offset, default_dht, sizeof(default_dht));
+		memcpy(w + sos_offset + sizeof(default_dht), data + sos_offset, size - sos_offset);
+		data = w;
+		size = p_worker->src_dht.size();
+	}
+
+	jpgd::jpeg_decoder_mem_stream mem_stream(data, size);
+	jpgd::jpeg_decoder decoder(&mem_stream);
+
+	if (decoder.get_error_code() != jpgd::JPGD_SUCCESS) {
+		return false;
+	}
+
+	const int comps = decoder.get_num_components();
+	if (comps != 1 && comps != 3) {
+		return false;
+	}
+
+	if (decoder.begin_decoding() != jpgd::JPGD_SUCCESS) {
+		return false;
+	}
+
+	r_width = decoder.get_width();
+	r_height = decoder.get_height();
+
+	// We keep the alpha channel jpgd gives us, so rows can be copied as is
+	// and the renderer doesn't need to expand RGB8 to RGBA8 again.
+	const int dst_bpl = r_width * 4;
+	p_worker->dst = feed->acquire_image(r_width, r_height, Image::FORMAT_RGBA8);
+	if (p_worker->dst.is_null()) {
+		return false;
+	}
+	uint8_t *dw = p_worker->dst->ptrw();
+
+	for (int y = 0; y < r_height; y++) {
+		const jpgd::uint8 *scan_line;
+		jpgd::uint scan_line_len;
+		if (decoder.decode((const void **)&scan_line, &scan_line_len) != jpgd::JPGD_SUCCESS) {
+			return false;
+		}
+
+		uint8_t *dst = dw + y * dst_bpl;
+		if (comps == 1) {
+			for (int x = 0; x < r_width; x++) {
+				dst[0] = scan_line[x];
+				dst[1] = scan_line[x];
+				dst[2] = scan_line[x];
+				dst[3] = 255;
+				dst += 4;
+			}
+		} else {
+			memcpy(dst, scan_line, dst_bpl);
+		}
+	}
+
+	return true;
+}
+
+void CameraMJPEGDecoder::_worker_thread(void *p_user) {
+	Worker *worker = static_cast<Worker *>(p_user);
+	CameraMJPEGDecoder *decoder = worker->decoder;
+
+	while (true) {
+		worker->start.wait();
+		if (worker->exit.is_set()) {
+			break;
+		}
+
+		int width = 0;
+		int height = 0;
+		if (decoder->_decode(worker, width, height)) {
+			MutexLock lock(decoder->publish_mutex);
+			if (worker->sequence > decoder->last_published) {
+				decoder->last_published = worker->sequence;
+
+				worker->timing.converted_usec = OS::get_singleton()->get_ticks_usec();
+				decoder->feed->set_frame_timing(worker->timing);
+				decoder->feed->set_RGB_img(worker->dst);
+			} else {
+				// a newer frame was already shown
+				decoder->dropped_frames.increment();
+				decoder->feed->report_skipped_frame();
+			}
+		} else {
+			decoder->dropped_frames.increment();
+			decoder->feed->report_skipped_frame();
+		}
+
+		// let the image go back to the pool once the feed is done with it
+		worker->dst.unref();
+		worker->busy.clear();
+	}
+}
+
+void CameraMJPEGDecoder::init(const Ref<CameraFeed> &p_feed, int p_worker_count) {
+	ERR_FAIL_COND(workers != nullptr);
+
+	if (p_worker_count < 0) {
+		// leave room for the capture and the main thread
+		p_worker_count = CLAMP(OS::get_singleton()->get_processor_count() / 2, 1, 4);
+	}
+
+	feed = p_feed;
+	next_sequence = 0;
+	last_published = 0;
+	dropped_frames.set(0);
+
+	worker_count = p_worker_count;
+	workers = memnew_arr(Worker, worker_count);
+
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].decoder = this;
+		workers[i].thread.start(&CameraMJPEGDecoder::_worker_thread, &workers[i]);
+	}
+}
+
+void CameraMJPEGDecoder::finish() {
+	if (workers == nullptr) {
+		return;
+	}
+
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].exit.set();
+		workers[i].start.post();
+	}
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].thread.wait_to_finish();
+	}
+
+	memdelete_arr(workers);
+	workers = nullptr;
+	worker_count = 0;
+	feed.unref();
+}
+
+bool CameraMJPEGDecoder::submit(const uint8_t *p_data, int p_size, const CameraFeed::FrameTiming &p_timing) {
+	ERR_FAIL_COND_V(workers == nullptr, false);
+
+	for (int i = 0; i < worker_count; i++) {
+		Worker &worker = workers[i];
+		if (worker.busy.is_set()) {
+			continue;
+		}
+
+		worker.busy.set();
+		worker.sequence = ++next_sequence;
+		worker.timing = p_timing;
+		if (worker.src.size() != p_size) {
+			worker.src.resize(p_size);
+		}
+		memcpy(worker.src.ptrw(), p_data, p_size);
+		worker.start.post();
+		return true;
+	}
+
+	// everybody is busy, don't queue up late frames
+	dropped_frames.increment();
+	feed->report_skipped_frame();
+	return false;
+}
+
+CameraMJPEGDecoder::~CameraMJPEGDecoder() {
+	finish();
+}
@@ -0,0 +1,93 @@
+/*************************************************************************/
+/*  camera_mjpeg.h                                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_MJPEG_H
+#define CAMERA_MJPEG_H
+
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+#include "servers/camera/camera_feed.h"
+
+// Decodes MJPEG frames on a small pool of worker threads.
+// Every worker decodes a whole frame, so throughput scales with the
+// number of workers while each frame is still decoded in one go.
+// If no worker is free when a frame arrives the frame is dropped,
+// and frames that finish after a newer frame was shown are dropped too.
+class CameraMJPEGDecoder {
+	struct Worker {
+		Thread thread;
+		Semaphore start;
+		SafeFlag busy;
+		SafeFlag exit;
+
+		uint64_t sequence = 0;
+		CameraFeed::FrameTiming timing;
+		Vector<uint8_t> src; // the compressed frame
+		Vector<uint8_t> src_dht; // the compressed frame with huffman tables added
+		Ref<Image> dst; // the decoded RGBA frame, from the feed's image pool
+
+		CameraMJPEGDecoder *decoder = nullptr;
+	};
+
+	Worker *workers = nullptr;
+	int worker_count = 0;
+
+	Ref<CameraFeed> feed;
+
+	// only touched by the thread submitting frames
+	uint64_t next_sequence = 0;
+
+	Mutex publish_mutex;
+	uint64_t last_published = 0;
+
+	SafeNumeric<uint32_t> dropped_frames;
+
+	static bool _needs_dht(const uint8_t *p_data, int p_size, int &r_sos_offset);
+
+	static void _worker_thread(void *p_user);
+	bool _decode(Worker *p_worker, int &r_width, int &r_height);
+
+public:
+	void init(const Ref<CameraFeed> &p_feed, int p_worker_count = -1);
+	void finish();
+
+	// Copies the frame and hands it to a free worker. Returns false if
+	// the frame was dropped because all workers are busy.
+	bool submit(const uint8_t *p_data, int p_size, const CameraFeed::FrameTiming &p_timing = CameraFeed::FrameTiming());
+
+	uint32_t get_dropped_frames() const { return dropped_frames.get(); }
+	bool is_initialized() const { return workers != nullptr; }
+
+	~CameraMJPEGDecoder();
+};
+
+#endif /* CAMERA_MJPEG_H */
@@ -41,9 +41,6 @@
 
 @interface MyCaptureSession : AVCaptureSession <AVCaptureVideoDataOutputSampleBufferDelegate> {
 	Ref<CameraFeed> feed;
-	size_t width[2];
-	size_t height[2];
-	Vector<uint8_t> img_data[2];
 
 	AVCaptureDeviceInput *input;
 	AVCaptureVideoDataOutput *output;
@@ -57,10 +54,6 @@
 	if (self = [super init]) {
 		NSError *error;
 		feed = p_feed;
-		width[0] = 0;
-		height[0] = 0;
-		width[1] = 0;
-		height[1] = 0;
 
 		[self beginConfiguration];
 
@@ -149,45 +142,31 @@
 	} else {
 		Ref<Image> img[2];
 
-		{
-			// do Y
-			size_t new_width = CVPixelBufferGetWidthOfPlane(pixelBuffer, 0);
-			size_t new_height = CVPixelBufferGetHeightOfPlane(pixelBuffer, 0);
+		for (int i = 0; i < 2; i++) {
+			// Y is R8, CbCr is RG8 at half the resolution
+			size_t plane_width = CVPixelBufferGetWidthOfPlane(pixelBuffer, i);
+			size_t plane_height = CVPixelBufferGetHeightOfPlane(pixelBuffer, i);
+			size_t bytes_per_row = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, i);
+			size_t row_size = plane_width * (i + 1);
 
-			if ((width[0] != new_width) || (height[0] != new_height)) {
-				width[0] = new_width;
-				height[0] = new_height;
-				img_data[0].resize(new_width * new_height);
+			///TODO OpenGL doesn't support FORMAT_RG8, need to do some form of conversion
+			img[i] = feed->acquire_image(plane_width, plane_height, i == 0 ? Image::FORMAT_R8 : Image::FORMAT_RG8);
+			if (img[i].is_null()) {
+				break;
 			}
 
-			uint8_t *w = img_data[0].ptrw();
-			memcpy(w, dataY, new_width * new_height);
-
-			img[0].instantiate();
-			img[0]->create(new_width, new_height, 0, Image::FORMAT_R8, img_data[0]);
-		}
-
-		{
-			// do CbCr
-			size_t new_width = CVPixelBufferGetWidthOfPlane(pixelBuffer, 1);
-			size_t new_height = CVPixelBufferGetHeightOfPlane(pixelBuffer, 1);
-
-			if ((width[1] != new_width) || (height[1] != new_height)) {
-				width[1] = new_width;
-				height[1] = new_height;
-				img_data[1].resize(2 * new_width * new_height);
+			// rows may be padded, so copy them one by one
+			const uint8_t *r = i == 0 ? dataY : dataCbCr;
+			uint8_t *w = img[i]->ptrw();
+			for (size_t y = 0; y < plane_height; y++) {
+				memcpy(w + y * row_size, r + y * bytes_per_row, row_size);
 			}
-
-			uint8_t *w = img_data[1].ptrw();
-			memcpy(w, dataCbCr, 2 * new_width * new_height);
-
-			///TODO OpenGL doesn't support FORMAT_RG8, need to do some form of conversion
-			img[1].instantiate();
-			img[1]->create(new_width, new_height, 0, Image::FORMAT_RG8, img_data[1]);
 		}
 
 		// set our texture...
-		feed->set_YCbCr_imgs(img[0], img[1]);
+		if (img[0].is_valid() && img[1].is_valid()) {
+			feed->set_YCbCr_imgs(img[0], img[1]);
+		}
 	}
 
 	// and unlock
@@ -223,6 +202,8 @@ AVCaptureDevice *CameraFeedOSX::get_device() const {
 CameraFeedOSX::CameraFeedOSX() {
 	device = nullptr;
 	capture_session = nullptr;
+	// we ask for kCVPixelFormatType_420YpCbCr8BiPlanarFullRange
+	ycbcr_full_range = true;
 };
 
 void CameraFeedOSX::set_device(AVCaptureDevice *p_device) {
@@ -241,6 +222,8 @@ void CameraFeedOSX::set_device(AVCaptureDevice *p_device) {
 };
 
 CameraFeedOSX::~CameraFeedOSX() {
+	wait_for_activation();
+
 	if (capture_session != nullptr) {
 		[capture_session release];
 		capture_session = nullptr;
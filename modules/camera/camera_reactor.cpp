@@ -0,0 +1,333 @@
+/*************************************************************************/
+/*  camera_reactor.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_reactor.h"
+
+#include "camera_x11.h"
+#include "core/os/os.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+void CameraCaptureReactor::init(int p_worker_count) {
+	ERR_FAIL_COND(workers != nullptr);
+
+	if (p_worker_count < 0) {
+		// one thread keeps up with several cameras, add more for big setups
+		p_worker_count = CLAMP(OS::get_singleton()->get_processor_count() / 4, 1, 4);
+	}
+
+	worker_count = p_worker_count;
+	workers = memnew_arr(Worker, worker_count);
+
+	for (int i = 0; i < worker_count; i++) {
+		Worker &worker = workers[i];
+		worker.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		worker.wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		ERR_CONTINUE_MSG(worker.epoll_fd == -1 || worker.wake_fd == -1, "Can't create the camera capture reactor.");
+
+		struct epoll_event event;
+		event.events = EPOLLIN;
+		event.data.ptr = nullptr; // the wake-up descriptor
+		epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, worker.wake_fd, &event);
+
+		worker.thread.start(&CameraCaptureReactor::_worker_thread, &worker);
+	}
+}
+
+void CameraCaptureReactor::finish() {
+	if (workers == nullptr) {
+		return;
+	}
+
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].exit.set();
+		_wake(&workers[i]);
+	}
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].thread.wait_to_finish();
+		if (workers[i].epoll_fd != -1) {
+			::close(workers[i].epoll_fd);
+		}
+		if (workers[i].wake_fd != -1) {
+			::close(workers[i].wake_fd);
+		}
+	}
+
+	memdelete_arr(workers);
+	workers = nullptr;
+	worker_count = 0;
+}
+
+void CameraCaptureReactor::add_device(V4l2_Device *p_device) {
+	ERR_FAIL_COND(workers == nullptr);
+
+	// the worker with the fewest devices gets the new one
+	Worker *worker = &workers[0];
+	for (int i = 1; i < worker_count; i++) {
+		if (workers[i].device_count.get() < worker->device_count.get()) {
+			worker = &workers[i];
+		}
+	}
+
+	MutexLock lock(worker->mutex);
+	ERR_FAIL_COND(_find_entry(worker, p_device) != -1);
+
+	Entry entry;
+	entry.device = p_device;
+	entry.fd = p_device->get_fd();
+	entry.last_frame_usec = OS::get_singleton()->get_ticks_usec();
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = p_device;
+	if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, entry.fd, &event) == -1) {
+		// let the worker reopen it
+		entry.fd = -1;
+		entry.failed = true;
+	}
+
+	worker->entries.push_back(entry);
+	worker->device_count.increment();
+	_wake(worker);
+}
+
+void CameraCaptureReactor::remove_device(V4l2_Device *p_device) {
+	if (workers == nullptr) {
+		return;
+	}
+
+	for (int i = 0; i < worker_count; i++) {
+		Worker *worker = &workers[i];
+		MutexLock lock(worker->mutex);
+		int idx = _find_entry(worker, p_device);
+		while (idx != -1 && worker->entries[idx].restarting) {
+			// the worker is reopening it without the lock, the device can't be stopped before that's done
+			worker->restart_waiters++;
+			worker->mutex.unlock();
+			worker->restart_done.wait();
+			worker->mutex.lock();
+			idx = _find_entry(worker, p_device);
+		}
+		if (idx == -1) {
+			continue;
+		}
+
+		if (worker->entries[idx].fd != -1) {
+			epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, worker->entries[idx].fd, nullptr);
+		}
+		worker->entries.remove(idx);
+		worker->device_count.decrement();
+		return;
+	}
+}
+
+int CameraCaptureReactor::_find_entry(Worker *p_worker, V4l2_Device *p_device) {
+	for (int i = 0; i < p_worker->entries.size(); i++) {
+		if (p_worker->entries[i].device == p_device) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void CameraCaptureReactor::_wake(Worker *p_worker) {
+	if (p_worker->wake_fd != -1) {
+		uint64_t one = 1;
+		if (write(p_worker->wake_fd, &one, sizeof(one)) == -1) {
+			// the counter is already set, the worker wakes up anyway
+		}
+	}
+}
+
+int CameraCaptureReactor::_get_timeout_msec(Worker *p_worker, uint64_t p_now) {
+	uint64_t next = UINT64_MAX;
+	for (int i = 0; i < p_worker->entries.size(); i++) {
+		const Entry &entry = p_worker->entries[i];
+		if (entry.failed || entry.starved) {
+			next = MIN(next, entry.retry_usec);
+		} else {
+			next = MIN(next, entry.last_frame_usec + STALL_TIMEOUT_USEC);
+		}
+	}
+
+	if (next == UINT64_MAX) {
+		return -1; // nothing to time out, wait for frames or changes
+	}
+	if (next <= p_now) {
+		return 0;
+	}
+	// round up, so we don't wake up just before the deadline
+	return (next - p_now + 999) / 1000;
+}
+
+void CameraCaptureReactor::_fail_entry(Worker *p_worker, Entry &p_entry, uint64_t p_now) {
+	if (p_entry.fd != -1) {
+		epoll_ctl(p_worker->epoll_fd, EPOLL_CTL_DEL, p_entry.fd, nullptr);
+		p_entry.fd = -1;
+	}
+	p_entry.failed = true;
+	p_entry.starved = false;
+	p_entry.retry_usec = p_now + p_entry.backoff_usec;
+	print_verbose("Camera " + p_entry.device->name + " stopped delivering frames, reopening it.");
+}
+
+void CameraCaptureReactor::_process_entry(Worker *p_worker, Entry &p_entry, uint32_t p_events, uint64_t p_now) {
+	Error err = p_entry.device->read_frame();
+	if (err == OK) {
+		p_entry.last_frame_usec = p_now;
+		p_entry.backoff_usec = RETRY_MIN_USEC;
+	} else if (err == ERR_BUSY) {
+		if (p_events & (EPOLLERR | EPOLLIN)) {
+			// V4L2 reports an error while no buffer is queued, which happens when
+			// the renderer still holds all of them. A device may also leave a frame
+			// with the driver until the feed took the last one. Don't spin on it, check back shortly.
+			struct epoll_event event;
+			event.events = 0;
+			event.data.ptr = p_entry.device;
+			epoll_ctl(p_worker->epoll_fd, EPOLL_CTL_MOD, p_entry.fd, &event);
+			p_entry.starved = true;
+			p_entry.retry_usec = p_now + STARVED_USEC;
+			p_entry.last_frame_usec = p_now;
+		}
+	} else {
+		_fail_entry(p_worker, p_entry, p_now);
+	}
+}
+
+void CameraCaptureReactor::_update_timers(Worker *p_worker, uint64_t p_now) {
+	for (int i = 0; i < p_worker->entries.size(); i++) {
+		Entry &entry = p_worker->entries.write[i];
+
+		if (entry.starved) {
+			if (p_now >= entry.retry_usec) {
+				struct epoll_event event;
+				event.events = EPOLLIN;
+				event.data.ptr = entry.device;
+				epoll_ctl(p_worker->epoll_fd, EPOLL_CTL_MOD, entry.fd, &event);
+				entry.starved = false;
+				entry.last_frame_usec = p_now;
+			}
+		} else if (entry.failed) {
+			if (p_now < entry.retry_usec) {
+				continue;
+			}
+
+			// Reopening probes the device and waits for the renderer to let go of its frames.
+			// The other devices of this worker keep capturing meanwhile, remove_device() waits for it.
+			V4l2_Device *device = entry.device;
+			entry.restarting = true;
+			p_worker->mutex.unlock();
+			bool restarted = device->restart();
+			p_worker->mutex.lock();
+			uint64_t now = OS::get_singleton()->get_ticks_usec();
+
+			// other devices may have come and gone, ours is still there
+			i = _find_entry(p_worker, device);
+			ERR_FAIL_COND(i == -1);
+			Entry &restarted_entry = p_worker->entries.write[i];
+			restarted_entry.restarting = false;
+			while (p_worker->restart_waiters > 0) {
+				p_worker->restart_waiters--;
+				p_worker->restart_done.post();
+			}
+
+			if (restarted) {
+				struct epoll_event event;
+				event.events = EPOLLIN;
+				event.data.ptr = device;
+				restarted_entry.fd = device->get_fd();
+				if (epoll_ctl(p_worker->epoll_fd, EPOLL_CTL_ADD, restarted_entry.fd, &event) != -1) {
+					restarted_entry.failed = false;
+					restarted_entry.last_frame_usec = now;
+					print_verbose("Camera " + device->name + " reopened.");
+					continue;
+				}
+				restarted_entry.fd = -1;
+			}
+
+			restarted_entry.backoff_usec = MIN(restarted_entry.backoff_usec * 2, (uint64_t)RETRY_MAX_USEC);
+			restarted_entry.retry_usec = now + restarted_entry.backoff_usec;
+		} else if (p_now - entry.last_frame_usec >= STALL_TIMEOUT_USEC) {
+			_fail_entry(p_worker, entry, p_now);
+		}
+	}
+}
+
+void CameraCaptureReactor::_worker_thread(void *p_user) {
+	Worker *worker = (Worker *)p_user;
+	struct epoll_event events[MAX_EVENTS];
+
+	while (!worker->exit.is_set()) {
+		int timeout;
+		{
+			MutexLock lock(worker->mutex);
+			timeout = _get_timeout_msec(worker, OS::get_singleton()->get_ticks_usec());
+		}
+
+		int count = epoll_wait(worker->epoll_fd, events, MAX_EVENTS, timeout);
+		if (count == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ERR_PRINT("Camera capture reactor failed to wait for frames.");
+			break;
+		}
+
+		MutexLock lock(worker->mutex);
+		uint64_t now = OS::get_singleton()->get_ticks_usec();
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.ptr == nullptr) {
+				uint64_t value;
+				if (read(worker->wake_fd, &value, sizeof(value)) == -1) {
+					// nothing pending anymore
+				}
+				continue;
+			}
+
+			// the device may have been removed while we were waiting
+			int idx = _find_entry(worker, (V4l2_Device *)events[i].data.ptr);
+			if (idx == -1 || worker->entries[idx].fd == -1 || worker->entries[idx].starved) {
+				continue;
+			}
+
+			_process_entry(worker, worker->entries.write[idx], events[i].events, now);
+		}
+
+		_update_timers(worker, now);
+	}
+}
+
+CameraCaptureReactor::~CameraCaptureReactor() {
+	finish();
+}
@@ -0,0 +1,106 @@
+/*************************************************************************/
+/*  camera_reactor.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_REACTOR_H
+#define CAMERA_REACTOR_H
+
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/vector.h"
+
+class V4l2_Device;
+
+// Captures frames for all streaming V4L2 devices on a small, fixed pool of
+// threads. Each thread waits on the file descriptors of its devices with
+// epoll, so an idle device costs no wake-ups and many cameras don't need
+// a thread each. A device that fails or stops delivering frames is
+// reopened with an increasing delay until it works again or is removed.
+class CameraCaptureReactor {
+	enum {
+		MAX_EVENTS = 16,
+		STALL_TIMEOUT_USEC = 2000000, // no frame for this long and the device is restarted
+		RETRY_MIN_USEC = 250000,
+		RETRY_MAX_USEC = 8000000,
+		STARVED_USEC = 2000 // all buffers are held by the renderer or the feed is full, check again after this
+	};
+
+	struct Entry {
+		V4l2_Device *device = nullptr;
+		int fd = -1; // the descriptor registered with epoll, -1 while failed
+		uint64_t last_frame_usec = 0;
+		uint64_t retry_usec = 0; // when to reopen a failed device or rearm a starved one
+		uint64_t backoff_usec = RETRY_MIN_USEC;
+		bool failed = false;
+		bool starved = false;
+		bool restarting = false; // reopened by the worker without holding its mutex
+	};
+
+	struct Worker {
+		Thread thread;
+		SafeFlag exit;
+		int epoll_fd = -1;
+		int wake_fd = -1; // eventfd that interrupts epoll_wait when devices change
+
+		// held while frames are captured, so removing a device waits for its frame to finish
+		Mutex mutex;
+		Vector<Entry> entries;
+		SafeNumeric<uint32_t> device_count; // read by add_device() without the mutex
+
+		// removing a device that is being reopened waits for this, guarded by mutex
+		Semaphore restart_done;
+		int restart_waiters = 0;
+	};
+
+	Worker *workers = nullptr;
+	int worker_count = 0;
+
+	static void _worker_thread(void *p_user);
+	static int _find_entry(Worker *p_worker, V4l2_Device *p_device);
+	static int _get_timeout_msec(Worker *p_worker, uint64_t p_now);
+	static void _process_entry(Worker *p_worker, Entry &p_entry, uint32_t p_events, uint64_t p_now);
+	static void _update_timers(Worker *p_worker, uint64_t p_now);
+	static void _fail_entry(Worker *p_worker, Entry &p_entry, uint64_t p_now);
+	static void _wake(Worker *p_worker);
+
+public:
+	void init(int p_worker_count = -1);
+	void finish();
+
+	// The device must be streaming. Once remove_device returns the device
+	// is no longer touched by the reactor.
+	void add_device(V4l2_Device *p_device);
+	void remove_device(V4l2_Device *p_device);
+
+	~CameraCaptureReactor();
+};
+
+#endif /* CAMERA_REACTOR_H */
@@ -0,0 +1,827 @@
+/*************************************************************************/
+/*  camera_virtual.cpp                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_virtual.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/io/image_loader.h"
+#include "core/io/yuv_converter.h"
+#include "core/os/os.h"
+
+//////////////////////////////////////////////////////////////////////////
+// CameraFeedVirtual - A feed that generates its frames or reads them from files
+
+static const char *pixel_format_names[CameraFeedVirtual::PIXEL_FORMAT_MAX] = { "RGB3", "NV12", "YUYV" };
+
+// BT.601 limited range, what the YCbCr conversions assume for cameras
+static _FORCE_INLINE_ void _rgb_to_ycbcr(const uint8_t *p_rgb, int &r_y, int &r_cb, int &r_cr) {
+	int r = p_rgb[0];
+	int g = p_rgb[1];
+	int b = p_rgb[2];
+	r_y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+	r_cb = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+	r_cr = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static void _rotate_row(const uint8_t *p_src, uint8_t *p_dst, int p_size, int p_shift) {
+	memcpy(p_dst, p_src + p_shift, p_size - p_shift);
+	memcpy(p_dst + p_size - p_shift, p_src, p_shift);
+}
+
+static Dictionary _make_format(int p_width, int p_height, const String &p_pixel_format, float p_fps) {
+	Dictionary format;
+	format["width"] = p_width;
+	format["height"] = p_height;
+	format["pixel_format"] = p_pixel_format;
+	format["fps"] = p_fps;
+	return format;
+}
+
+CameraFeedVirtual::PixelFormat CameraFeedVirtual::pixel_format_from_string(const String &p_pixel_format) {
+	for (int i = 0; i < PIXEL_FORMAT_MAX; i++) {
+		if (p_pixel_format == pixel_format_names[i]) {
+			return PixelFormat(i);
+		}
+	}
+	return PIXEL_FORMAT_MAX;
+}
+
+String CameraFeedVirtual::pixel_format_to_string(PixelFormat p_pixel_format) {
+	ERR_FAIL_INDEX_V(p_pixel_format, PIXEL_FORMAT_MAX, String());
+	return pixel_format_names[p_pixel_format];
+}
+
+void CameraFeedVirtual::set_source(const String &p_path) {
+	source_path = p_path;
+
+	String extension = p_path.get_extension().to_lower();
+	if (p_path.is_empty()) {
+		source = SOURCE_PATTERN;
+	} else if (extension == "y4m") {
+		source = SOURCE_Y4M;
+	} else if (extension == "yuv") {
+		source = SOURCE_RAW_I420;
+	} else {
+		source = SOURCE_IMAGES;
+	}
+}
+
+String CameraFeedVirtual::get_source() const {
+	return source_path;
+}
+
+void CameraFeedVirtual::set_loop(bool p_loop) {
+	loop = p_loop;
+}
+
+int CameraFeedVirtual::_get_cbcr_height() const {
+	return pixel_format == PIXEL_FORMAT_NV12 ? (height + 1) / 2 : height;
+}
+
+int CameraFeedVirtual::_get_frame_size() const {
+	if (pixel_format == PIXEL_FORMAT_RGB3) {
+		return width * height * 3;
+	}
+	return width * height + ((width + 1) / 2) * _get_cbcr_height() * 2;
+}
+
+bool CameraFeedVirtual::_open_source() {
+	switch (source) {
+		case SOURCE_PATTERN: {
+			_build_pattern();
+			return true;
+		}
+		case SOURCE_IMAGES: {
+			return _load_images();
+		}
+		case SOURCE_Y4M:
+		case SOURCE_RAW_I420: {
+			file = FileAccess::open(source_path, FileAccess::READ);
+			ERR_FAIL_COND_V_MSG(!file, false, "Can't open camera source \"" + source_path + "\".");
+
+			if (source == SOURCE_Y4M) {
+				if (!_open_y4m()) {
+					_close_source();
+					return false;
+				}
+			} else {
+				// raw files have no header, the frames are as large as configured
+				file_chroma_shift_x = 1;
+				file_chroma_shift_y = 1;
+				file_data_offset = 0;
+			}
+
+			int cbcr_size = 0;
+			if (file_chroma_shift_x >= 0) {
+				int cbcr_width = (width + (1 << file_chroma_shift_x) - 1) >> file_chroma_shift_x;
+				int cbcr_height = (height + (1 << file_chroma_shift_y) - 1) >> file_chroma_shift_y;
+				cbcr_size = cbcr_width * cbcr_height;
+			}
+			file_frame.resize(width * height + cbcr_size * 2);
+			if (pixel_format == PIXEL_FORMAT_RGB3) {
+				rgba_frame.resize(width * height * 4);
+			}
+			file_next_frame = 0;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CameraFeedVirtual::_close_source() {
+	if (file) {
+		memdelete(file);
+		file = nullptr;
+	}
+	stills.clear();
+	file_frame.clear();
+	rgba_frame.clear();
+}
+
+bool CameraFeedVirtual::_open_y4m() {
+	// a single line such as "YUV4MPEG2 W640 H480 F30:1 Ip A1:1 C420jpeg"
+	Vector<String> tokens = file->get_line().split(" ", false);
+	ERR_FAIL_COND_V_MSG(tokens.is_empty() || tokens[0] != "YUV4MPEG2", false, "\"" + source_path + "\" is not a YUV4MPEG2 file.");
+
+	int file_width = 0;
+	int file_height = 0;
+	file_chroma_shift_x = 1;
+	file_chroma_shift_y = 1;
+
+	for (int i = 1; i < tokens.size(); i++) {
+		String value = tokens[i].substr(1);
+		switch (tokens[i][0]) {
+			case 'W': {
+				file_width = value.to_int();
+			} break;
+			case 'H': {
+				file_height = value.to_int();
+			} break;
+			case 'F': {
+				Vector<String> rate = value.split(":");
+				if (rate.size() == 2 && rate[0].to_int() > 0 && rate[1].to_int() > 0) {
+					fps_numerator = rate[0].to_int();
+					fps_denominator = rate[1].to_int();
+				}
+			} break;
+			case 'C': {
+				if (value.begins_with("420")) {
+					file_chroma_shift_x = 1;
+					file_chroma_shift_y = 1;
+				} else if (value == "422") {
+					file_chroma_shift_x = 1;
+					file_chroma_shift_y = 0;
+				} else if (value == "444") {
+					file_chroma_shift_x = 0;
+					file_chroma_shift_y = 0;
+				} else if (value == "mono") {
+					file_chroma_shift_x = -1;
+					file_chroma_shift_y = -1;
+				} else {
+					ERR_FAIL_V_MSG(false, "Unsupported YUV4MPEG2 color space \"" + value + "\" in \"" + source_path + "\".");
+				}
+			} break;
+			default:
+				break;
+		}
+	}
+
+	ERR_FAIL_COND_V_MSG(file_width <= 0 || file_height <= 0, false, "\"" + source_path + "\" has no frame size.");
+	width = file_width;
+	height = file_height;
+	file_data_offset = file->get_position();
+	return true;
+}
+
+bool CameraFeedVirtual::_load_images() {
+	Vector<String> paths;
+
+	DirAccess *dir = DirAccess::open(source_path);
+	if (dir) {
+		List<String> extensions;
+		ImageLoader::get_recognized_extensions(&extensions);
+
+		dir->list_dir_begin();
+		for (String file_name = dir->get_next(); !file_name.is_empty(); file_name = dir->get_next()) {
+			if (!dir->current_is_dir() && extensions.find(file_name.get_extension().to_lower())) {
+				paths.push_back(source_path.plus_file(file_name));
+			}
+		}
+		dir->list_dir_end();
+		memdelete(dir);
+
+		paths.sort();
+	} else {
+		paths.push_back(source_path);
+	}
+
+	for (int i = 0; i < paths.size(); i++) {
+		Ref<Image> image;
+		image.instantiate();
+		if (image->load(paths[i]) != OK) {
+			continue; // the loader reported why
+		}
+		if (image->is_compressed()) {
+			image->decompress();
+		}
+		image->convert(Image::FORMAT_RGB8);
+		if (image->get_width() != width || image->get_height() != height) {
+			image->resize(width, height);
+		}
+
+		Vector<uint8_t> still;
+		still.resize(_get_frame_size());
+		_convert_rgb(image->get_data().ptr(), still.ptrw());
+		stills.push_back(still);
+	}
+
+	ERR_FAIL_COND_V_MSG(stills.is_empty(), false, "No images found for camera source \"" + source_path + "\".");
+	return true;
+}
+
+void CameraFeedVirtual::_build_pattern() {
+	// colour bars over the top three quarters, a grey ramp below them
+	static const uint8_t bars[8][3] = {
+		{ 255, 255, 255 },
+		{ 255, 255, 0 },
+		{ 0, 255, 255 },
+		{ 0, 255, 0 },
+		{ 255, 0, 255 },
+		{ 255, 0, 0 },
+		{ 0, 0, 255 },
+		{ 0, 0, 0 },
+	};
+
+	Vector<uint8_t> rgb;
+	rgb.resize(width * height * 3);
+	uint8_t *w = rgb.ptrw();
+	int ramp_top = height * 3 / 4;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			uint8_t *pixel = w + (y * width + x) * 3;
+			if (y < ramp_top) {
+				const uint8_t *bar = bars[x * 8 / width];
+				pixel[0] = bar[0];
+				pixel[1] = bar[1];
+				pixel[2] = bar[2];
+			} else {
+				uint8_t grey = x * 255 / MAX(width - 1, 1);
+				pixel[0] = grey;
+				pixel[1] = grey;
+				pixel[2] = grey;
+			}
+		}
+	}
+
+	Vector<uint8_t> still;
+	still.resize(_get_frame_size());
+	_convert_rgb(rgb.ptr(), still.ptrw());
+	stills.push_back(still);
+}
+
+void CameraFeedVirtual::_convert_rgb(const uint8_t *p_rgb, uint8_t *p_dst) const {
+	if (pixel_format == PIXEL_FORMAT_RGB3) {
+		memcpy(p_dst, p_rgb, width * height * 3);
+		return;
+	}
+
+	uint8_t *dst_y = p_dst;
+	for (int i = 0; i < width * height; i++) {
+		int luma, cb, cr;
+		_rgb_to_ycbcr(p_rgb + i * 3, luma, cb, cr);
+		dst_y[i] = luma;
+	}
+
+	// every chroma sample is the average over the pixels it covers
+	uint8_t *dst_cbcr = p_dst + width * height;
+	int cbcr_width = (width + 1) / 2;
+	int cbcr_height = _get_cbcr_height();
+	int rows = pixel_format == PIXEL_FORMAT_NV12 ? 2 : 1;
+	for (int j = 0; j < cbcr_height; j++) {
+		for (int i = 0; i < cbcr_width; i++) {
+			int cb_sum = 0;
+			int cr_sum = 0;
+			int count = 0;
+			for (int y = j * rows; y < MIN((j + 1) * rows, height); y++) {
+				for (int x = i * 2; x < MIN(i * 2 + 2, width); x++) {
+					int luma, cb, cr;
+					_rgb_to_ycbcr(p_rgb + (y * width + x) * 3, luma, cb, cr);
+					cb_sum += cb;
+					cr_sum += cr;
+					count++;
+				}
+			}
+			uint8_t *sample = dst_cbcr + (j * cbcr_width + i) * 2;
+			sample[0] = (cb_sum + count / 2) / count;
+			sample[1] = (cr_sum + count / 2) / count;
+		}
+	}
+}
+
+bool CameraFeedVirtual::_read_next_file_frame() {
+	uint64_t frame_size = file_frame.size();
+
+	// the second attempt starts over, if the file loops
+	for (int attempt = 0; attempt < 2; attempt++) {
+		if (source == SOURCE_Y4M) {
+			// every frame starts with a line such as "FRAME" or "FRAME Ip"
+			if (file->get_line().begins_with("FRAME") && file->get_buffer(file_frame.ptrw(), frame_size) == frame_size) {
+				return true;
+			}
+		} else if (file->get_buffer(file_frame.ptrw(), frame_size) == frame_size) {
+			return true;
+		}
+
+		if (!loop) {
+			return false;
+		}
+		file->seek(file_data_offset);
+	}
+
+	return false; // not even a single frame in there
+}
+
+bool CameraFeedVirtual::_read_file_frame(uint64_t p_frame) {
+	// frames whose time passed while we were behind are skipped, so the file plays in real time
+	while (file_next_frame <= p_frame) {
+		if (!_read_next_file_frame()) {
+			return false;
+		}
+		file_next_frame++;
+	}
+	return true;
+}
+
+void CameraFeedVirtual::_convert_file_frame(uint8_t *p_dst) {
+	const uint8_t *src_y = file_frame.ptr();
+	int luma_size = width * height;
+	bool mono = file_chroma_shift_x < 0;
+	int src_cbcr_width = mono ? 0 : (width + (1 << file_chroma_shift_x) - 1) >> file_chroma_shift_x;
+	int src_cbcr_height = mono ? 0 : (height + (1 << file_chroma_shift_y) - 1) >> file_chroma_shift_y;
+	const uint8_t *src_cb = src_y + luma_size;
+	const uint8_t *src_cr = src_cb + src_cbcr_width * src_cbcr_height;
+
+	if (pixel_format == PIXEL_FORMAT_RGB3) {
+		if (mono) {
+			for (int i = 0; i < luma_size; i++) {
+				uint8_t grey = CLAMP((src_y[i] - 16) * 255 / 219, 0, 255);
+				p_dst[i * 3 + 0] = grey;
+				p_dst[i * 3 + 1] = grey;
+				p_dst[i * 3 + 2] = grey;
+			}
+			return;
+		}
+
+		YUVConverter::Source yuv;
+		if (file_chroma_shift_x == 0) {
+			yuv.format = YUVConverter::SOURCE_YUV444P;
+		} else {
+			yuv.format = file_chroma_shift_y == 0 ? YUVConverter::SOURCE_YUV422P : YUVConverter::SOURCE_I420;
+		}
+		yuv.planes[0] = src_y;
+		yuv.planes[1] = src_cb;
+		yuv.planes[2] = src_cr;
+		yuv.strides[0] = width;
+		yuv.strides[1] = src_cbcr_width;
+		yuv.strides[2] = src_cbcr_width;
+		yuv.width = width;
+		yuv.height = height;
+
+		uint8_t *rgba = rgba_frame.ptrw();
+		YUVConverter::convert_to_rgba8(yuv, rgba);
+		for (int i = 0; i < luma_size; i++) {
+			p_dst[i * 3 + 0] = rgba[i * 4 + 0];
+			p_dst[i * 3 + 1] = rgba[i * 4 + 1];
+			p_dst[i * 3 + 2] = rgba[i * 4 + 2];
+		}
+		return;
+	}
+
+	memcpy(p_dst, src_y, luma_size);
+
+	// resample the chroma by averaging the file's samples at the corners of the block each of ours covers
+	uint8_t *dst_cbcr = p_dst + luma_size;
+	int cbcr_width = (width + 1) / 2;
+	int cbcr_height = _get_cbcr_height();
+	int rows_shift = pixel_format == PIXEL_FORMAT_NV12 ? 1 : 0;
+	for (int j = 0; j < cbcr_height; j++) {
+		int y0 = j << rows_shift;
+		int y1 = MIN(y0 + (1 << rows_shift) - 1, height - 1);
+		for (int i = 0; i < cbcr_width; i++) {
+			uint8_t *sample = dst_cbcr + (j * cbcr_width + i) * 2;
+			if (mono) {
+				sample[0] = 128;
+				sample[1] = 128;
+				continue;
+			}
+
+			int x0 = i * 2;
+			int x1 = MIN(x0 + 1, width - 1);
+			int row_a = (y0 >> file_chroma_shift_y) * src_cbcr_width;
+			int row_b = (y1 >> file_chroma_shift_y) * src_cbcr_width;
+			int col_a = x0 >> file_chroma_shift_x;
+			int col_b = x1 >> file_chroma_shift_x;
+			sample[0] = (src_cb[row_a + col_a] + src_cb[row_a + col_b] + src_cb[row_b + col_a] + src_cb[row_b + col_b] + 2) >> 2;
+			sample[1] = (src_cr[row_a + col_a] + src_cr[row_a + col_b] + src_cr[row_b + col_a] + src_cr[row_b + col_b] + 2) >> 2;
+		}
+	}
+}
+
+void CameraFeedVirtual::_scroll_pattern(uint8_t *p_dst, uint64_t p_frame) const {
+	// a few pixels every frame, so motion and tearing show. Even, so chroma samples stay whole.
+	int offset = int((p_frame * 4) % width) & ~1;
+	const uint8_t *src = stills[0].ptr();
+
+	if (pixel_format == PIXEL_FORMAT_RGB3) {
+		for (int y = 0; y < height; y++) {
+			_rotate_row(src + y * width * 3, p_dst + y * width * 3, width * 3, offset * 3);
+		}
+		return;
+	}
+
+	for (int y = 0; y < height; y++) {
+		_rotate_row(src + y * width, p_dst + y * width, width, offset);
+	}
+
+	// two bytes per chroma sample, at half the offset
+	int cbcr_pitch = ((width + 1) / 2) * 2;
+	src += width * height;
+	p_dst += width * height;
+	for (int j = 0; j < _get_cbcr_height(); j++) {
+		_rotate_row(src + j * cbcr_pitch, p_dst + j * cbcr_pitch, cbcr_pitch, offset);
+	}
+}
+
+void CameraFeedVirtual::_stamp_frame_number(uint8_t *p_dst, uint64_t p_frame) const {
+	int block = MAX(2, (width / 64) & ~1);
+	int bits = MIN(32, width / block);
+	int rows = MIN(block, height);
+	int cbcr_pitch = ((width + 1) / 2) * 2;
+	int cbcr_rows = pixel_format == PIXEL_FORMAT_NV12 ? (rows + 1) / 2 : rows;
+
+	for (int bit = 0; bit < bits; bit++) {
+		bool set = (p_frame >> bit) & 1;
+		int x = bit * block;
+
+		if (pixel_format == PIXEL_FORMAT_RGB3) {
+			for (int y = 0; y < rows; y++) {
+				memset(p_dst + (y * width + x) * 3, set ? 255 : 0, block * 3);
+			}
+			continue;
+		}
+
+		for (int y = 0; y < rows; y++) {
+			memset(p_dst + y * width + x, set ? 235 : 16, block);
+		}
+		// neutral chroma, x is even so it starts on a whole sample
+		uint8_t *cbcr = p_dst + width * height;
+		for (int j = 0; j < cbcr_rows; j++) {
+			memset(cbcr + j * cbcr_pitch + x, 128, block);
+		}
+	}
+}
+
+bool CameraFeedVirtual::_fill_buffer(Buffer *p_buffer, uint64_t p_frame) {
+	uint8_t *dst = p_buffer->data.ptrw();
+
+	switch (source) {
+		case SOURCE_PATTERN: {
+			_scroll_pattern(dst, p_frame);
+			_stamp_frame_number(dst, p_frame);
+			return true;
+		}
+		case SOURCE_IMAGES: {
+			if (!loop && p_frame >= (uint64_t)stills.size()) {
+				return false;
+			}
+			const Vector<uint8_t> &still = stills[p_frame % stills.size()];
+			memcpy(dst, still.ptr(), still.size());
+			return true;
+		}
+		case SOURCE_Y4M:
+		case SOURCE_RAW_I420: {
+			if (!_read_file_frame(p_frame)) {
+				return false;
+			}
+			_convert_file_frame(dst);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CameraFeedVirtual::_publish(Buffer *p_buffer) {
+	const uint8_t *data = p_buffer->data.ptr();
+	buffers_in_flight.increment();
+
+	if (pixel_format == PIXEL_FORMAT_RGB3) {
+		FramePlane rgb;
+		rgb.data = data;
+		rgb.width = width;
+		rgb.height = height;
+		rgb.row_pitch = width * 3;
+		rgb.format = Image::FORMAT_RGB8;
+		set_RGB_raw(rgb, &CameraFeedVirtual::_release_buffer, p_buffer);
+		return;
+	}
+
+	FramePlane y_plane;
+	y_plane.data = data;
+	y_plane.width = width;
+	y_plane.height = height;
+	y_plane.row_pitch = width;
+	y_plane.format = Image::FORMAT_R8;
+
+	FramePlane cbcr_plane;
+	cbcr_plane.data = data + width * height;
+	cbcr_plane.width = (width + 1) / 2;
+	cbcr_plane.height = _get_cbcr_height();
+	cbcr_plane.row_pitch = cbcr_plane.width * 2;
+	cbcr_plane.format = Image::FORMAT_RG8;
+
+	set_YCbCr_raws(y_plane, cbcr_plane, &CameraFeedVirtual::_release_buffer, p_buffer);
+}
+
+void CameraFeedVirtual::_release_buffer(void *p_user) {
+	// called by the renderer once the buffer has been uploaded
+	Buffer *buffer = (Buffer *)p_user;
+	buffer->in_use.clear();
+	buffer->feed->buffers_in_flight.decrement();
+}
+
+void CameraFeedVirtual::_capture_thread(void *p_user) {
+	CameraFeedVirtual *feed = (CameraFeedVirtual *)p_user;
+	const OS *os = OS::get_singleton();
+
+	// frame n is due n intervals after the start, so the framerate doesn't drift
+	const uint64_t interval_numerator = 1000000 * (uint64_t)feed->fps_denominator;
+	const uint64_t interval_denominator = feed->fps_numerator;
+	const uint64_t start_usec = os->get_ticks_usec();
+	uint64_t frame = 0;
+	bool ended = false;
+
+	while (feed->running.is_set()) {
+		uint64_t due_usec = start_usec + frame * interval_numerator / interval_denominator;
+		uint64_t now_usec = os->get_ticks_usec();
+		if (ended || now_usec < due_usec) {
+			// short naps, so deactivating doesn't wait on slow framerates
+			os->delay_usec(ended ? 10000 : MIN(due_usec - now_usec, (uint64_t)10000));
+			continue;
+		}
+
+		DropPolicy drop_policy = feed->get_drop_policy();
+		if (drop_policy == DROP_POLICY_BLOCK && feed->is_frame_pending()) {
+			// like a camera that holds on to its frames, the ones that fall due meanwhile are lost
+			os->delay_usec(1000);
+			continue;
+		}
+
+		uint64_t current = (now_usec - start_usec) * interval_denominator / interval_numerator;
+		if (current > frame) {
+			feed->report_dropped_frames(uint32_t(current - frame));
+			frame = current;
+			due_usec = start_usec + frame * interval_numerator / interval_denominator;
+		}
+
+		FrameTiming timing;
+		timing.capture_usec = due_usec;
+		timing.dequeue_usec = now_usec;
+		timing.sequence = frame;
+		frame++;
+
+		if (drop_policy == DROP_POLICY_NEWEST && feed->is_frame_pending()) {
+			// don't bother making a frame that won't be shown
+			feed->report_skipped_frame();
+			continue;
+		}
+
+		Buffer *buffer = nullptr;
+		for (int i = 0; i < feed->buffer_count; i++) {
+			if (!feed->buffers[i].in_use.is_set()) {
+				buffer = &feed->buffers[i];
+				break;
+			}
+		}
+		if (buffer == nullptr) {
+			// every buffer is still waiting for the renderer, so this frame is lost
+			feed->report_underrun();
+			feed->report_dropped_frames(1);
+			continue;
+		}
+
+		if (!feed->_fill_buffer(buffer, timing.sequence)) {
+			ended = true; // played through a source that doesn't loop
+			continue;
+		}
+
+		buffer->in_use.set();
+		timing.converted_usec = os->get_ticks_usec();
+		feed->set_frame_timing(timing);
+		feed->_publish(buffer);
+	}
+}
+
+Array CameraFeedVirtual::get_formats() {
+	Array formats;
+	for (int i = 0; i < PIXEL_FORMAT_MAX; i++) {
+		if (source == SOURCE_PATTERN || source == SOURCE_IMAGES) {
+			// any size and framerate, reported as the smallest and largest mode
+			formats.push_back(_make_format(MIN_SIZE, MIN_SIZE, pixel_format_names[i], 1.0));
+			formats.push_back(_make_format(MAX_SIZE, MAX_SIZE, pixel_format_names[i], MAX_FPS));
+		} else {
+			// files play at their own size, known once the feed was activated
+			formats.push_back(_make_format(width, height, pixel_format_names[i], float(fps_numerator) / fps_denominator));
+		}
+	}
+	return formats;
+}
+
+bool CameraFeedVirtual::set_format(int p_width, int p_height, const String &p_pixel_format, float p_fps) {
+	ERR_FAIL_COND_V(p_width <= 0 || p_height <= 0, false);
+	ERR_FAIL_COND_V(p_fps < 0.0, false);
+	PixelFormat new_pixel_format = pixel_format_from_string(p_pixel_format);
+	ERR_FAIL_COND_V_MSG(new_pixel_format == PIXEL_FORMAT_MAX, false, "Invalid pixel format \"" + p_pixel_format + "\".");
+
+	{
+		MutexLock lock(activation_mutex);
+		pending_format.pixel_format = new_pixel_format;
+		pending_format.width = CLAMP(p_width, (int)MIN_SIZE, (int)MAX_SIZE);
+		pending_format.height = CLAMP(p_height, (int)MIN_SIZE, (int)MAX_SIZE);
+		pending_format.fps = p_fps;
+		format_pending = true;
+	}
+	// the format can only change while we aren't capturing
+	_request_settings_change();
+	return true;
+}
+
+void CameraFeedVirtual::set_queue_depth(int p_depth) {
+	{
+		MutexLock lock(activation_mutex);
+		int previous_depth = queue_depth;
+		CameraFeed::set_queue_depth(p_depth);
+		if (queue_depth == previous_depth) {
+			return;
+		}
+	}
+	_request_settings_change();
+}
+
+void CameraFeedVirtual::apply_settings() {
+	MutexLock lock(activation_mutex);
+	if (!format_pending) {
+		// the queue depth is picked up by activate_feed()
+		return;
+	}
+	format_pending = false;
+
+	pixel_format = pending_format.pixel_format;
+	width = pending_format.width;
+	height = pending_format.height;
+	if (pending_format.fps > 0.0) {
+		// kept as a fraction, like Y4M files have it
+		fps_numerator = CLAMP((int)Math::round(pending_format.fps * 1000.0), 1, MAX_FPS * 1000);
+		fps_denominator = 1000;
+	}
+}
+
+bool CameraFeedVirtual::activate_feed() {
+	if (running.is_set()) {
+		return true;
+	}
+	if (!_open_source()) {
+		return false;
+	}
+
+	{
+		MutexLock lock(activation_mutex);
+		buffer_count = queue_depth;
+	}
+	buffers = memnew_arr(Buffer, buffer_count);
+	for (int i = 0; i < buffer_count; i++) {
+		buffers[i].feed = this;
+		buffers[i].data.resize(_get_frame_size());
+	}
+	buffers_in_flight.set(0);
+
+	// the first frame is due right away, it is taken once the feed is marked active
+	running.set();
+	thread.start(&CameraFeedVirtual::_capture_thread, this);
+	return true;
+}
+
+void CameraFeedVirtual::deactivate_feed() {
+	if (!running.is_set()) {
+		return;
+	}
+	running.clear();
+	thread.wait_to_finish();
+	// also waits for the frame the renderer is uploading from our buffers
+	drop_pending_frames();
+
+	if (buffers_in_flight.get() == 0) {
+		memdelete_arr(buffers);
+	} else {
+		// leaked rather than freed while the renderer reads them
+		ERR_PRINT("Camera buffers of " + name + " are still in use by the renderer.");
+	}
+	buffers = nullptr;
+	buffer_count = 0;
+
+	_close_source();
+}
+
+CameraFeedVirtual::CameraFeedVirtual(const String &p_name) :
+		CameraFeed(p_name) {
+	// we produce limited range, like most cameras
+	ycbcr_full_range = false;
+}
+
+CameraFeedVirtual::~CameraFeedVirtual() {
+	wait_for_activation();
+	deactivate_feed();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// CameraVirtual - Subclass for the virtual camera server
+
+void CameraVirtual::register_settings() {
+	GLOBAL_DEF("camera/driver", "");
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/driver", PropertyInfo(Variant::STRING, "camera/driver", PROPERTY_HINT_ENUM_SUGGESTION, "virtual"));
+	GLOBAL_DEF("camera/virtual/feed_count", 1);
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/virtual/feed_count", PropertyInfo(Variant::INT, "camera/virtual/feed_count", PROPERTY_HINT_RANGE, "1,16,1"));
+	GLOBAL_DEF("camera/virtual/source", "");
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/virtual/source", PropertyInfo(Variant::STRING, "camera/virtual/source", PROPERTY_HINT_FILE, "*.y4m,*.yuv,*.png,*.jpg,*.webp"));
+	GLOBAL_DEF("camera/virtual/pixel_format", "NV12");
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/virtual/pixel_format", PropertyInfo(Variant::STRING, "camera/virtual/pixel_format", PROPERTY_HINT_ENUM, "NV12,YUYV,RGB3"));
+	GLOBAL_DEF("camera/virtual/width", 640);
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/virtual/width", PropertyInfo(Variant::INT, "camera/virtual/width", PROPERTY_HINT_RANGE, "16,8192,1"));
+	GLOBAL_DEF("camera/virtual/height", 480);
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/virtual/height", PropertyInfo(Variant::INT, "camera/virtual/height", PROPERTY_HINT_RANGE, "16,8192,1"));
+	GLOBAL_DEF("camera/virtual/fps", 30.0);
+	ProjectSettings::get_singleton()->set_custom_property_info("camera/virtual/fps", PropertyInfo(Variant::FLOAT, "camera/virtual/fps", PROPERTY_HINT_RANGE, "1,1000,0.01"));
+	GLOBAL_DEF("camera/virtual/loop", true);
+}
+
+bool CameraVirtual::is_requested() {
+	String driver = GLOBAL_GET("camera/driver");
+
+	// the command line wins over the project
+	List<String> args = OS::get_singleton()->get_cmdline_args();
+	for (const List<String>::Element *E = args.front(); E; E = E->next()) {
+		if (E->get() == "--camera-driver" && E->next()) {
+			driver = E->next()->get();
+		}
+	}
+
+	return driver.to_lower() == "virtual";
+}
+
+CameraVirtual::CameraVirtual() {
+	String source = GLOBAL_GET("camera/virtual/source");
+	String pixel_format = GLOBAL_GET("camera/virtual/pixel_format");
+	int width = GLOBAL_GET("camera/virtual/width");
+	int height = GLOBAL_GET("camera/virtual/height");
+	float fps = GLOBAL_GET("camera/virtual/fps");
+	bool loop = GLOBAL_GET("camera/virtual/loop");
+	int feed_count = GLOBAL_GET("camera/virtual/feed_count");
+
+	for (int i = 0; i < feed_count; i++) {
+		Ref<CameraFeedVirtual> feed = memnew(CameraFeedVirtual(vformat("Virtual Camera %d", i + 1)));
+		feed->set_source(source);
+		feed->set_loop(loop);
+		feed->set_format(width, height, pixel_format, fps);
+		add_feed(feed);
+	}
+}
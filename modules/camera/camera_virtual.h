@@ -0,0 +1,167 @@
+/*************************************************************************/
+/*  camera_virtual.h                                                     */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_VIRTUAL_H
+#define CAMERA_VIRTUAL_H
+
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+#include "servers/camera/camera_feed.h"
+#include "servers/camera_server.h"
+
+class FileAccess;
+
+// A camera without hardware, for machines that have none such as CI and
+// benchmark runners. Frames come from a generated test pattern, a Y4M or raw
+// I420 file, or a sequence of images, and are handed to the feed at a steady
+// framerate through the same paths real cameras use.
+//
+// The generated pattern scrolls a set of colour bars and stamps the frame
+// number in the top left corner as a row of black and white squares, least
+// significant bit first, so tests can tell which frame they are looking at.
+class CameraFeedVirtual : public CameraFeed {
+public:
+	enum Source {
+		SOURCE_PATTERN,
+		SOURCE_Y4M, // YUV4MPEG2 with 4:2:0, 4:2:2, 4:4:4 or monochrome frames
+		SOURCE_RAW_I420, // headerless I420 frames of the configured size
+		SOURCE_IMAGES, // a single image or a directory of them, shown in name order
+	};
+
+	enum PixelFormat {
+		PIXEL_FORMAT_RGB3, // packed RGB
+		PIXEL_FORMAT_NV12, // Y plane and CbCr plane at half resolution
+		PIXEL_FORMAT_YUYV, // 4:2:2, split into a Y plane and a CbCr plane at half horizontal resolution
+		PIXEL_FORMAT_MAX
+	};
+
+private:
+	// The frames we hand out without copying, one per queued buffer of a real camera.
+	struct Buffer {
+		CameraFeedVirtual *feed = nullptr;
+		SafeFlag in_use; // until the renderer released it
+		Vector<uint8_t> data;
+	};
+
+	String source_path;
+	Source source = SOURCE_PATTERN;
+	PixelFormat pixel_format = PIXEL_FORMAT_NV12;
+	int width = 640;
+	int height = 480;
+	int fps_numerator = 30;
+	int fps_denominator = 1;
+	bool loop = true;
+
+	// Filled in by activate_feed(), only used by the capture thread afterwards.
+	Buffer *buffers = nullptr;
+	int buffer_count = 0;
+	Vector<Vector<uint8_t>> stills; // the pattern or the images, in the output format
+	FileAccess *file = nullptr;
+	uint64_t file_data_offset = 0; // where the first frame of the file starts
+	int file_chroma_shift_x = 1; // the chroma subsampling of the file, -1 if it has no chroma
+	int file_chroma_shift_y = 1;
+	uint64_t file_next_frame = 0; // counts on when the file loops
+	Vector<uint8_t> file_frame; // the planes of the frame read last
+	Vector<uint8_t> rgba_frame; // for converting file frames to RGB
+
+	Thread thread;
+	SafeFlag running;
+	SafeNumeric<uint32_t> buffers_in_flight;
+
+	enum {
+		MIN_SIZE = 16,
+		MAX_SIZE = 8192,
+		MAX_FPS = 1000,
+	};
+
+	static void _capture_thread(void *p_user);
+	static void _release_buffer(void *p_user);
+
+	// the mode set_format() asked for, applied on the activation thread, guarded by activation_mutex
+	struct PendingFormat {
+		PixelFormat pixel_format = PIXEL_FORMAT_NV12;
+		int width = 0;
+		int height = 0;
+		float fps = 0.0;
+	};
+	PendingFormat pending_format;
+	bool format_pending = false;
+
+	int _get_frame_size() const;
+	int _get_cbcr_height() const;
+	bool _open_source();
+	void _close_source();
+	bool _open_y4m();
+	bool _load_images();
+	void _build_pattern();
+	bool _read_next_file_frame();
+	bool _read_file_frame(uint64_t p_frame);
+	void _convert_file_frame(uint8_t *p_dst);
+	void _convert_rgb(const uint8_t *p_rgb, uint8_t *p_dst) const;
+	void _scroll_pattern(uint8_t *p_dst, uint64_t p_frame) const;
+	void _stamp_frame_number(uint8_t *p_dst, uint64_t p_frame) const;
+	bool _fill_buffer(Buffer *p_buffer, uint64_t p_frame);
+	void _publish(Buffer *p_buffer);
+
+public:
+	static PixelFormat pixel_format_from_string(const String &p_pixel_format);
+	static String pixel_format_to_string(PixelFormat p_pixel_format);
+
+	// Takes effect once the feed is activated again. A path ending in .y4m or .yuv
+	// plays that file, any other path is an image or a directory of images, and
+	// an empty path generates the pattern.
+	void set_source(const String &p_path);
+	String get_source() const;
+	void set_loop(bool p_loop);
+
+	Array get_formats();
+	bool set_format(int p_width, int p_height, const String &p_pixel_format, float p_fps = 0.0);
+	void set_queue_depth(int p_depth);
+
+	bool activate_feed();
+	void deactivate_feed();
+	void apply_settings();
+
+	CameraFeedVirtual(const String &p_name);
+	~CameraFeedVirtual();
+};
+
+// Adds the virtual feeds configured in the project settings. Picked instead of
+// the platform's camera server with the camera/driver project setting or the
+// --camera-driver command line argument.
+class CameraVirtual : public CameraServer {
+public:
+	static void register_settings();
+	static bool is_requested();
+
+	CameraVirtual();
+};
+
+#endif /* CAMERA_VIRTUAL_H */
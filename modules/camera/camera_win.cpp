@@ -59,7 +59,8 @@ CameraFeedWindows::CameraFeedWindows() {
 
 CameraFeedWindows::~CameraFeedWindows() {
 	// make sure we stop recording if we are!
-	if (is_active()) {
+	wait_for_activation();
+	if (is_capturing()) {
 		deactivate_feed();
 	};
 
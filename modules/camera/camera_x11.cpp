@@ -29,6 +29,7 @@
 /*************************************************************************/
 
 #include "camera_x11.h"
+#include "core/io/yuv_converter.h"
 #include "servers/camera/camera_feed.h"
 
 #include <algorithm>
@@ -42,10 +43,14 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -53,9 +58,16 @@
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 
-// formats that can be used
-// mainly necessary if libv4l2 is not available
+// formats that can be used, in order of preference
+// the YCbCr formats are passed to the feed as is so the conversion
+// happens on the GPU, RGB24 is mainly used when libv4l2 converts for us
 std::vector<__u32> supported_formats{
+	V4L2_PIX_FMT_YUYV,
+	V4L2_PIX_FMT_NV12,
+	V4L2_PIX_FMT_UYVY,
+#ifdef MODULE_JPG_ENABLED
+	V4L2_PIX_FMT_MJPEG,
+#endif
 	V4L2_PIX_FMT_RGB24
 };
 
@@ -67,16 +79,20 @@ int V4l2_Device::xioctl(int fd, unsigned long int request, void *arg) {
 	return r;
 };
 
-V4l2_Device::V4l2_Device(std::string dev_name, struct v4l2_funcs *funcs) {
+V4l2_Device::V4l2_Device(std::string dev_name, struct v4l2_funcs *funcs, CameraCaptureReactor *reactor, CameraCapabilityCache *capability_cache) {
 	this->dev_name = dev_name;
 	this->funcs = funcs;
+	this->reactor = reactor;
+	this->capability_cache = capability_cache;
 	this->use_libv4l2 = funcs->libv4l2;
 };
 
 bool V4l2_Device::check_device(bool print_debug) {
 	// print_debug is used whether debug messages should be printed
-	// (as the devices are checked every second, which resulted in
-	// many useless print outs)
+	// (incompatible devices are checked again on hotplug events,
+	// which would print the same messages over and over)
+	probed = false;
+	cached_probe_key = String();
 	int fd = -1;
 	struct stat st;
 	if (stat(dev_name.c_str(), &st) == -1 || (!S_ISCHR(st.st_mode))) {
@@ -87,6 +103,49 @@ bool V4l2_Device::check_device(bool print_debug) {
 		return false;
 	}
 
+	// Ask the kernel what is behind the node before opening it through libv4l2, which
+	// probes the device itself. A node that didn't change since it was last probed takes
+	// what was found then. Modes asked for through set_format are always tried.
+	String cache_key;
+	if (requested_pixelformat == 0) {
+		int raw_fd = ::open(dev_name.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (raw_fd != -1) {
+			struct v4l2_capability raw_cap;
+			CLEAR(raw_cap);
+			if (::ioctl(raw_fd, VIDIOC_QUERYCAP, &raw_cap) != -1) {
+				cache_key = CameraCapabilityCache::make_key(dev_name, raw_cap, funcs->libv4l2, supported_formats);
+				cap = raw_cap;
+			}
+			::close(raw_fd);
+		}
+	}
+
+	CameraCapabilityCache::Entry cached;
+	if (!cache_key.is_empty() && capability_cache->lookup(cache_key, cached)) {
+		name = String((const char *)cap.card) + String(" (") + String(dev_name.c_str()) + String(")");
+		if (!cached.usable) {
+#ifdef DEBUG_ENABLED
+			if (print_debug)
+				print_line(String(dev_name.c_str()) + " wasn't usable when it was last probed.");
+#endif
+			return false;
+		}
+
+		CLEAR(fmt);
+		fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		fmt.fmt.pix = cached.pix;
+		type = (IOType)cached.io_type;
+		buffer_size = cached.buffer_size;
+		requested_format_found = false;
+		cached_probe_key = cache_key;
+
+		probed = true;
+		probed_fmt = fmt;
+		probed_type = type;
+		probed_buffer_size = buffer_size;
+		return true;
+	}
+
 	// open device
 	fd = funcs->open(dev_name.c_str(), O_RDWR | O_NONBLOCK, 0);
 
@@ -117,6 +176,7 @@ bool V4l2_Device::check_device(bool print_debug) {
 			print_line(String(dev_name.c_str()) + " is no video capture device.");
 #endif
 		funcs->close(fd);
+		_cache_probe(cache_key, false);
 		return false;
 	}
 
@@ -127,6 +187,7 @@ bool V4l2_Device::check_device(bool print_debug) {
 			print_line(String(dev_name.c_str()) + " is just a meta information device.");
 #endif
 		funcs->close(fd);
+		_cache_probe(cache_key, false);
 		return false;
 	}
 
@@ -141,6 +202,7 @@ bool V4l2_Device::check_device(bool print_debug) {
 			print_line(String(dev_name.c_str()) + " has no capability to capture frames.");
 #endif
 		funcs->close(fd);
+		_cache_probe(cache_key, false);
 		return false;
 	}
 
@@ -158,9 +220,40 @@ bool V4l2_Device::check_device(bool print_debug) {
 		return false;
 	}
 	fmt.fmt.pix.field = V4L2_FIELD_INTERLACED;
+	struct v4l2_format default_fmt = fmt;
+
+	// If the default pixelformat is one we support, try it first.
+	// Cameras usually default to the format that gives them their
+	// full framerate at the default size (often MJPEG).
+	std::vector<__u32> formats = supported_formats;
+	std::vector<__u32>::iterator default_it = std::find(formats.begin(), formats.end(), default_fmt.fmt.pix.pixelformat);
+	if (default_it != formats.end()) {
+		std::rotate(formats.begin(), default_it, default_it + 1);
+	}
+
 	bool found = false;
-	for (unsigned int i = 0; i < supported_formats.size(); ++i) {
-		fmt.fmt.pix.pixelformat = supported_formats[i];
+	requested_format_found = false;
+	if (requested_pixelformat != 0) {
+		// the mode asked for through set_format, the driver picks the closest size it has
+		fmt = default_fmt;
+		fmt.fmt.pix.width = requested_width;
+		fmt.fmt.pix.height = requested_height;
+		fmt.fmt.pix.pixelformat = requested_pixelformat;
+		if (xioctl(fd, VIDIOC_TRY_FMT, &fmt) != -1 && fmt.fmt.pix.pixelformat == requested_pixelformat) {
+			found = true;
+			requested_format_found = true;
+		}
+#ifdef DEBUG_ENABLED
+		else if (print_debug) {
+			print_line(String(dev_name.c_str()) + " can't capture in " + fourcc_to_string(requested_pixelformat) + ", using its default format.");
+		}
+#endif
+	}
+
+	for (unsigned int i = 0; i < formats.size() && !found; ++i) {
+		// VIDIOC_TRY_FMT adjusts the format, so start from the default each time
+		fmt = default_fmt;
+		fmt.fmt.pix.pixelformat = formats[i];
 		// This commented code could be used if VIDIOC_TRY_FMT is not implemented
 		// in the driver, but it will interfere with current executed streams.
 		// if(-1 == xioctl(fd, VIDIOC_S_FMT, &fmt)) {
@@ -180,6 +273,10 @@ bool V4l2_Device::check_device(bool print_debug) {
 		if (xioctl(fd, VIDIOC_TRY_FMT, &fmt) == -1) {
 			continue;
 		}
+		// drivers may silently replace a pixelformat they don't support
+		if (fmt.fmt.pix.pixelformat != formats[i]) {
+			continue;
+		}
 		found = true;
 		break;
 	}
@@ -189,6 +286,7 @@ bool V4l2_Device::check_device(bool print_debug) {
 			print_line(String(dev_name.c_str()) + " has no supported pixelformat.");
 #endif
 		funcs->close(fd);
+		_cache_probe(cache_key, false);
 		return false;
 	}
 
@@ -204,11 +302,270 @@ bool V4l2_Device::check_device(bool print_debug) {
 
 	funcs->close(fd);
 
+	probed = true;
+	probed_fmt = fmt;
+	probed_type = type;
+	probed_buffer_size = buffer_size;
+	_cache_probe(cache_key, true);
+
 	// Now the device can be opened...
 	// To start streaming the fmt must be set and the buffers must be prepared.
 	return true;
 }
 
+void V4l2_Device::_cache_probe(const String &key, bool usable) {
+	// nodes that failed for a reason that may go away, such as permissions, aren't remembered
+	if (key.is_empty()) {
+		return;
+	}
+
+	CameraCapabilityCache::Entry entry;
+	entry.usable = usable;
+	if (usable) {
+		entry.io_type = type;
+		entry.pix = fmt.fmt.pix;
+		entry.buffer_size = buffer_size;
+	}
+	capability_cache->store(key, entry);
+}
+
+bool V4l2_Device::probe() {
+	if (!probed) {
+		return check_device();
+	}
+
+	// streaming adjusts these, start over from what the device reported
+	fmt = probed_fmt;
+	type = probed_type;
+	buffer_size = probed_buffer_size;
+	return true;
+}
+
+String V4l2_Device::fourcc_to_string(__u32 fourcc) {
+	char chars[5];
+	for (int i = 0; i < 4; i++) {
+		chars[i] = (fourcc >> (i * 8)) & 0xff;
+	}
+	chars[4] = 0;
+	// short codes are padded with spaces
+	return String(chars).strip_edges(false, true);
+}
+
+__u32 V4l2_Device::string_to_fourcc(const String &fourcc) {
+	CharString chars = fourcc.ascii();
+	if (chars.length() == 0 || chars.length() > 4) {
+		return 0;
+	}
+
+	__u32 result = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = i < chars.length() ? chars[i] : ' ';
+		result |= (__u32)(uint8_t)c << (i * 8);
+	}
+	return result;
+}
+
+void V4l2_Device::_add_modes(Array &r_formats, int fd, __u32 pixelformat, unsigned int width, unsigned int height) {
+	Vector<double> rates;
+
+	struct v4l2_frmivalenum frmival;
+	CLEAR(frmival);
+	frmival.pixel_format = pixelformat;
+	frmival.width = width;
+	frmival.height = height;
+	while (xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &frmival) != -1) {
+		if (frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+			if (frmival.discrete.numerator > 0) {
+				rates.push_back((double)frmival.discrete.denominator / frmival.discrete.numerator);
+			}
+		} else {
+			// a range, the shortest interval gives the highest framerate
+			if (frmival.stepwise.min.numerator > 0) {
+				rates.push_back((double)frmival.stepwise.min.denominator / frmival.stepwise.min.numerator);
+			}
+			if (frmival.stepwise.max.numerator > 0) {
+				rates.push_back((double)frmival.stepwise.max.denominator / frmival.stepwise.max.numerator);
+			}
+			break;
+		}
+		frmival.index++;
+	}
+
+	if (rates.is_empty()) {
+		// the camera doesn't tell, 0 stands for its default framerate
+		rates.push_back(0.0);
+	}
+
+	for (int i = 0; i < rates.size(); i++) {
+		Dictionary mode;
+		mode["width"] = width;
+		mode["height"] = height;
+		mode["pixel_format"] = fourcc_to_string(pixelformat);
+		mode["fps"] = rates[i];
+		r_formats.push_back(mode);
+	}
+}
+
+Array V4l2_Device::get_formats() {
+	Array formats;
+
+	// a streaming device is asked through the descriptor it captures with
+	int query_fd = fd;
+	if (query_fd == -1) {
+		query_fd = funcs->open(dev_name.c_str(), O_RDWR | O_NONBLOCK, 0);
+		ERR_FAIL_COND_V_MSG(query_fd == -1, formats, "Cannot open device " + String(dev_name.c_str()) + ".");
+	}
+
+	struct v4l2_fmtdesc fmtdesc;
+	CLEAR(fmtdesc);
+	fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	while (xioctl(query_fd, VIDIOC_ENUM_FMT, &fmtdesc) != -1) {
+		fmtdesc.index++;
+		if (std::find(supported_formats.begin(), supported_formats.end(), fmtdesc.pixelformat) == supported_formats.end()) {
+			continue;
+		}
+
+		struct v4l2_frmsizeenum frmsize;
+		CLEAR(frmsize);
+		frmsize.pixel_format = fmtdesc.pixelformat;
+		while (xioctl(query_fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) != -1) {
+			if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+				_add_modes(formats, query_fd, fmtdesc.pixelformat, frmsize.discrete.width, frmsize.discrete.height);
+			} else {
+				// any size within a range
+				_add_modes(formats, query_fd, fmtdesc.pixelformat, frmsize.stepwise.min_width, frmsize.stepwise.min_height);
+				_add_modes(formats, query_fd, fmtdesc.pixelformat, frmsize.stepwise.max_width, frmsize.stepwise.max_height);
+				break;
+			}
+			frmsize.index++;
+		}
+	}
+
+	if (query_fd != fd) {
+		funcs->close(query_fd);
+	}
+
+	return formats;
+}
+
+bool V4l2_Device::set_format(unsigned int width, unsigned int height, __u32 pixelformat, float fps) {
+	ERR_FAIL_COND_V(streaming.is_set(), false);
+	if (std::find(supported_formats.begin(), supported_formats.end(), pixelformat) == supported_formats.end()) {
+		return false;
+	}
+
+	__u32 previous_pixelformat = requested_pixelformat;
+	unsigned int previous_width = requested_width;
+	unsigned int previous_height = requested_height;
+	float previous_fps = requested_fps;
+
+	requested_pixelformat = pixelformat;
+	requested_width = width;
+	requested_height = height;
+	requested_fps = fps;
+
+	if (check_device(true) && requested_format_found) {
+		return true;
+	}
+
+	// keep capturing the way we did
+	requested_pixelformat = previous_pixelformat;
+	requested_width = previous_width;
+	requested_height = previous_height;
+	requested_fps = previous_fps;
+	check_device();
+	return false;
+}
+
+bool V4l2_Device::_get_default_crop(struct v4l2_rect &r_crop) {
+	struct v4l2_selection sel;
+	CLEAR(sel);
+	sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	sel.target = V4L2_SEL_TGT_CROP_DEFAULT;
+	if (xioctl(fd, VIDIOC_G_SELECTION, &sel) != -1) {
+		r_crop = sel.r;
+		return true;
+	}
+
+	// older drivers only know the crop ioctls
+	struct v4l2_cropcap cropcap;
+	CLEAR(cropcap);
+	cropcap.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (xioctl(fd, VIDIOC_CROPCAP, &cropcap) == -1) {
+		return false;
+	}
+	r_crop = cropcap.defrect;
+	return true;
+}
+
+bool V4l2_Device::_set_crop(struct v4l2_rect &r_crop) {
+	// the driver may adjust the crop, r_crop is what it went with
+	struct v4l2_selection sel;
+	CLEAR(sel);
+	sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	sel.target = V4L2_SEL_TGT_CROP;
+	sel.r = r_crop;
+	if (xioctl(fd, VIDIOC_S_SELECTION, &sel) != -1) {
+		r_crop = sel.r;
+		return true;
+	}
+
+	struct v4l2_crop crop;
+	CLEAR(crop);
+	crop.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	crop.c = r_crop;
+	if (xioctl(fd, VIDIOC_S_CROP, &crop) == -1 || xioctl(fd, VIDIOC_G_CROP, &crop) == -1) {
+		return false;
+	}
+	r_crop = crop.c;
+	return true;
+}
+
+bool V4l2_Device::_crop_to_region() {
+	if (requested_region.has_no_area() && !region_cropped) {
+		// leave the camera's crop alone unless we changed it
+		return false;
+	}
+
+	// most webcams can't crop, those leave the region to the feed
+	struct v4l2_rect whole;
+	if (!_get_default_crop(whole) || whole.width == 0 || whole.height == 0) {
+		return false;
+	}
+
+	const int frame_width = fmt.fmt.pix.width;
+	const int frame_height = fmt.fmt.pix.height;
+	const Rect2i region = requested_region.intersection(Rect2i(0, 0, frame_width, frame_height));
+	if (region.has_no_area() || region == Rect2i(0, 0, frame_width, frame_height)) {
+		// don't keep a crop an earlier capture left behind
+		_set_crop(whole);
+		return false;
+	}
+
+	// The crop is in pixels of the sensor, which the driver scales to the frame size. The frames
+	// are then asked for at the size of the region, so they keep the scale of the whole frame.
+	struct v4l2_rect crop;
+	crop.left = whole.left + (int64_t)region.position.x * whole.width / frame_width;
+	crop.top = whole.top + (int64_t)region.position.y * whole.height / frame_height;
+	crop.width = (int64_t)region.size.x * whole.width / frame_width;
+	crop.height = (int64_t)region.size.y * whole.height / frame_height;
+	struct v4l2_rect wanted = crop;
+	if (!_set_crop(crop)) {
+		return false;
+	}
+	if (crop.left != wanted.left || crop.top != wanted.top || crop.width != wanted.width || crop.height != wanted.height) {
+		// rounded to what the sensor can do, which would no longer be the region asked for
+		_set_crop(whole);
+		return false;
+	}
+
+	fmt.fmt.pix.width = region.size.x;
+	fmt.fmt.pix.height = region.size.y;
+	fmt.fmt.pix.bytesperline = 0;
+	fmt.fmt.pix.sizeimage = 0;
+	return true;
+}
+
 bool V4l2_Device::close() {
 	if (buffer_available) {
 		cleanup_buffers();
@@ -237,6 +594,10 @@ bool V4l2_Device::request_buffers() {
 		return false;
 	}
 
+	// cropping on the camera sends less over the bus than cutting the region out of whole frames
+	struct v4l2_format whole_fmt = fmt;
+	region_cropped = _crop_to_region();
+
 	if (xioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
 #ifdef DEBUG_ENABLED
 		print_line("Cannot set format for " + String(dev_name.c_str()) + ".");
@@ -244,6 +605,52 @@ bool V4l2_Device::request_buffers() {
 		return false;
 	}
 
+	if (fmt.fmt.pix.pixelformat != whole_fmt.fmt.pix.pixelformat && !cached_probe_key.is_empty()) {
+		// the device changed in a way VIDIOC_QUERYCAP doesn't show, find its modes again
+		capability_cache->erase(cached_probe_key);
+		if (!check_device(true)) {
+			return false;
+		}
+		return request_buffers();
+	}
+
+	if (region_cropped && (fmt.fmt.pix.width != (unsigned int)requested_region.size.x || fmt.fmt.pix.height != (unsigned int)requested_region.size.y)) {
+		// the driver scales the crop to a size of its own, capture whole frames instead
+		struct v4l2_rect crop;
+		if (_get_default_crop(crop)) {
+			_set_crop(crop);
+		}
+		region_cropped = false;
+		fmt = whole_fmt;
+		if (xioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
+#ifdef DEBUG_ENABLED
+			print_line("Cannot set format for " + String(dev_name.c_str()) + ".");
+#endif
+			return false;
+		}
+	}
+
+	if (region_cropped) {
+		// smaller frames need smaller buffers
+		buffer_size = MAX(fmt.fmt.pix.sizeimage, MAX(fmt.fmt.pix.bytesperline, fmt.fmt.pix.width * 2) * fmt.fmt.pix.height);
+	}
+
+	if (requested_fps > 0.0) {
+		// not every camera lets us choose, those keep capturing at their default framerate
+		struct v4l2_streamparm parm;
+		CLEAR(parm);
+		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if (xioctl(fd, VIDIOC_G_PARM, &parm) != -1 && (parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+			parm.parm.capture.timeperframe.numerator = 1000;
+			parm.parm.capture.timeperframe.denominator = (__u32)Math::round(requested_fps * 1000.0);
+			if (xioctl(fd, VIDIOC_S_PARM, &parm) == -1) {
+#ifdef DEBUG_ENABLED
+				print_line("Cannot set framerate for " + String(dev_name.c_str()) + ".");
+#endif
+			}
+		}
+	}
+
 	width = 0;
 	height = 0;
 
@@ -274,7 +681,8 @@ bool V4l2_Device::request_buffers() {
 		case TYPE_IO_MMAP: {
 			CLEAR(req);
 
-			req.count = 4;
+			// the renderer holds on to a few extra buffers when they are shared
+			req.count = can_export_buffers() ? buffer_count + DMABUF_HELD_FRAMES : buffer_count;
 			req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 			req.memory = V4L2_MEMORY_MMAP;
 
@@ -306,6 +714,9 @@ bool V4l2_Device::request_buffers() {
 					if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1)
 						return false;
 
+					buffers[n_buffers].device = this;
+					buffers[n_buffers].index = n_buffers;
+					buffers[n_buffers].dmabuf_fd = -1;
 					buffers[n_buffers].length = buf.length;
 					buffers[n_buffers].start = funcs->mmap(
 							NULL /* start anywhere */,
@@ -332,7 +743,7 @@ bool V4l2_Device::request_buffers() {
 		case TYPE_IO_USRPTR: {
 			CLEAR(req);
 
-			req.count = 4;
+			req.count = buffer_count;
 			req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 			req.memory = V4L2_MEMORY_USERPTR;
 
@@ -340,14 +751,16 @@ bool V4l2_Device::request_buffers() {
 				return false;
 			}
 
-			buffers = (V4l2_Device::buffer *)calloc(4, sizeof(*buffers));
+			buffers = (V4l2_Device::buffer *)calloc(req.count, sizeof(*buffers));
 
 			if (!buffers) {
 				//fprintf(stderr, "Out of memory\n");
 				return false;
 			}
 
-			for (n_buffers = 0; n_buffers < 4; ++n_buffers) {
+			for (n_buffers = 0; n_buffers < req.count; ++n_buffers) {
+				buffers[n_buffers].device = this;
+				buffers[n_buffers].index = n_buffers;
 				buffers[n_buffers].length = buffer_size;
 				buffers[n_buffers].start = malloc(buffer_size);
 
@@ -366,6 +779,10 @@ bool V4l2_Device::request_buffers() {
 }
 
 void V4l2_Device::cleanup_buffers() {
+	// The feed hands every frame back before drop_pending_frames() and clear_shared_frames() return,
+	// which the capture stops with. A release coming in later would use unmapped memory and a deleted device.
+	CRASH_COND_MSG(buffers_in_flight.get() > 0, "Camera buffers of " + name + " are still in use by the renderer.");
+
 	switch (type) {
 		case TYPE_IO_READ: {
 			free(buffers[0].start);
@@ -373,8 +790,13 @@ void V4l2_Device::cleanup_buffers() {
 		}
 		case TYPE_IO_MMAP: {
 			for (unsigned int i = 0; i < n_buffers; ++i) {
+				if (buffers[i].dmabuf_fd != -1) {
+					// the renderer keeps its own reference to imported buffers
+					::close(buffers[i].dmabuf_fd);
+				}
 				funcs->munmap(buffers[i].start, buffers[i].length);
 			}
+			use_dmabuf = false;
 			break;
 		}
 		case TYPE_IO_USRPTR: {
@@ -396,37 +818,35 @@ V4l2_Device::~V4l2_Device() {
 }
 
 bool V4l2_Device::start_streaming(Ref<CameraFeed> feed) {
+	stream_feed = feed.ptr();
+	buffers_in_flight.set(0);
+
+	// frames the feed still has to cut the region out of are copied, the renderer would sample them whole
+	if (!_start_capture(region_cropped || requested_region.has_no_area())) {
+		stream_feed = nullptr;
+		return false;
+	}
+
+	streaming.set();
+	reactor->add_device(this);
+	return true;
+};
+
+bool V4l2_Device::_start_capture(bool share_buffers) {
 	enum v4l2_buf_type b_type;
 
+	// sample the buffers in place if the renderer can import them,
+	// otherwise their contents are uploaded every frame
+	use_dmabuf = share_buffers && type == TYPE_IO_MMAP && can_export_buffers() && export_buffers(stream_feed);
+	queued_buffers.set(0);
+	last_sequence = -1;
+
 	// start streaming depending on type
 	switch (type) {
-		case TYPE_IO_MMAP: {
-			for (unsigned int i = 0; i < n_buffers; ++i) {
-				CLEAR(buf);
-				buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				buf.memory = V4L2_MEMORY_MMAP;
-				buf.index = i;
-
-				if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
-					return false;
-			}
-			b_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			if (xioctl(fd, VIDIOC_STREAMON, &b_type) == -1)
-				return false;
-			break;
-		}
+		case TYPE_IO_MMAP:
 		case TYPE_IO_USRPTR: {
 			for (unsigned int i = 0; i < n_buffers; ++i) {
-				struct v4l2_buffer buf;
-
-				CLEAR(buf);
-				buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				buf.memory = V4L2_MEMORY_USERPTR;
-				buf.index = i;
-				buf.m.userptr = (unsigned long)buffers[i].start;
-				buf.length = buffers[i].length;
-
-				if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
+				if (!queue_buffer(i))
 					return false;
 			}
 			b_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -438,15 +858,19 @@ bool V4l2_Device::start_streaming(Ref<CameraFeed> feed) {
 			break;
 	}
 
-	streaming = true;
-	stream_thread = std::thread(&V4l2_Device::stream_image, this, feed);
+#ifdef MODULE_JPG_ENABLED
+	if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG) {
+		mjpeg_decoder.init(stream_feed);
+	}
+#endif
+
 	return true;
-};
+}
 
-void V4l2_Device::stop_streaming() {
-	streaming = false;
-	if (stream_thread.joinable())
-		stream_thread.join();
+void V4l2_Device::_stop_capture() {
+#ifdef MODULE_JPG_ENABLED
+	mjpeg_decoder.finish();
+#endif
 
 	switch (type) {
 		case TYPE_IO_MMAP:
@@ -460,126 +884,471 @@ void V4l2_Device::stop_streaming() {
 	}
 }
 
-void V4l2_Device::stream_image(Ref<CameraFeed> feed) {
-	fd_set fds;
-	struct timeval tv;
-	int r;
-	while (this->streaming) {
-		// check if new image available
-		do {
-			FD_ZERO(&fds);
-			FD_SET(this->fd, &fds);
-
-			/* Timeout. */
-			tv.tv_sec = 2;
-			tv.tv_usec = 0;
-
-			r = select(fd + 1, &fds, NULL, NULL, &tv);
-		} while (r == -1 && (errno == EINTR || errno == EAGAIN));
-		if (r <= 0) {
-			return;
+bool V4l2_Device::restart() {
+	// a frame that wasn't shown yet points into our buffers
+	stream_feed->drop_pending_frames();
+	_stop_capture();
+	if (use_dmabuf) {
+		stream_feed->clear_shared_frames();
+	}
+	close();
+
+	// the device may have come back with different capabilities
+	if (!check_device() || !request_buffers()) {
+		close();
+		return false;
+	}
+
+	// Importing buffers needs to wait for the renderer, which could be
+	// waiting for us to remove this device, so frames are copied from now on.
+	if (!_start_capture(false)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool V4l2_Device::can_export_buffers() {
+	// only NV12 maps onto textures the renderer can sample as is (an R8 Y plane and an RG8 CbCr plane)
+	if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_NV12) {
+		return false;
+	}
+
+	// formats emulated by libv4l2 are converted into its own buffers, exporting ours would give the raw data
+	struct v4l2_fmtdesc fmtdesc;
+	CLEAR(fmtdesc);
+	fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	while (xioctl(fd, VIDIOC_ENUM_FMT, &fmtdesc) != -1) {
+		if (fmtdesc.pixelformat == fmt.fmt.pix.pixelformat) {
+			return !(fmtdesc.flags & V4L2_FMT_FLAG_EMULATED);
 		}
+		fmtdesc.index++;
+	}
+	return false;
+}
 
-		// grab image depending on the type of image grabbing
-		// currently only tested for TYPE_IO_MMAP
-		switch (type) {
-			case TYPE_IO_READ: {
-				if (funcs->read(fd, buffers[0].start, buffers[0].length) == -1) {
-					switch (errno) {
-						case EAGAIN:
-							continue;
-						case EIO: // could be ignored somehow?
-						default:
-							return;
-					}
-				}
+bool V4l2_Device::export_buffers(Ref<CameraFeed> feed) {
+	unsigned int bpl = MAX(fmt.fmt.pix.bytesperline, fmt.fmt.pix.width);
+
+	CameraFeed::SharedPlane y_plane;
+	y_plane.width = fmt.fmt.pix.width;
+	y_plane.height = fmt.fmt.pix.height;
+	y_plane.row_pitch = bpl;
+	y_plane.format = Image::FORMAT_R8;
+
+	CameraFeed::SharedPlane cbcr_plane;
+	cbcr_plane.offset = bpl * fmt.fmt.pix.height;
+	cbcr_plane.width = (fmt.fmt.pix.width + 1) / 2;
+	cbcr_plane.height = (fmt.fmt.pix.height + 1) / 2;
+	cbcr_plane.row_pitch = bpl;
+	cbcr_plane.format = Image::FORMAT_RG8;
+
+	bool exported = true;
+	for (unsigned int i = 0; i < n_buffers && exported; ++i) {
+		struct v4l2_exportbuffer expbuf;
+		CLEAR(expbuf);
+		expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		expbuf.index = i;
+		expbuf.flags = O_RDONLY | O_CLOEXEC;
+		if (xioctl(fd, VIDIOC_EXPBUF, &expbuf) == -1) {
+			exported = false;
+			break;
+		}
+		buffers[i].dmabuf_fd = expbuf.fd;
 
-				get_image(feed, (uint8_t *)(buffers[0].start));
-				break;
+		y_plane.fd = expbuf.fd;
+		cbcr_plane.fd = expbuf.fd;
+		// frames are added in buffer order, so the frame index matches the buffer index
+		exported = feed->add_YCbCr_shared_frame(y_plane, cbcr_plane) == (int)i;
+	}
+
+	if (!exported) {
+		feed->clear_shared_frames();
+		for (unsigned int i = 0; i < n_buffers; ++i) {
+			if (buffers[i].dmabuf_fd != -1) {
+				::close(buffers[i].dmabuf_fd);
+				buffers[i].dmabuf_fd = -1;
 			}
-			case TYPE_IO_MMAP: {
-				CLEAR(buf);
+		}
+#ifdef DEBUG_ENABLED
+		print_line(String(dev_name.c_str()) + ": Buffers can't be shared with the renderer, copying frames instead.");
+#endif
+		return false;
+	}
 
-				buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				buf.memory = V4L2_MEMORY_MMAP;
+	width = fmt.fmt.pix.width;
+	height = fmt.fmt.pix.height;
+	return true;
+}
 
-				if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-					switch (errno) {
-						case EAGAIN:
-							continue;
-						case EIO: // could be ignored
-						default:
-							return;
-					}
-				}
+bool V4l2_Device::queue_buffer(unsigned int index) {
+	struct v4l2_buffer qbuf;
 
-				get_image(feed, (uint8_t *)(buffers[buf.index].start));
+	CLEAR(qbuf);
+	qbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	qbuf.index = index;
+	if (type == TYPE_IO_USRPTR) {
+		qbuf.memory = V4L2_MEMORY_USERPTR;
+		qbuf.m.userptr = (unsigned long)buffers[index].start;
+		qbuf.length = buffers[index].length;
+	} else {
+		qbuf.memory = V4L2_MEMORY_MMAP;
+	}
 
-				if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
-					return;
-				break;
+	if (xioctl(fd, VIDIOC_QBUF, &qbuf) == -1) {
+		return false;
+	}
+	queued_buffers.increment();
+	return true;
+}
+
+void V4l2_Device::release_buffer(void *userdata) {
+	// called by the renderer once the buffer has been uploaded, or once the GPU is done drawing with a shared one
+	struct buffer *b = (struct buffer *)userdata;
+	V4l2_Device *device = b->device;
+
+	if (device->streaming.is_set()) {
+		device->queue_buffer(b->index);
+	}
+	device->buffers_in_flight.decrement();
+}
+
+void V4l2_Device::stop_streaming() {
+	streaming.clear();
+	reactor->remove_device(this);
+	if (stream_feed) {
+		// also waits for the frame the renderer is uploading from our buffers
+		stream_feed->drop_pending_frames();
+	}
+	stream_feed = nullptr;
+
+	_stop_capture();
+}
+
+void V4l2_Device::_stamp_dequeued(const struct v4l2_buffer *dequeued) {
+	frame_timing = CameraFeed::FrameTiming();
+	frame_timing.dequeue_usec = OS::get_singleton()->get_ticks_usec();
+	if (dequeued == nullptr) {
+		// read() gives no timestamps
+		return;
+	}
+
+	// the driver ran out of buffers to capture into if we just took its last one
+	if (queued_buffers.get() > 0 && queued_buffers.decrement() == 0) {
+		stream_feed->report_underrun();
+	}
+
+	frame_timing.sequence = dequeued->sequence;
+	if (last_sequence >= 0 && frame_timing.sequence > last_sequence + 1) {
+		stream_feed->report_dropped_frames(frame_timing.sequence - last_sequence - 1);
+	}
+	last_sequence = frame_timing.sequence;
+
+	if ((dequeued->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+		// the driver stamps buffers with the monotonic clock, our ticks count from engine start
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		uint64_t now_usec = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+		uint64_t captured_usec = (uint64_t)dequeued->timestamp.tv_sec * 1000000 + dequeued->timestamp.tv_usec;
+		if (captured_usec <= now_usec && now_usec - captured_usec < frame_timing.dequeue_usec) {
+			frame_timing.capture_usec = frame_timing.dequeue_usec - (now_usec - captured_usec);
+		}
+	}
+}
+
+void V4l2_Device::_publish_timing(Ref<CameraFeed> feed) {
+	frame_timing.converted_usec = OS::get_singleton()->get_ticks_usec();
+	feed->set_frame_timing(frame_timing);
+}
+
+Error V4l2_Device::read_frame() {
+	Ref<CameraFeed> feed = stream_feed;
+
+	CameraFeed::DropPolicy drop_policy = feed->get_drop_policy();
+	if (drop_policy == CameraFeed::DROP_POLICY_BLOCK && feed->is_frame_pending()) {
+		// leave the frames with the driver until the waiting one was shown
+		return ERR_BUSY;
+	}
+
+	// grab image depending on the type of image grabbing
+	// currently only tested for TYPE_IO_MMAP
+	switch (type) {
+		case TYPE_IO_READ: {
+			long int size = funcs->read(fd, buffers[0].start, buffers[0].length);
+			if (size == -1) {
+				return errno == EAGAIN ? ERR_BUSY : ERR_CANT_ACQUIRE_RESOURCE;
 			}
-			case TYPE_IO_USRPTR: {
-				CLEAR(buf);
 
-				buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				buf.memory = V4L2_MEMORY_USERPTR;
+			_stamp_dequeued(nullptr);
+			get_image(feed, (uint8_t *)(buffers[0].start), size, nullptr);
+			break;
+		}
+		case TYPE_IO_MMAP: {
+			CLEAR(buf);
 
-				if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-					switch (errno) {
-						case EAGAIN:
-							continue;
-						case EIO: // could be ignored
-						default:
-							return;
-					}
-				}
+			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory = V4L2_MEMORY_MMAP;
 
-				for (unsigned int i = 0; i < n_buffers; ++i)
-					if (buf.m.userptr == (unsigned long)buffers[i].start && buf.length == buffers[i].length)
-						break;
+			if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
+				return errno == EAGAIN ? ERR_BUSY : ERR_CANT_ACQUIRE_RESOURCE;
+			}
+
+			_stamp_dequeued(&buf);
 
-				get_image(feed, (uint8_t *)(buf.m.userptr));
+			if (drop_policy == CameraFeed::DROP_POLICY_NEWEST && feed->is_frame_pending()) {
+				// don't bother converting a frame that won't be shown
+				feed->report_skipped_frame();
+				if (!queue_buffer(buf.index))
+					return ERR_CANT_ACQUIRE_RESOURCE;
+				break;
+			}
 
-				if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
-					return;
+			if (use_dmabuf) {
+				// the buffer is mapped as well, for the feed's CPU side copy of the latest frame
+				unsigned int bpl = MAX(fmt.fmt.pix.bytesperline, fmt.fmt.pix.width);
+				const uint8_t *start = (const uint8_t *)buffers[buf.index].start;
+
+				CameraFeed::FramePlane y_plane;
+				y_plane.data = start;
+				y_plane.width = fmt.fmt.pix.width;
+				y_plane.height = fmt.fmt.pix.height;
+				y_plane.row_pitch = bpl;
+				y_plane.format = Image::FORMAT_R8;
+
+				CameraFeed::FramePlane cbcr_plane;
+				cbcr_plane.data = start + bpl * fmt.fmt.pix.height;
+				cbcr_plane.width = (fmt.fmt.pix.width + 1) / 2;
+				cbcr_plane.height = (fmt.fmt.pix.height + 1) / 2;
+				cbcr_plane.row_pitch = bpl;
+				cbcr_plane.format = Image::FORMAT_RG8;
+
+				// queued again once the GPU is done drawing with it
+				buffers_in_flight.increment();
+				_publish_timing(feed);
+				feed->set_YCbCr_shared_frame(buf.index, y_plane, cbcr_plane, &V4l2_Device::release_buffer, &buffers[buf.index]);
 				break;
 			}
-			default:
+
+			if (get_image(feed, (uint8_t *)(buffers[buf.index].start), buf.bytesused, &buffers[buf.index])) {
+				// queued again once the renderer is done with it
 				break;
+			}
+
+			if (!queue_buffer(buf.index))
+				return ERR_CANT_ACQUIRE_RESOURCE;
+			break;
+		}
+		case TYPE_IO_USRPTR: {
+			CLEAR(buf);
+
+			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory = V4L2_MEMORY_USERPTR;
+
+			if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
+				return errno == EAGAIN ? ERR_BUSY : ERR_CANT_ACQUIRE_RESOURCE;
+			}
+
+			_stamp_dequeued(&buf);
+
+			unsigned int i;
+			for (i = 0; i < n_buffers; ++i)
+				if (buf.m.userptr == (unsigned long)buffers[i].start && buf.length == buffers[i].length)
+					break;
+
+			if (drop_policy == CameraFeed::DROP_POLICY_NEWEST && feed->is_frame_pending()) {
+				// don't bother converting a frame that won't be shown
+				feed->report_skipped_frame();
+			} else if (i < n_buffers && get_image(feed, (uint8_t *)(buf.m.userptr), buf.bytesused, &buffers[i])) {
+				// queued again once the renderer is done with it
+				break;
+			}
+
+			if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
+				return ERR_CANT_ACQUIRE_RESOURCE;
+			queued_buffers.increment();
+			break;
 		}
+		default:
+			return ERR_UNAVAILABLE;
 	}
-}
 
-void V4l2_Device::get_image(Ref<CameraFeed> feed, uint8_t *buffer) {
-	Ref<Image> img;
-	img.instantiate();
+	return OK;
+}
 
+bool V4l2_Device::get_image(Ref<CameraFeed> feed, uint8_t *buffer, size_t size, struct buffer *hold_buffer) {
+	// If hold_buffer is set, formats that the renderer can take as is
+	// are uploaded straight from the buffer. In that case true is returned
+	// and the buffer is queued again once the upload is done.
 	if (xioctl(fd, VIDIOC_G_FMT, &fmt) == -1) {
-		return;
+		return false;
 	}
 
+	unsigned int new_width = fmt.fmt.pix.width;
+	unsigned int new_height = fmt.fmt.pix.height;
+	// some drivers leave bytesperline empty
+	unsigned int bpl = fmt.fmt.pix.bytesperline;
+
 	// other format implementations should be put here.
 	// Mainly useful if libv4l2 is not installed
 	switch (fmt.fmt.pix.pixelformat) {
 		case V4L2_PIX_FMT_RGB24: {
-			if (width != fmt.fmt.pix.width || height != fmt.fmt.pix.height) {
-				width = fmt.fmt.pix.width;
-				height = fmt.fmt.pix.height;
-				img_data.resize(width * height * 3);
+			if (bpl < new_width * 3) {
+				bpl = new_width * 3;
 			}
 
-			uint8_t *w = img_data.ptrw();
-			// TODO: Buffer is 1024 Byte longer?
-			memcpy(w, buffer, width * height * 3);
+			if (hold_buffer != nullptr) {
+				width = new_width;
+				height = new_height;
+
+				CameraFeed::FramePlane rgb;
+				rgb.data = buffer;
+				rgb.width = width;
+				rgb.height = height;
+				rgb.row_pitch = bpl;
+				rgb.format = Image::FORMAT_RGB8;
+
+				buffers_in_flight.increment();
+				_publish_timing(feed);
+				feed->set_RGB_raw(rgb, &V4l2_Device::release_buffer, hold_buffer);
+				return true;
+			}
 
-			img->create(width, height, 0, Image::FORMAT_RGB8, img_data);
+			width = new_width;
+			height = new_height;
+			Ref<Image> img = feed->acquire_image(width, height, Image::FORMAT_RGBA8);
+			ERR_FAIL_COND_V(img.is_null(), false);
+
+			// we copy anyway, so hand the renderer RGBA it can take as is
+			YUVConverter::Source source;
+			source.format = YUVConverter::SOURCE_RGB24;
+			source.planes[0] = buffer;
+			source.strides[0] = bpl;
+			source.width = width;
+			source.height = height;
+			YUVConverter::convert_to_rgba8(source, img->ptrw());
+
+			_publish_timing(feed);
 			feed->set_RGB_img(img);
 			break;
 		}
+		case V4L2_PIX_FMT_NV12: {
+			// full resolution Y plane followed by an interleaved
+			// CbCr plane at half resolution in both directions
+			if (bpl < new_width) {
+				bpl = new_width;
+			}
+			unsigned int cbcr_width = (new_width + 1) / 2;
+			unsigned int cbcr_height = (new_height + 1) / 2;
+			const uint8_t *cbcr = buffer + bpl * new_height;
+
+			if (hold_buffer != nullptr) {
+				// both planes map directly onto R8 and RG8 textures
+				width = new_width;
+				height = new_height;
+
+				CameraFeed::FramePlane y_plane;
+				y_plane.data = buffer;
+				y_plane.width = width;
+				y_plane.height = height;
+				y_plane.row_pitch = bpl;
+				y_plane.format = Image::FORMAT_R8;
+
+				CameraFeed::FramePlane cbcr_plane;
+				cbcr_plane.data = cbcr;
+				cbcr_plane.width = cbcr_width;
+				cbcr_plane.height = cbcr_height;
+				cbcr_plane.row_pitch = bpl;
+				cbcr_plane.format = Image::FORMAT_RG8;
+
+				buffers_in_flight.increment();
+				_publish_timing(feed);
+				feed->set_YCbCr_raws(y_plane, cbcr_plane, &V4l2_Device::release_buffer, hold_buffer);
+				return true;
+			}
+
+			width = new_width;
+			height = new_height;
+			Ref<Image> y_img = feed->acquire_image(width, height, Image::FORMAT_R8);
+			Ref<Image> cbcr_img = feed->acquire_image(cbcr_width, cbcr_height, Image::FORMAT_RG8);
+			ERR_FAIL_COND_V(y_img.is_null() || cbcr_img.is_null(), false);
+
+			uint8_t *w = y_img->ptrw();
+			for (unsigned int y = 0; y < height; y++) {
+				memcpy(w + y * width, buffer + y * bpl, width);
+			}
+
+			w = cbcr_img->ptrw();
+			for (unsigned int y = 0; y < cbcr_height; y++) {
+				memcpy(w + y * cbcr_width * 2, cbcr + y * bpl, cbcr_width * 2);
+			}
+
+			_publish_timing(feed);
+			feed->set_YCbCr_imgs(y_img, cbcr_img);
+			break;
+		}
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY: {
+			// packed 4:2:2, two pixels share one Cb and one Cr sample.
+			// Split into a Y plane and a CbCr plane at half horizontal
+			// resolution, the conversion to RGB is done by the shader.
+			if (bpl < new_width * 2) {
+				bpl = new_width * 2;
+			}
+			// an odd width ends in half a macropixel, its Cr sample is only there if the line has room for it
+			unsigned int cbcr_width = (new_width + 1) / 2;
+			bool whole_last = bpl >= cbcr_width * 4;
+			width = new_width;
+			height = new_height;
+			Ref<Image> y_img = feed->acquire_image(width, height, Image::FORMAT_R8);
+			Ref<Image> cbcr_img = feed->acquire_image(cbcr_width, height, Image::FORMAT_RG8);
+			ERR_FAIL_COND_V(y_img.is_null() || cbcr_img.is_null(), false);
+
+			// byte offsets of Y0 and Cb within a macropixel, Y1 and Cr follow 2 bytes later
+			unsigned int y_ofs = fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUYV ? 0 : 1;
+			unsigned int c_ofs = 1 - y_ofs;
+
+			uint8_t *wy = y_img->ptrw();
+			uint8_t *wc = cbcr_img->ptrw();
+			for (unsigned int y = 0; y < height; y++) {
+				const uint8_t *src = buffer + y * bpl;
+				uint8_t *dst_y = wy + y * width;
+				uint8_t *dst_c = wc + y * cbcr_width * 2;
+				for (unsigned int x = 0; x < width / 2; x++) {
+					dst_y[0] = src[y_ofs];
+					dst_y[1] = src[y_ofs + 2];
+					dst_c[0] = src[c_ofs];
+					dst_c[1] = src[c_ofs + 2];
+					src += 4;
+					dst_y += 2;
+					dst_c += 2;
+				}
+				if (width & 1) {
+					dst_y[0] = src[y_ofs];
+					dst_c[0] = src[c_ofs];
+					dst_c[1] = whole_last ? src[c_ofs + 2] : 128;
+				}
+			}
+
+			_publish_timing(feed);
+			feed->set_YCbCr_imgs(y_img, cbcr_img);
+			break;
+		}
+#ifdef MODULE_JPG_ENABLED
+		case V4L2_PIX_FMT_MJPEG: {
+			// decoded and handed to the feed by the decoder's workers,
+			// the frame is dropped if they are all still busy
+			width = new_width;
+			height = new_height;
+			feed->record_encoded_frame(buffer, size, frame_timing);
+			mjpeg_decoder.submit(buffer, size, frame_timing);
+			break;
+		}
+#endif
 		default:
 			break;
 	}
+
+	return false;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -603,6 +1372,7 @@ void CameraFeedX11::set_device(V4l2_Device *p_device) {
 };
 
 CameraFeedX11::~CameraFeedX11() {
+	wait_for_activation();
 	this->deactivate_feed();
 	if (device != NULL) {
 		memdelete(device);
@@ -612,15 +1382,25 @@ CameraFeedX11::~CameraFeedX11() {
 
 bool CameraFeedX11::activate_feed() {
 	// activate streaming if not already
-	if (!device->streaming) {
-		if (!device->check_device()) {
+	if (!device->streaming.is_set()) {
+		if (!device->probe()) {
 			return false;
 		}
+		Rect2i region;
+		{
+			MutexLock lock(activation_mutex);
+			device->set_buffer_count(queue_depth);
+			region = region_of_interest;
+		}
 		if (!device->request_buffers()) {
 			device->close();
 			return false;
 		}
+		ycbcr_full_range = device->is_full_range();
+		// the feed only cuts out what the camera didn't crop already
+		_set_cpu_region(device->is_region_cropped() ? Rect2i() : region);
 		if (!device->start_streaming(this)) {
+			clear_shared_frames();
 			device->cleanup_buffers();
 			device->close();
 			return false;
@@ -630,15 +1410,204 @@ bool CameraFeedX11::activate_feed() {
 	return true;
 };
 
+Array CameraFeedX11::get_formats() {
+	return device->get_formats();
+}
+
+bool CameraFeedX11::set_format(int p_width, int p_height, const String &p_pixel_format, float p_fps) {
+	ERR_FAIL_COND_V(p_width <= 0 || p_height <= 0, false);
+	ERR_FAIL_COND_V(p_fps < 0.0, false);
+	__u32 pixelformat = V4l2_Device::string_to_fourcc(p_pixel_format);
+	ERR_FAIL_COND_V_MSG(pixelformat == 0, false, "Invalid pixel format \"" + p_pixel_format + "\".");
+	if (std::find(supported_formats.begin(), supported_formats.end(), pixelformat) == supported_formats.end()) {
+		return false;
+	}
+
+	{
+		MutexLock lock(activation_mutex);
+		pending_format.width = p_width;
+		pending_format.height = p_height;
+		pending_format.pixelformat = pixelformat;
+		pending_format.fps = p_fps;
+		format_pending = true;
+	}
+	// probing the camera for the mode takes a while
+	_request_settings_change();
+	return true;
+}
+
+void CameraFeedX11::set_queue_depth(int p_depth) {
+	{
+		MutexLock lock(activation_mutex);
+		int previous_depth = queue_depth;
+		CameraFeed::set_queue_depth(p_depth);
+		if (queue_depth == previous_depth) {
+			return;
+		}
+	}
+	_request_settings_change();
+}
+
+void CameraFeedX11::set_region_of_interest(const Rect2i &p_region) {
+	ERR_FAIL_COND(p_region.position.x < 0 || p_region.position.y < 0 || p_region.size.x < 0 || p_region.size.y < 0);
+
+	{
+		MutexLock lock(activation_mutex);
+		if (region_of_interest == p_region) {
+			return;
+		}
+		// the CPU region follows once the camera knows whether it crops itself
+		region_of_interest = p_region;
+	}
+	_request_settings_change();
+}
+
+void CameraFeedX11::apply_settings() {
+	PendingFormat format;
+	bool has_format;
+	Rect2i region;
+	{
+		MutexLock lock(activation_mutex);
+		format = pending_format;
+		has_format = format_pending;
+		format_pending = false;
+		region = region_of_interest;
+	}
+
+	if (has_format && !device->set_format(format.width, format.height, format.pixelformat, format.fps)) {
+		WARN_PRINT("Camera " + name + " can't capture in " + V4l2_Device::fourcc_to_string(format.pixelformat) + vformat(" at %dx%d, it keeps its previous mode.", format.width, format.height));
+	}
+	device->set_region(region);
+}
+
+bool CameraFeedX11::can_record(RecordingFormat p_format) const {
+#ifdef MODULE_JPG_ENABLED
+	if (p_format == RECORDING_FORMAT_MJPEG) {
+		// the frames are recorded before they are decoded
+		return device != NULL && device->get_pixelformat() == V4L2_PIX_FMT_MJPEG;
+	}
+#endif
+	return CameraFeed::can_record(p_format);
+}
+
+void CameraFeedX11::check_feed() {
+	if (!device->check_device(true)) {
+		// the hotplug thread owns the list of feeds, it hands the removal to the server
+		lost.set();
+		CameraX11 *server = static_cast<CameraX11 *>(CameraServer::get_singleton());
+		if (server) {
+			server->wake_hotplug_thread();
+		}
+	}
+}
+
+bool CameraFeedX11::is_lost() const {
+	return lost.is_set();
+}
+
 void CameraFeedX11::deactivate_feed() {
 	// end camera capture if we have one
-	if (device->streaming) {
+	if (device->streaming.is_set()) {
 		device->stop_streaming();
+		// the capture thread is done, so no frame is shown from the buffers anymore
+		clear_shared_frames();
 		device->cleanup_buffers();
 		device->close();
 	};
 };
 
+Ref<CameraFeedX11> CameraX11::find_feed(const std::string &dev_name) {
+	for (int i = 0; i < devices.size(); ++i) {
+		if (devices[i]->get_device()->dev_name == dev_name) {
+			return devices[i];
+		}
+	}
+	return Ref<CameraFeedX11>();
+}
+
+void CameraX11::remove_device(const Ref<CameraFeedX11> &p_feed) {
+	// the queued change keeps the feed alive, so it is destroyed on the main thread
+	queue_remove_feed(p_feed);
+	devices.erase(p_feed);
+}
+
+void CameraX11::remove_lost_devices() {
+	for (int i = devices.size() - 1; i >= 0; --i) {
+		if (devices[i]->is_lost()) {
+			remove_device(devices[i]);
+		}
+	}
+}
+
+void CameraX11::wake_hotplug_thread() {
+	if (wake_fd != -1) {
+		uint64_t one = 1;
+		if (write(wake_fd, &one, sizeof(one)) == -1) {
+			// the thread is woken up already
+		}
+	}
+}
+
+void CameraX11::add_device(const std::string &dev_name, bool print_debug) {
+	struct stat st;
+	if (stat(dev_name.c_str(), &st) == -1) {
+		rejected_nodes.erase(dev_name);
+		return;
+	}
+
+	// don't open nodes again that weren't usable and haven't changed since
+	std::map<std::string, RejectedNode>::iterator rejected = rejected_nodes.find(dev_name);
+	if (rejected != rejected_nodes.end()) {
+		if (rejected->second.rdev == st.st_rdev && rejected->second.ctime == st.st_ctime) {
+			return;
+		}
+		rejected_nodes.erase(rejected);
+	}
+
+	// create new device and check if it is compatible
+	V4l2_Device *dev = memnew(V4l2_Device(dev_name, &this->funcs, &this->reactor, &this->capability_cache));
+	if (dev->check_device(print_debug)) {
+		Ref<CameraFeedX11> newfeed;
+		newfeed.instantiate();
+		newfeed->set_device(dev);
+
+		// assume display camera so inverse
+		Transform2D transform = Transform2D(-1.0, 0.0, 0.0, -1.0, 1.0, 1.0);
+		newfeed->set_transform(transform);
+
+		// the server's feed list belongs to the main thread
+		devices.push_back(newfeed);
+		queue_add_feed(newfeed);
+	} else {
+		memdelete(dev);
+
+		RejectedNode node;
+		node.rdev = st.st_rdev;
+		node.ctime = st.st_ctime;
+		rejected_nodes[dev_name] = node;
+	}
+}
+
+void CameraX11::update_device(const std::string &dev_name) {
+	Ref<CameraFeedX11> feed = find_feed(dev_name);
+	if (feed.is_null()) {
+		add_device(dev_name, true);
+		return;
+	}
+
+	struct stat st;
+	if (stat(dev_name.c_str(), &st) == -1 || !S_ISCHR(st.st_mode)) {
+		remove_device(feed);
+		return;
+	}
+
+	// A streaming device notices problems itself and is reopened by the
+	// capture reactor. Otherwise probe it again, its permissions or the
+	// device behind the node may have changed. That happens on the thread
+	// that brings the feed up and down, so the two never use the device at once.
+	feed->request_check();
+}
+
 void CameraX11::update_feeds() {
 	DIR *dir;
 	struct dirent *ent;
@@ -656,63 +1625,27 @@ void CameraX11::update_feeds() {
 	// sort so we start with video0
 	std::sort(devs.begin(), devs.end());
 
-	int j;
-	unsigned int i;
-	std::vector<std::string>::iterator it;
-
-	// remove missing feeds
-	for (j = 0; j < feeds.size(); ++j) {
-		Ref<CameraFeedX11> feed = (Ref<CameraFeedX11>)feeds[j];
-		std::string dev_name = feed->get_device()->dev_name;
-		it = std::find(devs.begin(), devs.end(), dev_name);
-		// also check if device is still openable
-		if (it == devs.end() || !feed->get_device()->check_device(!alive)) {
-			remove_feed(feed);
+	// remove missing feeds, feeds that are still there keep their
+	// capabilities and are only probed again when they change
+	remove_lost_devices();
+	for (int j = devices.size() - 1; j >= 0; --j) {
+		if (std::find(devs.begin(), devs.end(), devices[j]->get_device()->dev_name) == devs.end()) {
+			remove_device(devices[j]);
 		}
 	}
 
-	for (i = 0; i < devs.size(); ++i) {
+	for (unsigned int i = 0; i < devs.size(); ++i) {
 		// keep existing devices
 		// currently only check by /dev/video* name
-		bool found = false;
-		for (j = 0; j < feeds.size(); ++j) {
-			Ref<CameraFeedX11> feed = (Ref<CameraFeedX11>)feeds[j];
-			if (devs[i] == feed->get_device()->dev_name) {
-				found = true;
-				break;
-			}
-		}
-		if (!found) {
-			// create new device and check if it is compatible
-			V4l2_Device *dev = memnew(V4l2_Device(devs[i].c_str(), &this->funcs));
-			if (dev->check_device(!alive)) {
-				Ref<CameraFeedX11> newfeed;
-				newfeed.instantiate();
-				newfeed->set_device(dev);
-
-				// assume display camera so inverse
-				Transform2D transform = Transform2D(-1.0, 0.0, 0.0, -1.0, 1.0, 1.0);
-				newfeed->set_transform(transform);
-
-				add_feed(newfeed);
-			} else {
-				memdelete(dev);
-			}
+		if (find_feed(devs[i]).is_null()) {
+			// only the first search prints why nodes aren't used, incompatible
+			// nodes would print the same messages again on every change
+			add_device(devs[i], !are_feeds_ready());
 		}
 	}
 };
 
-void CameraX11::check_change() {
-	// simple hotplug functionality
-	// checks for new cameras (or removed cameras)
-	// every second.
-	while (alive) {
-		update_feeds();
-		usleep(1000000);
-	}
-}
-
-CameraX11::CameraX11() {
+void CameraX11::load_functions() {
 	// determine if libv4l2 is installed and
 	// set functions appropriately
 	libv4l2 = dlopen("libv4l2.so.0", RTLD_NOW);
@@ -744,24 +1677,128 @@ CameraX11::CameraX11() {
 		print_line("libv4l2 found.");
 #endif
 	}
+}
 
-	// Find available cameras we have at this time
+void CameraX11::check_change() {
+	// Probing every node can take a while, so the cameras present at startup are looked
+	// for here rather than holding up the engine. Asking for the feeds waits for it.
+	load_functions();
+	capability_cache.load(OS::get_singleton()->get_cache_path().plus_file(OS::get_singleton()->get_godot_dir_name()).plus_file("camera_capabilities.cfg"));
 	update_feeds();
+	capability_cache.save();
+	finish_enumeration();
+
+	if (inotify_fd == -1) {
+		// no change notifications available, look every second
+		while (alive) {
+			usleep(1000000);
+			update_feeds();
+			capability_cache.save();
+		}
+		return;
+	}
+
+	// only nodes that were created, removed or changed are probed
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (alive) {
+		struct pollfd fds[2];
+		fds[0].fd = inotify_fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = wake_fd;
+		fds[1].events = POLLIN;
+
+		int r = poll(fds, 2, -1);
+		if (r == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ERR_PRINT("Can't watch for camera changes anymore.");
+			return;
+		}
+		if (!alive) {
+			break;
+		}
+		if (fds[1].revents & POLLIN) {
+			uint64_t count;
+			if (read(wake_fd, &count, sizeof(count)) == -1) {
+				// someone else read it
+			}
+		}
+		remove_lost_devices();
+
+		std::vector<std::string> changed;
+		bool overflow = false;
+		long int len;
+		while ((len = read(inotify_fd, events, sizeof(events))) > 0) {
+			for (char *ptr = events; ptr < events + len;) {
+				const struct inotify_event *event = (const struct inotify_event *)ptr;
+				if (event->mask & IN_Q_OVERFLOW) {
+					overflow = true;
+				} else if (event->len > 0 && strncmp(event->name, "video", 5) == 0) {
+					std::string dev_name = std::string("/dev/") + std::string(event->name);
+					if (std::find(changed.begin(), changed.end(), dev_name) == changed.end()) {
+						changed.push_back(dev_name);
+					}
+				}
+				ptr += sizeof(struct inotify_event) + event->len;
+			}
+		}
 
-	// start the hotplug thread
-	// alive is also used to trigger debug output
-	// (as devices that are incompatible would always be checked
-	// and therefore print always debug messages)
+		if (overflow) {
+			// events were lost, compare everything
+			update_feeds();
+		} else {
+			std::sort(changed.begin(), changed.end());
+			for (unsigned int i = 0; i < changed.size(); ++i) {
+				update_device(changed[i]);
+			}
+		}
+		capability_cache.save();
+	}
+}
+
+CameraX11::CameraX11() {
+	// one set of threads captures the frames of all our cameras
+	reactor.init();
+
+	// Device nodes are created and removed in /dev, udev then adjusts
+	// their permissions, all of which inotify reports. Watch before the
+	// first scan so nothing that shows up in between is missed.
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd != -1 && inotify_add_watch(inotify_fd, "/dev", IN_CREATE | IN_DELETE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO) == -1) {
+		::close(inotify_fd);
+		inotify_fd = -1;
+	}
+	if (inotify_fd != -1) {
+		wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (wake_fd == -1) {
+			::close(inotify_fd);
+			inotify_fd = -1;
+		}
+	}
+
+	// start the hotplug thread, which finds the cameras we have at this time first
 	alive = true;
+	begin_enumeration();
 	hotplug_thread = std::thread(&CameraX11::check_change, this);
 };
 
 CameraX11::~CameraX11() {
 	// end the hotplug thread
 	alive = false;
+	wake_hotplug_thread();
 	if (hotplug_thread.joinable()) {
 		hotplug_thread.join();
 	}
+	if (inotify_fd != -1) {
+		::close(inotify_fd);
+	}
+	if (wake_fd != -1) {
+		::close(wake_fd);
+	}
+
+	// stop capturing, feeds that are still streaming are no longer serviced
+	reactor.finish();
 
 	// close the library
 	if (this->libv4l2 != NULL) {
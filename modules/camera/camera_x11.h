@@ -33,13 +33,23 @@
 
 #include <linux/videodev2.h>
 #include <stdint.h>
+#include <sys/types.h>
+#include <map>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "camera_capability_cache.h"
+#include "camera_reactor.h"
 #include "servers/camera/camera_feed.h"
 #include "servers/camera_server.h"
 
+#include "modules/modules_enabled.gen.h" // For jpg.
+
+#ifdef MODULE_JPG_ENABLED
+#include "camera_mjpeg.h"
+#endif
+
 enum IOType {
 	TYPE_IO_NONE = 0, // not usable
 	TYPE_IO_MMAP = 1, // using mmap buffers
@@ -66,6 +76,11 @@ private:
 	struct buffer {
 		void *start;
 		size_t length;
+		// used to queue the buffer again once the renderer released it
+		V4l2_Device *device;
+		unsigned int index;
+		// exported dmabuf, -1 if the buffer isn't shared with the renderer
+		int dmabuf_fd;
 	} * buffers;
 	unsigned int n_buffers;
 	struct v4l2_buffer buf;
@@ -74,79 +89,211 @@ private:
 	// only for read and userp
 	unsigned int buffer_size;
 
+	// what check_device found, streaming changes the live values
+	bool probed = false;
+	struct v4l2_format probed_fmt;
+	IOType probed_type = TYPE_IO_NONE;
+	unsigned int probed_buffer_size = 0;
+
+	// what probing found on earlier runs, nodes that didn't change aren't probed again
+	CameraCapabilityCache *capability_cache;
+	String cached_probe_key; // the entry check_device took its results from, empty if it probed
+	void _cache_probe(const String &key, bool usable);
+
+	// the capture mode asked for through set_format, the camera's default if no pixelformat is set
+	__u32 requested_pixelformat = 0;
+	unsigned int requested_width = 0;
+	unsigned int requested_height = 0;
+	float requested_fps = 0.0;
+	// whether check_device could use the requested mode
+	bool requested_format_found = false;
+	// part of the frame to capture, in pixels of the whole frame, empty for all of it
+	Rect2i requested_region;
+	// whether the camera crops to requested_region itself, set by request_buffers
+	bool region_cropped = false;
+	bool _get_default_crop(struct v4l2_rect &r_crop);
+	bool _set_crop(struct v4l2_rect &r_crop);
+	bool _crop_to_region();
+	void _add_modes(Array &r_formats, int fd, __u32 pixelformat, unsigned int width, unsigned int height);
+
 	// the file descriptor
 	int fd = -1;
 	// the v4l2 functions (either libv4l2 or normal v4l2)
 	struct v4l2_funcs *funcs;
-	// the image data
-	Vector<uint8_t> img_data;
 	// whether device is initialized
 	// access type and used pixelformat
 	IOType type = TYPE_IO_NONE;
 
-	// Thread that set image to the feed
-	std::thread stream_thread;
-	// and the function for the thread
-	void stream_image(Ref<CameraFeed> feed);
-	void get_image(Ref<CameraFeed> feed, uint8_t *buffer);
+#ifdef MODULE_JPG_ENABLED
+	// decodes MJPEG frames off the capture thread
+	CameraMJPEGDecoder mjpeg_decoder;
+#endif
+
+	// captures our frames while streaming
+	CameraCaptureReactor *reactor;
+	// the feed frames go to, only set while streaming
+	CameraFeed *stream_feed = nullptr;
+	bool _start_capture(bool share_buffers);
+	void _stop_capture();
+	// timing of the frame being handed to the feed
+	CameraFeed::FrameTiming frame_timing;
+	void _stamp_dequeued(const struct v4l2_buffer *dequeued);
+	void _publish_timing(Ref<CameraFeed> feed);
+	bool get_image(Ref<CameraFeed> feed, uint8_t *buffer, size_t size, struct buffer *hold_buffer);
 
 	// ioctl with some signal tolerance
 	int xioctl(int fd, unsigned long int request, void *arg);
 	bool buffer_available = false;
 
+	// number of buffers to capture into, see CameraFeed::set_queue_depth()
+	unsigned int buffer_count = 4;
+	// buffers the driver can capture into, it drops frames when none are left
+	SafeNumeric<uint32_t> queued_buffers;
+	// frame number of the last dequeued buffer, to notice the frames the driver dropped
+	int64_t last_sequence = -1;
+
+	// buffers handed to the renderer without copying, queued again once uploaded
+	SafeNumeric<uint32_t> buffers_in_flight;
+	bool queue_buffer(unsigned int index);
+	static void release_buffer(void *userdata);
+
+	// Buffers exported as dmabufs are sampled by the GPU in place. The feed hands
+	// a shown buffer back once the GPU is done drawing with it, which takes a few
+	// frames, so a few more buffers are requested to capture into meanwhile.
+	enum {
+		DMABUF_HELD_FRAMES = 3
+	};
+	bool use_dmabuf = false;
+	bool can_export_buffers();
+	bool export_buffers(Ref<CameraFeed> feed);
+
 public:
 	bool use_libv4l2;
 	bool opened = false;
 
-	bool streaming = false;
+	SafeFlag streaming; // read by release_buffer() on the render thread
 	std::string dev_name;
 	String name;
 
 	unsigned int width = 0;
 	unsigned int height = 0;
 
-	V4l2_Device(std::string dev_name, struct v4l2_funcs *funcs);
+	V4l2_Device(std::string dev_name, struct v4l2_funcs *funcs, CameraCaptureReactor *reactor, CameraCapabilityCache *capability_cache);
 	~V4l2_Device();
 
 	bool check_device(bool print_debug = false);
+	// like check_device, but reuses the last successful result
+	bool probe();
+	void invalidate_probe() { probed = false; }
 	bool close();
 
+	// capture modes of the camera, see CameraFeed::get_formats()
+	Array get_formats();
+	// false if the camera can't capture in pixelformat, the previous mode is kept then
+	bool set_format(unsigned int width, unsigned int height, __u32 pixelformat, float fps);
+
+	static String fourcc_to_string(__u32 fourcc);
+	static __u32 string_to_fourcc(const String &fourcc);
+	__u32 get_pixelformat() const { return fmt.fmt.pix.pixelformat; }
+	// the driver's default for YCbCr is limited range
+	bool is_full_range() const { return fmt.fmt.pix.quantization == V4L2_QUANTIZATION_FULL_RANGE; }
+
+	// used by the next request_buffers()
+	void set_buffer_count(unsigned int count) { buffer_count = count; }
+	void set_region(const Rect2i &region) { requested_region = region; }
+	// false if the frames are captured whole and the feed has to cut the region out
+	bool is_region_cropped() const { return region_cropped; }
 	bool request_buffers();
 	void cleanup_buffers();
 
 	bool start_streaming(Ref<CameraFeed> feed);
 	void stop_streaming();
+
+	// used by the capture reactor
+	int get_fd() const { return fd; }
+	// OK if a frame was captured, ERR_BUSY if there was none yet, any other error if the device failed
+	Error read_frame();
+	// reopens a failed device, false if it should be tried again later
+	bool restart();
 };
 
 class CameraFeedX11 : public CameraFeed {
 private:
 	V4l2_Device *device;
 
+	// the mode set_format() asked for, applied on the activation thread, guarded by activation_mutex
+	struct PendingFormat {
+		int width = 0;
+		int height = 0;
+		__u32 pixelformat = 0;
+		float fps = 0.0;
+	};
+	PendingFormat pending_format;
+	bool format_pending = false;
+
+	// set by check_feed(), the hotplug thread then removes the feed
+	SafeFlag lost;
+
 public:
 	V4l2_Device *get_device() const;
+	bool is_lost() const;
 
 	CameraFeedX11();
 	~CameraFeedX11();
 
 	void set_device(V4l2_Device *p_device);
 
+	Array get_formats();
+	bool set_format(int p_width, int p_height, const String &p_pixel_format, float p_fps = 0.0);
+	void set_queue_depth(int p_depth);
+	void set_region_of_interest(const Rect2i &p_region);
+	bool can_record(RecordingFormat p_format) const;
+
 	bool activate_feed();
 	void deactivate_feed();
+	void check_feed();
+	void apply_settings();
 };
 
 class CameraX11 : public CameraServer {
 private:
 	struct v4l2_funcs funcs;
-	void *libv4l2;
+	void *libv4l2 = nullptr;
+	void load_functions();
+	CameraCaptureReactor reactor;
+	CameraCapabilityCache capability_cache;
 	bool alive = false;
+	// looks for the cameras present at startup, then watches for changes
 	std::thread hotplug_thread;
 	void check_change();
 
+	// watches /dev for video nodes coming and going
+	int inotify_fd = -1;
+	int wake_fd = -1;
+
+	// nodes that aren't usable cameras, only probed again once they changed
+	struct RejectedNode {
+		dev_t rdev;
+		time_t ctime;
+	};
+	std::map<std::string, RejectedNode> rejected_nodes;
+
+	// the feeds handed to the server, only used on the hotplug thread
+	Vector<Ref<CameraFeedX11>> devices;
+
+	Ref<CameraFeedX11> find_feed(const std::string &dev_name);
+	void add_device(const std::string &dev_name, bool print_debug);
+	void update_device(const std::string &dev_name);
+	void remove_device(const Ref<CameraFeedX11> &p_feed);
+	void remove_lost_devices();
+
 public:
 	CameraX11();
 	~CameraX11();
 
 	void update_feeds();
+	// has the hotplug thread look at the feeds again, without inotify it does so every second anyway
+	void wake_hotplug_thread();
 };
 
 #endif /* CAMERAX11_H */
@@ -30,6 +30,8 @@
 
 #include "register_types.h"
 
+#include "camera_virtual.h"
+
 #if defined(WINDOWS_ENABLED)
 #include "camera_win.h"
 #endif
@@ -41,6 +43,12 @@
 #endif
 
 void register_camera_types() {
+	CameraVirtual::register_settings();
+	if (CameraVirtual::is_requested()) {
+		CameraServer::make_default<CameraVirtual>();
+		return;
+	}
+
 #if defined(WINDOWS_ENABLED)
 	CameraServer::make_default<CameraWindows>();
 #endif
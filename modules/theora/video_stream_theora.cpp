@@ -31,10 +31,9 @@
 #include "video_stream_theora.h"
 
 #include "core/config/project_settings.h"
+#include "core/io/yuv_converter.h"
 #include "core/os/os.h"
 
-#include "thirdparty/misc/yuv2rgb.h"
-
 int VideoStreamPlaybackTheora::buffer_data() {
 	char *buffer = ogg_sync_buffer(&oy, 4096);
 
@@ -93,16 +92,24 @@ void VideoStreamPlaybackTheora::video_write() {
 
 		//uv_offset=(ti.pic_x/2)+(yuv[1].stride)*(ti.pic_y/2);
 
+		YUVConverter::Source source;
 		if (px_fmt == TH_PF_444) {
-			yuv444_2_rgb8888((uint8_t *)dst, (uint8_t *)yuv[0].data, (uint8_t *)yuv[1].data, (uint8_t *)yuv[2].data, size.x, size.y, yuv[0].stride, yuv[1].stride, size.x << 2);
-
+			source.format = YUVConverter::SOURCE_YUV444P;
 		} else if (px_fmt == TH_PF_422) {
-			yuv422_2_rgb8888((uint8_t *)dst, (uint8_t *)yuv[0].data, (uint8_t *)yuv[1].data, (uint8_t *)yuv[2].data, size.x, size.y, yuv[0].stride, yuv[1].stride, size.x << 2);
-
+			source.format = YUVConverter::SOURCE_YUV422P;
 		} else if (px_fmt == TH_PF_420) {
-			yuv420_2_rgb8888((uint8_t *)dst, (uint8_t *)yuv[0].data, (uint8_t *)yuv[1].data, (uint8_t *)yuv[2].data, size.x, size.y, yuv[0].stride, yuv[1].stride, size.x << 2);
+			source.format = YUVConverter::SOURCE_I420;
 		};
 
+		// Theora only knows BT.601 with limited range
+		for (int i = 0; i < 3; i++) {
+			source.planes[i] = yuv[i].data;
+			source.strides[i] = yuv[i].stride;
+		}
+		source.width = size.x;
+		source.height = size.y;
+		YUVConverter::convert_to_rgba8(source, (uint8_t *)dst);
+
 		format = Image::FORMAT_RGBA8;
 	}
 
@@ -32,6 +32,7 @@
 
 #include "core/config/project_settings.h"
 #include "core/core_string_names.h"
+#include "servers/camera/camera_feed.h"
 #include "servers/rendering_server.h"
 #include "texture.h"
 
@@ -114,16 +115,48 @@ int Environment::get_canvas_max_layer() const {
 
 void Environment::set_camera_feed_id(int p_id) {
 	bg_camera_feed_id = p_id;
-// FIXME: Disabled during Vulkan refactoring, should be ported.
-#if 0
-	RS::get_singleton()->environment_set_camera_feed_id(environment, camera_feed_id);
-#endif
+	_update_camera_feed();
 }
 
 int Environment::get_camera_feed_id() const {
 	return bg_camera_feed_id;
 }
 
+void Environment::_camera_feed_changed(int p_id) {
+	if (p_id == bg_camera_feed_id) {
+		_update_camera_feed();
+	}
+}
+
+void Environment::_update_camera_feed() {
+	// Runs on the main thread, the server signals are connected deferred as servers may add
+	// and remove feeds on other threads. The renderer only gets to see the texture. We hold
+	// on to the feed, so its texture stays valid until the renderer has been told to let go.
+	Ref<CameraFeed> feed;
+	if (CameraServer::get_singleton()) {
+		feed = CameraServer::get_singleton()->get_feed_by_id(bg_camera_feed_id);
+	}
+	if (feed.is_valid() && feed->is_capturing()) {
+		RS::get_singleton()->environment_set_camera_feed(environment, feed->get_texture(CameraServer::FEED_RESOLVED_IMAGE), feed->get_transform());
+	} else {
+		RS::get_singleton()->environment_set_camera_feed(environment, RID(), Transform2D());
+	}
+
+	if (feed == bg_camera_feed) {
+		return;
+	}
+	// the renderer has let go of the old feed's texture above, before we do
+	if (bg_camera_feed.is_valid()) {
+		bg_camera_feed->disconnect(SNAME("activated"), callable_mp(this, &Environment::_update_camera_feed));
+		bg_camera_feed->disconnect(SNAME("deactivated"), callable_mp(this, &Environment::_update_camera_feed));
+	}
+	bg_camera_feed = feed;
+	if (bg_camera_feed.is_valid()) {
+		bg_camera_feed->connect(SNAME("activated"), callable_mp(this, &Environment::_update_camera_feed));
+		bg_camera_feed->connect(SNAME("deactivated"), callable_mp(this, &Environment::_update_camera_feed));
+	}
+}
+
 // Ambient light
 
 void Environment::set_ambient_light_color(const Color &p_color) {
@@ -1416,6 +1449,10 @@ void Environment::_bind_methods() {
 Environment::Environment() {
 	environment = RS::get_singleton()->environment_create();
 
+	if (CameraServer::get_singleton()) {
+		CameraServer::get_singleton()->connect(SNAME("camera_feed_added"), callable_mp(this, &Environment::_camera_feed_changed), varray(), CONNECT_DEFERRED);
+		CameraServer::get_singleton()->connect(SNAME("camera_feed_removed"), callable_mp(this, &Environment::_camera_feed_changed), varray(), CONNECT_DEFERRED);
+	}
 	set_camera_feed_id(bg_camera_feed_id);
 
 	glow_levels.resize(7);
@@ -102,6 +102,9 @@ private:
 	float bg_energy = 1.0;
 	int bg_canvas_max_layer = 0;
 	int bg_camera_feed_id = 1;
+	Ref<CameraFeed> bg_camera_feed;
+	void _camera_feed_changed(int p_id);
+	void _update_camera_feed();
 
 	// Ambient light
 	Color ambient_color;
@@ -2872,8 +2872,20 @@ RID CameraTexture::get_rid() const {
 }
 
 Ref<Image> CameraTexture::get_image() const {
-	// not (yet) supported
-	return Ref<Image>();
+	// only what the feed keeps on the CPU, reading the texture back would stall the renderer
+	Ref<CameraFeed> feed = CameraServer::get_singleton()->get_feed_by_id(camera_feed_id);
+	if (feed.is_null()) {
+		return Ref<Image>();
+	}
+
+	Dictionary frame = feed->get_latest_frame();
+	if (which_feed == CameraServer::FEED_CBCR_IMAGE) {
+		return frame.get("cbcr_image", Variant());
+	} else if (which_feed == CameraServer::FEED_RESOLVED_IMAGE && bool(frame.get("ycbcr", false))) {
+		// converted on the GPU only
+		return Ref<Image>();
+	}
+	return frame.get("image", Variant());
 }
 
 void CameraTexture::set_camera_feed_id(int p_new_id) {
@@ -889,7 +889,7 @@ class CameraTexture : public Texture2D {
 private:
 	mutable RID _texture;
 	int camera_feed_id = 0;
-	CameraServer::FeedImage which_feed = CameraServer::FEED_RGBA_IMAGE;
+	CameraServer::FeedImage which_feed = CameraServer::FEED_RESOLVED_IMAGE;
 
 protected:
 	static void _bind_methods();
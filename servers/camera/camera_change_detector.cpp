@@ -0,0 +1,207 @@
+/*************************************************************************/
+/*  camera_change_detector.cpp                                           */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_change_detector.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHANGE_SSE2_ENABLED
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CHANGE_NEON_ENABLED
+#include <arm_neon.h>
+#endif
+
+void CameraChangeDetector::_resize(int p_width, int p_height) {
+	width = p_width;
+	height = p_height;
+	grid_width = (p_width + DECIMATION - 1) / DECIMATION;
+	grid_height = (p_height + DECIMATION - 1) / DECIMATION;
+	blocks_x = (grid_width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	blocks_y = (grid_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	grid_pitch = (blocks_x + 1) / 2 * BLOCK_SIZE * 2;
+
+	// the padding stays 0 in both planes, so it never differs
+	reference.resize(grid_pitch * grid_height);
+	samples.resize(grid_pitch * grid_height);
+	memset(reference.ptr(), 0, reference.size());
+	memset(samples.ptr(), 0, samples.size());
+	sums.resize(blocks_x + 1);
+	changed_blocks.resize(blocks_x * blocks_y);
+	has_reference = false;
+}
+
+void CameraChangeDetector::_sample(const uint8_t *p_data, int p_row_pitch, int p_pixel_size, int p_luma_offset) {
+	const int step = DECIMATION * p_pixel_size;
+	for (int y = 0; y < grid_height; y++) {
+		const uint8_t *src = p_data + y * DECIMATION * p_row_pitch + p_luma_offset;
+		uint8_t *dst = samples.ptr() + y * grid_pitch;
+		for (int x = 0; x < grid_width; x++) {
+			dst[x] = src[x * step];
+		}
+	}
+}
+
+void CameraChangeDetector::_add_row_differences(const uint8_t *p_a, const uint8_t *p_b, int p_count, uint32_t *r_sums) {
+	// p_count is a multiple of 2 * BLOCK_SIZE, each half of 16 samples belongs to a block of its own
+#if defined(CHANGE_SSE2_ENABLED)
+	for (int i = 0; i < p_count; i += BLOCK_SIZE * 2) {
+		__m128i sad = _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(p_a + i)), _mm_loadu_si128((const __m128i *)(p_b + i)));
+		r_sums[i / BLOCK_SIZE] += (uint32_t)_mm_cvtsi128_si32(sad);
+		r_sums[i / BLOCK_SIZE + 1] += (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+	}
+#elif defined(CHANGE_NEON_ENABLED)
+	for (int i = 0; i < p_count; i += BLOCK_SIZE * 2) {
+		uint8x16_t difference = vabdq_u8(vld1q_u8(p_a + i), vld1q_u8(p_b + i));
+		uint64x2_t sad = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(difference)));
+		r_sums[i / BLOCK_SIZE] += (uint32_t)vgetq_lane_u64(sad, 0);
+		r_sums[i / BLOCK_SIZE + 1] += (uint32_t)vgetq_lane_u64(sad, 1);
+	}
+#else
+	for (int i = 0; i < p_count; i++) {
+		int difference = (int)p_a[i] - (int)p_b[i];
+		r_sums[i / BLOCK_SIZE] += difference < 0 ? -difference : difference;
+	}
+#endif
+}
+
+void CameraChangeDetector::_update_reference() {
+	// only the blocks that will be shown, so differences too small to count don't add up unseen
+	for (int by = 0; by < blocks_y; by++) {
+		const int from_row = by * BLOCK_SIZE;
+		const int to_row = MIN(from_row + BLOCK_SIZE, grid_height);
+		for (int bx = 0; bx < blocks_x; bx++) {
+			if (!changed_blocks[by * blocks_x + bx]) {
+				continue;
+			}
+			for (int y = from_row; y < to_row; y++) {
+				const int offset = y * grid_pitch + bx * BLOCK_SIZE;
+				memcpy(reference.ptr() + offset, samples.ptr() + offset, BLOCK_SIZE);
+			}
+		}
+	}
+}
+
+void CameraChangeDetector::_merge_rects(Result &r_result) const {
+	// runs of changed blocks in a row, extended downwards while the rows below have the same run
+	LocalVector<Rect2i> rects;
+	Rect2i bounds;
+	for (int by = 0; by < blocks_y; by++) {
+		int bx = 0;
+		while (bx < blocks_x) {
+			if (!changed_blocks[by * blocks_x + bx]) {
+				bx++;
+				continue;
+			}
+			const int run_start = bx;
+			while (bx < blocks_x && changed_blocks[by * blocks_x + bx]) {
+				bx++;
+			}
+			const Rect2i run(run_start, by, bx - run_start, 1);
+			bounds = bounds.has_no_area() ? run : bounds.merge(run);
+			if (rects.size() > (uint32_t)MAX_RECTS) {
+				continue; // only the bounds are used anymore
+			}
+
+			bool extended = false;
+			for (uint32_t i = 0; i < rects.size(); i++) {
+				if (rects[i].position.x == run.position.x && rects[i].size.x == run.size.x && rects[i].get_end().y == by) {
+					rects[i].size.y++;
+					extended = true;
+					break;
+				}
+			}
+			if (!extended) {
+				rects.push_back(run);
+			}
+		}
+	}
+
+	if (rects.size() > (uint32_t)MAX_RECTS) {
+		rects.clear();
+		rects.push_back(bounds);
+	}
+
+	const Rect2i frame(0, 0, width, height);
+	r_result.rect_count = rects.size();
+	for (uint32_t i = 0; i < rects.size(); i++) {
+		const Rect2i &rect = rects[i];
+		r_result.rects[i] = Rect2i(rect.position * BLOCK_PIXELS, rect.size * BLOCK_PIXELS).intersection(frame);
+	}
+}
+
+void CameraChangeDetector::detect(const uint8_t *p_data, int p_width, int p_height, int p_row_pitch, int p_pixel_size, int p_luma_offset, int p_threshold, Result &r_result) {
+	r_result = Result();
+	if (p_width != width || p_height != height) {
+		_resize(p_width, p_height);
+	}
+
+	_sample(p_data, p_row_pitch, p_pixel_size, p_luma_offset);
+
+	if (!has_reference) {
+		// nothing to compare with, the whole frame is new
+		SWAP(reference, samples);
+		has_reference = true;
+		r_result.changed = true;
+		return;
+	}
+
+	int changed_count = 0;
+	for (int by = 0; by < blocks_y; by++) {
+		const int from_row = by * BLOCK_SIZE;
+		const int to_row = MIN(from_row + BLOCK_SIZE, grid_height);
+		memset(sums.ptr(), 0, sums.size() * sizeof(uint32_t));
+		for (int y = from_row; y < to_row; y++) {
+			_add_row_differences(samples.ptr() + y * grid_pitch, reference.ptr() + y * grid_pitch, grid_pitch, sums.ptr());
+		}
+
+		for (int bx = 0; bx < blocks_x; bx++) {
+			// blocks at the edges hold fewer samples
+			const int count = MIN(BLOCK_SIZE, grid_width - bx * BLOCK_SIZE) * (to_row - from_row);
+			const bool changed = sums[bx] > (uint32_t)(p_threshold * count);
+			changed_blocks[by * blocks_x + bx] = changed;
+			changed_count += changed;
+		}
+	}
+
+	if (changed_count == 0) {
+		return;
+	}
+
+	r_result.changed = true;
+	r_result.score = (float)changed_count / (blocks_x * blocks_y);
+	_merge_rects(r_result);
+	_update_reference();
+}
+
+void CameraChangeDetector::reset() {
+	has_reference = false;
+}
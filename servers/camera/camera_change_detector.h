@@ -0,0 +1,84 @@
+/*************************************************************************/
+/*  camera_change_detector.h                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_CHANGE_DETECTOR_H
+#define CAMERA_CHANGE_DETECTOR_H
+
+#include "core/math/rect2.h"
+#include "core/templates/local_vector.h"
+
+// Finds the parts of camera frames that changed, so feeds of mostly static scenes can skip
+// uploading the rest. Every DECIMATION-th pixel of every DECIMATION-th row is sampled into a
+// small luma plane, which is compared block by block with the samples of what was shown.
+class CameraChangeDetector {
+public:
+	enum {
+		DECIMATION = 4, // pixels between samples in both directions
+		BLOCK_SIZE = 8, // samples along the side of a block
+		BLOCK_PIXELS = DECIMATION * BLOCK_SIZE, // pixels along the side of a block
+		MAX_RECTS = 8, // more changed areas are merged into one rectangle
+	};
+
+	struct Result {
+		bool changed = false; // always set for the first frame
+		float score = 0.0; // part of the blocks that changed, from 0 to 1
+		Rect2i rects[MAX_RECTS]; // in pixels of the frame, none if the whole frame changed
+		int rect_count = 0;
+	};
+
+	// Compares a frame with the samples of the changed parts of earlier frames. A block changed when its
+	// samples differ by more than p_threshold on average. p_luma_offset is the byte of a pixel holding
+	// luma, green is close enough for RGB.
+	void detect(const uint8_t *p_data, int p_width, int p_height, int p_row_pitch, int p_pixel_size, int p_luma_offset, int p_threshold, Result &r_result);
+	// The next frame changed in whole, for when a frame that was detected as changed wasn't shown.
+	void reset();
+
+private:
+	int width = 0;
+	int height = 0;
+	int grid_width = 0; // samples
+	int grid_height = 0;
+	int grid_pitch = 0; // whole pairs of blocks, so rows can be compared 16 samples at a time
+	int blocks_x = 0;
+	int blocks_y = 0;
+	bool has_reference = false;
+	LocalVector<uint8_t> reference; // samples of what is shown
+	LocalVector<uint8_t> samples; // of the frame being compared
+	LocalVector<uint32_t> sums; // differences per block
+	LocalVector<uint8_t> changed_blocks;
+
+	void _resize(int p_width, int p_height);
+	void _sample(const uint8_t *p_data, int p_row_pitch, int p_pixel_size, int p_luma_offset);
+	static void _add_row_differences(const uint8_t *p_a, const uint8_t *p_b, int p_count, uint32_t *r_sums);
+	void _update_reference();
+	void _merge_rects(Result &r_result) const;
+};
+
+#endif // CAMERA_CHANGE_DETECTOR_H
@@ -30,6 +30,10 @@
 
 #include "camera_feed.h"
 
+#include "core/os/os.h"
+
+#include "servers/camera/camera_frame_set.h"
+#include "servers/rendering/rendering_device.h"
 #include "servers/rendering_server.h"
 
 void CameraFeed::_bind_methods() {
@@ -40,6 +44,7 @@ void CameraFeed::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("is_active"), &CameraFeed::is_active);
 	ClassDB::bind_method(D_METHOD("set_active", "active"), &CameraFeed::set_active);
+	ClassDB::bind_method(D_METHOD("is_capturing"), &CameraFeed::is_capturing);
 
 	ClassDB::bind_method(D_METHOD("get_name"), &CameraFeed::get_name);
 	ClassDB::bind_method(D_METHOD("_set_name", "name"), &CameraFeed::set_name);
@@ -56,9 +61,60 @@ void CameraFeed::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("get_datatype"), &CameraFeed::get_datatype);
 
+	ClassDB::bind_method(D_METHOD("get_statistics"), &CameraFeed::get_statistics);
+
+	ClassDB::bind_method(D_METHOD("set_queue_depth", "depth"), &CameraFeed::set_queue_depth);
+	ClassDB::bind_method(D_METHOD("get_queue_depth"), &CameraFeed::get_queue_depth);
+	ClassDB::bind_method(D_METHOD("set_drop_policy", "policy"), &CameraFeed::set_drop_policy);
+	ClassDB::bind_method(D_METHOD("get_drop_policy"), &CameraFeed::get_drop_policy);
+	ClassDB::bind_method(D_METHOD("set_region_of_interest", "region"), &CameraFeed::set_region_of_interest);
+	ClassDB::bind_method(D_METHOD("get_region_of_interest"), &CameraFeed::get_region_of_interest);
+
+	ClassDB::bind_method(D_METHOD("set_keep_latest_frame", "enable"), &CameraFeed::set_keep_latest_frame);
+	ClassDB::bind_method(D_METHOD("is_keeping_latest_frame"), &CameraFeed::is_keeping_latest_frame);
+	ClassDB::bind_method(D_METHOD("set_grayscale_downscale", "downscale"), &CameraFeed::set_grayscale_downscale);
+	ClassDB::bind_method(D_METHOD("get_grayscale_downscale"), &CameraFeed::get_grayscale_downscale);
+	ClassDB::bind_method(D_METHOD("get_latest_frame"), &CameraFeed::get_latest_frame);
+
+	ClassDB::bind_method(D_METHOD("set_change_detection", "enable"), &CameraFeed::set_change_detection);
+	ClassDB::bind_method(D_METHOD("is_detecting_changes"), &CameraFeed::is_detecting_changes);
+	ClassDB::bind_method(D_METHOD("set_change_threshold", "threshold"), &CameraFeed::set_change_threshold);
+	ClassDB::bind_method(D_METHOD("get_change_threshold"), &CameraFeed::get_change_threshold);
+
+	ClassDB::bind_method(D_METHOD("add_luma_readback", "level", "region"), &CameraFeed::add_luma_readback, DEFVAL(Rect2i()));
+	ClassDB::bind_method(D_METHOD("clear_luma_readbacks"), &CameraFeed::clear_luma_readbacks);
+
+	ClassDB::bind_method(D_METHOD("add_output", "width", "height", "format", "frame_interval"), &CameraFeed::add_output, DEFVAL(1));
+	ClassDB::bind_method(D_METHOD("remove_output", "output"), &CameraFeed::remove_output);
+	ClassDB::bind_method(D_METHOD("get_outputs"), &CameraFeed::get_outputs);
+
+	ClassDB::bind_method(D_METHOD("start_recording", "path", "format"), &CameraFeed::start_recording);
+	ClassDB::bind_method(D_METHOD("stop_recording"), &CameraFeed::stop_recording);
+	ClassDB::bind_method(D_METHOD("is_recording"), &CameraFeed::is_recording);
+	ClassDB::bind_method(D_METHOD("can_record", "format"), &CameraFeed::can_record);
+
+	ClassDB::bind_method(D_METHOD("get_formats"), &CameraFeed::get_formats);
+	ClassDB::bind_method(D_METHOD("set_format", "width", "height", "pixel_format", "fps"), &CameraFeed::set_format, DEFVAL(0.0));
+
+	ClassDB::bind_method(D_METHOD("_activation_finished", "activated"), &CameraFeed::_activation_finished);
+	ClassDB::bind_method(D_METHOD("_deactivation_finished"), &CameraFeed::_deactivation_finished);
+
+	ADD_SIGNAL(MethodInfo("activated"));
+	ADD_SIGNAL(MethodInfo("activation_failed"));
+	ADD_SIGNAL(MethodInfo("deactivated"));
+	ADD_SIGNAL(MethodInfo("motion_detected", PropertyInfo(Variant::FLOAT, "score")));
+	ADD_SIGNAL(MethodInfo("luma_readback_completed", PropertyInfo(Variant::INT, "sequence"), PropertyInfo(Variant::INT, "level"), PropertyInfo(Variant::RECT2I, "region"), PropertyInfo(Variant::OBJECT, "image", PROPERTY_HINT_RESOURCE_TYPE, "Image")));
+
 	ADD_GROUP("Feed", "feed_");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "feed_is_active"), "set_active", "is_active");
 	ADD_PROPERTY(PropertyInfo(Variant::TRANSFORM2D, "feed_transform"), "set_transform", "get_transform");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "feed_queue_depth", PROPERTY_HINT_RANGE, "2,32,1"), "set_queue_depth", "get_queue_depth");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "feed_drop_policy", PROPERTY_HINT_ENUM, "Drop Oldest,Drop Newest,Block"), "set_drop_policy", "get_drop_policy");
+	ADD_PROPERTY(PropertyInfo(Variant::RECT2I, "feed_region_of_interest"), "set_region_of_interest", "get_region_of_interest");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "feed_keep_latest_frame"), "set_keep_latest_frame", "is_keeping_latest_frame");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "feed_grayscale_downscale", PROPERTY_HINT_RANGE, "0,16,1"), "set_grayscale_downscale", "get_grayscale_downscale");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "feed_change_detection"), "set_change_detection", "is_detecting_changes");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "feed_change_threshold", PROPERTY_HINT_RANGE, "1,64,1"), "set_change_threshold", "get_change_threshold");
 
 	BIND_ENUM_CONSTANT(FEED_NOIMAGE);
 	BIND_ENUM_CONSTANT(FEED_RGB);
@@ -68,6 +124,16 @@ void CameraFeed::_bind_methods() {
 	BIND_ENUM_CONSTANT(FEED_UNSPECIFIED);
 	BIND_ENUM_CONSTANT(FEED_FRONT);
 	BIND_ENUM_CONSTANT(FEED_BACK);
+
+	BIND_ENUM_CONSTANT(DROP_POLICY_OLDEST);
+	BIND_ENUM_CONSTANT(DROP_POLICY_NEWEST);
+	BIND_ENUM_CONSTANT(DROP_POLICY_BLOCK);
+
+	BIND_ENUM_CONSTANT(OUTPUT_FORMAT_RGBA8);
+	BIND_ENUM_CONSTANT(OUTPUT_FORMAT_L8);
+
+	BIND_ENUM_CONSTANT(RECORDING_FORMAT_Y4M);
+	BIND_ENUM_CONSTANT(RECORDING_FORMAT_MJPEG);
 }
 
 int CameraFeed::get_id() const {
@@ -75,24 +141,180 @@ int CameraFeed::get_id() const {
 }
 
 bool CameraFeed::is_active() const {
-	return active;
+	MutexLock lock(activation_mutex);
+	return activation_wanted;
+}
+
+bool CameraFeed::is_capturing() const {
+	return active.is_set();
 }
 
 void CameraFeed::set_active(bool p_is_active) {
-	if (p_is_active == active) {
-		// all good
-	} else if (p_is_active) {
-		// attempt to activate this feed
-		if (activate_feed()) {
-			print_line("Activate " + name);
-			active = true;
-		}
+	MutexLock lock(activation_mutex);
+	if (p_is_active == activation_wanted) {
+		// all good, or on its way
+		return;
+	}
+	activation_wanted = p_is_active;
+
+	if (p_is_active) {
+		_reset_statistics();
 	} else {
-		// just deactivate it
-		deactivate_feed();
+		// frames are ignored from now on, the camera itself is stopped on the activation thread
+		active.clear();
 		print_line("Deactivate " + name);
-		active = false;
 	}
+
+	_start_activation_thread();
+}
+
+void CameraFeed::_request_settings_change() {
+	MutexLock lock(activation_mutex);
+	settings_changed = true;
+	_start_activation_thread();
+}
+
+void CameraFeed::request_check() {
+	MutexLock lock(activation_mutex);
+	check_wanted = true;
+	_start_activation_thread();
+}
+
+void CameraFeed::_start_activation_thread() {
+	// called with activation_mutex locked
+	if (activation_running) {
+		// picks up the request before it returns
+		return;
+	}
+	if (activation_thread.is_started()) {
+		// done with its last request, it only has to return
+		activation_thread.wait_to_finish();
+	}
+	activation_running = true;
+	activation_thread.start(&CameraFeed::_activation_thread, this);
+}
+
+void CameraFeed::wait_for_activation() {
+	MutexLock lock(activation_mutex);
+	while (activation_running) {
+		// the thread needs the lock to finish its requests, it wakes us up once it is done
+		activation_waiters++;
+		activation_mutex.unlock();
+		activation_done.wait();
+		activation_mutex.lock();
+	}
+	if (activation_thread.is_started()) {
+		// it doesn't take the lock anymore once it isn't running
+		activation_thread.wait_to_finish();
+	}
+}
+
+void CameraFeed::_activation_thread(void *p_user) {
+	CameraFeed *feed = static_cast<CameraFeed *>(p_user);
+
+	while (true) {
+		bool activate = false;
+		bool check = false;
+		bool change_settings = false;
+		bool restart = false;
+		{
+			MutexLock lock(feed->activation_mutex);
+			if (feed->settings_changed && (feed->activation_wanted || !feed->feed_activated)) {
+				// before starting the camera, rather than starting it in the old mode first,
+				// and after stopping it if it is on its way down
+				feed->settings_changed = false;
+				change_settings = true;
+				restart = feed->feed_activated;
+			} else if (feed->activation_wanted == feed->feed_activated) {
+				if (feed->check_wanted && !feed->feed_activated) {
+					check = true;
+				} else {
+					if (feed->activation_wanted && !feed->active.is_set()) {
+						// activated again before we got to stopping the camera
+						feed->active.set();
+						feed->call_deferred(SNAME("_activation_finished"), true);
+					}
+					// an active camera notices problems while capturing
+					feed->check_wanted = false;
+					feed->activation_running = false;
+					while (feed->activation_waiters > 0) {
+						feed->activation_waiters--;
+						feed->activation_done.post();
+					}
+					return;
+				}
+				if (check) {
+					feed->check_wanted = false;
+				}
+			}
+			activate = feed->activation_wanted;
+		}
+
+		if (change_settings) {
+			if (!restart) {
+				feed->apply_settings();
+				continue;
+			}
+
+			// the camera takes most settings only while it isn't capturing, the feed stays active meanwhile
+			feed->deactivate_feed();
+			feed->apply_settings();
+			bool activated = feed->activate_feed();
+
+			MutexLock lock(feed->activation_mutex);
+			feed->feed_activated = activated;
+			if (!activated) {
+				feed->activation_wanted = false;
+				feed->active.clear();
+			}
+			feed->call_deferred(SNAME("_activation_finished"), activated);
+		} else if (check) {
+			feed->check_feed();
+		} else if (activate) {
+			bool activated = feed->activate_feed();
+
+			MutexLock lock(feed->activation_mutex);
+			feed->feed_activated = activated;
+			if (!activated) {
+				// not retried until set_active(true) is called again
+				feed->activation_wanted = false;
+			} else if (feed->activation_wanted) {
+				feed->active.set();
+			}
+			feed->call_deferred(SNAME("_activation_finished"), activated);
+		} else {
+			feed->deactivate_feed();
+
+			{
+				// the next activation may well use a different size, don't hold on to the memory
+				MutexLock latest_lock(feed->latest_frame_mutex);
+				feed->latest_images[0].unref();
+				feed->latest_images[1].unref();
+				feed->latest_grayscale.unref();
+			}
+			{
+				MutexLock pool_lock(feed->image_pool_mutex);
+				feed->image_pool.clear();
+			}
+
+			MutexLock lock(feed->activation_mutex);
+			feed->feed_activated = false;
+			feed->call_deferred(SNAME("_deactivation_finished"));
+		}
+	}
+}
+
+void CameraFeed::_activation_finished(bool p_activated) {
+	if (!p_activated) {
+		emit_signal(SNAME("activation_failed"));
+	} else if (active.is_set()) {
+		print_line("Activate " + name);
+		emit_signal(SNAME("activated"));
+	}
+}
+
+void CameraFeed::_deactivation_finished() {
+	emit_signal(SNAME("deactivated"));
 }
 
 String CameraFeed::get_name() const {
@@ -132,7 +354,7 @@ void CameraFeed::set_transform(const Transform2D &p_transform) {
 }
 
 RID CameraFeed::get_texture(CameraServer::FeedImage p_which) {
-	return texture[p_which];
+	return proxy_texture[p_which];
 }
 
 CameraFeed::CameraFeed() {
@@ -141,12 +363,19 @@ CameraFeed::CameraFeed() {
 	base_width = 0;
 	base_height = 0;
 	name = "???";
-	active = false;
+	change_threshold.set(8);
 	datatype = CameraFeed::FEED_RGB;
 	position = CameraFeed::FEED_UNSPECIFIED;
 	transform = Transform2D(1.0, 0.0, 0.0, -1.0, 0.0, 1.0);
 	texture[CameraServer::FEED_Y_IMAGE] = RenderingServer::get_singleton()->texture_2d_placeholder_create();
 	texture[CameraServer::FEED_CBCR_IMAGE] = RenderingServer::get_singleton()->texture_2d_placeholder_create();
+	proxy_texture[CameraServer::FEED_Y_IMAGE] = RenderingServer::get_singleton()->texture_proxy_create(texture[CameraServer::FEED_Y_IMAGE]);
+	proxy_texture[CameraServer::FEED_CBCR_IMAGE] = RenderingServer::get_singleton()->texture_proxy_create(texture[CameraServer::FEED_CBCR_IMAGE]);
+	texture[CameraServer::FEED_RESOLVED_IMAGE] = RenderingServer::get_singleton()->texture_2d_placeholder_create();
+	proxy_texture[CameraServer::FEED_RESOLVED_IMAGE] = RenderingServer::get_singleton()->texture_proxy_create(texture[CameraServer::FEED_RGBA_IMAGE]);
+	if (CameraServer::get_singleton()) {
+		CameraServer::get_singleton()->register_frame_source(this);
+	}
 }
 
 CameraFeed::CameraFeed(String p_name, FeedPosition p_position) {
@@ -155,92 +384,1251 @@ CameraFeed::CameraFeed(String p_name, FeedPosition p_position) {
 	base_width = 0;
 	base_height = 0;
 	name = p_name;
-	active = false;
+	change_threshold.set(8);
 	datatype = CameraFeed::FEED_NOIMAGE;
 	position = p_position;
 	transform = Transform2D(1.0, 0.0, 0.0, -1.0, 0.0, 1.0);
 	texture[CameraServer::FEED_Y_IMAGE] = RenderingServer::get_singleton()->texture_2d_placeholder_create();
 	texture[CameraServer::FEED_CBCR_IMAGE] = RenderingServer::get_singleton()->texture_2d_placeholder_create();
+	proxy_texture[CameraServer::FEED_Y_IMAGE] = RenderingServer::get_singleton()->texture_proxy_create(texture[CameraServer::FEED_Y_IMAGE]);
+	proxy_texture[CameraServer::FEED_CBCR_IMAGE] = RenderingServer::get_singleton()->texture_proxy_create(texture[CameraServer::FEED_CBCR_IMAGE]);
+	texture[CameraServer::FEED_RESOLVED_IMAGE] = RenderingServer::get_singleton()->texture_2d_placeholder_create();
+	proxy_texture[CameraServer::FEED_RESOLVED_IMAGE] = RenderingServer::get_singleton()->texture_proxy_create(texture[CameraServer::FEED_RGBA_IMAGE]);
+	if (CameraServer::get_singleton()) {
+		CameraServer::get_singleton()->register_frame_source(this);
+	}
 }
 
 CameraFeed::~CameraFeed() {
+	wait_for_activation();
+
+	// capture has stopped, so the recording is complete
+	stop_recording();
+
+	// capture has stopped, so nothing feeds the outputs anymore
+	while (!output_feeds.is_empty()) {
+		remove_output(output_feeds[output_feeds.size() - 1]);
+	}
+
+	// no more frames are picked up once this returns
+	if (CameraServer::get_singleton()) {
+		CameraServer::get_singleton()->unregister_frame_source(this);
+	}
+	drop_pending_frames();
+
 	// Free our textures
+	clear_shared_frames();
+	RenderingServer::get_singleton()->free(proxy_texture[CameraServer::FEED_Y_IMAGE]);
+	RenderingServer::get_singleton()->free(proxy_texture[CameraServer::FEED_CBCR_IMAGE]);
+	RenderingServer::get_singleton()->free(proxy_texture[CameraServer::FEED_RESOLVED_IMAGE]);
 	RenderingServer::get_singleton()->free(texture[CameraServer::FEED_Y_IMAGE]);
 	RenderingServer::get_singleton()->free(texture[CameraServer::FEED_CBCR_IMAGE]);
+	RenderingServer::get_singleton()->free(texture[CameraServer::FEED_RESOLVED_IMAGE]);
+	if (luma_pyramid.is_valid()) {
+		RenderingServer::get_singleton()->free(luma_pyramid);
+	}
 }
 
-void CameraFeed::set_RGB_img(const Ref<Image> &p_rgb_img) {
-	ERR_FAIL_COND(p_rgb_img.is_null());
-	if (active) {
-		int new_width = p_rgb_img->get_width();
-		int new_height = p_rgb_img->get_height();
+CameraFeed::Frame &CameraFeed::_begin_frame() {
+	// the slot is ours until it is published
+	return frames[write_frame];
+}
 
-		if ((base_width != new_width) || (base_height != new_height)) {
-			// We're assuming here that our camera image doesn't change around formats etc, allocate the whole lot...
-			base_width = new_width;
-			base_height = new_height;
+void CameraFeed::_publish_frame() {
+	if (!_detect_changes(frames[write_frame])) {
+		// what is shown already looks the same
+		uploads_skipped.increment();
+		_release_frame(frames[write_frame]);
+		return;
+	}
 
-			RID new_texture = RenderingServer::get_singleton()->texture_2d_create(p_rgb_img);
-			RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_RGBA_IMAGE], new_texture);
-		} else {
-			RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_RGBA_IMAGE], p_rgb_img);
+	if (drop_policy.get() != DROP_POLICY_OLDEST && frames[write_frame].type != FRAME_NONE && is_frame_pending()) {
+		// keep the waiting frame, capture code that can hold off frames for DROP_POLICY_BLOCK doesn't get here
+		frames_skipped.increment();
+		_release_frame(frames[write_frame]);
+		// the changes of this frame won't be shown, so compare the next one with all of it
+		change_detector.reset();
+		return;
+	}
+
+	uint32_t previous = mailbox.exchange(write_frame | FRAME_FRESH);
+	write_frame = previous & FRAME_INDEX_MASK;
+
+	if (previous & FRAME_FRESH) {
+		// the render thread never picked this one up, a newer frame replaces it
+		if (frames[write_frame].type != FRAME_NONE) {
+			frames_skipped.increment();
 		}
+		_release_frame(frames[write_frame]);
+	}
+}
 
-		datatype = CameraFeed::FEED_RGB;
+void CameraFeed::_release_frame(Frame &p_frame) {
+	if (p_frame.release) {
+		p_frame.release(p_frame.userdata);
 	}
+	p_frame = Frame();
 }
 
-void CameraFeed::set_YCbCr_img(const Ref<Image> &p_ycbcr_img) {
-	ERR_FAIL_COND(p_ycbcr_img.is_null());
-	if (active) {
-		int new_width = p_ycbcr_img->get_width();
-		int new_height = p_ycbcr_img->get_height();
+void CameraFeed::drop_pending_frames() {
+	// publish an empty frame, taking back the one that is waiting
+	frames[write_frame] = Frame();
+	_publish_frame();
 
-		if ((base_width != new_width) || (base_height != new_height)) {
-			// We're assuming here that our camera image doesn't change around formats etc, allocate the whole lot...
-			base_width = new_width;
-			base_height = new_height;
+	// update_frame() may have picked up a frame just before, it hands the frame back before unlocking
+	MutexLock lock(frame_mutex);
+}
 
-			RID new_texture = RenderingServer::get_singleton()->texture_2d_create(p_ycbcr_img);
-			RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_RGBA_IMAGE], new_texture);
-		} else {
-			RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_RGBA_IMAGE], p_ycbcr_img);
+void CameraFeed::update_frame() {
+	MutexLock lock(frame_mutex);
+
+	if (!(mailbox.get() & FRAME_FRESH)) {
+		return; // nothing new since the last frame
+	}
+
+	uint32_t previous = mailbox.exchange(read_frame);
+	read_frame = previous & FRAME_INDEX_MASK;
+
+	Frame &frame = frames[read_frame];
+	if (frame.type != FRAME_NONE && active.is_set()) {
+		_apply_frame(frame);
+		_update_luma_pyramid(frame);
+		// uploads hand raw frames back themselves
+		frame.release = nullptr;
+
+		shown_timing = frame.timing;
+		shown_upload_usec = OS::get_singleton()->get_ticks_usec();
+		shown_awaiting_draw = true;
+	}
+	_release_frame(frame);
+}
+
+void CameraFeed::frame_drawn() {
+	MutexLock lock(frame_mutex);
+
+	draw_count++;
+	_release_retired_frames(false);
+
+	if (!shown_awaiting_draw) {
+		return;
+	}
+	shown_awaiting_draw = false;
+
+	FrameSample sample;
+	sample.drawn_usec = OS::get_singleton()->get_ticks_usec();
+
+	// stages the capture code didn't stamp are left out
+	uint64_t stages[5] = { shown_timing.capture_usec, shown_timing.dequeue_usec, shown_timing.converted_usec, shown_upload_usec, sample.drawn_usec };
+	for (int i = 0; i < 4; i++) {
+		if (stages[i] != 0 && stages[i + 1] >= stages[i]) {
+			sample.stage_usec[i] = stages[i + 1] - stages[i];
+		}
+	}
+	if (shown_timing.capture_usec != 0 && sample.drawn_usec >= shown_timing.capture_usec) {
+		sample.latency_usec = sample.drawn_usec - shown_timing.capture_usec;
+	}
+
+	MutexLock statistics_lock(statistics_mutex);
+	samples[next_sample] = sample;
+	next_sample = (next_sample + 1) % STATISTICS_WINDOW;
+	sample_count = MIN(sample_count + 1, (int)STATISTICS_WINDOW);
+	frames_drawn++;
+}
+
+void CameraFeed::set_frame_timing(const FrameTiming &p_timing) {
+	frames[write_frame].timing = p_timing;
+}
+
+void CameraFeed::report_skipped_frame() {
+	frames_skipped.increment();
+}
+
+void CameraFeed::report_dropped_frames(uint32_t p_count) {
+	frames_dropped.add(p_count);
+}
+
+void CameraFeed::report_underrun() {
+	underruns.increment();
+}
+
+Ref<Image> CameraFeed::acquire_image(int p_width, int p_height, Image::Format p_format) {
+	ERR_FAIL_COND_V(p_width <= 0 || p_height <= 0, Ref<Image>());
+	ERR_FAIL_INDEX_V(p_format, Image::FORMAT_MAX, Ref<Image>());
+
+	MutexLock pool_lock(image_pool_mutex);
+
+	int unused = -1;
+	for (int i = 0; i < image_pool.size(); i++) {
+		const Ref<Image> &image = image_pool[i];
+		if (image->reference_get_count() > 1) {
+			// still queued or being uploaded
+			continue;
 		}
+		if (image->get_width() == p_width && image->get_height() == p_height && image->get_format() == p_format) {
+			return image;
+		}
+		unused = i;
+	}
+
+	Ref<Image> image;
+	image.instantiate();
+	image->create(p_width, p_height, false, p_format);
+	_count_image_allocation();
+
+	if (unused >= 0) {
+		// the size or format changed, replace an image that no longer fits
+		image_pool.write[unused] = image;
+	} else if (image_pool.size() < IMAGE_POOL_SIZE) {
+		image_pool.push_back(image);
+	}
+
+	return image;
+}
+
+void CameraFeed::_count_image_allocation() {
+	MutexLock statistics_lock(statistics_mutex);
+	allocation_usec[next_allocation] = OS::get_singleton()->get_ticks_usec();
+	next_allocation = (next_allocation + 1) % STATISTICS_WINDOW;
+	allocation_count = MIN(allocation_count + 1, (int)STATISTICS_WINDOW);
+	image_allocations++;
+}
+
+void CameraFeed::_reset_statistics() {
+	MutexLock statistics_lock(statistics_mutex);
+	sample_count = 0;
+	next_sample = 0;
+	frames_drawn = 0;
+	allocation_count = 0;
+	next_allocation = 0;
+	image_allocations = 0;
+	frames_dropped.set(0);
+	frames_skipped.set(0);
+	underruns.set(0);
+	uploads_skipped.set(0);
+	uploads_partial.set(0);
+}
+
+Dictionary CameraFeed::get_statistics() {
+	uint64_t now = OS::get_singleton()->get_ticks_usec();
+
+	int frames_last_second = 0;
+	Vector<int64_t> latencies;
+	int64_t stage_total[4] = { 0, 0, 0, 0 };
+	int stage_count[4] = { 0, 0, 0, 0 };
+	int allocations_last_second = 0;
+	uint64_t drawn;
+	uint64_t allocations;
+	{
+		MutexLock statistics_lock(statistics_mutex);
+		drawn = frames_drawn;
+		allocations = image_allocations;
+		for (int i = 0; i < allocation_count; i++) {
+			if (now - allocation_usec[i] < 1000000) {
+				allocations_last_second++;
+			}
+		}
+		latencies.resize(sample_count);
+		int latency_count = 0;
+		for (int i = 0; i < sample_count; i++) {
+			const FrameSample &sample = samples[i];
+			if (now - sample.drawn_usec < 1000000) {
+				frames_last_second++;
+			}
+			if (sample.latency_usec >= 0) {
+				latencies.write[latency_count++] = sample.latency_usec;
+			}
+			for (int j = 0; j < 4; j++) {
+				if (sample.stage_usec[j] >= 0) {
+					stage_total[j] += sample.stage_usec[j];
+					stage_count[j]++;
+				}
+			}
+		}
+		latencies.resize(latency_count);
+	}
+	latencies.sort();
+
+	Dictionary statistics;
+	statistics["fps"] = frames_last_second;
+	statistics["frames_drawn"] = drawn;
+	statistics["frames_dropped"] = frames_dropped.get();
+	statistics["frames_skipped"] = frames_skipped.get();
+	statistics["underruns"] = underruns.get();
+	statistics["uploads_skipped"] = uploads_skipped.get();
+	statistics["uploads_partial"] = uploads_partial.get();
+	statistics["image_allocations"] = allocations;
+	statistics["image_allocations_per_second"] = allocations_last_second;
+	statistics["latency_p50_ms"] = latencies.is_empty() ? 0.0 : latencies[latencies.size() / 2] / 1000.0;
+	statistics["latency_p99_ms"] = latencies.is_empty() ? 0.0 : latencies[MIN(latencies.size() - 1, latencies.size() * 99 / 100)] / 1000.0;
+
+	CameraRecorder::Statistics recording;
+	{
+		MutexLock lock(recording_mutex);
+		recording = recorder != nullptr ? recorder->get_statistics() : recording_statistics;
+	}
+	statistics["recording_frames_written"] = recording.frames_written;
+	statistics["recording_frames_dropped"] = recording.frames_dropped;
+	statistics["recording_bytes_written"] = recording.bytes_written;
+	statistics["recording_queue_peak"] = recording.queue_peak;
+	statistics["recording_write_ms"] = recording.write_usec / 1000.0;
+
+	static const char *stage_names[4] = { "capture_to_dequeue_ms", "dequeue_to_converted_ms", "converted_to_upload_ms", "upload_to_drawn_ms" };
+	for (int i = 0; i < 4; i++) {
+		statistics[stage_names[i]] = stage_count[i] > 0 ? stage_total[i] / 1000.0 / stage_count[i] : 0.0;
+	}
+
+	return statistics;
+}
+
+void CameraFeed::_apply_frame(const Frame &p_frame) {
+	if (showing_shared_frame && p_frame.type != FRAME_YCBCR_SHARED) {
+		// back to frames uploaded into our own textures
+		RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_Y_IMAGE], texture[CameraServer::FEED_Y_IMAGE]);
+		RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_CBCR_IMAGE], texture[CameraServer::FEED_CBCR_IMAGE]);
+		_retire_shown_shared_frame();
+		showing_shared_frame = false;
+		base_width = 0;
+		base_height = 0;
+	}
+
+	switch (p_frame.type) {
+		case FRAME_RGB_IMAGE:
+		case FRAME_YCBCR_IMAGE: {
+			const Ref<Image> &img = p_frame.images[0];
+			int new_width = img->get_width();
+			int new_height = img->get_height();
+
+			if ((base_width != new_width) || (base_height != new_height)) {
+				// We're assuming here that our camera image doesn't change around formats etc, allocate the whole lot...
+				base_width = new_width;
+				base_height = new_height;
+
+				RID new_texture = RenderingServer::get_singleton()->texture_2d_create(img);
+				RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_RGBA_IMAGE], new_texture);
+			} else {
+				RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_RGBA_IMAGE], img);
+			}
+
+			datatype = p_frame.type == FRAME_RGB_IMAGE ? CameraFeed::FEED_RGB : CameraFeed::FEED_YCBCR;
+		} break;
+		case FRAME_YCBCR_IMAGES: {
+			const Ref<Image> &y_img = p_frame.images[0];
+			const Ref<Image> &cbcr_img = p_frame.images[1];
+			int new_y_width = y_img->get_width();
+			int new_y_height = y_img->get_height();
+
+			if ((base_width != new_y_width) || (base_height != new_y_height)) {
+				// We're assuming here that our camera image doesn't change around formats etc, allocate the whole lot...
+				base_width = new_y_width;
+				base_height = new_y_height;
+				{
+					RID new_texture = RenderingServer::get_singleton()->texture_2d_create(y_img);
+					RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_Y_IMAGE], new_texture);
+				}
+				{
+					RID new_texture = RenderingServer::get_singleton()->texture_2d_create(cbcr_img);
+					RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_CBCR_IMAGE], new_texture);
+				}
+			} else {
+				RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_Y_IMAGE], y_img);
+				RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_CBCR_IMAGE], cbcr_img);
+			}
+
+			datatype = CameraFeed::FEED_YCBCR_SEP;
+		} break;
+		case FRAME_RGB_RAW: {
+			const FramePlane &rgb = p_frame.planes[0];
+			bool resized = (base_width != rgb.width) || (base_height != rgb.height);
+			base_width = rgb.width;
+			base_height = rgb.height;
+
+			if (!resized && _can_update_changes(rgb.format) && p_frame.changed_rect_count > 0 && p_frame.changed_since == shown_frame_id) {
+				_update_texture_changes(CameraServer::FEED_RGBA_IMAGE, rgb, p_frame, p_frame.release, p_frame.userdata);
+			} else {
+				_update_texture_raw(CameraServer::FEED_RGBA_IMAGE, rgb, resized, p_frame.release, p_frame.userdata);
+			}
+
+			datatype = CameraFeed::FEED_RGB;
+		} break;
+		case FRAME_YCBCR_RAWS: {
+			const FramePlane &y = p_frame.planes[0];
+			bool resized = (base_width != y.width) || (base_height != y.height);
+			base_width = y.width;
+			base_height = y.height;
+
+			// Updates are executed in order, so once the CbCr plane is released the Y plane is done too.
+			if (!resized && _can_update_changes(y.format) && _can_update_changes(p_frame.planes[1].format) && p_frame.changed_rect_count > 0 && p_frame.changed_since == shown_frame_id) {
+				_update_texture_changes(CameraServer::FEED_Y_IMAGE, y, p_frame, nullptr, nullptr);
+				_update_texture_changes(CameraServer::FEED_CBCR_IMAGE, p_frame.planes[1], p_frame, p_frame.release, p_frame.userdata);
+			} else {
+				_update_texture_raw(CameraServer::FEED_Y_IMAGE, y, resized, nullptr, nullptr);
+				_update_texture_raw(CameraServer::FEED_CBCR_IMAGE, p_frame.planes[1], resized, p_frame.release, p_frame.userdata);
+			}
+
+			datatype = CameraFeed::FEED_YCBCR_SEP;
+		} break;
+		case FRAME_YCBCR_SHARED: {
+			ERR_FAIL_INDEX(p_frame.shared_frame, shared_frames.size());
+			const SharedFrame &shared = shared_frames[p_frame.shared_frame];
+			RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_Y_IMAGE], shared.y);
+			RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_CBCR_IMAGE], shared.cbcr);
+			_retire_shown_shared_frame();
+			shown_shared_release = p_frame.release;
+			shown_shared_userdata = p_frame.userdata;
+			showing_shared_frame = true;
+
+			base_width = shared.width;
+			base_height = shared.height;
+
+			datatype = CameraFeed::FEED_YCBCR_SEP;
+		} break;
+		default:
+			break;
+	}
+	// frames from the change detector that follow this one may only update what changed
+	shown_frame_id = p_frame.type == FRAME_YCBCR_SHARED ? 0 : p_frame.id;
+
+	if (datatype == CameraFeed::FEED_YCBCR || datatype == CameraFeed::FEED_YCBCR_SEP) {
+		_resolve_frame();
+	} else if (showing_resolved_frame) {
+		RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_RESOLVED_IMAGE], texture[CameraServer::FEED_RGBA_IMAGE]);
+		showing_resolved_frame = false;
+	}
+}
+
+void CameraFeed::_resolve_frame() {
+	// Converted once per new frame here, instead of by every shader that samples the feed.
+	RID cbcr = datatype == CameraFeed::FEED_YCBCR_SEP ? proxy_texture[CameraServer::FEED_CBCR_IMAGE] : RID();
+	RenderingServer::get_singleton()->texture_2d_ycbcr_resolve(texture[CameraServer::FEED_RESOLVED_IMAGE], proxy_texture[CameraServer::FEED_Y_IMAGE], cbcr, ycbcr_full_range);
+
+	if (!showing_resolved_frame) {
+		RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_RESOLVED_IMAGE], texture[CameraServer::FEED_RESOLVED_IMAGE]);
+		showing_resolved_frame = true;
+	}
+}
+
+void CameraFeed::set_RGB_img(const Ref<Image> &p_rgb_img) {
+	ERR_FAIL_COND(p_rgb_img.is_null());
+	if (active.is_set()) {
+		Frame &frame = _begin_frame();
+		frame.type = FRAME_RGB_IMAGE;
+		frame.images[0] = p_rgb_img;
+		const Rect2i region = _get_cpu_region(p_rgb_img->get_width(), p_rgb_img->get_height(), false);
+		if (!region.has_no_area()) {
+			frame.images[0] = _crop_image(p_rgb_img, region, p_rgb_img->get_width(), p_rgb_img->get_height());
+		}
+		_keep_latest_images(frame.images, 1, false, frame.timing);
+		const FramePlane plane = _get_image_plane(frame.images[0]);
+		_feed_outputs(&plane, 1, false, frame.timing);
+		_record_frame(&plane, 1, false, frame.timing);
+		_publish_frame();
+	}
+}
 
-		datatype = CameraFeed::FEED_YCBCR;
+void CameraFeed::set_YCbCr_img(const Ref<Image> &p_ycbcr_img) {
+	ERR_FAIL_COND(p_ycbcr_img.is_null());
+	if (active.is_set()) {
+		Frame &frame = _begin_frame();
+		frame.type = FRAME_YCBCR_IMAGE;
+		frame.images[0] = p_ycbcr_img;
+		const Rect2i region = _get_cpu_region(p_ycbcr_img->get_width(), p_ycbcr_img->get_height(), true);
+		if (!region.has_no_area()) {
+			frame.images[0] = _crop_image(p_ycbcr_img, region, p_ycbcr_img->get_width(), p_ycbcr_img->get_height());
+		}
+		_keep_latest_images(frame.images, 1, true, frame.timing);
+		const FramePlane plane = _get_image_plane(frame.images[0]);
+		_feed_outputs(&plane, 1, true, frame.timing);
+		_record_frame(&plane, 1, true, frame.timing);
+		_publish_frame();
 	}
 }
 
 void CameraFeed::set_YCbCr_imgs(const Ref<Image> &p_y_img, const Ref<Image> &p_cbcr_img) {
 	ERR_FAIL_COND(p_y_img.is_null());
 	ERR_FAIL_COND(p_cbcr_img.is_null());
-	if (active) {
-		///@TODO investigate whether we can use thirdparty/misc/yuv2rgb.h here to convert our YUV data to RGB, our shader approach is potentially faster though..
-		// Wondering about including that into multiple projects, may cause issues.
-		// That said, if we convert to RGB, we could enable using texture resources again...
-
-		int new_y_width = p_y_img->get_width();
-		int new_y_height = p_y_img->get_height();
-
-		if ((base_width != new_y_width) || (base_height != new_y_height)) {
-			// We're assuming here that our camera image doesn't change around formats etc, allocate the whole lot...
-			base_width = new_y_width;
-			base_height = new_y_height;
-			{
-				RID new_texture = RenderingServer::get_singleton()->texture_2d_create(p_y_img);
-				RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_Y_IMAGE], new_texture);
+	if (active.is_set()) {
+		Frame &frame = _begin_frame();
+		frame.type = FRAME_YCBCR_IMAGES;
+		frame.images[0] = p_y_img;
+		frame.images[1] = p_cbcr_img;
+		const Rect2i region = _get_cpu_region(p_y_img->get_width(), p_y_img->get_height(), true);
+		if (!region.has_no_area()) {
+			frame.images[0] = _crop_image(p_y_img, region, p_y_img->get_width(), p_y_img->get_height());
+			frame.images[1] = _crop_image(p_cbcr_img, region, p_y_img->get_width(), p_y_img->get_height());
+		}
+		_keep_latest_images(frame.images, 2, true, frame.timing);
+		const FramePlane planes[2] = { _get_image_plane(frame.images[0]), _get_image_plane(frame.images[1]) };
+		_feed_outputs(planes, 2, true, frame.timing);
+		_record_frame(planes, 2, true, frame.timing);
+		_publish_frame();
+	}
+}
+
+void CameraFeed::_update_texture_raw(CameraServer::FeedImage p_which, const FramePlane &p_plane, bool p_resized, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	if (p_resized) {
+		// the contents get replaced by the update right after
+		Ref<Image> img;
+		img.instantiate();
+		img->create(p_plane.width, p_plane.height, false, p_plane.format);
+
+		RID new_texture = RenderingServer::get_singleton()->texture_2d_create(img);
+		RenderingServer::get_singleton()->texture_replace(texture[p_which], new_texture);
+	}
+
+	RenderingServer::get_singleton()->texture_2d_update_raw(texture[p_which], p_plane.data, p_plane.row_pitch, p_plane.format, p_release, p_userdata);
+}
+
+bool CameraFeed::_can_update_changes(Image::Format p_format) {
+	// the renderer converts other formats through a whole image, each changed rect would upload all of it
+	return p_format == Image::FORMAT_R8 || p_format == Image::FORMAT_RG8 || p_format == Image::FORMAT_RGB8 || p_format == Image::FORMAT_RGBA8;
+}
+
+void CameraFeed::_update_texture_changes(CameraServer::FeedImage p_which, const FramePlane &p_plane, const Frame &p_frame, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	const FramePlane &luma = p_frame.planes[0];
+	for (int i = 0; i < p_frame.changed_rect_count; i++) {
+		// the rects are in pixels of the first plane
+		const Rect2i region = _get_plane_region(p_frame.changed_rects[i], luma.width, luma.height, p_plane.width, p_plane.height);
+		const bool last = i == p_frame.changed_rect_count - 1;
+		RenderingServer::get_singleton()->texture_2d_update_raw_region(texture[p_which], region, p_plane.data, p_plane.row_pitch, p_plane.format, last ? p_release : nullptr, last ? p_userdata : nullptr);
+	}
+	if (p_which != CameraServer::FEED_Y_IMAGE) {
+		uploads_partial.increment();
+	}
+}
+
+bool CameraFeed::_detect_changes(Frame &p_frame) {
+	if (!change_detection.is_set()) {
+		if (change_detector_used) {
+			// start over once it is turned on again
+			change_detector.reset();
+			change_detector_used = false;
+		}
+		return true;
+	}
+
+	FramePlane plane;
+	int luma_offset = 0;
+	switch (p_frame.type) {
+		case FRAME_RGB_IMAGE:
+			plane = _get_image_plane(p_frame.images[0]);
+			luma_offset = 1;
+			break;
+		case FRAME_YCBCR_IMAGE:
+		case FRAME_YCBCR_IMAGES:
+			plane = _get_image_plane(p_frame.images[0]);
+			break;
+		case FRAME_RGB_RAW:
+			plane = p_frame.planes[0];
+			luma_offset = 1;
+			break;
+		case FRAME_YCBCR_RAWS:
+			plane = p_frame.planes[0];
+			break;
+		default:
+			break;
+	}
+	const int pixel_size = Image::get_format_pixel_size(plane.format);
+	if (plane.data == nullptr || pixel_size <= luma_offset) {
+		// nothing on the CPU to compare, such as shared frames, the next frame is compared with all of it
+		change_detector.reset();
+		return true;
+	}
+
+	CameraChangeDetector::Result result;
+	change_detector.detect(plane.data, plane.width, plane.height, plane.row_pitch, pixel_size, luma_offset, change_threshold.get(), result);
+	change_detector_used = true;
+	if (!result.changed) {
+		return false;
+	}
+
+	p_frame.id = next_frame_id++;
+	p_frame.changed_since = result.rect_count > 0 ? last_changed_id : 0;
+	p_frame.changed_rect_count = result.rect_count;
+	for (int i = 0; i < result.rect_count; i++) {
+		p_frame.changed_rects[i] = result.rects[i];
+	}
+	last_changed_id = p_frame.id;
+
+	if (result.score > 0.0) {
+		call_deferred(SNAME("emit_signal"), SNAME("motion_detected"), result.score);
+	}
+	return true;
+}
+
+void CameraFeed::set_change_detection(bool p_enable) {
+	change_detection.set_to(p_enable);
+}
+
+bool CameraFeed::is_detecting_changes() const {
+	return change_detection.is_set();
+}
+
+void CameraFeed::set_change_threshold(int p_threshold) {
+	change_threshold.set(CLAMP(p_threshold, 1, 64));
+}
+
+int CameraFeed::get_change_threshold() const {
+	return change_threshold.get();
+}
+
+void CameraFeed::add_luma_readback(int p_level, const Rect2i &p_region) {
+	ERR_FAIL_COND(p_level < 1 || p_level > RS::MAX_LUMA_PYRAMID_LEVELS);
+	ERR_FAIL_COND(p_region.position.x < 0 || p_region.position.y < 0 || p_region.size.x < 0 || p_region.size.y < 0);
+
+	MutexLock lock(frame_mutex);
+	if (luma_pyramid.is_null()) {
+		luma_pyramid = RenderingServer::get_singleton()->luma_pyramid_create();
+		RenderingServer::get_singleton()->luma_pyramid_set_callback(luma_pyramid, _luma_readback_completed, this);
+	}
+	RenderingServer::get_singleton()->luma_pyramid_add_readback(luma_pyramid, p_level, p_region);
+	luma_readback_count.increment();
+}
+
+void CameraFeed::clear_luma_readbacks() {
+	MutexLock lock(frame_mutex);
+	if (luma_pyramid.is_valid()) {
+		RenderingServer::get_singleton()->luma_pyramid_clear_readbacks(luma_pyramid);
+	}
+	luma_readback_count.set(0);
+}
+
+void CameraFeed::set_luma_readback_callback(LumaReadbackCallback p_callback, void *p_userdata) {
+	MutexLock lock(luma_callback_mutex);
+	luma_callback = p_callback;
+	luma_userdata = p_userdata;
+}
+
+void CameraFeed::_update_luma_pyramid(const Frame &p_frame) {
+	luma_frames_shown++;
+	if (luma_readback_count.get() == 0) {
+		return;
+	}
+
+	// the Y plane is luma already, everything else is read after it was converted to RGBA
+	RID source = datatype == CameraFeed::FEED_YCBCR_SEP ? proxy_texture[CameraServer::FEED_Y_IMAGE] : proxy_texture[CameraServer::FEED_RESOLVED_IMAGE];
+	int64_t sequence = p_frame.timing.sequence >= 0 ? p_frame.timing.sequence : int64_t(luma_frames_shown);
+	RenderingServer::get_singleton()->luma_pyramid_update(luma_pyramid, source, sequence);
+}
+
+void CameraFeed::_luma_readback_completed(void *p_userdata, int64_t p_sequence, int p_level, const Rect2i &p_region, const uint8_t *p_data) {
+	CameraFeed *feed = (CameraFeed *)p_userdata;
+	{
+		MutexLock lock(feed->luma_callback_mutex);
+		if (feed->luma_callback) {
+			feed->luma_callback(feed->luma_userdata, p_sequence, p_level, p_region, p_data);
+		}
+	}
+
+	Vector<uint8_t> data;
+	data.resize(p_region.size.x * p_region.size.y);
+	memcpy(data.ptrw(), p_data, data.size());
+	Ref<Image> image;
+	image.instantiate();
+	image->create(p_region.size.x, p_region.size.y, false, Image::FORMAT_L8, data);
+	feed->call_deferred(SNAME("emit_signal"), SNAME("luma_readback_completed"), p_sequence, p_level, p_region, image);
+}
+
+void CameraFeed::set_RGB_raw(const FramePlane &p_rgb, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	if (!active.is_set() || p_rgb.data == nullptr) {
+		if (p_release) {
+			p_release(p_userdata);
+		}
+		ERR_FAIL_NULL(p_rgb.data);
+		return;
+	}
+
+	Frame &frame = _begin_frame();
+	frame.type = FRAME_RGB_RAW;
+	frame.planes[0] = p_rgb;
+	const Rect2i region = _get_cpu_region(p_rgb.width, p_rgb.height, false);
+	if (!region.has_no_area()) {
+		frame.planes[0] = _crop_plane(p_rgb, region, p_rgb.width, p_rgb.height);
+	}
+	frame.release = p_release;
+	frame.userdata = p_userdata;
+	_keep_latest_planes(frame.planes, 1, false, frame.timing);
+	_feed_outputs(frame.planes, 1, false, frame.timing);
+	_record_frame(frame.planes, 1, false, frame.timing);
+	_publish_frame();
+}
+
+void CameraFeed::set_YCbCr_raws(const FramePlane &p_y, const FramePlane &p_cbcr, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	if (!active.is_set() || p_y.data == nullptr || p_cbcr.data == nullptr) {
+		if (p_release) {
+			p_release(p_userdata);
+		}
+		ERR_FAIL_NULL(p_y.data);
+		ERR_FAIL_NULL(p_cbcr.data);
+		return;
+	}
+
+	Frame &frame = _begin_frame();
+	frame.type = FRAME_YCBCR_RAWS;
+	frame.planes[0] = p_y;
+	frame.planes[1] = p_cbcr;
+	const Rect2i region = _get_cpu_region(p_y.width, p_y.height, true);
+	if (!region.has_no_area()) {
+		frame.planes[0] = _crop_plane(p_y, region, p_y.width, p_y.height);
+		frame.planes[1] = _crop_plane(p_cbcr, region, p_y.width, p_y.height);
+	}
+	frame.release = p_release;
+	frame.userdata = p_userdata;
+	_keep_latest_planes(frame.planes, 2, true, frame.timing);
+	_feed_outputs(frame.planes, 2, true, frame.timing);
+	_record_frame(frame.planes, 2, true, frame.timing);
+	_publish_frame();
+}
+
+int CameraFeed::add_YCbCr_shared_frame(const SharedPlane &p_y, const SharedPlane &p_cbcr) {
+	SharedFrame frame;
+	frame.y = RenderingServer::get_singleton()->texture_2d_dmabuf_create(p_y.fd, p_y.offset, p_y.width, p_y.height, p_y.row_pitch, p_y.format);
+	if (frame.y.is_null()) {
+		return -1;
+	}
+	frame.cbcr = RenderingServer::get_singleton()->texture_2d_dmabuf_create(p_cbcr.fd, p_cbcr.offset, p_cbcr.width, p_cbcr.height, p_cbcr.row_pitch, p_cbcr.format);
+	if (frame.cbcr.is_null()) {
+		RenderingServer::get_singleton()->free(frame.y);
+		return -1;
+	}
+
+	frame.width = p_y.width;
+	frame.height = p_y.height;
+
+	MutexLock lock(frame_mutex);
+	shared_frames.push_back(frame);
+	return shared_frames.size() - 1;
+}
+
+void CameraFeed::set_YCbCr_shared_frame(int p_frame, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	set_YCbCr_shared_frame(p_frame, FramePlane(), FramePlane(), p_release, p_userdata);
+}
+
+void CameraFeed::set_YCbCr_shared_frame(int p_frame, const FramePlane &p_y, const FramePlane &p_cbcr, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	if (!active.is_set()) {
+		if (p_release) {
+			p_release(p_userdata);
+		}
+		return;
+	}
+
+	Frame &frame = _begin_frame();
+	frame.type = FRAME_YCBCR_SHARED;
+	frame.shared_frame = p_frame;
+	frame.release = p_release;
+	frame.userdata = p_userdata;
+	if (p_y.data != nullptr && p_cbcr.data != nullptr) {
+		const FramePlane planes[2] = { p_y, p_cbcr };
+		_keep_latest_planes(planes, 2, true, frame.timing);
+		_feed_outputs(planes, 2, true, frame.timing);
+		_record_frame(planes, 2, true, frame.timing);
+	}
+	_publish_frame();
+}
+
+void CameraFeed::clear_shared_frames() {
+	// a frame that is still waiting may point at them
+	drop_pending_frames();
+
+	MutexLock lock(frame_mutex);
+
+	if (showing_shared_frame) {
+		// point back at our own textures before the frames go away
+		RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_Y_IMAGE], texture[CameraServer::FEED_Y_IMAGE]);
+		RenderingServer::get_singleton()->texture_proxy_update(proxy_texture[CameraServer::FEED_CBCR_IMAGE], texture[CameraServer::FEED_CBCR_IMAGE]);
+		_retire_shown_shared_frame();
+		showing_shared_frame = false;
+
+		// the next uploaded frame recreates our textures at the right size
+		base_width = 0;
+		base_height = 0;
+	}
+
+	// the renderer keeps its own reference to the buffers it imported,
+	// the capture code only has to stop writing to them once it has them back
+	_release_retired_frames(true);
+
+	for (int i = 0; i < shared_frames.size(); i++) {
+		RenderingServer::get_singleton()->free(shared_frames[i].y);
+		RenderingServer::get_singleton()->free(shared_frames[i].cbcr);
+	}
+	shared_frames.clear();
+}
+
+void CameraFeed::_retire_shown_shared_frame() {
+	// called with frame_mutex locked, when the proxies stop pointing at the shown shared frame
+	if (shown_shared_release) {
+		RetiredFrame retired;
+		retired.release = shown_shared_release;
+		retired.userdata = shown_shared_userdata;
+		retired.retired_draw = draw_count;
+		retired_frames.push_back(retired);
+	}
+	shown_shared_release = nullptr;
+	shown_shared_userdata = nullptr;
+}
+
+void CameraFeed::_release_retired_frames(bool p_all) {
+	// called with frame_mutex locked, the GPU is done with a frame once the frames it had queued behind it were drawn
+	RenderingDevice *rd = RenderingDevice::get_singleton();
+	uint64_t lag = rd ? rd->get_frame_delay() + 1 : 1;
+	while (!retired_frames.is_empty() && (p_all || draw_count - retired_frames[0].retired_draw >= lag)) {
+		retired_frames[0].release(retired_frames[0].userdata);
+		retired_frames.remove(0);
+	}
+}
+
+void CameraFeed::_keep_latest_images(const Ref<Image> *p_images, int p_count, bool p_ycbcr, const FrameTiming &p_timing) {
+	bool keeping = _is_keeping_frames();
+	if (!keeping && grayscale_downscale.get() == 0) {
+		return;
+	}
+
+	Ref<Image> grayscale;
+	if (!p_images[0]->is_empty()) {
+		grayscale = _make_grayscale(_get_image_plane(p_images[0]), p_ycbcr);
+	}
+
+	Ref<Image> images[2];
+	if (keeping) {
+		// the image is shared with the renderer, which only reads it
+		for (int i = 0; i < p_count; i++) {
+			images[i] = p_images[i];
+		}
+	}
+	_store_latest_frame(images, grayscale, p_ycbcr, p_timing);
+}
+
+void CameraFeed::_keep_latest_planes(const FramePlane *p_planes, int p_count, bool p_ycbcr, const FrameTiming &p_timing) {
+	bool keeping = _is_keeping_frames();
+	if (!keeping && grayscale_downscale.get() == 0) {
+		return;
+	}
+
+	Ref<Image> images[2];
+	if (keeping) {
+		// the planes go back to the camera, copy them
+		for (int i = 0; i < p_count; i++) {
+			const FramePlane &plane = p_planes[i];
+			images[i] = acquire_image(plane.width, plane.height, plane.format);
+			ERR_FAIL_COND(images[i].is_null());
+
+			int row_size = plane.width * Image::get_format_pixel_size(plane.format);
+			uint8_t *w = images[i]->ptrw();
+			for (int y = 0; y < plane.height; y++) {
+				memcpy(w + y * row_size, plane.data + y * plane.row_pitch, row_size);
 			}
-			{
-				RID new_texture = RenderingServer::get_singleton()->texture_2d_create(p_cbcr_img);
-				RenderingServer::get_singleton()->texture_replace(texture[CameraServer::FEED_CBCR_IMAGE], new_texture);
+		}
+	}
+
+	_store_latest_frame(images, _make_grayscale(p_planes[0], p_ycbcr), p_ycbcr, p_timing);
+}
+
+Ref<Image> CameraFeed::_make_grayscale(const FramePlane &p_plane, bool p_ycbcr) {
+	int downscale = MIN((int)grayscale_downscale.get(), MIN(p_plane.width, p_plane.height));
+	if (downscale <= 0) {
+		return Ref<Image>();
+	}
+
+	int width = p_plane.width / downscale;
+	int height = p_plane.height / downscale;
+	Ref<Image> grayscale = acquire_image(width, height, Image::FORMAT_L8);
+	ERR_FAIL_COND_V(grayscale.is_null(), Ref<Image>());
+
+	// YCbCr already has luma as its first channel, RGB is weighted like BT.601 does
+	int pixel_size = Image::get_format_pixel_size(p_plane.format);
+	bool weigh_rgb = !p_ycbcr && pixel_size >= 3;
+	int area = downscale * downscale;
+
+	uint8_t *w = grayscale->ptrw();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			// average the block of pixels this one covers
+			uint32_t sum = 0;
+			for (int by = 0; by < downscale; by++) {
+				const uint8_t *r = p_plane.data + (y * downscale + by) * p_plane.row_pitch + x * downscale * pixel_size;
+				for (int bx = 0; bx < downscale; bx++) {
+					sum += weigh_rgb ? (77 * r[0] + 150 * r[1] + 29 * r[2]) >> 8 : r[0];
+					r += pixel_size;
+				}
 			}
-		} else {
-			RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_Y_IMAGE], p_y_img);
-			RenderingServer::get_singleton()->texture_2d_update(texture[CameraServer::FEED_CBCR_IMAGE], p_cbcr_img);
+			w[y * width + x] = sum / area;
 		}
+	}
+
+	return grayscale;
+}
+
+void CameraFeed::_store_latest_frame(const Ref<Image> *p_images, const Ref<Image> &p_grayscale, bool p_ycbcr, const FrameTiming &p_timing) {
+	MutexLock lock(latest_frame_mutex);
+	latest_images[0] = p_images[0];
+	latest_images[1] = p_images[1];
+	latest_grayscale = p_grayscale;
+	latest_ycbcr = p_ycbcr;
+	latest_timing = p_timing;
+
+	if (frame_sets.is_empty()) {
+		return;
+	}
+
+	CameraFrameSet::CapturedFrame frame;
+	frame.images[0] = p_images[0];
+	frame.images[1] = p_images[1];
+	frame.grayscale = p_grayscale;
+	frame.ycbcr = p_ycbcr;
+	frame.timestamp_usec = _get_frame_usec(p_timing);
+	frame.sequence = p_timing.sequence;
+	for (int i = 0; i < frame_sets.size(); i++) {
+		frame_sets[i]->frame_captured(this, frame);
+	}
+}
 
-		datatype = CameraFeed::FEED_YCBCR_SEP;
+uint64_t CameraFeed::_get_frame_usec(const FrameTiming &p_timing) {
+	if (p_timing.capture_usec != 0) {
+		return p_timing.capture_usec;
 	}
+	// frames without timing go by when they reached us
+	return p_timing.dequeue_usec != 0 ? p_timing.dequeue_usec : OS::get_singleton()->get_ticks_usec();
+}
+
+bool CameraFeed::_is_keeping_frames() const {
+	return keep_latest_frame.is_set() || frame_set_count.get() > 0;
+}
+
+void CameraFeed::add_frame_set(CameraFrameSet *p_frame_set) {
+	MutexLock lock(latest_frame_mutex);
+	frame_sets.push_back(p_frame_set);
+	frame_set_count.increment();
+}
+
+void CameraFeed::remove_frame_set(CameraFrameSet *p_frame_set) {
+	// waits for the capture side to be done handing a frame to the set
+	MutexLock lock(latest_frame_mutex);
+	if (frame_sets.has(p_frame_set)) {
+		frame_sets.erase(p_frame_set);
+		frame_set_count.decrement();
+	}
+}
+
+void CameraFeed::set_keep_latest_frame(bool p_enable) {
+	keep_latest_frame.set_to(p_enable);
+}
+
+bool CameraFeed::is_keeping_latest_frame() const {
+	return keep_latest_frame.is_set();
+}
+
+void CameraFeed::set_grayscale_downscale(int p_downscale) {
+	grayscale_downscale.set(CLAMP(p_downscale, 0, 16));
+}
+
+int CameraFeed::get_grayscale_downscale() const {
+	return grayscale_downscale.get();
+}
+
+Dictionary CameraFeed::get_latest_frame() {
+	Dictionary frame;
+
+	MutexLock lock(latest_frame_mutex);
+	if (latest_images[0].is_null() && latest_grayscale.is_null()) {
+		return frame;
+	}
+
+	if (latest_images[0].is_valid()) {
+		frame["image"] = latest_images[0];
+	}
+	if (latest_images[1].is_valid()) {
+		frame["cbcr_image"] = latest_images[1];
+	}
+	if (latest_grayscale.is_valid()) {
+		frame["grayscale"] = latest_grayscale;
+	}
+	frame["ycbcr"] = latest_ycbcr;
+	frame["timestamp_usec"] = latest_timing.capture_usec != 0 ? latest_timing.capture_usec : latest_timing.dequeue_usec;
+	frame["sequence"] = latest_timing.sequence;
+	return frame;
+}
+
+CameraFeed::FramePlane CameraFeed::_get_image_plane(const Ref<Image> &p_image) {
+	FramePlane plane;
+	if (!p_image->is_empty()) {
+		plane.data = p_image->ptr();
+		plane.width = p_image->get_width();
+		plane.height = p_image->get_height();
+		plane.row_pitch = plane.width * Image::get_format_pixel_size(p_image->get_format());
+		plane.format = p_image->get_format();
+	}
+	return plane;
+}
+
+void CameraFeed::_set_cpu_region(const Rect2i &p_region) {
+	MutexLock lock(region_mutex);
+	cpu_region = p_region;
+}
+
+Rect2i CameraFeed::_get_cpu_region(int p_width, int p_height, bool p_subsampled) {
+	Rect2i region;
+	{
+		MutexLock lock(region_mutex);
+		region = cpu_region;
+	}
+	if (region.has_no_area()) {
+		return Rect2i();
+	}
+
+	const Rect2i frame(0, 0, p_width, p_height);
+	region = region.intersection(frame);
+	if (p_subsampled) {
+		// grow to even rows and columns so the chroma samples stay lined up with the luma ones
+		Vector2i end = region.get_end();
+		region.position.x &= ~1;
+		region.position.y &= ~1;
+		end.x = MIN((end.x + 1) & ~1, p_width);
+		end.y = MIN((end.y + 1) & ~1, p_height);
+		region.size = end - region.position;
+	}
+
+	if (region.has_no_area() || region == frame) {
+		// outside the frame or all of it, either way there is nothing to cut
+		return Rect2i();
+	}
+	return region;
+}
+
+Rect2i CameraFeed::_get_plane_region(const Rect2i &p_region, int p_frame_width, int p_frame_height, int p_width, int p_height) {
+	if (p_width == p_frame_width && p_height == p_frame_height) {
+		return p_region;
+	}
+
+	// subsampled planes, the region rounds outwards
+	const Vector2i end = p_region.get_end();
+	Rect2i region;
+	region.position.x = p_region.position.x * p_width / p_frame_width;
+	region.position.y = p_region.position.y * p_height / p_frame_height;
+	region.size.x = MIN((end.x * p_width + p_frame_width - 1) / p_frame_width, p_width) - region.position.x;
+	region.size.y = MIN((end.y * p_height + p_frame_height - 1) / p_frame_height, p_height) - region.position.y;
+	return region;
+}
+
+CameraFeed::FramePlane CameraFeed::_crop_plane(const FramePlane &p_plane, const Rect2i &p_region, int p_frame_width, int p_frame_height) {
+	// the rows keep their pitch, so the plane is cut without copying it
+	const Rect2i region = _get_plane_region(p_region, p_frame_width, p_frame_height, p_plane.width, p_plane.height);
+	FramePlane plane = p_plane;
+	plane.data += region.position.y * p_plane.row_pitch + region.position.x * Image::get_format_pixel_size(p_plane.format);
+	plane.width = region.size.x;
+	plane.height = region.size.y;
+	return plane;
+}
+
+Ref<Image> CameraFeed::_crop_image(const Ref<Image> &p_image, const Rect2i &p_region, int p_frame_width, int p_frame_height) {
+	const Rect2i region = _get_plane_region(p_region, p_frame_width, p_frame_height, p_image->get_width(), p_image->get_height());
+	Ref<Image> cropped = acquire_image(region.size.x, region.size.y, p_image->get_format());
+	ERR_FAIL_COND_V(cropped.is_null(), p_image);
+
+	const int pixel_size = Image::get_format_pixel_size(p_image->get_format());
+	const int src_pitch = p_image->get_width() * pixel_size;
+	const int dst_pitch = region.size.x * pixel_size;
+	const uint8_t *src = p_image->ptr() + region.position.y * src_pitch + region.position.x * pixel_size;
+	uint8_t *dst = cropped->ptrw();
+	for (int y = 0; y < region.size.y; y++) {
+		memcpy(dst + y * dst_pitch, src + y * src_pitch, dst_pitch);
+	}
+	return cropped;
+}
+
+void CameraFeed::set_region_of_interest(const Rect2i &p_region) {
+	ERR_FAIL_COND(p_region.position.x < 0 || p_region.position.y < 0 || p_region.size.x < 0 || p_region.size.y < 0);
+	region_of_interest = p_region;
+	_set_cpu_region(p_region);
+}
+
+Rect2i CameraFeed::get_region_of_interest() const {
+	return region_of_interest;
+}
+
+Ref<CameraFeed> CameraFeed::add_output(int p_width, int p_height, OutputFormat p_format, int p_frame_interval) {
+	ERR_FAIL_COND_V(p_width <= 0 || p_height <= 0, Ref<CameraFeed>());
+	ERR_FAIL_INDEX_V(p_format, OUTPUT_FORMAT_MAX, Ref<CameraFeed>());
+	ERR_FAIL_COND_V_MSG(output_source != nullptr, Ref<CameraFeed>(), "The output of a feed can't have outputs of its own.");
+
+	Ref<CameraFeed> output = memnew(CameraFeed(name + vformat(" (%dx%d)", p_width, p_height), position));
+	output->output_source = this;
+	output->output_frame_interval = MAX(p_frame_interval, 1);
+	output->transform = transform;
+	output->ycbcr_full_range = ycbcr_full_range;
+
+	{
+		MutexLock lock(outputs_mutex);
+		output_feeds.push_back(output);
+
+		int index = 0;
+		while (index < output_conversions.size()) {
+			const OutputConversion &conversion = output_conversions[index];
+			if (conversion.width == p_width && conversion.height == p_height && conversion.format == p_format) {
+				break;
+			}
+			index++;
+		}
+		if (index == output_conversions.size()) {
+			OutputConversion conversion;
+			conversion.width = p_width;
+			conversion.height = p_height;
+			conversion.format = p_format;
+			output_conversions.push_back(conversion);
+		}
+		output_conversions.write[index].outputs.push_back(output.ptr());
+	}
+
+	CameraServer::get_singleton()->add_feed(output);
+	return output;
+}
+
+void CameraFeed::remove_output(const Ref<CameraFeed> &p_output) {
+	ERR_FAIL_COND(p_output.is_null());
+	ERR_FAIL_COND_MSG(p_output->output_source != this, "The feed isn't an output of this feed.");
+
+	// p_output may point into our list
+	Ref<CameraFeed> output = p_output;
+	{
+		MutexLock lock(outputs_mutex);
+		for (int i = 0; i < output_conversions.size(); i++) {
+			OutputConversion &conversion = output_conversions.write[i];
+			conversion.outputs.erase(output.ptr());
+			if (conversion.outputs.is_empty()) {
+				output_conversions.remove(i);
+				break;
+			}
+		}
+		output_feeds.erase(output);
+	}
+
+	output->output_source = nullptr;
+	if (CameraServer::get_singleton()) {
+		CameraServer::get_singleton()->remove_feed(output);
+	}
+}
+
+Array CameraFeed::get_outputs() {
+	MutexLock lock(outputs_mutex);
+	Array outputs;
+	for (int i = 0; i < output_feeds.size(); i++) {
+		outputs.push_back(output_feeds[i]);
+	}
+	return outputs;
+}
+
+void CameraFeed::_convert_band(uint32_t p_band, ConversionJob *p_job) {
+	int from_row = p_band * p_job->rows_per_band;
+	CameraFrameScaler::convert_rows(p_job->source, p_job->format, p_job->dst, p_job->width, p_job->height, from_row, from_row + p_job->rows_per_band);
+}
+
+bool CameraFeed::_make_source(const FramePlane *p_planes, int p_count, bool p_ycbcr, CameraFrameScaler::Source &r_source) const {
+	if (p_planes[0].data == nullptr) {
+		return false;
+	}
+
+	r_source.planes[0] = p_planes[0].data;
+	r_source.strides[0] = p_planes[0].row_pitch;
+	r_source.pixel_size = Image::get_format_pixel_size(p_planes[0].format);
+	r_source.width = p_planes[0].width;
+	r_source.height = p_planes[0].height;
+	r_source.full_range = ycbcr_full_range;
+	if (!p_ycbcr) {
+		// not something we can take RGB from otherwise
+		r_source.layout = CameraFrameScaler::LAYOUT_RGB;
+		return r_source.pixel_size >= 3;
+	} else if (p_count == 1) {
+		r_source.layout = CameraFrameScaler::LAYOUT_YCBCR_PACKED;
+		return r_source.pixel_size >= 3;
+	}
+
+	r_source.layout = CameraFrameScaler::LAYOUT_YCBCR_PLANES;
+	r_source.planes[1] = p_planes[1].data;
+	r_source.strides[1] = p_planes[1].row_pitch;
+	r_source.chroma_width = p_planes[1].width;
+	r_source.chroma_height = p_planes[1].height;
+	return p_planes[1].data != nullptr && p_planes[1].width > 0 && p_planes[1].height > 0;
+}
+
+void CameraFeed::_feed_outputs(const FramePlane *p_planes, int p_count, bool p_ycbcr, const FrameTiming &p_timing) {
+	MutexLock lock(outputs_mutex);
+	if (output_conversions.is_empty()) {
+		return;
+	}
+
+	ConversionJob job;
+	if (!_make_source(p_planes, p_count, p_ycbcr, job.source)) {
+		return;
+	}
+
+	for (int i = 0; i < output_conversions.size(); i++) {
+		const OutputConversion &conversion = output_conversions[i];
+
+		// every output takes its own share of the frames, the conversion runs once for all of them
+		CameraFeed *first_output = nullptr;
+		for (CameraFeed *output : conversion.outputs) {
+			output->output_frame_wanted = output->active.is_set() && output->output_frame_counter++ % output->output_frame_interval == 0;
+			if (output->output_frame_wanted && first_output == nullptr) {
+				first_output = output;
+			}
+		}
+		if (first_output == nullptr) {
+			continue;
+		}
+
+		Ref<Image> image = first_output->acquire_image(conversion.width, conversion.height, conversion.format == OUTPUT_FORMAT_L8 ? Image::FORMAT_L8 : Image::FORMAT_RGBA8);
+		if (image.is_null()) {
+			continue;
+		}
+
+		job.format = conversion.format == OUTPUT_FORMAT_L8 ? CameraFrameScaler::FORMAT_L8 : CameraFrameScaler::FORMAT_RGBA8;
+		job.dst = image->ptrw();
+		job.width = conversion.width;
+		job.height = conversion.height;
+		// bands small enough to spread over the threads, small frames are converted right here
+		job.rows_per_band = MAX(16, conversion.height / 32);
+		job.rows_per_band = (job.rows_per_band + CameraFrameScaler::ROW_ALIGNMENT - 1) / CameraFrameScaler::ROW_ALIGNMENT * CameraFrameScaler::ROW_ALIGNMENT;
+		uint32_t bands = (conversion.height + job.rows_per_band - 1) / job.rows_per_band;
+		CameraServer::get_singleton()->do_conversion_work(bands, this, &CameraFeed::_convert_band, &job);
+
+		FrameTiming timing = p_timing;
+		timing.converted_usec = OS::get_singleton()->get_ticks_usec();
+		for (CameraFeed *output : conversion.outputs) {
+			if (output->output_frame_wanted) {
+				output->set_frame_timing(timing);
+				output->set_RGB_img(image);
+			}
+		}
+	}
+}
+
+void CameraFeed::set_queue_depth(int p_depth) {
+	queue_depth = CLAMP(p_depth, 2, 32);
+}
+
+int CameraFeed::get_queue_depth() const {
+	return queue_depth;
+}
+
+void CameraFeed::set_drop_policy(DropPolicy p_policy) {
+	ERR_FAIL_INDEX(p_policy, DROP_POLICY_BLOCK + 1);
+	drop_policy.set(p_policy);
+}
+
+CameraFeed::DropPolicy CameraFeed::get_drop_policy() const {
+	return (DropPolicy)drop_policy.get();
+}
+
+bool CameraFeed::is_frame_pending() const {
+	return mailbox.get() & FRAME_FRESH;
+}
+
+Array CameraFeed::get_formats() {
+	// feeds that can't choose their capture mode have nothing to offer
+	return Array();
+}
+
+bool CameraFeed::set_format(int p_width, int p_height, const String &p_pixel_format, float p_fps) {
+	return false;
 }
 
 bool CameraFeed::activate_feed() {
@@ -251,3 +1639,80 @@ bool CameraFeed::activate_feed() {
 void CameraFeed::deactivate_feed() {
 	// nothing to do here
 }
+
+void CameraFeed::check_feed() {
+	// nothing to check
+}
+
+void CameraFeed::apply_settings() {
+	// nothing to apply
+}
+
+bool CameraFeed::can_record(RecordingFormat p_format) const {
+	// feeds get their frames decoded, only cameras that can pass on what they capture record it as is
+	return p_format == RECORDING_FORMAT_Y4M;
+}
+
+Error CameraFeed::start_recording(const String &p_path, RecordingFormat p_format) {
+	ERR_FAIL_INDEX_V(p_format, RECORDING_FORMAT_MAX, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V_MSG(!can_record(p_format), ERR_UNAVAILABLE, "The camera of this feed doesn't capture in the requested recording format.");
+
+	stop_recording();
+
+	CameraRecorder *new_recorder = memnew(CameraRecorder);
+	Error err = new_recorder->start(p_path, p_format == RECORDING_FORMAT_MJPEG ? CameraRecorder::FORMAT_MJPEG : CameraRecorder::FORMAT_Y4M);
+	if (err != OK) {
+		memdelete(new_recorder);
+		return err;
+	}
+
+	MutexLock lock(recording_mutex);
+	recorder = new_recorder;
+	recording_statistics = CameraRecorder::Statistics();
+	return OK;
+}
+
+void CameraFeed::stop_recording() {
+	CameraRecorder *old_recorder;
+	{
+		// the capture side is done with it once we have the lock
+		MutexLock lock(recording_mutex);
+		old_recorder = recorder;
+		recorder = nullptr;
+	}
+	if (old_recorder == nullptr) {
+		return;
+	}
+
+	// waits for the frames still queued to be written
+	old_recorder->finish();
+
+	MutexLock lock(recording_mutex);
+	recording_statistics = old_recorder->get_statistics();
+	memdelete(old_recorder);
+}
+
+bool CameraFeed::is_recording() {
+	MutexLock lock(recording_mutex);
+	return recorder != nullptr;
+}
+
+void CameraFeed::record_encoded_frame(const uint8_t *p_data, int p_size, const FrameTiming &p_timing) {
+	MutexLock lock(recording_mutex);
+	if (recorder != nullptr && active.is_set()) {
+		recorder->push_encoded_frame(p_data, p_size, _get_frame_usec(p_timing));
+	}
+}
+
+void CameraFeed::_record_frame(const FramePlane *p_planes, int p_count, bool p_ycbcr, const FrameTiming &p_timing) {
+	MutexLock lock(recording_mutex);
+	if (recorder == nullptr || recorder->get_format() != CameraRecorder::FORMAT_Y4M) {
+		return;
+	}
+
+	CameraFrameScaler::Source source;
+	if (_make_source(p_planes, p_count, p_ycbcr, source)) {
+		recorder->push_frame(source, _get_frame_usec(p_timing));
+	}
+}
+
@@ -33,9 +33,18 @@
 
 #include "core/io/image.h"
 #include "core/math/transform_2d.h"
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+#include "servers/camera/camera_change_detector.h"
+#include "servers/camera/camera_frame_scaler.h"
+#include "servers/camera/camera_recorder.h"
 #include "servers/camera_server.h"
 #include "servers/rendering_server.h"
 
+class CameraFrameSet;
+
 /**
 	@author Bastiaan Olij <mux213@gmail.com>
 
@@ -60,6 +69,55 @@ public:
 		FEED_BACK // this is a camera on the back of the device
 	};
 
+	enum DropPolicy {
+		DROP_POLICY_OLDEST, // a frame that wasn't shown yet is replaced by a newer one, for the lowest latency
+		DROP_POLICY_NEWEST, // new frames are thrown away while one is waiting to be shown
+		DROP_POLICY_BLOCK // capturing waits until the waiting frame was shown, frames queue up in the camera
+	};
+
+	enum OutputFormat {
+		OUTPUT_FORMAT_RGBA8,
+		OUTPUT_FORMAT_L8,
+		OUTPUT_FORMAT_MAX
+	};
+
+	enum RecordingFormat {
+		RECORDING_FORMAT_Y4M, // uncompressed frames as captured, before they are converted to RGB
+		RECORDING_FORMAT_MJPEG, // the JPEG frames of cameras that capture in MJPEG, without decoding them
+		RECORDING_FORMAT_MAX
+	};
+
+	// A plane of a frame that is still owned by the capture code (such as a mapped capture buffer).
+	struct FramePlane {
+		const uint8_t *data = nullptr;
+		int width = 0;
+		int height = 0;
+		int row_pitch = 0; // bytes from the start of one row to the next
+		Image::Format format = Image::FORMAT_MAX;
+	};
+
+	// A plane of a frame in a dmabuf shared with the capture device, which the renderer samples in place.
+	struct SharedPlane {
+		int fd = -1;
+		uint64_t offset = 0; // bytes from the start of the dmabuf to the first row
+		int width = 0;
+		int height = 0;
+		int row_pitch = 0;
+		Image::Format format = Image::FORMAT_MAX;
+	};
+
+	// Gets the luma of part of a frame, p_region.size.x bytes per row, see add_luma_readback().
+	typedef void (*LumaReadbackCallback)(void *p_userdata, int64_t p_sequence, int p_level, const Rect2i &p_region, const uint8_t *p_data);
+
+	// When a frame went through the stages of the capture pipeline, in OS::get_ticks_usec() time.
+	// Stages the capture code can't tell are left at 0.
+	struct FrameTiming {
+		uint64_t capture_usec = 0; // when the sensor captured the frame
+		uint64_t dequeue_usec = 0; // when the capture code got it from the driver
+		uint64_t converted_usec = 0; // when it was ready to be handed to the renderer
+		int64_t sequence = -1; // frame counter of the driver, gaps are frames it dropped
+	};
+
 private:
 	int id; // unique id for this, for internal use in case feeds are removed
 	int base_width;
@@ -71,15 +129,249 @@ protected:
 	FeedPosition position; // position of camera on the device
 	Transform2D transform; // display transform
 
-	bool active; // only when active do we actually update the camera texture each frame
+	SafeFlag active; // only when active do we actually update the camera texture each frame, set while the camera captures
+	int queue_depth = 4; // number of buffers the camera captures into
+	SafeNumeric<uint32_t> drop_policy; // a DropPolicy, read by the capture side
 	RID texture[CameraServer::FEED_IMAGES]; // texture images needed for this
+	RID proxy_texture[CameraServer::FEED_IMAGES]; // what we hand out, points at texture or at a shared frame
+
+	struct SharedFrame {
+		RID y;
+		RID cbcr;
+		int width = 0;
+		int height = 0;
+	};
+	Vector<SharedFrame> shared_frames; // imported capture buffers
+	bool showing_shared_frame = false;
+
+	// A shared frame is handed back to the capture code once the GPU is done drawing with it,
+	// which is a few drawn frames after the proxies stopped pointing at it. Guarded by frame_mutex.
+	struct RetiredFrame {
+		RS::TextureRawReleaseCallback release = nullptr;
+		void *userdata = nullptr;
+		uint64_t retired_draw = 0; // draw_count when the proxies moved on
+	};
+	uint64_t draw_count = 0; // frame_drawn() calls
+	RS::TextureRawReleaseCallback shown_shared_release = nullptr;
+	void *shown_shared_userdata = nullptr;
+	Vector<RetiredFrame> retired_frames;
+	void _retire_shown_shared_frame();
+	void _release_retired_frames(bool p_all);
+	bool showing_resolved_frame = false; // the resolved proxy points at our RGBA conversion instead of the RGBA image
+	bool ycbcr_full_range = false; // set by feeds whose YCbCr uses 0-255 rather than 16-235
+
+	// Frames reach us from capture threads through a triple buffer: the capture code fills
+	// write_frame and swaps it into the mailbox, the render thread swaps read_frame out of it.
+	// A frame that wasn't picked up yet is replaced by the next one, so the latest frame wins.
+	enum FrameType {
+		FRAME_NONE,
+		FRAME_RGB_IMAGE,
+		FRAME_YCBCR_IMAGE,
+		FRAME_YCBCR_IMAGES,
+		FRAME_RGB_RAW,
+		FRAME_YCBCR_RAWS,
+		FRAME_YCBCR_SHARED,
+	};
+
+	struct Frame {
+		FrameType type = FRAME_NONE;
+		Ref<Image> images[2];
+		FramePlane planes[2];
+		RS::TextureRawReleaseCallback release = nullptr;
+		void *userdata = nullptr;
+		int shared_frame = -1;
+		FrameTiming timing;
+		// set by the change detector, the frame only differs from the one with id changed_since within the rects
+		uint64_t id = 0;
+		uint64_t changed_since = 0;
+		Rect2i changed_rects[CameraChangeDetector::MAX_RECTS];
+		int changed_rect_count = 0; // 0 if the whole frame changed
+	};
+
+	enum {
+		FRAME_INDEX_MASK = 0x3,
+		FRAME_FRESH = 0x4, // set while the mailbox holds a frame the render thread hasn't seen
+	};
+
+	Frame frames[3];
+	SafeNumeric<uint32_t> mailbox;
+	uint32_t write_frame = 1; // only touched by the capture side
+	uint32_t read_frame = 2; // only touched by update_frame()
+	Mutex frame_mutex; // guards the textures against update_frame() and the shared frame list
+
+	// Statistics over the last frames drawn, the samples are written on the rendering server thread.
+	enum {
+		STATISTICS_WINDOW = 240,
+	};
+	struct FrameSample {
+		uint64_t drawn_usec = 0;
+		int64_t latency_usec = -1; // capture to drawn
+		int64_t stage_usec[4] = { -1, -1, -1, -1 }; // capture to dequeue, dequeue to converted, converted to upload, upload to drawn
+	};
+	Mutex statistics_mutex;
+	FrameSample samples[STATISTICS_WINDOW];
+	int sample_count = 0;
+	int next_sample = 0;
+	uint64_t frames_drawn = 0;
+	SafeNumeric<uint64_t> frames_dropped; // never reached us, going by the driver's sequence numbers
+	SafeNumeric<uint64_t> frames_skipped; // replaced by a newer frame before they were shown
+	SafeNumeric<uint64_t> underruns; // times the camera had no buffer left to capture into
+	// the frame update_frame() uploaded, until it was drawn
+	FrameTiming shown_timing;
+	uint64_t shown_upload_usec = 0;
+	bool shown_awaiting_draw = false;
+	// when frame images were allocated, see acquire_image()
+	uint64_t allocation_usec[STATISTICS_WINDOW];
+	int allocation_count = 0;
+	int next_allocation = 0;
+	uint64_t image_allocations = 0;
+
+	// Images handed out by acquire_image(), an image is reused once nobody but the pool holds it.
+	enum {
+		IMAGE_POOL_SIZE = 16,
+	};
+	Mutex image_pool_mutex;
+	Vector<Ref<Image>> image_pool;
+
+	// The latest frame on the CPU for get_latest_frame(), kept by the setters on the capture side.
+	SafeFlag keep_latest_frame;
+	SafeNumeric<uint32_t> grayscale_downscale; // 0 when no grayscale frame is made
+	Mutex latest_frame_mutex; // guards the frame below
+	Ref<Image> latest_images[2];
+	Ref<Image> latest_grayscale;
+	bool latest_ycbcr = false;
+	FrameTiming latest_timing;
+	// frame sets the feed is in, they get every latest frame, see CameraServer::create_frame_set()
+	Vector<CameraFrameSet *> frame_sets; // guarded by latest_frame_mutex
+	SafeNumeric<uint32_t> frame_set_count;
+
+	bool _is_keeping_frames() const;
+	void _keep_latest_images(const Ref<Image> *p_images, int p_count, bool p_ycbcr, const FrameTiming &p_timing);
+	void _keep_latest_planes(const FramePlane *p_planes, int p_count, bool p_ycbcr, const FrameTiming &p_timing);
+	Ref<Image> _make_grayscale(const FramePlane &p_plane, bool p_ycbcr);
+	void _store_latest_frame(const Ref<Image> *p_images, const Ref<Image> &p_grayscale, bool p_ycbcr, const FrameTiming &p_timing);
+
+	// Feeds that get the frames of this one at a size and format of their own, see add_output().
+	// Outputs that ask for the same size and format share one conversion.
+	struct OutputConversion {
+		int width = 0;
+		int height = 0;
+		OutputFormat format = OUTPUT_FORMAT_RGBA8;
+		Vector<CameraFeed *> outputs;
+	};
+	Mutex outputs_mutex; // guards the outputs, held by the capture side while it converts
+	Vector<Ref<CameraFeed>> output_feeds;
+	Vector<OutputConversion> output_conversions;
+	// only set on outputs, their source feeds them from its capture side
+	CameraFeed *output_source = nullptr;
+	int output_frame_interval = 1;
+	uint32_t output_frame_counter = 0;
+	bool output_frame_wanted = false;
+
+	struct ConversionJob {
+		CameraFrameScaler::Source source;
+		CameraFrameScaler::Format format = CameraFrameScaler::FORMAT_RGBA8;
+		uint8_t *dst = nullptr;
+		int width = 0;
+		int height = 0;
+		int rows_per_band = 0;
+	};
+	bool _make_source(const FramePlane *p_planes, int p_count, bool p_ycbcr, CameraFrameScaler::Source &r_source) const;
+	void _convert_band(uint32_t p_band, ConversionJob *p_job);
+	void _feed_outputs(const FramePlane *p_planes, int p_count, bool p_ycbcr, const FrameTiming &p_timing);
+	static FramePlane _get_image_plane(const Ref<Image> &p_image);
+	static uint64_t _get_frame_usec(const FrameTiming &p_timing);
+
+	// Copies the frames to a file on a thread of its own while it is set, see start_recording().
+	Mutex recording_mutex; // guards the recorder, held by the capture side while it hands frames over
+	CameraRecorder *recorder = nullptr;
+	CameraRecorder::Statistics recording_statistics; // of the last recording, once it stopped
+	void _record_frame(const FramePlane *p_planes, int p_count, bool p_ycbcr, const FrameTiming &p_timing);
+
+	// Frames that didn't change aren't uploaded, and only the parts that did are, see set_change_detection().
+	SafeFlag change_detection;
+	SafeNumeric<uint32_t> change_threshold;
+	SafeNumeric<uint64_t> uploads_skipped;
+	SafeNumeric<uint64_t> uploads_partial;
+	// only touched by the capture side
+	CameraChangeDetector change_detector;
+	bool change_detector_used = false;
+	uint64_t next_frame_id = 1;
+	uint64_t last_changed_id = 0;
+	// the frame in our textures, only touched by update_frame()
+	uint64_t shown_frame_id = 0;
+	bool _detect_changes(Frame &p_frame);
+	static bool _can_update_changes(Image::Format p_format);
+	void _update_texture_changes(CameraServer::FeedImage p_which, const FramePlane &p_plane, const Frame &p_frame, RS::TextureRawReleaseCallback p_release, void *p_userdata);
+
+	// Levels of a luma pyramid the renderer builds from each frame shown, read back for the CPU, see add_luma_readback().
+	RID luma_pyramid; // created with the first readback, guarded by frame_mutex
+	SafeNumeric<uint32_t> luma_readback_count;
+	uint64_t luma_frames_shown = 0; // for cameras that don't number their frames, only touched by update_frame()
+	Mutex luma_callback_mutex; // guards the callback, which is called on the rendering thread
+	LumaReadbackCallback luma_callback = nullptr;
+	void *luma_userdata = nullptr;
+	void _update_luma_pyramid(const Frame &p_frame);
+	static void _luma_readback_completed(void *p_userdata, int64_t p_sequence, int p_level, const Rect2i &p_region, const uint8_t *p_data);
+
+	// The part of the frames the feed shows, see set_region_of_interest(). Feeds of cameras that crop
+	// themselves clear the CPU region, the setters cut whatever is left out of each frame.
+	Rect2i region_of_interest; // in pixels of the whole frame, empty for all of it
+	Mutex region_mutex; // guards the CPU region, read by the capture side
+	Rect2i cpu_region;
+	void _set_cpu_region(const Rect2i &p_region);
+	Rect2i _get_cpu_region(int p_width, int p_height, bool p_subsampled);
+	static Rect2i _get_plane_region(const Rect2i &p_region, int p_frame_width, int p_frame_height, int p_width, int p_height);
+	static FramePlane _crop_plane(const FramePlane &p_plane, const Rect2i &p_region, int p_frame_width, int p_frame_height);
+	Ref<Image> _crop_image(const Ref<Image> &p_image, const Rect2i &p_region, int p_frame_width, int p_frame_height);
+
+	// Bringing a camera up or down can take a while, so activate_feed() and deactivate_feed() run on
+	// a thread of their own. It works through requests until the feed is in the state last asked for.
+	Thread activation_thread;
+	Mutex activation_mutex; // guards the state below
+	bool activation_wanted = false; // what set_active() asked for last
+	bool activation_running = false;
+	int activation_waiters = 0; // wait_for_activation() calls waiting on activation_done
+	Semaphore activation_done; // posted once for each waiter when activation_running is cleared
+	bool feed_activated = false; // activate_feed() succeeded and deactivate_feed() wasn't called since
+	bool check_wanted = false; // see request_check()
+	bool settings_changed = false; // see _request_settings_change()
+
+	void _start_activation_thread();
+	// Has apply_settings() called on the activation thread, with the camera stopped for it if it is capturing.
+	// An active feed is activated again afterwards, emitting activated or activation_failed. Returns right away.
+	void _request_settings_change();
+	static void _activation_thread(void *p_user);
+	void _activation_finished(bool p_activated);
+	void _deactivation_finished();
+
+	void _reset_statistics();
+	void _count_image_allocation();
+
+	Frame &_begin_frame();
+	void _publish_frame();
+	static void _release_frame(Frame &p_frame);
+	void _apply_frame(const Frame &p_frame);
+	void _resolve_frame();
 
 	static void _bind_methods();
 
+	void _update_texture_raw(CameraServer::FeedImage p_which, const FramePlane &p_plane, bool p_resized, RS::TextureRawReleaseCallback p_release, void *p_userdata);
+
 public:
 	int get_id() const;
+	// What set_active() asked for last, false again once the activation failed.
 	bool is_active() const;
+	// Returns right away, the activated, activation_failed or deactivated signal follows once the camera is done.
 	void set_active(bool p_is_active);
+	// Whether the camera captures and frames are taken, set_active(true) gets there once activated is emitted.
+	bool is_capturing() const;
+	// Blocks until the camera is in the state last passed to set_active(), call it before
+	// changing what activate_feed() and deactivate_feed() depend on.
+	void wait_for_activation();
+	// Has check_feed() called on the activation thread once the camera is neither active nor on its way up
+	// or down, for capture code that learned the camera may have changed. Returns right away.
+	void request_check();
 
 	String get_name() const;
 	void set_name(String p_name);
@@ -100,15 +392,128 @@ public:
 	virtual ~CameraFeed();
 
 	FeedDataType get_datatype() const;
+
+	// Only used by cameras that capture into a queue of buffers, takes effect once the feed is activated again.
+	virtual void set_queue_depth(int p_depth);
+	int get_queue_depth() const;
+
+	// Only shows the part of the frames within p_region, an empty region shows the whole frame. Cameras that
+	// can crop do so before capturing, otherwise the setters cut the region out before the frames are uploaded.
+	virtual void set_region_of_interest(const Rect2i &p_region);
+	Rect2i get_region_of_interest() const;
+
+	void set_drop_policy(DropPolicy p_policy);
+	DropPolicy get_drop_policy() const;
+	// Whether a frame is waiting to be shown, capture code can hold off new frames while it is.
+	bool is_frame_pending() const;
+
+	// An image to fill with a frame and hand to one of the setters below, may be called from any thread.
+	// Reuses the image of an earlier frame once the renderer is done with it, so capturing at a
+	// steady size doesn't allocate. The contents are whatever the image held last.
+	Ref<Image> acquire_image(int p_width, int p_height, Image::Format p_format);
+
+	// The setters below may be called from any thread, but only one at a time. They queue the
+	// frame, update_frame() shows it on the rendering server thread.
 	void set_RGB_img(const Ref<Image> &p_rgb_img);
 	void set_YCbCr_img(const Ref<Image> &p_ycbcr_img);
 	void set_YCbCr_imgs(const Ref<Image> &p_y_img, const Ref<Image> &p_cbcr_img);
 
+	// Upload frames without copying them into images first. The planes must stay valid
+	// until p_release is called, which happens once the renderer has copied them.
+	void set_RGB_raw(const FramePlane &p_rgb, RS::TextureRawReleaseCallback p_release, void *p_userdata);
+	void set_YCbCr_raws(const FramePlane &p_y, const FramePlane &p_cbcr, RS::TextureRawReleaseCallback p_release, void *p_userdata);
+
+	// Frames the renderer samples straight from buffers shared with the capture device.
+	// Adding returns the index of the frame, or -1 if the renderer can't import the planes.
+	// The capture code must keep a shown buffer untouched until p_release is called, which happens once
+	// the GPU is done drawing with it, or right away for frames that weren't shown.
+	// Capture code that has the buffer mapped passes its planes for get_latest_frame().
+	int add_YCbCr_shared_frame(const SharedPlane &p_y, const SharedPlane &p_cbcr);
+	void set_YCbCr_shared_frame(int p_frame, RS::TextureRawReleaseCallback p_release = nullptr, void *p_userdata = nullptr);
+	void set_YCbCr_shared_frame(int p_frame, const FramePlane &p_y, const FramePlane &p_cbcr, RS::TextureRawReleaseCallback p_release = nullptr, void *p_userdata = nullptr);
+	void clear_shared_frames();
+
+	// Timing of the frame the next setter call hands over, call it from the same thread right before.
+	void set_frame_timing(const FrameTiming &p_timing);
+	// For frames the capture code threw away itself, such as when it can't keep up decoding them.
+	void report_skipped_frame();
+	// For frames the camera captured but never handed over, such as gaps in its frame numbers.
+	void report_dropped_frames(uint32_t p_count);
+	// For when the camera had no buffer left to capture into.
+	void report_underrun();
+	// Rolling statistics of the frames shown recently.
+	Dictionary get_statistics();
+
+	// Whether get_latest_frame() has the full frame, copying it on the capture thread where the renderer takes it in place.
+	void set_keep_latest_frame(bool p_enable);
+	bool is_keeping_latest_frame() const;
+	// Makes a grayscale frame at 1/p_downscale of the size on the capture thread, 0 for none.
+	void set_grayscale_downscale(int p_downscale);
+	int get_grayscale_downscale() const;
+	// Compares each frame with the one shown on the capture side, see the feed_change_detection property.
+	void set_change_detection(bool p_enable);
+	bool is_detecting_changes() const;
+	void set_change_threshold(int p_threshold);
+	int get_change_threshold() const;
+	// Reads p_region of level p_level of a luma pyramid the renderer builds from each frame it shows, where level 1
+	// to 3 are 1/2 to 1/8 of the frame size and an empty region is the whole level. The GPU copies arrive a few
+	// frames later without stalling it, through the luma_readback_completed signal and the callback below.
+	void add_luma_readback(int p_level, const Rect2i &p_region = Rect2i());
+	void clear_luma_readbacks();
+	// For tracking code that doesn't want an Image per readback, called on the rendering thread.
+	void set_luma_readback_callback(LumaReadbackCallback p_callback, void *p_userdata);
+
+	// The latest frame the camera captured, without a readback from the GPU.
+	Dictionary get_latest_frame();
+	// Called by frame sets, a feed keeps its latest frame while it is in one.
+	void add_frame_set(CameraFrameSet *p_frame_set);
+	void remove_frame_set(CameraFrameSet *p_frame_set);
+
+	// Releases a frame that was queued but not shown yet and waits for the one being uploaded, so that none is in
+	// flight anymore once it returns. Call this before the buffers behind them go away, with no frame being captured.
+	void drop_pending_frames();
+	// Shows the latest queued frame, called by the camera server before each frame is drawn.
+	void update_frame();
+	// Called by the camera server once the frame shown by update_frame() was drawn.
+	void frame_drawn();
+
+	// Adds a feed that gets the frames of this one scaled to p_width x p_height in p_format, and only
+	// every p_frame_interval-th of them. It is added to the camera server and gets frames while both
+	// feeds are active. Frames the renderer samples from shared buffers without a CPU mapping can't be converted.
+	Ref<CameraFeed> add_output(int p_width, int p_height, OutputFormat p_format, int p_frame_interval = 1);
+	void remove_output(const Ref<CameraFeed> &p_output);
+	Array get_outputs();
+
+	// Records the frames the camera captures to p_path until stop_recording() is called. The capture
+	// side only copies each frame into a queue, frames are dropped rather than holding up capture
+	// when the disk can't keep up.
+	Error start_recording(const String &p_path, RecordingFormat p_format);
+	void stop_recording();
+	bool is_recording();
+	virtual bool can_record(RecordingFormat p_format) const;
+	// For capture code that gets encoded frames from the camera, before it decodes them.
+	void record_encoded_frame(const uint8_t *p_data, int p_size, const FrameTiming &p_timing);
+
+	// The capture modes the camera offers, one Dictionary per mode with "width", "height",
+	// "pixel_format" (a FourCC such as "YUYV") and "fps" keys. Cameras that take any size
+	// or framerate within a range report the smallest and largest mode.
+	virtual Array get_formats();
+	// Captures in the given mode from now on, p_fps of 0 keeps the camera's default framerate.
+	// The camera may adjust the size and framerate to the closest it supports.
+	virtual bool set_format(int p_width, int p_height, const String &p_pixel_format, float p_fps = 0.0);
+
 	virtual bool activate_feed();
 	virtual void deactivate_feed();
+	// Called on the activation thread after request_check(), while the camera isn't active.
+	virtual void check_feed();
+	// Called on the activation thread after _request_settings_change(), while the camera isn't capturing.
+	virtual void apply_settings();
 };
 
 VARIANT_ENUM_CAST(CameraFeed::FeedDataType);
 VARIANT_ENUM_CAST(CameraFeed::FeedPosition);
+VARIANT_ENUM_CAST(CameraFeed::DropPolicy);
+VARIANT_ENUM_CAST(CameraFeed::OutputFormat);
+VARIANT_ENUM_CAST(CameraFeed::RecordingFormat);
 
 #endif /* !CAMERA_FEED_H */
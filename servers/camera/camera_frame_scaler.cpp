@@ -0,0 +1,152 @@
+/*************************************************************************/
+/*  camera_frame_scaler.cpp                                              */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_frame_scaler.h"
+
+#include "core/error/error_macros.h"
+#include "core/io/yuv_converter.h"
+#include "core/math/math_funcs.h"
+
+#include <string.h>
+
+static _FORCE_INLINE_ uint8_t _clamp_channel(int p_value) {
+	return p_value < 0 ? 0 : (p_value > 255 ? 255 : p_value);
+}
+
+// BT.601, the same as the GPU conversion of camera feeds
+static _FORCE_INLINE_ void _ycbcr_to_rgb(int p_y, int p_cb, int p_cr, bool p_full_range, uint8_t *r_rgb) {
+	int d = p_cb - 128;
+	int e = p_cr - 128;
+	if (p_full_range) {
+		int c = p_y * 256;
+		r_rgb[0] = _clamp_channel((c + 359 * e + 128) >> 8);
+		r_rgb[1] = _clamp_channel((c - 88 * d - 183 * e + 128) >> 8);
+		r_rgb[2] = _clamp_channel((c + 454 * d + 128) >> 8);
+	} else {
+		int c = (p_y - 16) * 298;
+		r_rgb[0] = _clamp_channel((c + 409 * e + 128) >> 8);
+		r_rgb[1] = _clamp_channel((c - 100 * d - 208 * e + 128) >> 8);
+		r_rgb[2] = _clamp_channel((c + 516 * d + 128) >> 8);
+	}
+}
+
+// The source pixel the center of destination pixel p_dst lands on.
+static _FORCE_INLINE_ int _sample(int p_dst, int p_dst_size, int p_src_size) {
+	return (int)(((int64_t)(2 * p_dst + 1) * p_src_size) / (2 * p_dst_size));
+}
+
+static bool _convert_rows_unscaled(const CameraFrameScaler::Source &p_source, CameraFrameScaler::Format p_format, uint8_t *p_dst, int p_width, int p_from_row, int p_to_row) {
+	const int rows = p_to_row - p_from_row;
+
+	if (p_format == CameraFrameScaler::FORMAT_L8) {
+		if (p_source.layout != CameraFrameScaler::LAYOUT_YCBCR_PLANES) {
+			return false;
+		}
+		// the Y plane as is
+		for (int y = p_from_row; y < p_to_row; y++) {
+			memcpy(p_dst + y * p_width, p_source.planes[0] + y * p_source.strides[0], p_width);
+		}
+		return true;
+	}
+
+	if (p_source.layout == CameraFrameScaler::LAYOUT_RGB && p_source.pixel_size == 4) {
+		for (int y = p_from_row; y < p_to_row; y++) {
+			memcpy(p_dst + y * p_width * 4, p_source.planes[0] + y * p_source.strides[0], p_width * 4);
+		}
+		return true;
+	}
+
+	YUVConverter::Source source;
+	source.width = p_width;
+	source.height = rows;
+	source.range = p_source.full_range ? YUVConverter::RANGE_FULL : YUVConverter::RANGE_LIMITED;
+	if (p_source.layout == CameraFrameScaler::LAYOUT_RGB && p_source.pixel_size == 3) {
+		source.format = YUVConverter::SOURCE_RGB24;
+		source.planes[0] = p_source.planes[0] + p_from_row * p_source.strides[0];
+		source.strides[0] = p_source.strides[0];
+	} else if (p_source.layout == CameraFrameScaler::LAYOUT_YCBCR_PLANES && p_source.chroma_width == (p_source.width + 1) / 2 && p_source.chroma_height == (p_source.height + 1) / 2) {
+		// bands start on an even row, so they start on a chroma row too
+		source.format = YUVConverter::SOURCE_NV12;
+		source.planes[0] = p_source.planes[0] + p_from_row * p_source.strides[0];
+		source.planes[1] = p_source.planes[1] + (p_from_row / 2) * p_source.strides[1];
+		source.strides[0] = p_source.strides[0];
+		source.strides[1] = p_source.strides[1];
+	} else {
+		return false;
+	}
+
+	YUVConverter::convert_to_rgba8(source, p_dst + p_from_row * p_width * 4);
+	return true;
+}
+
+void CameraFrameScaler::convert_rows(const Source &p_source, Format p_format, uint8_t *p_dst, int p_width, int p_height, int p_from_row, int p_to_row) {
+	ERR_FAIL_COND(p_source.width <= 0 || p_source.height <= 0);
+	ERR_FAIL_COND(p_from_row % ROW_ALIGNMENT != 0);
+	p_to_row = MIN(p_to_row, p_height);
+
+	if (p_width == p_source.width && p_height == p_source.height && _convert_rows_unscaled(p_source, p_format, p_dst, p_width, p_from_row, p_to_row)) {
+		return;
+	}
+
+	const bool ycbcr = p_source.layout != LAYOUT_RGB;
+	for (int y = p_from_row; y < p_to_row; y++) {
+		int sy = _sample(y, p_height, p_source.height);
+		const uint8_t *row = p_source.planes[0] + sy * p_source.strides[0];
+		const uint8_t *chroma_row = nullptr;
+		if (p_source.layout == LAYOUT_YCBCR_PLANES) {
+			chroma_row = p_source.planes[1] + MIN(sy * p_source.chroma_height / p_source.height, p_source.chroma_height - 1) * p_source.strides[1];
+		}
+
+		uint8_t *dst = p_dst + y * p_width * (p_format == FORMAT_RGBA8 ? 4 : 1);
+		for (int x = 0; x < p_width; x++) {
+			int sx = _sample(x, p_width, p_source.width);
+			const uint8_t *pixel = row + sx * p_source.pixel_size;
+
+			if (p_format == FORMAT_L8) {
+				// YCbCr keeps its Y values as captured, RGB is weighted like BT.601 does
+				*dst++ = ycbcr ? pixel[0] : (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2]) >> 8;
+				continue;
+			}
+
+			if (!ycbcr) {
+				dst[0] = pixel[0];
+				dst[1] = pixel[1];
+				dst[2] = pixel[2];
+			} else if (chroma_row) {
+				const uint8_t *chroma = chroma_row + MIN(sx * p_source.chroma_width / p_source.width, p_source.chroma_width - 1) * 2;
+				_ycbcr_to_rgb(pixel[0], chroma[0], chroma[1], p_source.full_range, dst);
+			} else {
+				_ycbcr_to_rgb(pixel[0], pixel[1], pixel[2], p_source.full_range, dst);
+			}
+			dst[3] = 255;
+			dst += 4;
+		}
+	}
+}
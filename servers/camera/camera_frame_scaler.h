@@ -0,0 +1,71 @@
+/*************************************************************************/
+/*  camera_frame_scaler.h                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_FRAME_SCALER_H
+#define CAMERA_FRAME_SCALER_H
+
+#include "core/typedefs.h"
+
+// Converts camera frames to RGBA8 or L8 at another size on the CPU, for the outputs of a
+// camera feed. Frames are sampled at the nearest pixel, and converted a band of rows at a
+// time so the work can be spread over threads.
+class CameraFrameScaler {
+public:
+	enum Layout {
+		LAYOUT_RGB, // packed RGB8 or RGBA8
+		LAYOUT_YCBCR_PACKED, // Y, Cb and Cr in the channels of every pixel
+		LAYOUT_YCBCR_PLANES, // a Y plane and an interleaved CbCr plane, possibly at a lower resolution
+	};
+
+	enum Format {
+		FORMAT_RGBA8,
+		FORMAT_L8,
+	};
+
+	struct Source {
+		Layout layout = LAYOUT_RGB;
+		const uint8_t *planes[2] = {};
+		int strides[2] = {}; // bytes from the start of one row to the next
+		int pixel_size = 0; // bytes per pixel of the first plane
+		int width = 0;
+		int height = 0;
+		int chroma_width = 0; // size of the CbCr plane
+		int chroma_height = 0;
+		bool full_range = false; // YCbCr from 0 to 255 rather than 16 to 235
+	};
+
+	// Rows of the destination are converted in bands of this many, or a multiple of it.
+	static const int ROW_ALIGNMENT = 2;
+
+	// Writes the rows from p_from_row up to p_to_row of a p_width x p_height image in p_format to p_dst.
+	static void convert_rows(const Source &p_source, Format p_format, uint8_t *p_dst, int p_width, int p_height, int p_from_row, int p_to_row);
+};
+
+#endif // CAMERA_FRAME_SCALER_H
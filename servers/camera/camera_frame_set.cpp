@@ -0,0 +1,272 @@
+/*************************************************************************/
+/*  camera_frame_set.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_frame_set.h"
+
+#include "servers/camera/camera_feed.h"
+
+void CameraFrameSet::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_feeds"), &CameraFrameSet::get_feeds);
+
+	ClassDB::bind_method(D_METHOD("set_tolerance", "tolerance_ms"), &CameraFrameSet::set_tolerance);
+	ClassDB::bind_method(D_METHOD("get_tolerance"), &CameraFrameSet::get_tolerance);
+
+	ClassDB::bind_method(D_METHOD("get_latest_set"), &CameraFrameSet::get_latest_set);
+	ClassDB::bind_method(D_METHOD("get_statistics"), &CameraFrameSet::get_statistics);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "tolerance", PROPERTY_HINT_RANGE, "0,100,0.1,suffix:ms"), "set_tolerance", "get_tolerance");
+}
+
+void CameraFrameSet::setup(const Vector<Ref<CameraFeed>> &p_feeds, double p_tolerance_ms) {
+	ERR_FAIL_COND(!feeds.is_empty());
+
+	set_tolerance(p_tolerance_ms);
+
+	{
+		MutexLock lock(mutex);
+		feeds = p_feeds;
+		histories.resize(feeds.size());
+		drift_offsets.resize(DRIFT_WINDOW * feeds.size());
+	}
+
+	// frames come in from here on
+	for (int i = 0; i < feeds.size(); i++) {
+		feeds.write[i]->add_frame_set(this);
+	}
+}
+
+void CameraFrameSet::frame_captured(const CameraFeed *p_feed, const CapturedFrame &p_frame) {
+	MutexLock lock(mutex);
+
+	int index = -1;
+	for (int i = 0; i < feeds.size(); i++) {
+		if (feeds[i].ptr() == p_feed) {
+			index = i;
+			break;
+		}
+	}
+	ERR_FAIL_COND(index < 0);
+
+	FeedHistory &history = histories.write[index];
+	int slot = history.next;
+	if (history.count == HISTORY_SIZE && !history.frames[slot].matched) {
+		history.unmatched++;
+	}
+	history.frames[slot] = p_frame;
+	history.frames[slot].matched = false;
+	history.next = (history.next + 1) % HISTORY_SIZE;
+	history.count = MIN(history.count + 1, (int)HISTORY_SIZE);
+
+	// this is the newest frame of its feed, pair it with the closest frames of the others
+	// that weren't in a set yet, a feed that doesn't have one within the tolerance holds the set off
+	Vector<int> picked;
+	picked.resize(feeds.size());
+	uint64_t earliest = p_frame.timestamp_usec;
+	uint64_t latest = p_frame.timestamp_usec;
+	for (int i = 0; i < feeds.size(); i++) {
+		if (i == index) {
+			picked.write[i] = slot;
+			continue;
+		}
+
+		const FeedHistory &other = histories[i];
+		int best = -1;
+		uint64_t best_distance = 0;
+		for (int j = 0; j < other.count; j++) {
+			const CapturedFrame &frame = other.frames[j];
+			if (frame.matched) {
+				continue;
+			}
+			uint64_t distance = frame.timestamp_usec > p_frame.timestamp_usec ? frame.timestamp_usec - p_frame.timestamp_usec : p_frame.timestamp_usec - frame.timestamp_usec;
+			if (best < 0 || distance < best_distance) {
+				best = j;
+				best_distance = distance;
+			}
+		}
+		if (best < 0 || best_distance > tolerance_usec) {
+			return;
+		}
+
+		picked.write[i] = best;
+		earliest = MIN(earliest, other.frames[best].timestamp_usec);
+		latest = MAX(latest, other.frames[best].timestamp_usec);
+	}
+	if (latest - earliest > tolerance_usec) {
+		return;
+	}
+
+	// publish the set, its frames aren't matched again
+	uint64_t offset_total = 0;
+	latest_set.resize(feeds.size());
+	for (int i = 0; i < feeds.size(); i++) {
+		CapturedFrame &frame = histories.write[i].frames[picked[i]];
+		frame.matched = true;
+		latest_set.write[i] = frame;
+		offset_total += frame.timestamp_usec - earliest;
+	}
+	latest_set_usec = earliest + offset_total / feeds.size();
+	latest_set_spread_usec = latest - earliest;
+	sets_matched++;
+
+	int64_t *offsets = drift_offsets.ptrw() + next_drift * feeds.size();
+	for (int i = 0; i < feeds.size(); i++) {
+		offsets[i] = int64_t(latest_set[i].timestamp_usec) - int64_t(latest_set[0].timestamp_usec);
+	}
+	drift_usec[next_drift] = latest_set_usec;
+	drift_spread_usec[next_drift] = latest_set_spread_usec;
+	next_drift = (next_drift + 1) % DRIFT_WINDOW;
+	drift_count = MIN(drift_count + 1, (int)DRIFT_WINDOW);
+}
+
+Array CameraFrameSet::get_feeds() const {
+	Array result;
+
+	MutexLock lock(mutex);
+	for (int i = 0; i < feeds.size(); i++) {
+		result.push_back(feeds[i]);
+	}
+	return result;
+}
+
+void CameraFrameSet::set_tolerance(double p_tolerance_ms) {
+	ERR_FAIL_COND(p_tolerance_ms < 0.0);
+
+	MutexLock lock(mutex);
+	tolerance_usec = p_tolerance_ms * 1000.0;
+}
+
+double CameraFrameSet::get_tolerance() const {
+	MutexLock lock(mutex);
+	return tolerance_usec / 1000.0;
+}
+
+Dictionary CameraFrameSet::_frame_to_dictionary(const CapturedFrame &p_frame) {
+	Dictionary frame;
+	if (p_frame.images[0].is_valid()) {
+		frame["image"] = p_frame.images[0];
+	}
+	if (p_frame.images[1].is_valid()) {
+		frame["cbcr_image"] = p_frame.images[1];
+	}
+	if (p_frame.grayscale.is_valid()) {
+		frame["grayscale"] = p_frame.grayscale;
+	}
+	frame["ycbcr"] = p_frame.ycbcr;
+	frame["timestamp_usec"] = p_frame.timestamp_usec;
+	frame["sequence"] = p_frame.sequence;
+	return frame;
+}
+
+Dictionary CameraFrameSet::get_latest_set() {
+	Dictionary set;
+
+	MutexLock lock(mutex);
+	if (sets_matched == 0) {
+		return set;
+	}
+
+	Array frames;
+	for (int i = 0; i < latest_set.size(); i++) {
+		frames.push_back(_frame_to_dictionary(latest_set[i]));
+	}
+	set["frames"] = frames;
+	set["timestamp_usec"] = latest_set_usec;
+	set["spread_usec"] = latest_set_spread_usec;
+	set["sequence"] = sets_matched - 1;
+	return set;
+}
+
+Dictionary CameraFrameSet::get_statistics() {
+	Dictionary statistics;
+
+	MutexLock lock(mutex);
+	statistics["sets_matched"] = sets_matched;
+
+	uint64_t spread_total = 0;
+	uint64_t spread_max = 0;
+	for (int i = 0; i < drift_count; i++) {
+		spread_total += drift_spread_usec[i];
+		spread_max = MAX(spread_max, drift_spread_usec[i]);
+	}
+	statistics["spread_mean_ms"] = drift_count > 0 ? spread_total / 1000.0 / drift_count : 0.0;
+	statistics["spread_max_ms"] = spread_max / 1000.0;
+
+	// the drift is the slope of a least squares fit of the offsets over time, relative to the oldest set
+	uint64_t first_usec = drift_count < DRIFT_WINDOW ? drift_usec[0] : drift_usec[next_drift];
+	Array feed_statistics;
+	for (int i = 0; i < feeds.size(); i++) {
+		double offset_total = 0.0;
+		double offset_max = 0.0;
+		double time_total = 0.0;
+		for (int j = 0; j < drift_count; j++) {
+			double offset = drift_offsets[j * feeds.size() + i] / 1000.0;
+			offset_total += offset;
+			offset_max = MAX(offset_max, Math::abs(offset));
+			time_total += int64_t(drift_usec[j] - first_usec) / 1000000.0;
+		}
+
+		double drift = 0.0;
+		if (drift_count > 1) {
+			double offset_mean = offset_total / drift_count;
+			double time_mean = time_total / drift_count;
+			double covariance = 0.0;
+			double variance = 0.0;
+			for (int j = 0; j < drift_count; j++) {
+				double time = int64_t(drift_usec[j] - first_usec) / 1000000.0 - time_mean;
+				covariance += time * (drift_offsets[j * feeds.size() + i] / 1000.0 - offset_mean);
+				variance += time * time;
+			}
+			if (variance > 0.0) {
+				drift = covariance / variance;
+			}
+		}
+
+		Dictionary feed;
+		feed["id"] = feeds[i]->get_id();
+		feed["frames_unmatched"] = histories[i].unmatched;
+		feed["offset_mean_ms"] = drift_count > 0 ? offset_total / drift_count : 0.0;
+		feed["offset_max_ms"] = offset_max;
+		feed["drift_ms_per_second"] = drift;
+		feed_statistics.push_back(feed);
+	}
+	statistics["feeds"] = feed_statistics;
+
+	return statistics;
+}
+
+CameraFrameSet::CameraFrameSet() {
+}
+
+CameraFrameSet::~CameraFrameSet() {
+	// waits for a capture thread that is handing over a frame
+	for (int i = 0; i < feeds.size(); i++) {
+		feeds.write[i]->remove_frame_set(this);
+	}
+}
@@ -0,0 +1,112 @@
+/*************************************************************************/
+/*  camera_frame_set.h                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_FRAME_SET_H
+#define CAMERA_FRAME_SET_H
+
+#include "core/io/image.h"
+#include "core/object/ref_counted.h"
+#include "core/os/mutex.h"
+
+class CameraFeed;
+
+// Matches the frames of several feeds by when they were captured, for stereo and multi-view rigs.
+// Feeds hand their frames over on their capture threads, and the frame that completes a set of
+// frames captured within the tolerance of each other publishes the set, so reading it never waits.
+class CameraFrameSet : public RefCounted {
+	GDCLASS(CameraFrameSet, RefCounted);
+
+public:
+	struct CapturedFrame {
+		Ref<Image> images[2];
+		Ref<Image> grayscale;
+		bool ycbcr = false;
+		uint64_t timestamp_usec = 0; // capture time in OS::get_ticks_usec() time
+		int64_t sequence = -1;
+		bool matched = false; // part of a set that was published
+	};
+
+private:
+	enum {
+		HISTORY_SIZE = 3, // recent frames of every feed the frames of the others are matched against
+		DRIFT_WINDOW = 120, // sets the offsets between feeds are measured over
+	};
+
+	struct FeedHistory {
+		CapturedFrame frames[HISTORY_SIZE];
+		int count = 0;
+		int next = 0;
+		uint64_t unmatched = 0; // frames that left the history without being in a set
+	};
+
+	Mutex mutex; // guards everything below, held by the capture side while it matches
+	Vector<Ref<CameraFeed>> feeds;
+	Vector<FeedHistory> histories;
+	uint64_t tolerance_usec = 0;
+
+	Vector<CapturedFrame> latest_set;
+	uint64_t latest_set_usec = 0;
+	uint64_t latest_set_spread_usec = 0;
+	uint64_t sets_matched = 0;
+
+	// offsets of the feeds to the first one, DRIFT_WINDOW rows of one column per feed
+	Vector<int64_t> drift_offsets;
+	uint64_t drift_usec[DRIFT_WINDOW];
+	uint64_t drift_spread_usec[DRIFT_WINDOW];
+	int drift_count = 0;
+	int next_drift = 0;
+
+	static Dictionary _frame_to_dictionary(const CapturedFrame &p_frame);
+
+protected:
+	static void _bind_methods();
+
+public:
+	// Called by CameraServer::create_frame_set().
+	void setup(const Vector<Ref<CameraFeed>> &p_feeds, double p_tolerance_ms);
+
+	// Called by a feed of the set on its capture thread for every frame it captures.
+	void frame_captured(const CameraFeed *p_feed, const CapturedFrame &p_frame);
+
+	Array get_feeds() const;
+
+	void set_tolerance(double p_tolerance_ms);
+	double get_tolerance() const;
+
+	// The frames of the latest matched set in the order of the feeds, empty until a set was matched.
+	Dictionary get_latest_set();
+	// How the feeds are matched and how far apart their frames are captured.
+	Dictionary get_statistics();
+
+	CameraFrameSet();
+	~CameraFrameSet();
+};
+
+#endif // CAMERA_FRAME_SET_H
@@ -0,0 +1,327 @@
+/*************************************************************************/
+/*  camera_recorder.cpp                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "camera_recorder.h"
+
+#include "core/os/os.h"
+
+const char *CameraRecorder::_get_y4m_chroma(const CameraFrameScaler::Source &p_source) {
+	if (p_source.width <= 0 || p_source.height <= 0) {
+		return nullptr;
+	}
+
+	switch (p_source.layout) {
+		case CameraFrameScaler::LAYOUT_RGB:
+		case CameraFrameScaler::LAYOUT_YCBCR_PACKED:
+			return p_source.pixel_size >= 3 ? "444" : nullptr;
+		case CameraFrameScaler::LAYOUT_YCBCR_PLANES:
+			if (p_source.pixel_size != 1 || p_source.chroma_width != (p_source.width + 1) / 2) {
+				return nullptr;
+			}
+			if (p_source.chroma_height == p_source.height) {
+				return "422";
+			}
+			// the CbCr planes cameras deliver are sited like MPEG-2 does
+			return p_source.chroma_height == (p_source.height + 1) / 2 ? "420mpeg2" : nullptr;
+	}
+	return nullptr;
+}
+
+bool CameraRecorder::_is_full_range(const CameraFrameScaler::Source &p_source) {
+	// RGB frames are converted to full range YCbCr
+	return p_source.layout == CameraFrameScaler::LAYOUT_RGB || p_source.full_range;
+}
+
+bool CameraRecorder::is_y4m_source(const CameraFrameScaler::Source &p_source) {
+	return _get_y4m_chroma(p_source) != nullptr;
+}
+
+Error CameraRecorder::start(const String &p_path, Format p_format) {
+	ERR_FAIL_COND_V(file != nullptr, ERR_ALREADY_IN_USE);
+
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(file == nullptr, err, "Can't open " + p_path + " to record the camera to.");
+
+	format = p_format;
+	batch.resize(BATCH_SIZE);
+	thread.start(_thread_func, this);
+	return OK;
+}
+
+void CameraRecorder::finish() {
+	if (file == nullptr) {
+		return;
+	}
+
+	{
+		MutexLock lock(queue_mutex);
+		finishing = true;
+	}
+	frames_waiting.post();
+	thread.wait_to_finish();
+
+	file->close();
+	memdelete(file);
+	file = nullptr;
+}
+
+CameraRecorder::QueuedFrame *CameraRecorder::_reserve_frame() {
+	// called with queue_mutex held, capture doesn't wait for the writer to catch up
+	if (finishing || queue_count == QUEUE_SIZE) {
+		frames_dropped.increment();
+		return nullptr;
+	}
+	return &queue[(queue_first + queue_count) % QUEUE_SIZE];
+}
+
+void CameraRecorder::_queue_frame() {
+	queue_count++;
+	queue_peak.exchange_if_greater(queue_count);
+	frames_waiting.post();
+}
+
+void CameraRecorder::push_frame(const CameraFrameScaler::Source &p_source, uint64_t p_timestamp_usec) {
+	if (format != FORMAT_Y4M) {
+		return;
+	}
+	if (!is_y4m_source(p_source)) {
+		frames_dropped.increment();
+		return;
+	}
+
+	MutexLock lock(queue_mutex);
+	QueuedFrame *frame = _reserve_frame();
+	if (frame == nullptr) {
+		return;
+	}
+
+	// copy the planes without their padding
+	int row_size = p_source.width * p_source.pixel_size;
+	int chroma_row_size = p_source.layout == CameraFrameScaler::LAYOUT_YCBCR_PLANES ? p_source.chroma_width * 2 : 0;
+	frame->data.resize(row_size * p_source.height + chroma_row_size * p_source.chroma_height);
+	uint8_t *w = frame->data.ptrw();
+	for (int y = 0; y < p_source.height; y++) {
+		memcpy(w, p_source.planes[0] + y * p_source.strides[0], row_size);
+		w += row_size;
+	}
+	for (int y = 0; y < p_source.chroma_height && chroma_row_size > 0; y++) {
+		memcpy(w, p_source.planes[1] + y * p_source.strides[1], chroma_row_size);
+		w += chroma_row_size;
+	}
+
+	frame->source = p_source;
+	frame->source.planes[0] = nullptr;
+	frame->source.planes[1] = nullptr;
+	frame->source.strides[0] = row_size;
+	frame->source.strides[1] = chroma_row_size;
+	frame->timestamp_usec = p_timestamp_usec;
+	_queue_frame();
+}
+
+void CameraRecorder::push_encoded_frame(const uint8_t *p_data, int p_size, uint64_t p_timestamp_usec) {
+	if (format != FORMAT_MJPEG || p_size <= 0) {
+		return;
+	}
+
+	MutexLock lock(queue_mutex);
+	QueuedFrame *frame = _reserve_frame();
+	if (frame == nullptr) {
+		return;
+	}
+
+	frame->data.resize(p_size);
+	memcpy(frame->data.ptrw(), p_data, p_size);
+	frame->timestamp_usec = p_timestamp_usec;
+	_queue_frame();
+}
+
+void CameraRecorder::_thread_func(void *p_user) {
+	CameraRecorder *recorder = (CameraRecorder *)p_user;
+	recorder->_write_frames();
+}
+
+void CameraRecorder::_write_frames() {
+	bool done = false;
+	while (!done) {
+		frames_waiting.wait();
+
+		while (true) {
+			const QueuedFrame *frame = nullptr;
+			uint64_t next_usec = 0;
+			{
+				MutexLock lock(queue_mutex);
+				// the frame rate in the Y4M header is taken from the first two frames
+				int wanted = format == FORMAT_Y4M && !header_written && !finishing ? 2 : 1;
+				if (queue_count < wanted) {
+					done = finishing && queue_count == 0;
+					break;
+				}
+				frame = &queue[queue_first];
+				if (queue_count > 1) {
+					next_usec = queue[(queue_first + 1) % QUEUE_SIZE].timestamp_usec;
+				}
+			}
+
+			_write_frame(*frame, next_usec);
+
+			MutexLock lock(queue_mutex);
+			queue_first = (queue_first + 1) % QUEUE_SIZE;
+			queue_count--;
+		}
+	}
+
+	_flush();
+}
+
+void CameraRecorder::_write_frame(const QueuedFrame &p_frame, uint64_t p_next_usec) {
+	if (format == FORMAT_MJPEG) {
+		// a stream of JPEG images, which players take as MJPEG
+		_write(p_frame.data.ptr(), p_frame.data.size());
+		frames_written.increment();
+		return;
+	}
+
+	const CameraFrameScaler::Source &source = p_frame.source;
+	if (!header_written) {
+		_write_y4m_header(source, p_next_usec > p_frame.timestamp_usec ? p_next_usec - p_frame.timestamp_usec : 0);
+	} else if (source.width != header_source.width || source.height != header_source.height || _get_y4m_chroma(source) != _get_y4m_chroma(header_source) || _is_full_range(source) != _is_full_range(header_source)) {
+		// the size of a Y4M stream can't change
+		frames_dropped.increment();
+		return;
+	}
+
+	_make_planar(p_frame);
+	static const char frame_tag[] = "FRAME\n";
+	_write((const uint8_t *)frame_tag, sizeof(frame_tag) - 1);
+	_write(planar.ptr(), planar.size());
+	frames_written.increment();
+}
+
+void CameraRecorder::_write_y4m_header(const CameraFrameScaler::Source &p_source, uint64_t p_frame_usec) {
+	String frame_rate = p_frame_usec > 0 ? vformat("%d:1000", (int64_t)Math::round(1000000000.0 / p_frame_usec)) : vformat("%d:1", DEFAULT_FRAME_RATE);
+	String header = vformat("YUV4MPEG2 W%d H%d F%s Ip A1:1", p_source.width, p_source.height, frame_rate);
+	header += vformat(" C%s XCOLORRANGE=%s\n", _get_y4m_chroma(p_source), _is_full_range(p_source) ? "FULL" : "LIMITED");
+
+	CharString chars = header.ascii();
+	_write((const uint8_t *)chars.get_data(), chars.length());
+	header_source = p_source;
+	header_written = true;
+}
+
+void CameraRecorder::_make_planar(const QueuedFrame &p_frame) {
+	const CameraFrameScaler::Source &source = p_frame.source;
+	const uint8_t *r = p_frame.data.ptr();
+	int pixels = source.width * source.height;
+
+	if (source.layout == CameraFrameScaler::LAYOUT_YCBCR_PLANES) {
+		// the Y plane as it is, the interleaved CbCr plane split in two
+		int chroma_pixels = source.chroma_width * source.chroma_height;
+		planar.resize(pixels + chroma_pixels * 2);
+		uint8_t *w = planar.ptrw();
+		memcpy(w, r, pixels);
+		const uint8_t *cbcr = r + pixels;
+		uint8_t *cb = w + pixels;
+		uint8_t *cr = cb + chroma_pixels;
+		for (int i = 0; i < chroma_pixels; i++) {
+			cb[i] = cbcr[i * 2 + 0];
+			cr[i] = cbcr[i * 2 + 1];
+		}
+		return;
+	}
+
+	planar.resize(pixels * 3);
+	uint8_t *y = planar.ptrw();
+	uint8_t *cb = y + pixels;
+	uint8_t *cr = cb + pixels;
+	if (source.layout == CameraFrameScaler::LAYOUT_YCBCR_PACKED) {
+		for (int i = 0; i < pixels; i++) {
+			y[i] = r[0];
+			cb[i] = r[1];
+			cr[i] = r[2];
+			r += source.pixel_size;
+		}
+		return;
+	}
+
+	// BT.601 full range, as JPEG uses
+	for (int i = 0; i < pixels; i++) {
+		int red = r[0];
+		int green = r[1];
+		int blue = r[2];
+		y[i] = (77 * red + 150 * green + 29 * blue) >> 8;
+		cb[i] = (-43 * red - 85 * green + 128 * blue + 32768) >> 8;
+		cr[i] = (128 * red - 107 * green - 21 * blue + 32768) >> 8;
+		r += source.pixel_size;
+	}
+}
+
+void CameraRecorder::_write(const uint8_t *p_data, int p_size) {
+	if (p_size >= BATCH_SIZE / 2) {
+		// large frames go out as they are, keeping the order
+		_flush();
+		_store(p_data, p_size);
+		return;
+	}
+
+	if (batch_used + p_size > BATCH_SIZE) {
+		_flush();
+	}
+	memcpy(batch.ptrw() + batch_used, p_data, p_size);
+	batch_used += p_size;
+}
+
+void CameraRecorder::_flush() {
+	if (batch_used > 0) {
+		_store(batch.ptr(), batch_used);
+		batch_used = 0;
+	}
+}
+
+void CameraRecorder::_store(const uint8_t *p_data, int p_size) {
+	uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
+	file->store_buffer(p_data, p_size);
+	write_usec.add(OS::get_singleton()->get_ticks_usec() - start_usec);
+	bytes_written.add(p_size);
+}
+
+CameraRecorder::Statistics CameraRecorder::get_statistics() const {
+	Statistics statistics;
+	statistics.frames_written = frames_written.get();
+	statistics.frames_dropped = frames_dropped.get();
+	statistics.bytes_written = bytes_written.get();
+	statistics.queue_peak = queue_peak.get();
+	statistics.write_usec = write_usec.get();
+	return statistics;
+}
+
+CameraRecorder::~CameraRecorder() {
+	finish();
+}
@@ -0,0 +1,132 @@
+/*************************************************************************/
+/*  camera_recorder.h                                                    */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef CAMERA_RECORDER_H
+#define CAMERA_RECORDER_H
+
+#include "core/io/file_access.h"
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/vector.h"
+#include "servers/camera/camera_frame_scaler.h"
+
+// Writes the frames of a camera feed to a file on a thread of its own. The capture side copies
+// each frame into a bounded queue and never waits for the disk: a frame that finds the queue
+// full is dropped and counted. The writer collects small frames into large writes.
+class CameraRecorder {
+public:
+	enum Format {
+		FORMAT_Y4M, // uncompressed YCbCr as captured, RGB frames are converted to YCbCr 4:4:4
+		FORMAT_MJPEG, // the camera's own JPEG frames one after the other, without decoding them
+	};
+
+	struct Statistics {
+		uint64_t frames_written = 0;
+		uint64_t frames_dropped = 0; // the queue was full, or the frame didn't fit the recording
+		uint64_t bytes_written = 0;
+		uint32_t queue_peak = 0; // most frames that waited to be written at once
+		uint64_t write_usec = 0; // time spent writing to the file
+	};
+
+private:
+	enum {
+		QUEUE_SIZE = 8,
+		BATCH_SIZE = 4 * 1024 * 1024, // frames are written in chunks of about this size
+		DEFAULT_FRAME_RATE = 30, // for Y4M recordings of a single frame
+	};
+
+	struct QueuedFrame {
+		Vector<uint8_t> data; // the planes without padding, or an encoded frame
+		CameraFrameScaler::Source source; // what the data holds, the plane pointers aren't used
+		uint64_t timestamp_usec = 0;
+	};
+
+	Format format = FORMAT_Y4M;
+	FileAccess *file = nullptr;
+	Thread thread;
+
+	// the writer owns queue[queue_first] while it writes it, it only leaves the queue afterwards
+	Mutex queue_mutex;
+	Semaphore frames_waiting;
+	QueuedFrame queue[QUEUE_SIZE];
+	int queue_first = 0;
+	int queue_count = 0;
+	bool finishing = false;
+
+	// only touched by the writer
+	Vector<uint8_t> batch;
+	int batch_used = 0;
+	Vector<uint8_t> planar; // a frame laid out for Y4M
+	bool header_written = false;
+	CameraFrameScaler::Source header_source; // the frames of a Y4M recording must all be like the first
+
+	SafeNumeric<uint64_t> frames_written;
+	SafeNumeric<uint64_t> frames_dropped;
+	SafeNumeric<uint64_t> bytes_written;
+	SafeNumeric<uint32_t> queue_peak;
+	SafeNumeric<uint64_t> write_usec;
+
+	QueuedFrame *_reserve_frame();
+	void _queue_frame();
+
+	static const char *_get_y4m_chroma(const CameraFrameScaler::Source &p_source);
+	static bool _is_full_range(const CameraFrameScaler::Source &p_source);
+
+	static void _thread_func(void *p_user);
+	void _write_frames();
+	void _write_frame(const QueuedFrame &p_frame, uint64_t p_next_usec);
+	void _write_y4m_header(const CameraFrameScaler::Source &p_source, uint64_t p_frame_usec);
+	void _make_planar(const QueuedFrame &p_frame);
+	void _write(const uint8_t *p_data, int p_size);
+	void _flush();
+	void _store(const uint8_t *p_data, int p_size);
+
+public:
+	static bool is_y4m_source(const CameraFrameScaler::Source &p_source);
+
+	// Opens p_path and starts the writer.
+	Error start(const String &p_path, Format p_format);
+	// Writes the frames still queued and closes the file.
+	void finish();
+
+	Format get_format() const { return format; }
+
+	// Called on the capture side, the frames are copied.
+	void push_frame(const CameraFrameScaler::Source &p_source, uint64_t p_timestamp_usec);
+	void push_encoded_frame(const uint8_t *p_data, int p_size, uint64_t p_timestamp_usec);
+
+	Statistics get_statistics() const;
+
+	~CameraRecorder();
+};
+
+#endif // CAMERA_RECORDER_H
@@ -29,8 +29,10 @@
 /*************************************************************************/
 
 #include "camera_server.h"
+#include "core/os/thread.h"
 #include "rendering_server.h"
 #include "servers/camera/camera_feed.h"
+#include "servers/camera/camera_frame_set.h"
 
 ////////////////////////////////////////////////////////
 // CameraServer
@@ -41,17 +43,22 @@ void CameraServer::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_feed", "index"), &CameraServer::get_feed);
 	ClassDB::bind_method(D_METHOD("get_feed_count"), &CameraServer::get_feed_count);
 	ClassDB::bind_method(D_METHOD("feeds"), &CameraServer::get_feeds);
+	ClassDB::bind_method(D_METHOD("are_feeds_ready"), &CameraServer::are_feeds_ready);
 
 	ClassDB::bind_method(D_METHOD("add_feed", "feed"), &CameraServer::add_feed);
 	ClassDB::bind_method(D_METHOD("remove_feed", "feed"), &CameraServer::remove_feed);
 
+	ClassDB::bind_method(D_METHOD("create_frame_set", "feeds", "tolerance_ms"), &CameraServer::create_frame_set, DEFVAL(5.0));
+
 	ADD_SIGNAL(MethodInfo("camera_feed_added", PropertyInfo(Variant::INT, "id")));
 	ADD_SIGNAL(MethodInfo("camera_feed_removed", PropertyInfo(Variant::INT, "id")));
+	ADD_SIGNAL(MethodInfo("feeds_ready"));
 
 	BIND_ENUM_CONSTANT(FEED_RGBA_IMAGE);
 	BIND_ENUM_CONSTANT(FEED_YCBCR_IMAGE);
 	BIND_ENUM_CONSTANT(FEED_Y_IMAGE);
 	BIND_ENUM_CONSTANT(FEED_CBCR_IMAGE);
+	BIND_ENUM_CONSTANT(FEED_RESOLVED_IMAGE);
 };
 
 CameraServer *CameraServer::singleton = nullptr;
@@ -61,6 +68,8 @@ CameraServer *CameraServer::get_singleton() {
 };
 
 int CameraServer::get_free_id() {
+	_THREAD_SAFE_METHOD_
+
 	bool id_exists = true;
 	int newid = 0;
 
@@ -73,12 +82,20 @@ int CameraServer::get_free_id() {
 				id_exists = true;
 			};
 		};
+		// feeds that are on their way to the main thread have theirs already
+		for (int i = 0; i < queued_feeds.size() && !id_exists; i++) {
+			if (queued_feeds[i].add && queued_feeds[i].feed->get_id() == newid) {
+				id_exists = true;
+			}
+		}
 	};
 
 	return newid;
 };
 
 int CameraServer::get_feed_index(int p_id) {
+	_THREAD_SAFE_METHOD_
+
 	for (int i = 0; i < feeds.size(); i++) {
 		if (feeds[i]->get_id() == p_id) {
 			return i;
@@ -89,6 +106,8 @@ int CameraServer::get_feed_index(int p_id) {
 };
 
 Ref<CameraFeed> CameraServer::get_feed_by_id(int p_id) {
+	_THREAD_SAFE_METHOD_
+
 	int index = get_feed_index(p_id);
 
 	if (index == -1) {
@@ -102,11 +121,14 @@ void CameraServer::add_feed(const Ref<CameraFeed> &p_feed) {
 	ERR_FAIL_COND(p_feed.is_null());
 
 	// add our feed
+	_THREAD_SAFE_LOCK_
 	feeds.push_back(p_feed);
+	int index = feeds.size() - 1;
+	_THREAD_SAFE_UNLOCK_
 
 // record for debugging
 #ifdef DEBUG_ENABLED
-	print_line("Registered camera " + p_feed->get_name() + " with id " + itos(p_feed->get_id()) + " position " + itos(p_feed->get_position()) + " at index " + itos(feeds.size() - 1));
+	print_line("Registered camera " + p_feed->get_name() + " with id " + itos(p_feed->get_id()) + " position " + itos(p_feed->get_position()) + " at index " + itos(index));
 #endif
 
 	// let whomever is interested know
@@ -114,60 +136,221 @@ void CameraServer::add_feed(const Ref<CameraFeed> &p_feed) {
 };
 
 void CameraServer::remove_feed(const Ref<CameraFeed> &p_feed) {
-	for (int i = 0; i < feeds.size(); i++) {
-		if (feeds[i] == p_feed) {
-			int feed_id = p_feed->get_id();
+	_THREAD_SAFE_LOCK_
+	int index = feeds.find(p_feed);
+	if (index != -1) {
+		// remove it from our array, the caller still holds a reference so it isn't destroyed with the lock held
+		feeds.remove(index);
+	}
+	_THREAD_SAFE_UNLOCK_
+	if (index == -1) {
+		return;
+	}
+
+	int feed_id = p_feed->get_id();
 
 // record for debugging
 #ifdef DEBUG_ENABLED
-			print_line("Removed camera " + p_feed->get_name() + " with id " + itos(feed_id) + " position " + itos(p_feed->get_position()));
+	print_line("Removed camera " + p_feed->get_name() + " with id " + itos(feed_id) + " position " + itos(p_feed->get_position()));
 #endif
 
-			// remove it from our array, if this results in our feed being unreferenced it will be destroyed
-			feeds.remove(i);
-
-			// let whomever is interested know
-			emit_signal(SNAME("camera_feed_removed"), feed_id);
-			return;
-		};
-	};
+	// let whomever is interested know
+	emit_signal(SNAME("camera_feed_removed"), feed_id);
 };
 
+void CameraServer::queue_add_feed(const Ref<CameraFeed> &p_feed) {
+	ERR_FAIL_COND(p_feed.is_null());
+
+	_THREAD_SAFE_METHOD_
+	QueuedFeed queued;
+	queued.feed = p_feed;
+	queued.add = true;
+	queued_feeds.push_back(queued);
+	if (queued_feeds.size() == 1) {
+		callable_mp(this, &CameraServer::_flush_queued_feeds).call_deferred(nullptr, 0);
+	}
+}
+
+void CameraServer::queue_remove_feed(const Ref<CameraFeed> &p_feed) {
+	ERR_FAIL_COND(p_feed.is_null());
+
+	_THREAD_SAFE_METHOD_
+	QueuedFeed queued;
+	queued.feed = p_feed;
+	queued.add = false;
+	queued_feeds.push_back(queued);
+	if (queued_feeds.size() == 1) {
+		callable_mp(this, &CameraServer::_flush_queued_feeds).call_deferred(nullptr, 0);
+	}
+}
+
+void CameraServer::_flush_queued_feeds() {
+	// Held until every change is applied, so get_free_id() sees each feed either queued or added.
+	// The queue is released after the lock, a feed that isn't used anymore is destroyed here.
+	Vector<QueuedFeed> changes;
+	_THREAD_SAFE_LOCK_
+	changes = queued_feeds;
+	queued_feeds.clear();
+	for (int i = 0; i < changes.size(); i++) {
+		if (changes[i].add) {
+			add_feed(changes[i].feed);
+		} else {
+			remove_feed(changes[i].feed);
+		}
+	}
+	_THREAD_SAFE_UNLOCK_
+}
+
+void CameraServer::begin_enumeration() {
+	enumerating.set();
+}
+
+void CameraServer::finish_enumeration() {
+	ERR_FAIL_COND(!enumerating.is_set());
+
+	enumerating.clear();
+	enumeration_done.post();
+	call_deferred(SNAME("emit_signal"), SNAME("feeds_ready"));
+}
+
+void CameraServer::_wait_for_enumeration() {
+	if (enumerating.is_set()) {
+		// pass it on to whoever else is waiting
+		enumeration_done.wait();
+		enumeration_done.post();
+	}
+
+	if (Thread::get_caller_id() == Thread::get_main_id()) {
+		// don't leave the feeds found so far for the next idle frame
+		_flush_queued_feeds();
+	}
+}
+
+bool CameraServer::are_feeds_ready() const {
+	return !enumerating.is_set();
+}
+
 Ref<CameraFeed> CameraServer::get_feed(int p_index) {
+	_wait_for_enumeration();
+
+	_THREAD_SAFE_METHOD_
 	ERR_FAIL_INDEX_V(p_index, feeds.size(), nullptr);
 
 	return feeds[p_index];
 };
 
 int CameraServer::get_feed_count() {
+	_wait_for_enumeration();
+
+	_THREAD_SAFE_METHOD_
 	return feeds.size();
 };
 
 Array CameraServer::get_feeds() {
+	_wait_for_enumeration();
+
+	_THREAD_SAFE_METHOD_
 	Array return_feeds;
-	int cc = get_feed_count();
-	return_feeds.resize(cc);
+	return_feeds.resize(feeds.size());
 
 	for (int i = 0; i < feeds.size(); i++) {
-		return_feeds[i] = get_feed(i);
+		return_feeds[i] = feeds[i];
 	};
 
 	return return_feeds;
 };
 
+Ref<CameraFrameSet> CameraServer::create_frame_set(const Array &p_feeds, double p_tolerance_ms) {
+	ERR_FAIL_COND_V_MSG(p_feeds.size() < 2, Ref<CameraFrameSet>(), "A frame set needs at least two feeds.");
+	ERR_FAIL_COND_V(p_tolerance_ms < 0.0, Ref<CameraFrameSet>());
+
+	Vector<Ref<CameraFeed>> set_feeds;
+	for (int i = 0; i < p_feeds.size(); i++) {
+		Ref<CameraFeed> feed = p_feeds[i];
+		ERR_FAIL_COND_V_MSG(feed.is_null(), Ref<CameraFrameSet>(), "A frame set can only match camera feeds.");
+		ERR_FAIL_COND_V_MSG(set_feeds.has(feed), Ref<CameraFrameSet>(), "A feed can only be in a frame set once.");
+		set_feeds.push_back(feed);
+	}
+
+	Ref<CameraFrameSet> frame_set;
+	frame_set.instantiate();
+	frame_set->setup(set_feeds, p_tolerance_ms);
+	return frame_set;
+}
+
 RID CameraServer::feed_texture(int p_id, CameraServer::FeedImage p_texture) {
+	_THREAD_SAFE_METHOD_
+
 	int index = get_feed_index(p_id);
 	ERR_FAIL_COND_V(index == -1, RID());
 
-	Ref<CameraFeed> feed = get_feed(index);
+	// the renderer doesn't wait for feeds that are still being looked for
+	Ref<CameraFeed> feed = feeds[index];
 
 	return feed->get_texture(p_texture);
 };
 
+void CameraServer::register_frame_source(CameraFeed *p_feed) {
+	MutexLock lock(frame_mutex);
+	frame_sources.push_back(p_feed);
+}
+
+void CameraServer::unregister_frame_source(CameraFeed *p_feed) {
+	// waits for _update_frames() to be done with the feed
+	MutexLock lock(frame_mutex);
+	frame_sources.erase(p_feed);
+}
+
+void CameraServer::_update_frames() {
+	// runs on the rendering server thread before each frame is drawn
+	MutexLock lock(frame_mutex);
+	for (int i = 0; i < frame_sources.size(); i++) {
+		frame_sources[i]->update_frame();
+	}
+}
+
+void CameraServer::_frames_drawn() {
+	MutexLock lock(frame_mutex);
+	for (int i = 0; i < frame_sources.size(); i++) {
+		frame_sources[i]->frame_drawn();
+	}
+}
+
+void CameraServer::get_frame_statistics(double &r_fps, double &r_latency, uint64_t &r_dropped_frames) {
+	r_fps = 0.0;
+	r_latency = 0.0;
+	r_dropped_frames = 0;
+
+	bool first = true;
+	MutexLock lock(frame_mutex);
+	for (int i = 0; i < frame_sources.size(); i++) {
+		if (!frame_sources[i]->is_capturing()) {
+			continue;
+		}
+
+		Dictionary statistics = frame_sources[i]->get_statistics();
+		double fps = statistics["fps"];
+		r_fps = first ? fps : MIN(r_fps, fps);
+		r_latency = MAX(r_latency, (double)statistics["latency_p99_ms"] / 1000.0);
+		r_dropped_frames += (uint64_t)statistics["frames_dropped"] + (uint64_t)statistics["frames_skipped"];
+		first = false;
+	}
+}
+
 CameraServer::CameraServer() {
 	singleton = this;
+
+	if (RenderingServer::get_singleton()) {
+		RenderingServer::get_singleton()->connect(SNAME("frame_pre_draw"), callable_mp(this, &CameraServer::_update_frames));
+		RenderingServer::get_singleton()->connect(SNAME("frame_post_draw"), callable_mp(this, &CameraServer::_frames_drawn));
+	}
 };
 
 CameraServer::~CameraServer() {
+	if (RenderingServer::get_singleton()) {
+		RenderingServer::get_singleton()->disconnect(SNAME("frame_pre_draw"), callable_mp(this, &CameraServer::_update_frames));
+		RenderingServer::get_singleton()->disconnect(SNAME("frame_post_draw"), callable_mp(this, &CameraServer::_frames_drawn));
+	}
+
 	singleton = nullptr;
 };
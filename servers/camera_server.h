@@ -33,8 +33,12 @@
 
 #include "core/object/class_db.h"
 #include "core/object/ref_counted.h"
+#include "core/os/mutex.h"
+#include "core/os/semaphore.h"
 #include "core/os/thread_safe.h"
 #include "core/templates/rid.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/thread_work_pool.h"
 #include "core/variant/variant.h"
 
 /**
@@ -45,6 +49,7 @@
 **/
 
 class CameraFeed;
+class CameraFrameSet;
 
 class CameraServer : public Object {
 	GDCLASS(CameraServer, Object);
@@ -56,7 +61,8 @@ public:
 		FEED_YCBCR_IMAGE = 0,
 		FEED_Y_IMAGE = 0,
 		FEED_CBCR_IMAGE = 1,
-		FEED_IMAGES = 2
+		FEED_RESOLVED_IMAGE = 2, // always RGBA, YCbCr feeds are converted on the GPU once per frame
+		FEED_IMAGES = 3
 	};
 
 	typedef CameraServer *(*CreateFunc)();
@@ -65,8 +71,42 @@ private:
 protected:
 	static CreateFunc create_func;
 
+	// Guarded by _thread_safe_, the render thread looks textures up through feed_texture().
 	Vector<Ref<CameraFeed>> feeds;
 
+	// Servers that look for cameras on a thread of their own queue the feeds they find and lose.
+	// The main thread applies the changes, so the feeds are added, removed, signalled and
+	// destroyed there. Everything queued before finish_enumeration() is there once get_feeds() returns.
+	struct QueuedFeed {
+		Ref<CameraFeed> feed;
+		bool add = true;
+	};
+	Vector<QueuedFeed> queued_feeds;
+	void queue_add_feed(const Ref<CameraFeed> &p_feed);
+	void queue_remove_feed(const Ref<CameraFeed> &p_feed);
+	void _flush_queued_feeds();
+
+	// Servers that look for cameras on a thread of their own call these around the first search,
+	// so starting the engine doesn't wait for it. get_feed(), get_feed_count() and get_feeds()
+	// wait for the search to finish, callers still see every camera that was there at startup.
+	void begin_enumeration();
+	void finish_enumeration();
+	Semaphore enumeration_done;
+	SafeFlag enumerating;
+	void _wait_for_enumeration();
+
+	// Every feed that can receive frames, including ones that aren't added to the server.
+	Mutex frame_mutex;
+	Vector<CameraFeed *> frame_sources;
+
+	void _update_frames();
+	void _frames_drawn();
+
+	// Converts frames for the outputs of feeds, shared by every feed and started when first used.
+	Mutex conversion_mutex;
+	ThreadWorkPool conversion_pool;
+	bool conversion_pool_started = false;
+
 	static CameraServer *singleton;
 
 	static void _bind_methods();
@@ -99,14 +139,40 @@ public:
 	void add_feed(const Ref<CameraFeed> &p_feed);
 	void remove_feed(const Ref<CameraFeed> &p_feed);
 
+	// Whether the cameras present at startup were found, feeds_ready is emitted once they are.
+	bool are_feeds_ready() const;
+
 	// Get our feeds.
 	Ref<CameraFeed> get_feed(int p_index);
 	int get_feed_count();
 	Array get_feeds();
 
+	// Matches the frames of p_feeds captured at most p_tolerance_ms apart, see CameraFrameSet.
+	Ref<CameraFrameSet> create_frame_set(const Array &p_feeds, double p_tolerance_ms = 5.0);
+
 	// Intended for use with custom CameraServer implementation.
 	RID feed_texture(int p_id, FeedImage p_texture);
 
+	// Called by feeds as they are created and destroyed, so frames queued by capture threads get shown.
+	void register_frame_source(CameraFeed *p_feed);
+	void unregister_frame_source(CameraFeed *p_feed);
+
+	// Combined over the active feeds for the performance monitors: the framerate of the slowest
+	// feed, the highest p99 latency in seconds and the number of frames dropped or skipped.
+	void get_frame_statistics(double &r_fps, double &r_latency, uint64_t &r_dropped_frames);
+
+	// Runs p_elements jobs on the conversion threads and returns once they are done.
+	// Capture threads of several feeds may call this, they take turns.
+	template <class C, class M, class U>
+	void do_conversion_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata) {
+		MutexLock lock(conversion_mutex);
+		if (!conversion_pool_started) {
+			conversion_pool.init();
+			conversion_pool_started = true;
+		}
+		conversion_pool.do_work(p_elements, p_instance, p_method, p_userdata);
+	}
+
 	CameraServer();
 	~CameraServer();
 };
@@ -54,6 +54,7 @@
 #include "audio/effects/audio_stream_generator.h"
 #include "audio_server.h"
 #include "camera/camera_feed.h"
+#include "camera/camera_frame_set.h"
 #include "camera_server.h"
 #include "core/extension/native_extension_manager.h"
 #include "display_server.h"
@@ -206,6 +207,7 @@ void register_server_types() {
 	GDREGISTER_CLASS(RDPipelineSpecializationConstant);
 
 	GDREGISTER_CLASS(CameraFeed);
+	GDREGISTER_CLASS(CameraFrameSet);
 
 	GDREGISTER_VIRTUAL_CLASS(PhysicsDirectBodyState2D);
 	GDREGISTER_VIRTUAL_CLASS(PhysicsDirectSpaceState2D);
@@ -258,6 +258,26 @@ void EffectsRD::copy_to_atlas_fb(RID p_source_rd_texture, RID p_dest_framebuffer
 	RD::get_singleton()->draw_list_draw(draw_list, true);
 }
 
+void EffectsRD::copy_camera_feed_to_fb(RID p_source_rd_texture, RID p_dest_framebuffer, RD::DrawListID p_draw_list, const Transform2D &p_uv_transform, float p_multiplier, float p_alpha) {
+	memset(&copy_to_fb.push_constant, 0, sizeof(CopyToFbPushConstant));
+
+	copy_to_fb.push_constant.uv_basis[0] = p_uv_transform.elements[0].x;
+	copy_to_fb.push_constant.uv_basis[1] = p_uv_transform.elements[0].y;
+	copy_to_fb.push_constant.uv_basis[2] = p_uv_transform.elements[1].x;
+	copy_to_fb.push_constant.uv_basis[3] = p_uv_transform.elements[1].y;
+	copy_to_fb.push_constant.uv_origin[0] = p_uv_transform.elements[2].x;
+	copy_to_fb.push_constant.uv_origin[1] = p_uv_transform.elements[2].y;
+	copy_to_fb.push_constant.multiplier = p_multiplier;
+	copy_to_fb.push_constant.alpha = p_alpha;
+
+	RD::DrawListID draw_list = p_draw_list;
+	RD::get_singleton()->draw_list_bind_render_pipeline(draw_list, copy_to_fb.pipelines[COPY_TO_FB_CAMERA_FEED].get_render_pipeline(RD::INVALID_ID, RD::get_singleton()->framebuffer_get_format(p_dest_framebuffer)));
+	RD::get_singleton()->draw_list_bind_uniform_set(draw_list, _get_uniform_set_from_texture(p_source_rd_texture), 0);
+	RD::get_singleton()->draw_list_bind_index_array(draw_list, index_array);
+	RD::get_singleton()->draw_list_set_push_constant(draw_list, &copy_to_fb.push_constant, sizeof(CopyToFbPushConstant));
+	RD::get_singleton()->draw_list_draw(draw_list, true);
+}
+
 void EffectsRD::copy_to_fb_rect(RID p_source_rd_texture, RID p_dest_framebuffer, const Rect2i &p_rect, bool p_flip_y, bool p_force_luminance, bool p_alpha_to_zero, bool p_srgb, RID p_secondary) {
 	memset(&copy_to_fb.push_constant, 0, sizeof(CopyToFbPushConstant));
 
@@ -1887,6 +1907,132 @@ void EffectsRD::sort_buffer(RID p_uniform_set, int p_size) {
 	RD::get_singleton()->compute_list_end();
 }
 
+void EffectsRD::ycbcr_to_rgba_convert(RID p_source_ycbcr, RID p_source_cbcr, RID p_dest_texture, const Size2i &p_size, bool p_full_range) {
+	YCbCrToRGBAMode mode = p_source_cbcr.is_valid() ? YCBCR_TO_RGBA_MODE_SEPARATE_CBCR : YCBCR_TO_RGBA_MODE_INTERLEAVED;
+	RID shader = ycbcr_to_rgba.shader.version_get_shader(ycbcr_to_rgba.shader_version, mode);
+
+	TexturePair tp;
+	tp.texture1 = p_source_ycbcr;
+	tp.texture2 = p_source_cbcr;
+
+	RID source_uniform_set;
+	if (ycbcr_to_compute_uniform_set_cache.has(tp) && RD::get_singleton()->uniform_set_is_valid(ycbcr_to_compute_uniform_set_cache[tp])) {
+		source_uniform_set = ycbcr_to_compute_uniform_set_cache[tp];
+	} else {
+		Vector<RD::Uniform> uniforms;
+		{
+			RD::Uniform u;
+			u.uniform_type = RD::UNIFORM_TYPE_SAMPLER_WITH_TEXTURE;
+			u.binding = 0;
+			u.ids.push_back(default_sampler);
+			u.ids.push_back(p_source_ycbcr);
+			uniforms.push_back(u);
+		}
+		if (mode == YCBCR_TO_RGBA_MODE_SEPARATE_CBCR) {
+			RD::Uniform u;
+			u.uniform_type = RD::UNIFORM_TYPE_SAMPLER_WITH_TEXTURE;
+			u.binding = 1;
+			u.ids.push_back(default_sampler);
+			u.ids.push_back(p_source_cbcr);
+			uniforms.push_back(u);
+		}
+		source_uniform_set = RD::get_singleton()->uniform_set_create(uniforms, shader, 0);
+		ycbcr_to_compute_uniform_set_cache[tp] = source_uniform_set;
+	}
+
+	RID dest_uniform_set;
+	if (rgba_image_to_compute_uniform_set_cache.has(p_dest_texture) && RD::get_singleton()->uniform_set_is_valid(rgba_image_to_compute_uniform_set_cache[p_dest_texture])) {
+		dest_uniform_set = rgba_image_to_compute_uniform_set_cache[p_dest_texture];
+	} else {
+		Vector<RD::Uniform> uniforms;
+		RD::Uniform u;
+		u.uniform_type = RD::UNIFORM_TYPE_IMAGE;
+		u.binding = 0;
+		u.ids.push_back(p_dest_texture);
+		uniforms.push_back(u);
+		dest_uniform_set = RD::get_singleton()->uniform_set_create(uniforms, shader, 1);
+		rgba_image_to_compute_uniform_set_cache[p_dest_texture] = dest_uniform_set;
+	}
+
+	ycbcr_to_rgba.push_constant.size[0] = p_size.x;
+	ycbcr_to_rgba.push_constant.size[1] = p_size.y;
+	if (p_full_range) {
+		ycbcr_to_rgba.push_constant.y_offset = 0.0;
+		ycbcr_to_rgba.push_constant.y_scale = 1.0;
+		ycbcr_to_rgba.push_constant.cbcr_scale = 1.0;
+	} else {
+		// Y is stored in 16-235, CbCr in 16-240
+		ycbcr_to_rgba.push_constant.y_offset = 16.0 / 255.0;
+		ycbcr_to_rgba.push_constant.y_scale = 255.0 / 219.0;
+		ycbcr_to_rgba.push_constant.cbcr_scale = 255.0 / 224.0;
+	}
+
+	RD::ComputeListID compute_list = RD::get_singleton()->compute_list_begin();
+	RD::get_singleton()->compute_list_bind_compute_pipeline(compute_list, ycbcr_to_rgba.pipelines[mode]);
+	RD::get_singleton()->compute_list_bind_uniform_set(compute_list, source_uniform_set, 0);
+	RD::get_singleton()->compute_list_bind_uniform_set(compute_list, dest_uniform_set, 1);
+	RD::get_singleton()->compute_list_set_push_constant(compute_list, &ycbcr_to_rgba.push_constant, sizeof(YCbCrToRGBAPushConstant));
+	RD::get_singleton()->compute_list_dispatch_threads(compute_list, p_size.x, p_size.y, 1);
+	RD::get_singleton()->compute_list_end();
+}
+
+void EffectsRD::luma_pyramid_build(RID p_source, const Size2i &p_source_size, bool p_source_is_luma, const RID *p_levels, const Size2i *p_level_sizes, int p_level_count) {
+	RID shader = luma_pyramid.shader.version_get_shader(luma_pyramid.shader_version, LUMA_PYRAMID_MODE_FROM_LUMA);
+
+	RD::ComputeListID compute_list = RD::get_singleton()->compute_list_begin();
+	for (int i = 0; i < p_level_count; i++) {
+		RID source = i == 0 ? p_source : p_levels[i - 1];
+		Size2i source_size = i == 0 ? p_source_size : p_level_sizes[i - 1];
+		LumaPyramidMode mode = (i == 0 && !p_source_is_luma) ? LUMA_PYRAMID_MODE_FROM_RGBA : LUMA_PYRAMID_MODE_FROM_LUMA;
+
+		// both modes have the same uniforms
+		RID source_uniform_set;
+		if (luma_source_uniform_set_cache.has(source) && RD::get_singleton()->uniform_set_is_valid(luma_source_uniform_set_cache[source])) {
+			source_uniform_set = luma_source_uniform_set_cache[source];
+		} else {
+			Vector<RD::Uniform> uniforms;
+			RD::Uniform u;
+			u.uniform_type = RD::UNIFORM_TYPE_SAMPLER_WITH_TEXTURE;
+			u.binding = 0;
+			u.ids.push_back(default_sampler);
+			u.ids.push_back(source);
+			uniforms.push_back(u);
+			source_uniform_set = RD::get_singleton()->uniform_set_create(uniforms, shader, 0);
+			luma_source_uniform_set_cache[source] = source_uniform_set;
+		}
+
+		RID dest_uniform_set;
+		if (luma_image_uniform_set_cache.has(p_levels[i]) && RD::get_singleton()->uniform_set_is_valid(luma_image_uniform_set_cache[p_levels[i]])) {
+			dest_uniform_set = luma_image_uniform_set_cache[p_levels[i]];
+		} else {
+			Vector<RD::Uniform> uniforms;
+			RD::Uniform u;
+			u.uniform_type = RD::UNIFORM_TYPE_IMAGE;
+			u.binding = 0;
+			u.ids.push_back(p_levels[i]);
+			uniforms.push_back(u);
+			dest_uniform_set = RD::get_singleton()->uniform_set_create(uniforms, shader, 1);
+			luma_image_uniform_set_cache[p_levels[i]] = dest_uniform_set;
+		}
+
+		luma_pyramid.push_constant.source_size[0] = source_size.x;
+		luma_pyramid.push_constant.source_size[1] = source_size.y;
+		luma_pyramid.push_constant.dest_size[0] = p_level_sizes[i].x;
+		luma_pyramid.push_constant.dest_size[1] = p_level_sizes[i].y;
+
+		if (i > 0) {
+			// the level before has to be written first
+			RD::get_singleton()->compute_list_add_barrier(compute_list);
+		}
+		RD::get_singleton()->compute_list_bind_compute_pipeline(compute_list, luma_pyramid.pipelines[mode]);
+		RD::get_singleton()->compute_list_bind_uniform_set(compute_list, source_uniform_set, 0);
+		RD::get_singleton()->compute_list_bind_uniform_set(compute_list, dest_uniform_set, 1);
+		RD::get_singleton()->compute_list_set_push_constant(compute_list, &luma_pyramid.push_constant, sizeof(LumaPyramidPushConstant));
+		RD::get_singleton()->compute_list_dispatch_threads(compute_list, p_level_sizes[i].x, p_level_sizes[i].y, 1);
+	}
+	RD::get_singleton()->compute_list_end();
+}
+
 EffectsRD::EffectsRD(bool p_prefer_raster_effects) {
 	prefer_raster_effects = p_prefer_raster_effects;
 
@@ -1955,6 +2101,7 @@ EffectsRD::EffectsRD(bool p_prefer_raster_effects) {
 		copy_modes.push_back("\n");
 		copy_modes.push_back("\n#define MODE_PANORAMA_TO_DP\n");
 		copy_modes.push_back("\n#define MODE_TWO_SOURCES\n");
+		copy_modes.push_back("\n#define MODE_CAMERA_FEED\n");
 
 		copy_to_fb.shader.initialize(copy_modes);
 
@@ -2476,6 +2623,35 @@ EffectsRD::EffectsRD(bool p_prefer_raster_effects) {
 		}
 	}
 
+	{
+		// also used by the mobile renderer, camera feeds have no raster fallback
+		Vector<String> ycbcr_to_rgba_modes;
+		ycbcr_to_rgba_modes.push_back("");
+		ycbcr_to_rgba_modes.push_back("\n#define MODE_SEPARATE_CBCR\n");
+
+		ycbcr_to_rgba.shader.initialize(ycbcr_to_rgba_modes);
+		memset(&ycbcr_to_rgba.push_constant, 0, sizeof(YCbCrToRGBAPushConstant));
+		ycbcr_to_rgba.shader_version = ycbcr_to_rgba.shader.version_create();
+
+		for (int i = 0; i < YCBCR_TO_RGBA_MODE_MAX; i++) {
+			ycbcr_to_rgba.pipelines[i] = RD::get_singleton()->compute_pipeline_create(ycbcr_to_rgba.shader.version_get_shader(ycbcr_to_rgba.shader_version, i));
+		}
+	}
+
+	{
+		Vector<String> luma_pyramid_modes;
+		luma_pyramid_modes.push_back("\n#define MODE_FROM_RGBA\n");
+		luma_pyramid_modes.push_back("");
+
+		luma_pyramid.shader.initialize(luma_pyramid_modes);
+		memset(&luma_pyramid.push_constant, 0, sizeof(LumaPyramidPushConstant));
+		luma_pyramid.shader_version = luma_pyramid.shader.version_create();
+
+		for (int i = 0; i < LUMA_PYRAMID_MODE_MAX; i++) {
+			luma_pyramid.pipelines[i] = RD::get_singleton()->compute_pipeline_create(luma_pyramid.shader.version_get_shader(luma_pyramid.shader_version, i));
+		}
+	}
+
 	RD::SamplerState sampler;
 	sampler.mag_filter = RD::SAMPLER_FILTER_LINEAR;
 	sampler.min_filter = RD::SAMPLER_FILTER_LINEAR;
@@ -2560,4 +2736,6 @@ EffectsRD::~EffectsRD() {
 	cube_to_dp.shader.version_free(cube_to_dp.shader_version);
 	sort.shader.version_free(sort.shader_version);
 	tonemap.shader.version_free(tonemap.shader_version);
+	ycbcr_to_rgba.shader.version_free(ycbcr_to_rgba.shader_version);
+	luma_pyramid.shader.version_free(luma_pyramid.shader_version);
 }
@@ -45,6 +45,7 @@
 #include "servers/rendering/renderer_rd/shaders/cubemap_filter_raster.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/cubemap_roughness.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/cubemap_roughness_raster.glsl.gen.h"
+#include "servers/rendering/renderer_rd/shaders/luma_pyramid.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/luminance_reduce.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/luminance_reduce_raster.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/resolve.glsl.gen.h"
@@ -61,6 +62,7 @@
 #include "servers/rendering/renderer_rd/shaders/ssao_interleave.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/subsurface_scattering.glsl.gen.h"
 #include "servers/rendering/renderer_rd/shaders/tonemap.glsl.gen.h"
+#include "servers/rendering/renderer_rd/shaders/ycbcr_to_rgba.glsl.gen.h"
 #include "servers/rendering/renderer_scene_render.h"
 
 #include "servers/rendering_server.h"
@@ -176,6 +178,7 @@ private:
 		COPY_TO_FB_COPY,
 		COPY_TO_FB_COPY_PANORAMA_TO_DP,
 		COPY_TO_FB_COPY2,
+		COPY_TO_FB_CAMERA_FEED,
 		COPY_TO_FB_MAX,
 
 	};
@@ -190,6 +193,11 @@ private:
 		uint32_t alpha_to_zero;
 		uint32_t srgb;
 		uint32_t pad;
+
+		float uv_basis[4];
+		float uv_origin[2];
+		float multiplier;
+		float alpha;
 	};
 
 	struct CopyToFb {
@@ -704,6 +712,45 @@ private:
 		RID pipelines[SORT_MODE_MAX];
 	} sort;
 
+	enum YCbCrToRGBAMode {
+		YCBCR_TO_RGBA_MODE_INTERLEAVED,
+		YCBCR_TO_RGBA_MODE_SEPARATE_CBCR,
+		YCBCR_TO_RGBA_MODE_MAX
+	};
+
+	struct YCbCrToRGBAPushConstant {
+		int32_t size[2];
+		float y_offset;
+		float y_scale;
+		float cbcr_scale;
+		uint32_t pad[3];
+	};
+
+	struct YCbCrToRGBA {
+		YCbCrToRGBAPushConstant push_constant;
+		YcbcrToRgbaShaderRD shader;
+		RID shader_version;
+		RID pipelines[YCBCR_TO_RGBA_MODE_MAX];
+	} ycbcr_to_rgba;
+
+	enum LumaPyramidMode {
+		LUMA_PYRAMID_MODE_FROM_RGBA,
+		LUMA_PYRAMID_MODE_FROM_LUMA,
+		LUMA_PYRAMID_MODE_MAX
+	};
+
+	struct LumaPyramidPushConstant {
+		int32_t source_size[2];
+		int32_t dest_size[2];
+	};
+
+	struct LumaPyramid {
+		LumaPyramidPushConstant push_constant;
+		LumaPyramidShaderRD shader;
+		RID shader_version;
+		RID pipelines[LUMA_PYRAMID_MODE_MAX];
+	} luma_pyramid;
+
 	RID default_sampler;
 	RID default_mipmap_sampler;
 	RID index_buffer;
@@ -742,6 +789,11 @@ private:
 	Map<TexturePair, RID> texture_pair_to_compute_uniform_set_cache;
 	Map<TexturePair, RID> image_pair_to_compute_uniform_set_cache;
 	Map<TextureSamplerPair, RID> texture_sampler_to_compute_uniform_set_cache;
+	// camera feeds cycle through a handful of textures, so these stay small
+	Map<TexturePair, RID> ycbcr_to_compute_uniform_set_cache;
+	Map<RID, RID> rgba_image_to_compute_uniform_set_cache;
+	Map<RID, RID> luma_source_uniform_set_cache;
+	Map<RID, RID> luma_image_uniform_set_cache;
 
 	RID _get_uniform_set_from_image(RID p_texture);
 	RID _get_uniform_set_for_input(RID p_texture);
@@ -760,6 +812,7 @@ public:
 	void copy_depth_to_rect(RID p_source_rd_texture, RID p_dest_framebuffer, const Rect2i &p_rect, bool p_flip_y = false);
 	void copy_depth_to_rect_and_linearize(RID p_source_rd_texture, RID p_dest_texture, const Rect2i &p_rect, bool p_flip_y, float p_z_near, float p_z_far);
 	void copy_to_atlas_fb(RID p_source_rd_texture, RID p_dest_framebuffer, const Rect2 &p_uv_rect, RD::DrawListID p_draw_list, bool p_flip_y = false, bool p_panorama = false);
+	void copy_camera_feed_to_fb(RID p_source_rd_texture, RID p_dest_framebuffer, RD::DrawListID p_draw_list, const Transform2D &p_uv_transform, float p_multiplier, float p_alpha = 1.0);
 	void gaussian_blur(RID p_source_rd_texture, RID p_texture, RID p_back_texture, const Rect2i &p_region, bool p_8bit_dst = false);
 	void set_color(RID p_dest_texture, const Color &p_color, const Rect2i &p_region, bool p_8bit_dst = false);
 	void gaussian_glow(RID p_source_rd_texture, RID p_back_texture, const Size2i &p_size, float p_strength = 1.0, bool p_high_quality = false, bool p_first_pass = false, float p_luminance_cap = 16.0, float p_exposure = 1.0, float p_bloom = 0.0, float p_hdr_bleed_threshold = 1.0, float p_hdr_bleed_scale = 1.0, RID p_auto_exposure = RID(), float p_auto_exposure_grey = 1.0);
@@ -876,6 +929,10 @@ public:
 
 	void sort_buffer(RID p_uniform_set, int p_size);
 
+	void ycbcr_to_rgba_convert(RID p_source_ycbcr, RID p_source_cbcr, RID p_dest_texture, const Size2i &p_size, bool p_full_range);
+	// Each level is half the size of the one before, the first one half the size of the source.
+	void luma_pyramid_build(RID p_source, const Size2i &p_source_size, bool p_source_is_luma, const RID *p_levels, const Size2i *p_level_sizes, int p_level_count);
+
 	EffectsRD(bool p_prefer_raster_effects);
 	~EffectsRD();
 };
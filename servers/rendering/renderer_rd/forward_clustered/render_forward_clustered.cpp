@@ -1324,6 +1324,10 @@ void RenderForwardClustered::_render_scene(RenderDataRD *p_render_data, const Co
 	Color clear_color;
 	bool keep_color = false;
 
+	RID camera_feed_texture;
+	Transform2D camera_feed_transform;
+	float camera_feed_energy = 1.0;
+
 	if (get_debug_draw_mode() == RS::VIEWPORT_DEBUG_DRAW_OVERDRAW) {
 		clear_color = Color(0, 0, 0, 1); //in overdraw mode, BG should always be black
 	} else if (is_environment(p_render_data->environment)) {
@@ -1360,6 +1364,18 @@ void RenderForwardClustered::_render_scene(RenderDataRD *p_render_data, const Co
 				keep_color = true;
 			} break;
 			case RS::ENV_BG_CAMERA_FEED: {
+				clear_color = Color(0, 0, 0, 1);
+				if (p_render_data->reflection_probe.is_valid()) {
+					break; // camera feeds are screen space, don't bake them into probes
+				}
+				RID feed_texture = environment_get_camera_feed_texture(p_render_data->environment);
+				if (feed_texture.is_valid()) {
+					// the sRGB view linearizes the feed while sampling
+					camera_feed_texture = storage->texture_get_rd_texture(feed_texture, true);
+					camera_feed_transform = environment_get_camera_feed_transform(p_render_data->environment);
+					camera_feed_energy = bg_energy;
+					keep_color = camera_feed_texture.is_valid();
+				}
 			} break;
 			default: {
 			}
@@ -1446,6 +1462,26 @@ void RenderForwardClustered::_render_scene(RenderDataRD *p_render_data, const Co
 
 	_pre_opaque_render(p_render_data, using_ssao, using_sdfgi || using_voxelgi, render_buffer ? render_buffer->normal_roughness_buffer : RID(), render_buffer ? render_buffer->voxelgi_buffer : RID());
 
+	if (camera_feed_texture.is_valid()) {
+		RENDER_TIMESTAMP("Render Camera Feed");
+		RD::get_singleton()->draw_command_begin_label("Render Camera Feed");
+
+		// fill the background, the opaque pass then keeps it and the depth from the pre-pass
+		RD::DrawListID draw_list = RD::get_singleton()->draw_list_begin(opaque_framebuffer, RD::INITIAL_ACTION_DROP, RD::FINAL_ACTION_READ, depth_pre_pass ? (continue_depth ? RD::INITIAL_ACTION_CONTINUE : RD::INITIAL_ACTION_KEEP) : RD::INITIAL_ACTION_DROP, RD::FINAL_ACTION_CONTINUE);
+		storage->get_effects()->copy_camera_feed_to_fb(camera_feed_texture, opaque_framebuffer, draw_list, camera_feed_transform, camera_feed_energy, using_separate_specular ? 0.0 : 1.0); //subsurf scatter must be 0
+		RD::get_singleton()->draw_list_end();
+
+		if (using_separate_specular) {
+			Vector<Color> sc;
+			sc.push_back(Color(0, 0, 0, 0));
+			RD::get_singleton()->draw_list_begin(render_buffer->specular_only_fb, RD::INITIAL_ACTION_CLEAR, RD::FINAL_ACTION_READ, RD::INITIAL_ACTION_DROP, RD::FINAL_ACTION_DISCARD, sc);
+			RD::get_singleton()->draw_list_end();
+		}
+
+		RD::get_singleton()->draw_command_end_label();
+		continue_depth = depth_pre_pass;
+	}
+
 	RD::get_singleton()->draw_command_begin_label("Render Opaque Pass");
 
 	scene_state.ubo.directional_light_count = p_render_data->directional_light_count;
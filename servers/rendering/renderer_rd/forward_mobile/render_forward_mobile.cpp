@@ -577,6 +577,10 @@ void RenderForwardMobile::_render_scene(RenderDataRD *p_render_data, const Color
 	Color clear_color = p_default_bg_color;
 	bool keep_color = false;
 
+	RID camera_feed_texture;
+	Transform2D camera_feed_transform;
+	float camera_feed_energy = 1.0;
+
 	if (get_debug_draw_mode() == RS::VIEWPORT_DEBUG_DRAW_OVERDRAW) {
 		clear_color = Color(0, 0, 0, 1); //in overdraw mode, BG should always be black
 	} else if (is_environment(p_render_data->environment)) {
@@ -617,6 +621,17 @@ void RenderForwardMobile::_render_scene(RenderDataRD *p_render_data, const Color
 				keep_color = true;
 			} break;
 			case RS::ENV_BG_CAMERA_FEED: {
+				clear_color = Color(0, 0, 0, 1);
+				if (p_render_data->reflection_probe.is_valid() || p_render_data->view_count != 1) {
+					break; // the feed is drawn in screen space, so only for single view rendering
+				}
+				RID feed_texture = environment_get_camera_feed_texture(p_render_data->environment);
+				if (feed_texture.is_valid()) {
+					// the sRGB view linearizes the feed while sampling
+					camera_feed_texture = storage->texture_get_rd_texture(feed_texture, true);
+					camera_feed_transform = environment_get_camera_feed_transform(p_render_data->environment);
+					camera_feed_energy = bg_energy / _render_buffers_get_luminance_multiplier();
+				}
 			} break;
 			default: {
 			}
@@ -740,6 +755,10 @@ void RenderForwardMobile::_render_scene(RenderDataRD *p_render_data, const Color
 			} else {
 				//single threaded
 				RD::DrawListID draw_list = RD::get_singleton()->draw_list_begin(framebuffer, keep_color ? RD::INITIAL_ACTION_KEEP : RD::INITIAL_ACTION_CLEAR, can_continue_color ? RD::FINAL_ACTION_CONTINUE : RD::FINAL_ACTION_READ, RD::INITIAL_ACTION_CLEAR, can_continue_depth ? RD::FINAL_ACTION_CONTINUE : RD::FINAL_ACTION_READ, c, 1.0, 0);
+				if (camera_feed_texture.is_valid()) {
+					// draw the feed inside the opaque subpass so it stays in tile memory
+					storage->get_effects()->copy_camera_feed_to_fb(camera_feed_texture, framebuffer, draw_list, camera_feed_transform, camera_feed_energy);
+				}
 				_render_list(draw_list, fb_format, &render_list_params, 0, render_list_params.element_count);
 			}
 		}
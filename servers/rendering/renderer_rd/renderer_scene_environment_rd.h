@@ -47,6 +47,8 @@ public:
 	Color bg_color;
 	float bg_energy = 1.0;
 	int canvas_max_layer = 0;
+	RID camera_feed_texture;
+	Transform2D camera_feed_transform;
 	RS::EnvironmentAmbientSource ambient_source = RS::ENV_AMBIENT_SOURCE_BG;
 	Color ambient_light;
 	float ambient_light_energy = 1.0;
@@ -205,6 +205,13 @@ void RendererSceneRenderRD::environment_set_canvas_max_layer(RID p_env, int p_ma
 	env->canvas_max_layer = p_max_layer;
 }
 
+void RendererSceneRenderRD::environment_set_camera_feed(RID p_env, RID p_texture, const Transform2D &p_transform) {
+	RendererSceneEnvironmentRD *env = environment_owner.get_or_null(p_env);
+	ERR_FAIL_COND(!env);
+	env->camera_feed_texture = p_texture;
+	env->camera_feed_transform = p_transform;
+}
+
 void RendererSceneRenderRD::environment_set_ambient_light(RID p_env, const Color &p_color, RS::EnvironmentAmbientSource p_ambient, float p_energy, float p_sky_contribution, RS::EnvironmentReflectionSource p_reflection_source) {
 	RendererSceneEnvironmentRD *env = environment_owner.get_or_null(p_env);
 	ERR_FAIL_COND(!env);
@@ -253,6 +260,18 @@ int RendererSceneRenderRD::environment_get_canvas_max_layer(RID p_env) const {
 	return env->canvas_max_layer;
 }
 
+RID RendererSceneRenderRD::environment_get_camera_feed_texture(RID p_env) const {
+	RendererSceneEnvironmentRD *env = environment_owner.get_or_null(p_env);
+	ERR_FAIL_COND_V(!env, RID());
+	return env->camera_feed_texture;
+}
+
+Transform2D RendererSceneRenderRD::environment_get_camera_feed_transform(RID p_env) const {
+	RendererSceneEnvironmentRD *env = environment_owner.get_or_null(p_env);
+	ERR_FAIL_COND_V(!env, Transform2D());
+	return env->camera_feed_transform;
+}
+
 Color RendererSceneRenderRD::environment_get_ambient_light_color(RID p_env) const {
 	RendererSceneEnvironmentRD *env = environment_owner.get_or_null(p_env);
 	ERR_FAIL_COND_V(!env, Color());
@@ -1000,6 +1000,7 @@ public:
 	virtual void environment_set_bg_color(RID p_env, const Color &p_color) override;
 	virtual void environment_set_bg_energy(RID p_env, float p_energy) override;
 	virtual void environment_set_canvas_max_layer(RID p_env, int p_max_layer) override;
+	virtual void environment_set_camera_feed(RID p_env, RID p_texture, const Transform2D &p_transform) override;
 	virtual void environment_set_ambient_light(RID p_env, const Color &p_color, RS::EnvironmentAmbientSource p_ambient = RS::ENV_AMBIENT_SOURCE_BG, float p_energy = 1.0, float p_sky_contribution = 0.0, RS::EnvironmentReflectionSource p_reflection_source = RS::ENV_REFLECTION_SOURCE_BG) override;
 
 	virtual RS::EnvironmentBG environment_get_background(RID p_env) const override;
@@ -1009,6 +1010,8 @@ public:
 	Color environment_get_bg_color(RID p_env) const;
 	float environment_get_bg_energy(RID p_env) const;
 	virtual int environment_get_canvas_max_layer(RID p_env) const override;
+	RID environment_get_camera_feed_texture(RID p_env) const;
+	Transform2D environment_get_camera_feed_transform(RID p_env) const;
 	Color environment_get_ambient_light_color(RID p_env) const;
 	RS::EnvironmentAmbientSource environment_get_ambient_source(RID p_env) const;
 	float environment_get_ambient_light_energy(RID p_env) const;
@@ -888,6 +888,74 @@ void RendererStorageRD::texture_2d_update(RID p_texture, const Ref<Image> &p_ima
 	_texture_2d_update(p_texture, p_image, p_layer, false);
 }
 
+void RendererStorageRD::_expand_rgb8_row(const uint8_t *p_src, uint8_t *p_dst, uint32_t p_pixels) {
+	for (uint32_t i = 0; i < p_pixels; i++) {
+		p_dst[0] = p_src[0];
+		p_dst[1] = p_src[1];
+		p_dst[2] = p_src[2];
+		p_dst[3] = 255;
+		p_src += 3;
+		p_dst += 4;
+	}
+}
+
+void RendererStorageRD::_texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, const Rect2i &p_region) {
+	ERR_FAIL_NULL(p_data);
+
+	Texture *tex = texture_owner.get_or_null(p_texture);
+	ERR_FAIL_COND(!tex);
+	ERR_FAIL_COND(tex->is_render_target);
+	ERR_FAIL_COND(tex->type != Texture::TYPE_2D);
+	ERR_FAIL_COND(tex->mipmaps != 1);
+	ERR_FAIL_COND(p_format != tex->format);
+
+	int row_size = Image::get_image_data_size(tex->width, 1, p_format, false);
+	ERR_FAIL_COND(p_row_pitch < row_size);
+
+#ifdef TOOLS_ENABLED
+	tex->image_cache_2d.unref();
+#endif
+
+	if (tex->validated_format == tex->format) {
+		// No conversion needed, the rows go straight into the staging buffer.
+		uint32_t data_size = p_row_pitch * (tex->height - 1) + row_size;
+		RD::get_singleton()->texture_update_raw(tex->rd_texture, 0, p_data, data_size, p_row_pitch, RD::BARRIER_MASK_ALL, p_region);
+	} else if (p_format == Image::FORMAT_RGB8 && tex->validated_format == Image::FORMAT_RGBA8) {
+		// Expanded while the rows are copied into the staging buffer.
+		uint32_t data_size = p_row_pitch * (tex->height - 1) + row_size;
+		RD::get_singleton()->texture_update_raw(tex->rd_texture, 0, p_data, data_size, p_row_pitch, RD::BARRIER_MASK_ALL, p_region, &_expand_rgb8_row, 3);
+	} else {
+		Vector<uint8_t> data;
+		data.resize(row_size * tex->height);
+		uint8_t *w = data.ptrw();
+		for (int y = 0; y < tex->height; y++) {
+			memcpy(w + y * row_size, p_data + y * p_row_pitch, row_size);
+		}
+		Ref<Image> image;
+		image.instantiate();
+		image->create(tex->width, tex->height, false, p_format, data);
+		_texture_2d_update(p_texture, image, 0, false);
+	}
+}
+
+void RendererStorageRD::texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	_texture_2d_update_raw(p_texture, p_data, p_row_pitch, p_format);
+
+	// the data has been copied (or the update failed), so the owner can have it back
+	if (p_release) {
+		p_release(p_userdata);
+	}
+}
+
+void RendererStorageRD::texture_2d_update_raw_region(RID p_texture, const Rect2i &p_region, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) {
+	// formats converted through an image are updated whole
+	_texture_2d_update_raw(p_texture, p_data, p_row_pitch, p_format, p_region);
+
+	if (p_release) {
+		p_release(p_userdata);
+	}
+}
+
 void RendererStorageRD::texture_3d_update(RID p_texture, const Vector<Ref<Image>> &p_data) {
 	Texture *tex = texture_owner.get_or_null(p_texture);
 	ERR_FAIL_COND(!tex);
@@ -964,6 +1032,308 @@ void RendererStorageRD::texture_proxy_update(RID p_texture, RID p_proxy_to) {
 	}
 }
 
+RID RendererStorageRD::texture_2d_dmabuf_create(int p_fd, uint64_t p_offset, int p_width, int p_height, int p_row_pitch, Image::Format p_format) {
+	ERR_FAIL_COND_V(p_width <= 0 || p_height <= 0, RID());
+
+	// only formats the GPU can sample as they are, there is no way to convert in place
+	Ref<Image> probe;
+	probe.instantiate();
+	probe->create(1, 1, false, p_format);
+	TextureToRDFormat ret_format;
+	Ref<Image> validated = _validate_texture_format(probe, ret_format);
+	if (validated->get_format() != p_format) {
+		return RID();
+	}
+
+	Texture texture;
+
+	texture.type = Texture::TYPE_2D;
+	texture.width = p_width;
+	texture.height = p_height;
+	texture.layers = 1;
+	texture.mipmaps = 1;
+	texture.depth = 1;
+	texture.format = p_format;
+	texture.validated_format = p_format;
+
+	texture.rd_type = RD::TEXTURE_TYPE_2D;
+	texture.rd_format = ret_format.format;
+	texture.rd_format_srgb = RD::DATA_FORMAT_MAX;
+
+	RD::TextureFormat rd_format;
+	rd_format.format = texture.rd_format;
+	rd_format.width = p_width;
+	rd_format.height = p_height;
+	rd_format.texture_type = RD::TEXTURE_TYPE_2D;
+	rd_format.usage_bits = RD::TEXTURE_USAGE_SAMPLING_BIT;
+
+	RD::TextureView rd_view;
+	rd_view.swizzle_r = ret_format.swizzle_r;
+	rd_view.swizzle_g = ret_format.swizzle_g;
+	rd_view.swizzle_b = ret_format.swizzle_b;
+	rd_view.swizzle_a = ret_format.swizzle_a;
+
+	texture.rd_texture = RD::get_singleton()->texture_create_from_dmabuf(rd_format, rd_view, p_fd, p_offset, p_row_pitch);
+	if (texture.rd_texture.is_null()) {
+		return RID();
+	}
+
+	texture.width_2d = texture.width;
+	texture.height_2d = texture.height;
+	texture.is_render_target = false;
+	texture.rd_view = rd_view;
+	texture.is_proxy = false;
+
+	return texture_owner.make_rid(texture);
+}
+
+void RendererStorageRD::texture_2d_ycbcr_resolve(RID p_texture, RID p_ycbcr, RID p_cbcr, bool p_full_range) {
+	Texture *tex = texture_owner.get_or_null(p_texture);
+	ERR_FAIL_COND(!tex);
+	ERR_FAIL_COND(tex->is_proxy);
+	ERR_FAIL_COND(tex->is_render_target);
+	// Read through proxies, their RD textures are recreated whenever they are pointed elsewhere.
+	Texture *ycbcr = texture_owner.get_or_null(p_ycbcr);
+	ERR_FAIL_COND(!ycbcr);
+	if (ycbcr->is_proxy) {
+		ycbcr = texture_owner.get_or_null(ycbcr->proxy_to);
+		ERR_FAIL_COND(!ycbcr);
+	}
+	ERR_FAIL_COND(ycbcr->type != Texture::TYPE_2D);
+	Texture *cbcr = nullptr;
+	if (p_cbcr.is_valid()) {
+		cbcr = texture_owner.get_or_null(p_cbcr);
+		ERR_FAIL_COND(!cbcr);
+		if (cbcr->is_proxy) {
+			cbcr = texture_owner.get_or_null(cbcr->proxy_to);
+			ERR_FAIL_COND(!cbcr);
+		}
+		ERR_FAIL_COND(cbcr->type != Texture::TYPE_2D);
+	}
+
+	if (!tex->is_ycbcr_resolve_target || tex->width != ycbcr->width || tex->height != ycbcr->height) {
+		// Regular textures can't be written by compute shaders, so this one gets replaced by one that can.
+		Texture texture;
+
+		texture.type = Texture::TYPE_2D;
+		texture.width = ycbcr->width;
+		texture.height = ycbcr->height;
+		texture.layers = 1;
+		texture.mipmaps = 1;
+		texture.depth = 1;
+		texture.format = Image::FORMAT_RGBA8;
+		texture.validated_format = Image::FORMAT_RGBA8;
+
+		texture.rd_type = RD::TEXTURE_TYPE_2D;
+		texture.rd_format = RD::DATA_FORMAT_R8G8B8A8_UNORM;
+		texture.rd_format_srgb = RD::DATA_FORMAT_R8G8B8A8_SRGB;
+
+		RD::TextureFormat rd_format;
+		rd_format.format = texture.rd_format;
+		rd_format.width = texture.width;
+		rd_format.height = texture.height;
+		rd_format.texture_type = RD::TEXTURE_TYPE_2D;
+		rd_format.usage_bits = RD::TEXTURE_USAGE_SAMPLING_BIT | RD::TEXTURE_USAGE_STORAGE_BIT | RD::TEXTURE_USAGE_CAN_COPY_FROM_BIT;
+		rd_format.shareable_formats.push_back(texture.rd_format);
+		rd_format.shareable_formats.push_back(texture.rd_format_srgb);
+
+		RD::TextureView rd_view;
+		texture.rd_texture = RD::get_singleton()->texture_create(rd_format, rd_view);
+		ERR_FAIL_COND(texture.rd_texture.is_null());
+
+		rd_view.format_override = texture.rd_format_srgb;
+		texture.rd_texture_srgb = RD::get_singleton()->texture_create_shared(rd_view, texture.rd_texture);
+		if (texture.rd_texture_srgb.is_null()) {
+			RD::get_singleton()->free(texture.rd_texture);
+			ERR_FAIL_COND(texture.rd_texture_srgb.is_null());
+		}
+
+		texture.width_2d = texture.width;
+		texture.height_2d = texture.height;
+		texture.is_render_target = false;
+		texture.rd_view = rd_view;
+		texture.is_proxy = false;
+		texture.is_ycbcr_resolve_target = true;
+
+		// proxies pointing at the old texture follow the replacement
+		texture_replace(p_texture, texture_owner.make_rid(texture));
+		tex = texture_owner.get_or_null(p_texture);
+	}
+
+#ifdef TOOLS_ENABLED
+	tex->image_cache_2d.unref();
+#endif
+
+	effects->ycbcr_to_rgba_convert(ycbcr->rd_texture, cbcr ? cbcr->rd_texture : RID(), tex->rd_texture, Size2i(tex->width, tex->height), p_full_range);
+}
+
+RID RendererStorageRD::luma_pyramid_allocate() {
+	return luma_pyramid_owner.allocate_rid();
+}
+
+void RendererStorageRD::luma_pyramid_initialize(RID p_rid) {
+	luma_pyramid_owner.initialize_rid(p_rid, LumaPyramid());
+	luma_pyramids.push_back(p_rid);
+}
+
+void RendererStorageRD::luma_pyramid_set_callback(RID p_pyramid, RS::LumaPyramidReadbackCallback p_callback, void *p_userdata) {
+	LumaPyramid *pyramid = luma_pyramid_owner.get_or_null(p_pyramid);
+	ERR_FAIL_COND(!pyramid);
+	pyramid->callback = p_callback;
+	pyramid->userdata = p_userdata;
+}
+
+void RendererStorageRD::luma_pyramid_add_readback(RID p_pyramid, int p_level, const Rect2i &p_region) {
+	LumaPyramid *pyramid = luma_pyramid_owner.get_or_null(p_pyramid);
+	ERR_FAIL_COND(!pyramid);
+	ERR_FAIL_COND(p_level < 1 || p_level > RS::MAX_LUMA_PYRAMID_LEVELS);
+	ERR_FAIL_COND(p_region.position.x < 0 || p_region.position.y < 0 || p_region.size.x < 0 || p_region.size.y < 0);
+
+	LumaPyramid::Readback readback;
+	readback.level = p_level;
+	readback.region = p_region;
+	pyramid->readbacks.push_back(readback);
+}
+
+void RendererStorageRD::luma_pyramid_clear_readbacks(RID p_pyramid) {
+	LumaPyramid *pyramid = luma_pyramid_owner.get_or_null(p_pyramid);
+	ERR_FAIL_COND(!pyramid);
+	// copies in flight still arrive
+	pyramid->readbacks.clear();
+}
+
+void RendererStorageRD::luma_pyramid_update(RID p_pyramid, RID p_texture, int64_t p_sequence) {
+	LumaPyramid *pyramid = luma_pyramid_owner.get_or_null(p_pyramid);
+	ERR_FAIL_COND(!pyramid);
+	if (pyramid->readbacks.is_empty()) {
+		return; // nobody would see the levels
+	}
+
+	Texture *tex = texture_owner.get_or_null(p_texture);
+	ERR_FAIL_COND(!tex);
+	if (tex->is_proxy) {
+		tex = texture_owner.get_or_null(tex->proxy_to);
+		ERR_FAIL_COND(!tex);
+	}
+	ERR_FAIL_COND(tex->type != Texture::TYPE_2D);
+	if (tex->width < 2 || tex->height < 2) {
+		return; // placeholder
+	}
+
+	if (pyramid->staging.size() != int(RD::get_singleton()->get_frame_delay() + 1)) {
+		_luma_pyramid_clear(pyramid);
+		pyramid->staging.resize(RD::get_singleton()->get_frame_delay() + 1);
+	}
+	LumaPyramid::Staging &staging = pyramid->staging.write[pyramid->next_staging];
+	if (staging.pending) {
+		// the GPU is further behind than the ring is deep, skip rather than wait for it
+		return;
+	}
+
+	if (pyramid->source_size != Size2i(tex->width, tex->height)) {
+		pyramid->source_size = Size2i(tex->width, tex->height);
+		Size2i size = pyramid->source_size;
+		for (int i = 0; i < RS::MAX_LUMA_PYRAMID_LEVELS; i++) {
+			if (pyramid->levels[i].is_valid()) {
+				RD::get_singleton()->free(pyramid->levels[i]);
+			}
+			size = Size2i(MAX(size.x / 2, 1), MAX(size.y / 2, 1));
+			pyramid->level_sizes[i] = size;
+
+			RD::TextureFormat rd_format;
+			rd_format.format = RD::DATA_FORMAT_R8_UNORM;
+			rd_format.width = size.x;
+			rd_format.height = size.y;
+			rd_format.texture_type = RD::TEXTURE_TYPE_2D;
+			rd_format.usage_bits = RD::TEXTURE_USAGE_SAMPLING_BIT | RD::TEXTURE_USAGE_STORAGE_BIT | RD::TEXTURE_USAGE_CAN_COPY_FROM_BIT;
+			pyramid->levels[i] = RD::get_singleton()->texture_create(rd_format, RD::TextureView());
+			ERR_FAIL_COND(pyramid->levels[i].is_null());
+		}
+	}
+
+	// only build as far down as a readback needs
+	int level_count = 0;
+	staging.readbacks.clear();
+	uint32_t size = 0;
+	for (int i = 0; i < pyramid->readbacks.size(); i++) {
+		LumaPyramid::Readback readback = pyramid->readbacks[i];
+		Rect2i level_rect(Point2i(), pyramid->level_sizes[readback.level - 1]);
+		readback.region = readback.region.has_no_area() ? level_rect : readback.region.intersection(level_rect);
+		if (readback.region.has_no_area()) {
+			continue;
+		}
+		readback.offset = size;
+		size += readback.region.size.x * readback.region.size.y;
+		level_count = MAX(level_count, readback.level);
+		staging.readbacks.push_back(readback);
+	}
+	if (level_count == 0) {
+		return;
+	}
+
+	bool source_is_luma = tex->format == Image::FORMAT_L8 || tex->format == Image::FORMAT_R8;
+	effects->luma_pyramid_build(tex->rd_texture, pyramid->source_size, source_is_luma, pyramid->levels, pyramid->level_sizes, level_count);
+
+	if (staging.size < size) {
+		if (staging.buffer.is_valid()) {
+			RD::get_singleton()->free(staging.buffer);
+		}
+		staging.buffer = RD::get_singleton()->readback_buffer_create(size);
+		ERR_FAIL_COND(staging.buffer.is_null());
+		staging.size = size;
+	}
+
+	for (int i = 0; i < staging.readbacks.size(); i++) {
+		const LumaPyramid::Readback &readback = staging.readbacks[i];
+		RD::get_singleton()->texture_copy_to_readback_buffer(pyramid->levels[readback.level - 1], readback.region, staging.buffer, readback.offset);
+	}
+	staging.pending = true;
+	staging.sequence = p_sequence;
+	pyramid->next_staging = (pyramid->next_staging + 1) % pyramid->staging.size();
+}
+
+void RendererStorageRD::_luma_pyramid_clear(LumaPyramid *p_pyramid) {
+	for (int i = 0; i < p_pyramid->staging.size(); i++) {
+		if (p_pyramid->staging[i].buffer.is_valid()) {
+			RD::get_singleton()->free(p_pyramid->staging[i].buffer);
+		}
+	}
+	p_pyramid->staging.clear();
+	p_pyramid->next_staging = 0;
+}
+
+void RendererStorageRD::_update_luma_pyramids() {
+	for (int i = 0; i < luma_pyramids.size(); i++) {
+		LumaPyramid *pyramid = luma_pyramid_owner.get_or_null(luma_pyramids[i]);
+		int count = pyramid->staging.size();
+		// oldest first, a slot that isn't ready means the ones after it aren't either
+		for (int j = 0; j < count; j++) {
+			LumaPyramid::Staging &staging = pyramid->staging.write[(pyramid->next_staging + j) % count];
+			if (!staging.pending) {
+				continue;
+			}
+			if (!RD::get_singleton()->readback_buffer_is_ready(staging.buffer)) {
+				break;
+			}
+			staging.pending = false;
+
+			uint32_t size = 0;
+			for (int k = 0; k < staging.readbacks.size(); k++) {
+				const LumaPyramid::Readback &readback = staging.readbacks[k];
+				size = MAX(size, readback.offset + readback.region.size.x * readback.region.size.y);
+			}
+			pyramid->data.resize(size);
+			if (!pyramid->callback || RD::get_singleton()->readback_buffer_get_data(staging.buffer, 0, size, pyramid->data.ptrw()) != OK) {
+				continue;
+			}
+			for (int k = 0; k < staging.readbacks.size(); k++) {
+				const LumaPyramid::Readback &readback = staging.readbacks[k];
+				pyramid->callback(pyramid->userdata, staging.sequence, readback.level, readback.region, pyramid->data.ptr() + readback.offset);
+			}
+		}
+	}
+}
+
 //these two APIs can be used together or in combination with the others.
 void RendererStorageRD::texture_2d_placeholder_initialize(RID p_texture) {
 	//this could be better optimized to reuse an existing image , done this way
@@ -9174,6 +9544,7 @@ void RendererStorageRD::update_dirty_resources() {
 	_update_dirty_multimeshes();
 	_update_dirty_skeletons();
 	_update_decal_atlas();
+	_update_luma_pyramids();
 }
 
 bool RendererStorageRD::has_os_feature(const String &p_feature) const {
@@ -9351,6 +9722,16 @@ bool RendererStorageRD::free(RID p_rid) {
 		FogVolume *fog_volume = fog_volume_owner.get_or_null(p_rid);
 		fog_volume->dependency.deleted_notify(p_rid);
 		fog_volume_owner.free(p_rid);
+	} else if (luma_pyramid_owner.owns(p_rid)) {
+		LumaPyramid *pyramid = luma_pyramid_owner.get_or_null(p_rid);
+		_luma_pyramid_clear(pyramid);
+		for (int i = 0; i < RS::MAX_LUMA_PYRAMID_LEVELS; i++) {
+			if (pyramid->levels[i].is_valid()) {
+				RD::get_singleton()->free(pyramid->levels[i]);
+			}
+		}
+		luma_pyramids.erase(p_rid);
+		luma_pyramid_owner.free(p_rid);
 	} else if (render_target_owner.owns(p_rid)) {
 		RenderTarget *rt = render_target_owner.get_or_null(p_rid);
 
@@ -276,6 +276,7 @@ private:
 
 		bool is_render_target;
 		bool is_proxy;
+		bool is_ycbcr_resolve_target = false; // can be written by texture_2d_ycbcr_resolve()
 
 		Ref<Image> image_cache_2d;
 		String path;
@@ -366,6 +367,43 @@ private:
 
 	void _update_decal_atlas();
 
+	/* LUMA PYRAMID */
+
+	struct LumaPyramid {
+		struct Readback {
+			int level = 1;
+			Rect2i region;
+			uint32_t offset = 0; // in the staging buffer
+		};
+
+		// Copies of one update on their way back, the ring has one more than the frames in flight.
+		struct Staging {
+			RID buffer;
+			uint32_t size = 0;
+			bool pending = false;
+			int64_t sequence = 0;
+			Vector<Readback> readbacks;
+		};
+
+		RS::LumaPyramidReadbackCallback callback = nullptr;
+		void *userdata = nullptr;
+		Vector<Readback> readbacks; // as added, regions clip against the levels on each update
+
+		Size2i source_size;
+		RID levels[RS::MAX_LUMA_PYRAMID_LEVELS];
+		Size2i level_sizes[RS::MAX_LUMA_PYRAMID_LEVELS];
+
+		Vector<Staging> staging;
+		int next_staging = 0; // the oldest, so readbacks arrive in order
+		Vector<uint8_t> data; // what a staging buffer held, handed to the callback
+	};
+
+	RID_Owner<LumaPyramid, true> luma_pyramid_owner;
+	Vector<RID> luma_pyramids;
+
+	void _luma_pyramid_clear(LumaPyramid *p_pyramid);
+	void _update_luma_pyramids();
+
 	/* SHADER */
 
 	struct Material;
@@ -1317,7 +1355,20 @@ public:
 
 	virtual void texture_2d_update(RID p_texture, const Ref<Image> &p_image, int p_layer = 0);
 	virtual void texture_3d_update(RID p_texture, const Vector<Ref<Image>> &p_data);
+	static void _expand_rgb8_row(const uint8_t *p_src, uint8_t *p_dst, uint32_t p_pixels);
+	void _texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, const Rect2i &p_region = Rect2i());
+	virtual void texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata);
+	virtual void texture_2d_update_raw_region(RID p_texture, const Rect2i &p_region, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata);
 	virtual void texture_proxy_update(RID p_texture, RID p_proxy_to);
+	virtual RID texture_2d_dmabuf_create(int p_fd, uint64_t p_offset, int p_width, int p_height, int p_row_pitch, Image::Format p_format);
+	virtual void texture_2d_ycbcr_resolve(RID p_texture, RID p_ycbcr, RID p_cbcr, bool p_full_range);
+
+	virtual RID luma_pyramid_allocate();
+	virtual void luma_pyramid_initialize(RID p_rid);
+	virtual void luma_pyramid_set_callback(RID p_pyramid, RS::LumaPyramidReadbackCallback p_callback, void *p_userdata);
+	virtual void luma_pyramid_add_readback(RID p_pyramid, int p_level, const Rect2i &p_region);
+	virtual void luma_pyramid_clear_readbacks(RID p_pyramid);
+	virtual void luma_pyramid_update(RID p_pyramid, RID p_texture, int64_t p_sequence);
 
 	//these two APIs can be used together or in combination with the others.
 	virtual void texture_2d_placeholder_initialize(RID p_texture);
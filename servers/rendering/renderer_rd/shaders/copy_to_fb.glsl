@@ -14,6 +14,11 @@ layout(push_constant, binding = 1, std430) uniform Params {
 
 	bool force_luminance;
 	uint pad[3];
+
+	vec4 uv_basis; // MODE_CAMERA_FEED
+	vec2 uv_origin;
+	float multiplier;
+	float alpha;
 }
 params;
 
@@ -31,6 +36,12 @@ void main() {
 	if (params.flip_y) {
 		uv_interp.y = 1.0 - uv_interp.y;
 	}
+
+#ifdef MODE_CAMERA_FEED
+	// the feed transform expects the origin at the bottom left
+	uv_interp.y = 1.0 - uv_interp.y;
+	uv_interp = mat2(params.uv_basis.xy, params.uv_basis.zw) * uv_interp + params.uv_origin;
+#endif
 }
 
 #[fragment]
@@ -49,6 +60,11 @@ layout(push_constant, binding = 1, std430) uniform Params {
 	bool alpha_to_zero;
 	bool srgb;
 	uint pad;
+
+	vec4 uv_basis;
+	vec2 uv_origin;
+	float multiplier;
+	float alpha;
 }
 params;
 
@@ -111,5 +127,9 @@ void main() {
 	if (params.srgb) {
 		color.rgb = linear_to_srgb(color.rgb);
 	}
+#ifdef MODE_CAMERA_FEED
+	color.rgb *= params.multiplier;
+	color.a = params.alpha;
+#endif
 	frag_color = color;
 }
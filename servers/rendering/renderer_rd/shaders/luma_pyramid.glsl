@@ -0,0 +1,39 @@
+#[compute]
+
+#version 450
+
+#VERSION_DEFINES
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(r8, set = 1, binding = 0) uniform restrict writeonly image2D dest_luma;
+
+layout(push_constant, binding = 1, std430) uniform Params {
+	ivec2 source_size;
+	ivec2 dest_size;
+}
+params;
+
+float get_luma(ivec2 pos) {
+	// odd sizes repeat the last row and column
+	vec4 color = texelFetch(source, min(pos, params.source_size - 1), 0);
+#ifdef MODE_FROM_RGBA
+	// BT.601, like the YCbCr the cameras capture
+	return dot(color.rgb, vec3(0.299, 0.587, 0.114));
+#else
+	return color.r;
+#endif
+}
+
+void main() {
+	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(pos, params.dest_size))) { //too large, do nothing
+		return;
+	}
+
+	ivec2 source_pos = pos * 2;
+	float luma = get_luma(source_pos) + get_luma(source_pos + ivec2(1, 0)) + get_luma(source_pos + ivec2(0, 1)) + get_luma(source_pos + ivec2(1, 1));
+
+	imageStore(dest_luma, pos, vec4(luma * 0.25));
+}
@@ -0,0 +1,50 @@
+#[compute]
+
+#version 450
+
+#VERSION_DEFINES
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(set = 0, binding = 0) uniform sampler2D source_ycbcr;
+#ifdef MODE_SEPARATE_CBCR
+layout(set = 0, binding = 1) uniform sampler2D source_cbcr;
+#endif
+layout(rgba8, set = 1, binding = 0) uniform restrict writeonly image2D dest_rgba;
+
+layout(push_constant, binding = 1, std430) uniform Params {
+	ivec2 size;
+	float y_offset;
+	float y_scale;
+	float cbcr_scale;
+	uint pad[3];
+}
+params;
+
+void main() {
+	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(pos, params.size))) { //too large, do nothing
+		return;
+	}
+
+	vec3 ycbcr;
+#ifdef MODE_SEPARATE_CBCR
+	ycbcr.x = texelFetch(source_ycbcr, pos, 0).r;
+	// the CbCr plane is usually subsampled, let the sampler interpolate it
+	ycbcr.yz = textureLod(source_cbcr, (vec2(pos) + 0.5) / vec2(params.size), 0.0).rg;
+#else
+	ycbcr = texelFetch(source_ycbcr, pos, 0).rgb;
+#endif
+
+	ycbcr.x = (ycbcr.x - params.y_offset) * params.y_scale;
+	ycbcr.yz = (ycbcr.yz - 0.5) * params.cbcr_scale;
+
+	// BT.601, same as the conversion camera shaders used to do themselves
+	vec3 rgb = mat3(
+					   vec3(1.00000, 1.00000, 1.00000),
+					   vec3(0.00000, -0.34414, 1.77200),
+					   vec3(1.40200, -0.71414, 0.00000)) *
+			ycbcr;
+
+	imageStore(dest_rgba, pos, vec4(clamp(rgb, 0.0, 1.0), 1.0));
+}
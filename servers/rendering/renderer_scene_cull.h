@@ -1099,6 +1099,7 @@ public:
 	PASS2(environment_set_bg_color, RID, const Color &)
 	PASS2(environment_set_bg_energy, RID, float)
 	PASS2(environment_set_canvas_max_layer, RID, int)
+	PASS3(environment_set_camera_feed, RID, RID, const Transform2D &)
 	PASS6(environment_set_ambient_light, RID, const Color &, RS::EnvironmentAmbientSource, float, float, RS::EnvironmentReflectionSource)
 
 	PASS6(environment_set_ssr, RID, bool, int, float, float, float)
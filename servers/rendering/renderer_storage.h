@@ -133,7 +133,18 @@ public:
 
 	virtual void texture_2d_update(RID p_texture, const Ref<Image> &p_image, int p_layer = 0) = 0;
 	virtual void texture_3d_update(RID p_texture, const Vector<Ref<Image>> &p_data) = 0;
+	virtual void texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) = 0;
+	virtual void texture_2d_update_raw_region(RID p_texture, const Rect2i &p_region, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, RS::TextureRawReleaseCallback p_release, void *p_userdata) = 0;
 	virtual void texture_proxy_update(RID p_proxy, RID p_base) = 0;
+	virtual RID texture_2d_dmabuf_create(int p_fd, uint64_t p_offset, int p_width, int p_height, int p_row_pitch, Image::Format p_format) = 0;
+	virtual void texture_2d_ycbcr_resolve(RID p_texture, RID p_ycbcr, RID p_cbcr, bool p_full_range) = 0;
+
+	virtual RID luma_pyramid_allocate() = 0;
+	virtual void luma_pyramid_initialize(RID p_rid) = 0;
+	virtual void luma_pyramid_set_callback(RID p_pyramid, RS::LumaPyramidReadbackCallback p_callback, void *p_userdata) = 0;
+	virtual void luma_pyramid_add_readback(RID p_pyramid, int p_level, const Rect2i &p_region) = 0;
+	virtual void luma_pyramid_clear_readbacks(RID p_pyramid) = 0;
+	virtual void luma_pyramid_update(RID p_pyramid, RID p_texture, int64_t p_sequence) = 0;
 
 	//these two APIs can be used together or in combination with the others.
 	virtual void texture_2d_placeholder_initialize(RID p_texture) = 0;
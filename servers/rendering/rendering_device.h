@@ -496,6 +496,9 @@ public:
 
 	virtual RID texture_create(const TextureFormat &p_format, const TextureView &p_view, const Vector<Vector<uint8_t>> &p_data = Vector<Vector<uint8_t>>()) = 0;
 	virtual RID texture_create_shared(const TextureView &p_view, RID p_with_texture) = 0;
+	// Wraps memory exported by another device (such as a capture buffer) as a linear 2D texture without copying it.
+	// Only sampling is allowed and the memory must outlive the texture. Returns an invalid RID if the driver can't import it.
+	virtual RID texture_create_from_dmabuf(const TextureFormat &p_format, const TextureView &p_view, int p_fd, uint64_t p_offset, uint32_t p_row_pitch) = 0;
 
 	enum TextureSliceType {
 		TEXTURE_SLICE_2D,
@@ -507,6 +510,14 @@ public:
 	virtual RID texture_create_shared_from_slice(const TextureView &p_view, RID p_with_texture, uint32_t p_layer, uint32_t p_mipmap, TextureSliceType p_slice_type = TEXTURE_SLICE_2D) = 0;
 
 	virtual Error texture_update(RID p_texture, uint32_t p_layer, const Vector<uint8_t> &p_data, uint32_t p_post_barrier = BARRIER_MASK_ALL) = 0;
+	// Converts p_pixels pixels of a row of the data passed to texture_update_raw() into the format of the texture.
+	typedef void (*TextureRowConversion)(const uint8_t *p_src, uint8_t *p_dst, uint32_t p_pixels);
+	// Copies straight from memory owned by the caller (such as a mapped capture buffer), which can be released once this returns.
+	// A non-zero row pitch allows padded rows, but only for uncompressed 2D textures without mipmaps.
+	// With a region only the pixels within it are copied, the data still covers the whole texture.
+	// Data in another format is converted row by row as it is copied into the staging buffer, which needs a row pitch
+	// and the size of its pixels.
+	virtual Error texture_update_raw(RID p_texture, uint32_t p_layer, const uint8_t *p_data, uint32_t p_data_size, uint32_t p_row_pitch = 0, uint32_t p_post_barrier = BARRIER_MASK_ALL, const Rect2i &p_region = Rect2i(), TextureRowConversion p_convert = nullptr, uint32_t p_source_pixel_size = 0) = 0;
 	virtual Vector<uint8_t> texture_get_data(RID p_texture, uint32_t p_layer) = 0; // CPU textures will return immediately, while GPU textures will most likely force a flush
 
 	virtual bool texture_is_format_supported_for_usage(DataFormat p_format, uint32_t p_usage) const = 0;
@@ -517,6 +528,9 @@ public:
 	virtual Error texture_copy(RID p_from_texture, RID p_to_texture, const Vector3 &p_from, const Vector3 &p_to, const Vector3 &p_size, uint32_t p_src_mipmap, uint32_t p_dst_mipmap, uint32_t p_src_layer, uint32_t p_dst_layer, uint32_t p_post_barrier = BARRIER_MASK_ALL) = 0;
 	virtual Error texture_clear(RID p_texture, const Color &p_color, uint32_t p_base_mipmap, uint32_t p_mipmaps, uint32_t p_base_layer, uint32_t p_layers, uint32_t p_post_barrier = BARRIER_MASK_ALL) = 0;
 	virtual Error texture_resolve_multisample(RID p_from_texture, RID p_to_texture, uint32_t p_post_barrier = BARRIER_MASK_ALL) = 0;
+	// Records a copy of p_region of the first mipmap and layer into a readback buffer, with tightly packed rows.
+	// The data can be read once readback_buffer_is_ready() says so, which takes as many frames as get_frame_delay().
+	virtual Error texture_copy_to_readback_buffer(RID p_texture, const Rect2i &p_region, RID p_buffer, uint32_t p_offset) = 0;
 
 	/*********************/
 	/**** FRAMEBUFFER ****/
@@ -745,6 +759,13 @@ public:
 	virtual Error buffer_clear(RID p_buffer, uint32_t p_offset, uint32_t p_size, uint32_t p_post_barrier = BARRIER_MASK_ALL) = 0;
 	virtual Vector<uint8_t> buffer_get_data(RID p_buffer) = 0; //this causes stall, only use to retrieve large buffers for saving
 
+	// Buffers the GPU copies into for the CPU to read without stalling, see texture_copy_to_readback_buffer().
+	virtual RID readback_buffer_create(uint32_t p_size_bytes) = 0;
+	// Whether the GPU is done with every copy recorded into the buffer so far.
+	virtual bool readback_buffer_is_ready(RID p_buffer) = 0;
+	// Fails with ERR_BUSY instead of waiting while copies into the buffer are in flight.
+	virtual Error readback_buffer_get_data(RID p_buffer, uint32_t p_offset, uint32_t p_size, uint8_t *r_data) = 0;
+
 	/******************************************/
 	/**** PIPELINE SPECIALIZATION CONSTANT ****/
 	/******************************************/
@@ -185,7 +185,18 @@ public:
 	//these go through command queue if they are in another thread
 	FUNC3(texture_2d_update, RID, const Ref<Image> &, int)
 	FUNC2(texture_3d_update, RID, const Vector<Ref<Image>> &)
+	FUNC6(texture_2d_update_raw, RID, const uint8_t *, int, Image::Format, TextureRawReleaseCallback, void *)
+	FUNC7(texture_2d_update_raw_region, RID, const Rect2i &, const uint8_t *, int, Image::Format, TextureRawReleaseCallback, void *)
 	FUNC2(texture_proxy_update, RID, RID)
+	//needs to know whether the import worked
+	FUNC6R(RID, texture_2d_dmabuf_create, int, uint64_t, int, int, int, Image::Format)
+	FUNC4(texture_2d_ycbcr_resolve, RID, RID, RID, bool)
+
+	FUNCRIDSPLIT(luma_pyramid)
+	FUNC3(luma_pyramid_set_callback, RID, LumaPyramidReadbackCallback, void *)
+	FUNC3(luma_pyramid_add_readback, RID, int, const Rect2i &)
+	FUNC1(luma_pyramid_clear_readbacks, RID)
+	FUNC3(luma_pyramid_update, RID, RID, int64_t)
 
 	//these also go pass-through
 	FUNCRIDTEX0(texture_2d_placeholder)
@@ -612,10 +623,7 @@ public:
 	FUNC2(environment_set_canvas_max_layer, RID, int)
 	FUNC6(environment_set_ambient_light, RID, const Color &, EnvironmentAmbientSource, float, float, EnvironmentReflectionSource)
 
-// FIXME: Disabled during Vulkan refactoring, should be ported.
-#if 0
-	FUNC2(environment_set_camera_feed_id, RID, int)
-#endif
+	FUNC3(environment_set_camera_feed, RID, RID, const Transform2D &)
 	FUNC6(environment_set_ssr, RID, bool, int, float, float, float)
 	FUNC1(environment_set_ssr_roughness_quality, EnvironmentSSRRoughnessQuality)
 
@@ -79,7 +79,8 @@ public:
 		MAX_GLOW_LEVELS = 7,
 		MAX_CURSORS = 8,
 		MAX_2D_DIRECTIONAL_LIGHTS = 8,
-		MAX_MESH_SURFACES = 256
+		MAX_MESH_SURFACES = 256,
+		MAX_LUMA_PYRAMID_LEVELS = 3
 	};
 
 	/* TEXTURE API */
@@ -106,8 +107,39 @@ public:
 
 	virtual void texture_2d_update(RID p_texture, const Ref<Image> &p_image, int p_layer = 0) = 0;
 	virtual void texture_3d_update(RID p_texture, const Vector<Ref<Image>> &p_data) = 0;
+
+	typedef void (*TextureRawReleaseCallback)(void *);
+
+	// Updates a 2D texture straight from memory owned by the caller, with rows p_row_pitch bytes apart.
+	// The data must stay valid until p_release is called, which happens once it was copied for upload.
+	virtual void texture_2d_update_raw(RID p_texture, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, TextureRawReleaseCallback p_release, void *p_userdata) = 0;
+	// Like texture_2d_update_raw(), but only the pixels within p_region change. The data still covers the whole texture.
+	// Formats the renderer can't copy as they are (or expand from RGB8) are converted and updated whole.
+	virtual void texture_2d_update_raw_region(RID p_texture, const Rect2i &p_region, const uint8_t *p_data, int p_row_pitch, Image::Format p_format, TextureRawReleaseCallback p_release, void *p_userdata) = 0;
 	virtual void texture_proxy_update(RID p_texture, RID p_proxy_to) = 0;
 
+	// Wraps a dmabuf (such as a buffer exported by a capture device) as a 2D texture that is sampled in place.
+	// Returns an invalid RID when the renderer can't import it. Only proxies should point at it, it can't be updated.
+	virtual RID texture_2d_dmabuf_create(int p_fd, uint64_t p_offset, int p_width, int p_height, int p_row_pitch, Image::Format p_format) = 0;
+
+	// Converts YCbCr into p_texture, which is (re)allocated as RGBA8 at the size of p_ycbcr when needed.
+	// p_ycbcr holds Y, Cb and Cr in its RGB channels, or only Y when the CbCr plane is passed separately.
+	virtual void texture_2d_ycbcr_resolve(RID p_texture, RID p_ycbcr, RID p_cbcr, bool p_full_range) = 0;
+
+	typedef void (*LumaPyramidReadbackCallback)(void *p_userdata, int64_t p_sequence, int p_level, const Rect2i &p_region, const uint8_t *p_data);
+
+	// Keeps 8-bit luma copies of a 2D texture at 1/2, 1/4 and 1/8 of its size (levels 1 to MAX_LUMA_PYRAMID_LEVELS)
+	// on the GPU, rebuilt by each luma_pyramid_update(). The regions added as readbacks are copied back without
+	// stalling, and reach the callback on the rendering thread a few frames later along with the sequence passed
+	// to that update, p_data holds p_region.size.x bytes per row. An update is skipped rather than waited for when
+	// all staging buffers are still in flight. Single channel textures are taken as luma already.
+	virtual RID luma_pyramid_create() = 0;
+	virtual void luma_pyramid_set_callback(RID p_pyramid, LumaPyramidReadbackCallback p_callback, void *p_userdata) = 0;
+	// An empty region reads back the whole level.
+	virtual void luma_pyramid_add_readback(RID p_pyramid, int p_level, const Rect2i &p_region) = 0;
+	virtual void luma_pyramid_clear_readbacks(RID p_pyramid) = 0;
+	virtual void luma_pyramid_update(RID p_pyramid, RID p_texture, int64_t p_sequence) = 0;
+
 	//these two APIs can be used together or in combination with the others.
 	virtual RID texture_2d_placeholder_create() = 0;
 	virtual RID texture_2d_layered_placeholder_create(TextureLayeredType p_layered_type) = 0;
@@ -968,6 +1000,7 @@ public:
 	virtual void environment_set_bg_color(RID p_env, const Color &p_color) = 0;
 	virtual void environment_set_bg_energy(RID p_env, float p_energy) = 0;
 	virtual void environment_set_canvas_max_layer(RID p_env, int p_max_layer) = 0;
+	virtual void environment_set_camera_feed(RID p_env, RID p_texture, const Transform2D &p_transform) = 0;
 	virtual void environment_set_ambient_light(RID p_env, const Color &p_color, EnvironmentAmbientSource p_ambient = ENV_AMBIENT_SOURCE_BG, float p_energy = 1.0, float p_sky_contribution = 0.0, EnvironmentReflectionSource p_reflection_source = ENV_REFLECTION_SOURCE_BG) = 0;
 
 	enum EnvironmentGlowBlendMode {
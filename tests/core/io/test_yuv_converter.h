@@ -0,0 +1,211 @@
+/*************************************************************************/
+/*  test_yuv_converter.h                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef TEST_YUV_CONVERTER_H
+#define TEST_YUV_CONVERTER_H
+
+#include "core/io/yuv_converter.h"
+#include "core/math/random_number_generator.h"
+#include "core/os/os.h"
+#include "core/templates/vector.h"
+
+#include "tests/test_macros.h"
+
+namespace TestYUVConverter {
+
+// Frame with random contents in every plane, so all implementations see the same data.
+struct TestFrame {
+	Vector<uint8_t> planes[3];
+	YUVConverter::Source source;
+
+	TestFrame(YUVConverter::SourceFormat p_format, int p_width, int p_height, uint64_t p_seed = 0) {
+		// odd strides, so rows don't start aligned
+		int strides[3] = { p_width * 3 + 7, p_width + 5, p_width + 5 };
+
+		Ref<RandomNumberGenerator> rng;
+		rng.instantiate();
+		rng->set_seed(p_seed);
+		for (int i = 0; i < 3; i++) {
+			planes[i].resize(strides[i] * p_height);
+			uint8_t *w = planes[i].ptrw();
+			for (int j = 0; j < planes[i].size(); j++) {
+				w[j] = rng->randi() & 0xff;
+			}
+			source.planes[i] = planes[i].ptr();
+			source.strides[i] = strides[i];
+		}
+		source.format = p_format;
+		source.width = p_width;
+		source.height = p_height;
+	}
+};
+
+static Vector<uint8_t> convert(const YUVConverter::Source &p_source, YUVConverter::Implementation p_implementation) {
+	Vector<uint8_t> rgba;
+	rgba.resize(p_source.width * p_source.height * 4);
+	YUVConverter::convert_to_rgba8(p_source, rgba.ptrw(), 0, p_implementation);
+	return rgba;
+}
+
+TEST_CASE("[YUVConverter] Known colors") {
+	uint8_t y[2] = { 235, 16 };
+	uint8_t cb[1] = { 128 };
+	uint8_t cr[1] = { 128 };
+
+	YUVConverter::Source source;
+	source.format = YUVConverter::SOURCE_YUV422P;
+	source.planes[0] = y;
+	source.planes[1] = cb;
+	source.planes[2] = cr;
+	source.strides[0] = 2;
+	source.strides[1] = 1;
+	source.strides[2] = 1;
+	source.width = 2;
+	source.height = 1;
+
+	uint8_t rgba[8];
+	YUVConverter::convert_to_rgba8(source, rgba);
+	CHECK_MESSAGE(rgba[0] == 255, "Limited range white should be white.");
+	CHECK(rgba[1] == 255);
+	CHECK(rgba[2] == 255);
+	CHECK(rgba[3] == 255);
+	CHECK_MESSAGE(rgba[4] == 0, "Limited range black should be black.");
+	CHECK(rgba[5] == 0);
+	CHECK(rgba[6] == 0);
+
+	source.range = YUVConverter::RANGE_FULL;
+	YUVConverter::convert_to_rgba8(source, rgba);
+	CHECK_MESSAGE(rgba[0] == 235, "Full range gray should keep its level.");
+	CHECK(rgba[4] == 16);
+
+	// BT.601 red
+	source.range = YUVConverter::RANGE_LIMITED;
+	y[0] = 81;
+	y[1] = 81;
+	cb[0] = 90;
+	cr[0] = 240;
+	YUVConverter::convert_to_rgba8(source, rgba);
+	CHECK(rgba[0] >= 253);
+	CHECK(rgba[1] <= 2);
+	CHECK(rgba[2] <= 2);
+}
+
+TEST_CASE("[YUVConverter] Packed formats") {
+	// two pixels, Y 16 and 235 sharing neutral chroma
+	uint8_t yuyv[4] = { 16, 128, 235, 128 };
+	uint8_t uyvy[4] = { 128, 16, 128, 235 };
+
+	YUVConverter::Source source;
+	source.format = YUVConverter::SOURCE_YUYV;
+	source.planes[0] = yuyv;
+	source.strides[0] = 4;
+	source.width = 2;
+	source.height = 1;
+
+	uint8_t from_yuyv[8];
+	YUVConverter::convert_to_rgba8(source, from_yuyv);
+
+	source.format = YUVConverter::SOURCE_UYVY;
+	source.planes[0] = uyvy;
+	uint8_t from_uyvy[8];
+	YUVConverter::convert_to_rgba8(source, from_uyvy);
+
+	CHECK(from_yuyv[0] == 0);
+	CHECK(from_yuyv[4] == 255);
+	CHECK_MESSAGE(memcmp(from_yuyv, from_uyvy, 8) == 0, "YUYV and UYVY with the same samples should give the same pixels.");
+
+	uint8_t rgb[6] = { 1, 2, 3, 4, 5, 6 };
+	source.format = YUVConverter::SOURCE_RGB24;
+	source.planes[0] = rgb;
+	source.strides[0] = 6;
+	uint8_t rgba[8];
+	YUVConverter::convert_to_rgba8(source, rgba);
+	const uint8_t expected[8] = { 1, 2, 3, 255, 4, 5, 6, 255 };
+	CHECK_MESSAGE(memcmp(rgba, expected, 8) == 0, "RGB24 should be copied with opaque alpha.");
+}
+
+TEST_CASE("[YUVConverter] Vector implementations match the scalar one") {
+	const int widths[] = { 1, 2, 15, 16, 17, 33, 64, 95, 130 };
+	for (int format = 0; format < YUVConverter::SOURCE_MAX; format++) {
+		for (int width : widths) {
+			TestFrame frame((YUVConverter::SourceFormat)format, width, 3, format * 1000 + width);
+			for (int color_space = 0; color_space < 2; color_space++) {
+				for (int range = 0; range < 2; range++) {
+					frame.source.color_space = (YUVConverter::ColorSpace)color_space;
+					frame.source.range = (YUVConverter::Range)range;
+					Vector<uint8_t> expected = convert(frame.source, YUVConverter::IMPLEMENTATION_SCALAR);
+
+					for (int implementation = YUVConverter::IMPLEMENTATION_SSE2; implementation < YUVConverter::IMPLEMENTATION_MAX; implementation++) {
+						if (!YUVConverter::is_implementation_supported((YUVConverter::Implementation)implementation)) {
+							continue;
+						}
+						INFO(YUVConverter::get_implementation_name((YUVConverter::Implementation)implementation), " format ", format, " width ", width);
+						CHECK(convert(frame.source, (YUVConverter::Implementation)implementation) == expected);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Prints the cost of converting a frame, run with `--test --no-skip --test-case="*Benchmark*"`.
+TEST_CASE("[YUVConverter][Benchmark] Per-frame cost" * doctest::skip()) {
+	const Size2i sizes[] = { Size2i(1280, 720), Size2i(1920, 1080), Size2i(3840, 2160) };
+	const YUVConverter::SourceFormat formats[] = { YUVConverter::SOURCE_YUYV, YUVConverter::SOURCE_NV12, YUVConverter::SOURCE_I420, YUVConverter::SOURCE_RGB24 };
+	const char *format_names[] = { "YUYV", "NV12", "I420", "RGB24" };
+	const int iterations = 20;
+
+	for (int i = 0; i < 4; i++) {
+		for (const Size2i &size : sizes) {
+			TestFrame frame(formats[i], size.x, size.y);
+			Vector<uint8_t> rgba;
+			rgba.resize(size.x * size.y * 4);
+
+			String line = vformat("%s %dx%d:", format_names[i], size.x, size.y);
+			for (int implementation = YUVConverter::IMPLEMENTATION_SCALAR; implementation < YUVConverter::IMPLEMENTATION_MAX; implementation++) {
+				if (!YUVConverter::is_implementation_supported((YUVConverter::Implementation)implementation)) {
+					continue;
+				}
+
+				uint64_t start = OS::get_singleton()->get_ticks_usec();
+				for (int j = 0; j < iterations; j++) {
+					YUVConverter::convert_to_rgba8(frame.source, rgba.ptrw(), 0, (YUVConverter::Implementation)implementation);
+				}
+				double msec = (OS::get_singleton()->get_ticks_usec() - start) / 1000.0 / iterations;
+				line += vformat(" %s %.2f ms", YUVConverter::get_implementation_name((YUVConverter::Implementation)implementation), msec);
+			}
+			MESSAGE(line);
+		}
+	}
+}
+
+} // namespace TestYUVConverter
+
+#endif // TEST_YUV_CONVERTER_H
@@ -0,0 +1,984 @@
+/*************************************************************************/
+/*  test_camera.h                                                        */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2021 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2021 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef TEST_CAMERA_H
+#define TEST_CAMERA_H
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/io/image.h"
+#include "core/io/yuv_converter.h"
+#include "core/object/message_queue.h"
+#include "core/os/os.h"
+#include "servers/camera/camera_feed.h"
+#include "servers/camera/camera_frame_set.h"
+#include "servers/camera_server.h"
+
+#include "modules/modules_enabled.gen.h" // For camera.
+
+#ifdef MODULE_CAMERA_ENABLED
+#include "modules/camera/camera_virtual.h"
+#endif
+
+#include "tests/test_macros.h"
+
+namespace TestCamera {
+
+// Feeds take their id from the camera server, the [SceneTree] tag provides the dummy rendering server
+// their textures live in. Declare it before the feeds, so it outlives them.
+struct TestCameraServer {
+	CameraServer *server = nullptr;
+
+	TestCameraServer() {
+		if (!CameraServer::get_singleton()) {
+			server = memnew(CameraServer);
+		}
+	}
+
+	~TestCameraServer() {
+		if (server) {
+			memdelete(server);
+		}
+	}
+};
+
+static Ref<Image> make_image(int p_width, int p_height, Image::Format p_format) {
+	Vector<uint8_t> data;
+	data.resize(Image::get_image_data_size(p_width, p_height, p_format, false));
+	memset(data.ptrw(), 0x80, data.size());
+
+	Ref<Image> image;
+	image.instantiate();
+	image->create(p_width, p_height, false, p_format, data);
+	return image;
+}
+
+static int released_frames = 0;
+
+static void count_release(void *p_userdata) {
+	released_frames++;
+}
+
+// A camera server that looks for its cameras on a thread of its own, like the one on Linux does.
+class TestEnumeratingServer : public CameraServer {
+	Thread thread;
+
+	static void _enumerate(void *p_user) {
+		TestEnumeratingServer *server = (TestEnumeratingServer *)p_user;
+		OS::get_singleton()->delay_usec(50000);
+		server->queue_add_feed(memnew(CameraFeed("Found late")));
+		server->finish_enumeration();
+	}
+
+public:
+	TestEnumeratingServer() {
+		begin_enumeration();
+		thread.start(_enumerate, this);
+	}
+
+	~TestEnumeratingServer() {
+		thread.wait_to_finish();
+		while (!feeds.is_empty()) {
+			Ref<CameraFeed> feed = feeds[feeds.size() - 1];
+			remove_feed(feed);
+		}
+	}
+};
+
+TEST_CASE("[SceneTree][Camera] Feeds are found in the background") {
+	REQUIRE_FALSE(CameraServer::get_singleton());
+	TestEnumeratingServer *server = memnew(TestEnumeratingServer);
+	SIGNAL_WATCH(server, "feeds_ready");
+
+	CHECK_FALSE(server->are_feeds_ready());
+	CHECK_MESSAGE(server->get_feed_count() == 1, "Asking for the feeds should wait for the cameras to be found.");
+	CHECK(server->are_feeds_ready());
+
+	Array signal_args;
+	signal_args.push_back(Array());
+	MessageQueue::get_singleton()->flush();
+	SIGNAL_CHECK("feeds_ready", signal_args);
+
+	SIGNAL_UNWATCH(server, "feeds_ready");
+	memdelete(server);
+}
+
+TEST_CASE("[SceneTree][Camera] Frames are shown by update_frame") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	feed->set_RGB_img(make_image(64, 48, Image::FORMAT_RGBA8));
+	CHECK_MESSAGE(feed->is_frame_pending(), "A queued frame should wait for the renderer.");
+	CHECK_MESSAGE(feed->get_datatype() == CameraFeed::FEED_NOIMAGE, "A queued frame shouldn't be shown yet.");
+
+	feed->update_frame();
+	CHECK_FALSE(feed->is_frame_pending());
+	CHECK(feed->get_datatype() == CameraFeed::FEED_RGB);
+	CHECK(feed->get_base_width() == 64);
+	CHECK(feed->get_base_height() == 48);
+
+	feed->set_YCbCr_imgs(make_image(64, 48, Image::FORMAT_R8), make_image(32, 24, Image::FORMAT_RG8));
+	feed->update_frame();
+	CHECK(feed->get_datatype() == CameraFeed::FEED_YCBCR_SEP);
+
+	feed->set_active(false);
+	feed->set_RGB_img(make_image(64, 48, Image::FORMAT_RGBA8));
+	CHECK_MESSAGE(!feed->is_frame_pending(), "An inactive feed should ignore frames.");
+}
+
+TEST_CASE("[SceneTree][Camera] Activation signals") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	SIGNAL_WATCH(feed.ptr(), "activated");
+	SIGNAL_WATCH(feed.ptr(), "activation_failed");
+	SIGNAL_WATCH(feed.ptr(), "deactivated");
+
+	Array signal_args;
+	signal_args.push_back(Array());
+
+	feed->set_active(true);
+	CHECK_MESSAGE(feed->is_active(), "A feed should report what it was asked for right away.");
+	feed->wait_for_activation();
+	CHECK(feed->is_capturing());
+	MessageQueue::get_singleton()->flush();
+	SIGNAL_CHECK("activated", signal_args);
+	SIGNAL_CHECK_FALSE("activation_failed");
+
+	feed->set_active(false);
+	CHECK_FALSE(feed->is_active());
+	CHECK_MESSAGE(!feed->is_capturing(), "A feed should stop taking frames right away.");
+	feed->wait_for_activation();
+	MessageQueue::get_singleton()->flush();
+	SIGNAL_CHECK("deactivated", signal_args);
+
+	// asked to stop before it was done starting
+	feed->set_active(true);
+	feed->set_active(false);
+	feed->wait_for_activation();
+	CHECK_FALSE(feed->is_capturing());
+	MessageQueue::get_singleton()->flush();
+	SIGNAL_CHECK_FALSE("activated");
+	SIGNAL_DISCARD("deactivated");
+
+	SIGNAL_UNWATCH(feed.ptr(), "activated");
+	SIGNAL_UNWATCH(feed.ptr(), "activation_failed");
+	SIGNAL_UNWATCH(feed.ptr(), "deactivated");
+}
+
+// Counts the checks the activation thread runs.
+class TestCheckedFeed : public CameraFeed {
+public:
+	SafeNumeric<int> checks;
+
+	void check_feed() override {
+		checks.increment();
+	}
+
+	TestCheckedFeed() :
+			CameraFeed("Test") {}
+};
+
+TEST_CASE("[SceneTree][Camera] Checks run on the activation thread") {
+	TestCameraServer camera_server;
+	Ref<TestCheckedFeed> feed = memnew(TestCheckedFeed);
+
+	feed->request_check();
+	feed->wait_for_activation();
+	CHECK(feed->checks.get() == 1);
+
+	feed->set_active(true);
+	feed->request_check();
+	feed->wait_for_activation();
+	CHECK_MESSAGE(feed->checks.get() == 1, "An active feed shouldn't be checked.");
+
+	// asked for while it is still on its way down
+	feed->set_active(false);
+	feed->request_check();
+	feed->wait_for_activation();
+	CHECK(feed->checks.get() == 2);
+	MessageQueue::get_singleton()->flush();
+}
+
+TEST_CASE("[SceneTree][Camera] Drop policies") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	feed->set_RGB_img(make_image(64, 48, Image::FORMAT_RGBA8));
+	feed->set_RGB_img(make_image(32, 24, Image::FORMAT_RGBA8));
+	feed->update_frame();
+	CHECK_MESSAGE(feed->get_base_width() == 32, "Dropping the oldest frame should show the latest one.");
+	CHECK(int(feed->get_statistics()["frames_skipped"]) == 1);
+
+	feed->set_drop_policy(CameraFeed::DROP_POLICY_NEWEST);
+	feed->set_RGB_img(make_image(64, 48, Image::FORMAT_RGBA8));
+	feed->set_RGB_img(make_image(16, 12, Image::FORMAT_RGBA8));
+	feed->update_frame();
+	CHECK_MESSAGE(feed->get_base_width() == 64, "Dropping the newest frame should show the waiting one.");
+	CHECK(int(feed->get_statistics()["frames_skipped"]) == 2);
+}
+
+TEST_CASE("[SceneTree][Camera] Raw frames are released") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	Vector<uint8_t> data;
+	data.resize(64 * 48 * 3);
+	CameraFeed::FramePlane plane;
+	plane.data = data.ptr();
+	plane.width = 64;
+	plane.height = 48;
+	plane.row_pitch = 64 * 3;
+	plane.format = Image::FORMAT_RGB8;
+
+	released_frames = 0;
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	CHECK_MESSAGE(released_frames == 1, "A replaced frame should be released right away.");
+
+	feed->update_frame();
+	CHECK_MESSAGE(released_frames == 2, "A frame should be released once it was uploaded.");
+	CHECK(feed->get_datatype() == CameraFeed::FEED_RGB);
+
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	feed->drop_pending_frames();
+	CHECK_MESSAGE(released_frames == 3, "Dropping pending frames should release them.");
+}
+
+TEST_CASE("[SceneTree][Camera] Frame images are recycled") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	Ref<Image> first = feed->acquire_image(64, 48, Image::FORMAT_RGBA8);
+	REQUIRE(first.is_valid());
+	CHECK(first->get_width() == 64);
+	CHECK(first->get_format() == Image::FORMAT_RGBA8);
+	Ref<Image> second = feed->acquire_image(64, 48, Image::FORMAT_RGBA8);
+	CHECK_MESSAGE(second != first, "An image that is still held shouldn't be handed out again.");
+	CHECK(int(feed->get_statistics()["image_allocations"]) == 2);
+
+	first.unref();
+	second.unref();
+	for (int i = 0; i < 10; i++) {
+		feed->set_RGB_img(feed->acquire_image(64, 48, Image::FORMAT_RGBA8));
+		feed->update_frame();
+	}
+	CHECK_MESSAGE(int(feed->get_statistics()["image_allocations"]) == 2, "Frames of the same size should reuse the images.");
+
+	feed->set_RGB_img(feed->acquire_image(32, 24, Image::FORMAT_RGBA8));
+	feed->update_frame();
+	CHECK(feed->get_base_width() == 32);
+	CHECK(int(feed->get_statistics()["image_allocations"]) == 3);
+
+	ERR_PRINT_OFF;
+	CHECK(feed->acquire_image(0, 48, Image::FORMAT_RGBA8).is_null());
+	ERR_PRINT_ON;
+}
+
+TEST_CASE("[SceneTree][Camera] Latest frame on the CPU") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	Vector<uint8_t> data;
+	data.resize(64 * 48 * 3);
+	for (int i = 0; i < data.size(); i++) {
+		data.write[i] = i % 3 == 1 ? 200 : 0;
+	}
+	CameraFeed::FramePlane plane;
+	plane.data = data.ptr();
+	plane.width = 64;
+	plane.height = 48;
+	plane.row_pitch = 64 * 3;
+	plane.format = Image::FORMAT_RGB8;
+
+	feed->set_RGB_raw(plane, nullptr, nullptr);
+	CHECK_MESSAGE(feed->get_latest_frame().is_empty(), "Frames shouldn't be kept unless asked for.");
+
+	feed->set_keep_latest_frame(true);
+	feed->set_grayscale_downscale(4);
+	CameraFeed::FrameTiming timing;
+	timing.capture_usec = 1234;
+	timing.sequence = 7;
+	feed->set_frame_timing(timing);
+	feed->set_RGB_raw(plane, nullptr, nullptr);
+
+	Dictionary frame = feed->get_latest_frame();
+	Ref<Image> image = frame.get("image", Variant());
+	REQUIRE(image.is_valid());
+	CHECK(image->get_width() == 64);
+	CHECK(image->get_format() == Image::FORMAT_RGB8);
+	CHECK_MESSAGE(image->ptr()[1] == 200, "The frame should be copied from the capture buffer.");
+	CHECK(int64_t(frame["timestamp_usec"]) == 1234);
+	CHECK(int64_t(frame["sequence"]) == 7);
+	CHECK_FALSE(bool(frame["ycbcr"]));
+
+	Ref<Image> grayscale = frame.get("grayscale", Variant());
+	REQUIRE(grayscale.is_valid());
+	CHECK(grayscale->get_width() == 16);
+	CHECK(grayscale->get_height() == 12);
+	CHECK(grayscale->get_format() == Image::FORMAT_L8);
+	CHECK(grayscale->ptr()[0] == (150 * 200) >> 8);
+
+	feed->set_keep_latest_frame(false);
+	feed->set_YCbCr_imgs(make_image(64, 48, Image::FORMAT_R8), make_image(32, 24, Image::FORMAT_RG8));
+	frame = feed->get_latest_frame();
+	CHECK_FALSE(frame.has("image"));
+	CHECK(bool(frame["ycbcr"]));
+	grayscale = frame.get("grayscale", Variant());
+	REQUIRE(grayscale.is_valid());
+	CHECK_MESSAGE(grayscale->ptr()[0] == 0x80, "YCbCr frames should take their Y values as they are.");
+}
+
+TEST_CASE("[SceneTree][Camera] Region of interest") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+	feed->set_keep_latest_frame(true);
+
+	// every pixel holds its column in red and its row in green
+	Vector<uint8_t> data;
+	data.resize(64 * 48 * 3);
+	for (int y = 0; y < 48; y++) {
+		for (int x = 0; x < 64; x++) {
+			data.write[(y * 64 + x) * 3 + 0] = x;
+			data.write[(y * 64 + x) * 3 + 1] = y;
+		}
+	}
+	CameraFeed::FramePlane plane;
+	plane.data = data.ptr();
+	plane.width = 64;
+	plane.height = 48;
+	plane.row_pitch = 64 * 3;
+	plane.format = Image::FORMAT_RGB8;
+
+	feed->set_region_of_interest(Rect2i(10, 20, 30, 16));
+	CHECK(feed->get_region_of_interest() == Rect2i(10, 20, 30, 16));
+	feed->set_RGB_raw(plane, nullptr, nullptr);
+	feed->update_frame();
+	CHECK(feed->get_base_width() == 30);
+	CHECK(feed->get_base_height() == 16);
+
+	Ref<Image> image = feed->get_latest_frame().get("image", Variant());
+	REQUIRE(image.is_valid());
+	CHECK(image->get_width() == 30);
+	CHECK(image->get_height() == 16);
+	CHECK_MESSAGE(image->ptr()[0] == 10, "The region should start at its column.");
+	CHECK_MESSAGE(image->ptr()[1] == 20, "The region should start at its row.");
+
+	feed->set_region_of_interest(Rect2i(50, 40, 100, 100));
+	feed->set_RGB_img(make_image(64, 48, Image::FORMAT_RGB8));
+	feed->update_frame();
+	CHECK_MESSAGE(feed->get_base_width() == 14, "The region should be clipped to the frame.");
+	CHECK(feed->get_base_height() == 8);
+
+	feed->set_region_of_interest(Rect2i(5, 5, 10, 10));
+	feed->set_YCbCr_imgs(make_image(64, 48, Image::FORMAT_R8), make_image(32, 24, Image::FORMAT_RG8));
+	Dictionary frame = feed->get_latest_frame();
+	Ref<Image> y_image = frame.get("image", Variant());
+	Ref<Image> cbcr_image = frame.get("cbcr_image", Variant());
+	REQUIRE(y_image.is_valid());
+	REQUIRE(cbcr_image.is_valid());
+	CHECK_MESSAGE(y_image->get_width() == 12, "Subsampled frames should be cut at even columns.");
+	CHECK(y_image->get_height() == 12);
+	CHECK(cbcr_image->get_width() == 6);
+	CHECK(cbcr_image->get_height() == 6);
+
+	feed->set_region_of_interest(Rect2i());
+	feed->set_RGB_raw(plane, nullptr, nullptr);
+	feed->update_frame();
+	CHECK_MESSAGE(feed->get_base_width() == 64, "An empty region should show the whole frame.");
+	CHECK(feed->get_base_height() == 48);
+
+	ERR_PRINT_OFF;
+	feed->set_region_of_interest(Rect2i(-1, 0, 10, 10));
+	ERR_PRINT_ON;
+	CHECK(feed->get_region_of_interest() == Rect2i());
+}
+
+TEST_CASE("[SceneTree][Camera] Change detection") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+	feed->set_change_detection(true);
+	SIGNAL_WATCH(feed.ptr(), "motion_detected");
+
+	Vector<uint8_t> data;
+	data.resize(128 * 96 * 3);
+	memset(data.ptrw(), 0x40, data.size());
+	CameraFeed::FramePlane plane;
+	plane.data = data.ptr();
+	plane.width = 128;
+	plane.height = 96;
+	plane.row_pitch = 128 * 3;
+	plane.format = Image::FORMAT_RGB8;
+
+	released_frames = 0;
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	feed->update_frame();
+	CHECK_MESSAGE(feed->get_base_width() == 128, "The first frame should always be shown.");
+	MessageQueue::get_singleton()->flush();
+	SIGNAL_CHECK_FALSE("motion_detected");
+
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	CHECK_MESSAGE(released_frames == 2, "A frame that didn't change should be released right away.");
+	CHECK_FALSE(feed->is_frame_pending());
+	CHECK(int(feed->get_statistics()["uploads_skipped"]) == 1);
+
+	// brighten a 20x20 square in the second block from the left
+	for (int y = 4; y < 24; y++) {
+		memset(data.ptrw() + y * plane.row_pitch + 40 * 3, 0xc0, 20 * 3);
+	}
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	CHECK(feed->is_frame_pending());
+	feed->update_frame();
+	CHECK(released_frames == 3);
+	CHECK_MESSAGE(int(feed->get_statistics()["uploads_partial"]) == 1, "Only the part that changed should be uploaded.");
+
+	MessageQueue::get_singleton()->flush();
+	Array score;
+	score.push_back(1.0f / 12.0f);
+	Array signal_args;
+	signal_args.push_back(score);
+	SIGNAL_CHECK("motion_detected", signal_args);
+
+	feed->set_change_detection(false);
+	feed->set_RGB_raw(plane, &count_release, nullptr);
+	CHECK_MESSAGE(feed->is_frame_pending(), "Frames should all be shown without change detection.");
+	feed->update_frame();
+
+	SIGNAL_UNWATCH(feed.ptr(), "motion_detected");
+
+	// the changed blocks come back as rectangles in pixels of the frame
+	CameraChangeDetector detector;
+	CameraChangeDetector::Result result;
+	Vector<uint8_t> luma;
+	luma.resize(100 * 70);
+	memset(luma.ptrw(), 0, luma.size());
+	detector.detect(luma.ptr(), 100, 70, 100, 1, 0, 8, result);
+	CHECK(result.changed);
+	CHECK(result.rect_count == 0);
+
+	for (int y = 0; y < 70; y++) {
+		memset(luma.ptrw() + y * 100 + 96, 255, 4);
+	}
+	detector.detect(luma.ptr(), 100, 70, 100, 1, 0, 8, result);
+	REQUIRE(result.rect_count == 1);
+	CHECK_MESSAGE(result.rects[0] == Rect2i(96, 0, 4, 70), "Rows of changed blocks should merge, cut to the frame.");
+
+	detector.detect(luma.ptr(), 100, 70, 100, 1, 0, 8, result);
+	CHECK_MESSAGE(!result.changed, "Changes should count once they were reported.");
+}
+
+// Delivers readbacks like the renderer does once the GPU copied them, which the dummy renderer never does.
+class TestLumaFeed : public CameraFeed {
+public:
+	void deliver(int64_t p_sequence, int p_level, const Rect2i &p_region, const uint8_t *p_data) {
+		_luma_readback_completed(this, p_sequence, p_level, p_region, p_data);
+	}
+
+	TestLumaFeed() :
+			CameraFeed("Test") {}
+};
+
+static int64_t luma_sequence = -1;
+static int luma_first_byte = -1;
+
+static void record_luma(void *p_userdata, int64_t p_sequence, int p_level, const Rect2i &p_region, const uint8_t *p_data) {
+	luma_sequence = p_sequence;
+	luma_first_byte = p_data[0];
+}
+
+// The signal watcher takes up to three arguments.
+class LumaReceiver : public Object {
+public:
+	int received = 0;
+	int64_t sequence = -1;
+	int level = 0;
+	Rect2i region;
+	Ref<Image> image;
+
+	void receive(int64_t p_sequence, int p_level, const Rect2i &p_region, const Ref<Image> &p_image) {
+		received++;
+		sequence = p_sequence;
+		level = p_level;
+		region = p_region;
+		image = p_image;
+	}
+};
+
+TEST_CASE("[SceneTree][Camera] Luma readbacks") {
+	TestCameraServer camera_server;
+	Ref<TestLumaFeed> feed = memnew(TestLumaFeed);
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	ERR_PRINT_OFF;
+	feed->add_luma_readback(0);
+	feed->add_luma_readback(RS::MAX_LUMA_PYRAMID_LEVELS + 1);
+	ERR_PRINT_ON;
+
+	// without a GPU to build the pyramid, frames are shown as before
+	feed->add_luma_readback(2, Rect2i(4, 4, 8, 8));
+	feed->set_RGB_img(make_image(64, 48, Image::FORMAT_RGB8));
+	feed->update_frame();
+	CHECK(feed->get_base_width() == 64);
+
+	LumaReceiver receiver;
+	feed->connect("luma_readback_completed", callable_mp(&receiver, &LumaReceiver::receive));
+	feed->set_luma_readback_callback(&record_luma, nullptr);
+
+	Vector<uint8_t> luma;
+	luma.resize(8 * 8);
+	memset(luma.ptrw(), 0x33, luma.size());
+	feed->deliver(42, 2, Rect2i(4, 4, 8, 8), luma.ptr());
+	CHECK_MESSAGE(luma_sequence == 42, "The callback should get the readback right away.");
+	CHECK(luma_first_byte == 0x33);
+	CHECK(receiver.received == 0);
+
+	// the signal follows on the main thread, with a copy of the data
+	memset(luma.ptrw(), 0, luma.size());
+	MessageQueue::get_singleton()->flush();
+	REQUIRE(receiver.received == 1);
+	CHECK(receiver.sequence == 42);
+	CHECK(receiver.level == 2);
+	CHECK(receiver.region == Rect2i(4, 4, 8, 8));
+	REQUIRE(receiver.image.is_valid());
+	CHECK(receiver.image->get_format() == Image::FORMAT_L8);
+	CHECK(receiver.image->get_size() == Size2i(8, 8));
+	CHECK(receiver.image->get_pixel(7, 7).get_r8() == 0x33);
+
+	feed->set_luma_readback_callback(nullptr, nullptr);
+	feed->clear_luma_readbacks();
+	feed->disconnect("luma_readback_completed", callable_mp(&receiver, &LumaReceiver::receive));
+}
+
+static void send_frame(Ref<CameraFeed> p_feed, uint64_t p_capture_usec, int64_t p_sequence) {
+	CameraFeed::FrameTiming timing;
+	timing.capture_usec = p_capture_usec;
+	timing.sequence = p_sequence;
+	p_feed->set_frame_timing(timing);
+	p_feed->set_RGB_img(make_image(16, 12, Image::FORMAT_RGB8));
+}
+
+TEST_CASE("[SceneTree][Camera] Frame sets") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> left = memnew(CameraFeed("Left"));
+	Ref<CameraFeed> right = memnew(CameraFeed("Right"));
+	Array feeds;
+	feeds.push_back(left);
+	feeds.push_back(right);
+	for (int i = 0; i < feeds.size(); i++) {
+		Ref<CameraFeed> feed = feeds[i];
+		feed->set_active(true);
+		feed->wait_for_activation();
+	}
+
+	Ref<CameraFrameSet> frame_set = CameraServer::get_singleton()->create_frame_set(feeds, 2.0);
+	REQUIRE(frame_set.is_valid());
+
+	send_frame(left, 10000, 0);
+	CHECK_MESSAGE(frame_set->get_latest_set().is_empty(), "A set needs a frame of every feed.");
+	send_frame(right, 15000, 0);
+	CHECK_MESSAGE(frame_set->get_latest_set().is_empty(), "Frames too far apart shouldn't be matched.");
+
+	// the right camera captures 1ms later, and a little more later with every frame
+	for (int i = 1; i <= 4; i++) {
+		send_frame(left, 10000 + i * 33000, i);
+		send_frame(right, 11000 + i * 33100, i);
+	}
+
+	Dictionary set = frame_set->get_latest_set();
+	REQUIRE_FALSE(set.is_empty());
+	CHECK(int(set["sequence"]) == 3);
+	CHECK(int64_t(set["spread_usec"]) == 1400);
+	Array frames = set["frames"];
+	REQUIRE(frames.size() == 2);
+	CHECK(int64_t(Dictionary(frames[0])["timestamp_usec"]) == 142000);
+	CHECK(int64_t(Dictionary(frames[1])["timestamp_usec"]) == 143400);
+	CHECK_MESSAGE(Ref<Image>(Dictionary(frames[0]).get("image", Variant())).is_valid(), "Feeds in a set should keep their frames.");
+
+	Dictionary statistics = frame_set->get_statistics();
+	CHECK(int(statistics["sets_matched"]) == 4);
+	Array feed_statistics = statistics["feeds"];
+	REQUIRE(feed_statistics.size() == 2);
+	Dictionary right_statistics = feed_statistics[1];
+	CHECK(double(right_statistics["offset_mean_ms"]) == doctest::Approx(1.25));
+	CHECK(double(right_statistics["offset_max_ms"]) == doctest::Approx(1.4));
+	CHECK(double(right_statistics["drift_ms_per_second"]) == doctest::Approx(0.1 / 0.03305).epsilon(0.01));
+	CHECK_MESSAGE(int(right_statistics["frames_unmatched"]) == 1, "The first frame should never have been matched.");
+
+	ERR_PRINT_OFF;
+	Array one_feed;
+	one_feed.push_back(left);
+	CHECK(CameraServer::get_singleton()->create_frame_set(one_feed).is_null());
+	ERR_PRINT_ON;
+
+	frame_set.unref();
+	send_frame(left, 175000, 5);
+	CHECK_MESSAGE(int64_t(left->get_latest_frame()["timestamp_usec"]) == 142000, "Frames shouldn't be kept once the feed left the set.");
+}
+
+TEST_CASE("[SceneTree][Camera] Outputs") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	Ref<CameraFeed> outputs[3] = {
+		feed->add_output(32, 24, CameraFeed::OUTPUT_FORMAT_RGBA8),
+		feed->add_output(32, 24, CameraFeed::OUTPUT_FORMAT_RGBA8, 2),
+		feed->add_output(16, 12, CameraFeed::OUTPUT_FORMAT_L8),
+	};
+	for (Ref<CameraFeed> &output : outputs) {
+		REQUIRE(output.is_valid());
+		CHECK_MESSAGE(CameraServer::get_singleton()->get_feed_by_id(output->get_id()) == output, "Outputs should be added to the camera server.");
+		output->set_keep_latest_frame(true);
+		output->set_active(true);
+		output->wait_for_activation();
+	}
+	CHECK(feed->get_outputs().size() == 3);
+
+	// red in Y, Cb and Cr planes at half resolution
+	Ref<Image> y_image = make_image(64, 48, Image::FORMAT_R8);
+	Ref<Image> cbcr_image = make_image(32, 24, Image::FORMAT_RG8);
+	memset(y_image->ptrw(), 81, 64 * 48);
+	uint8_t *cbcr = cbcr_image->ptrw();
+	for (int i = 0; i < 32 * 24; i++) {
+		cbcr[i * 2 + 0] = 90;
+		cbcr[i * 2 + 1] = 240;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		CameraFeed::FrameTiming timing;
+		timing.sequence = i;
+		feed->set_frame_timing(timing);
+		feed->set_YCbCr_imgs(y_image, cbcr_image);
+	}
+
+	Dictionary every_frame = outputs[0]->get_latest_frame();
+	Dictionary every_other_frame = outputs[1]->get_latest_frame();
+	CHECK(int(every_frame["sequence"]) == 3);
+	CHECK_MESSAGE(int(every_other_frame["sequence"]) == 2, "An output should only take every so many frames.");
+
+	Ref<Image> rgba = every_frame.get("image", Variant());
+	REQUIRE(rgba.is_valid());
+	CHECK(rgba->get_width() == 32);
+	CHECK(rgba->get_format() == Image::FORMAT_RGBA8);
+	CHECK(rgba->ptr()[0] > 250);
+	CHECK(rgba->ptr()[1] < 5);
+	CHECK(rgba->ptr()[3] == 255);
+
+	Ref<Image> grayscale = outputs[2]->get_latest_frame().get("image", Variant());
+	REQUIRE(grayscale.is_valid());
+	CHECK(grayscale->get_format() == Image::FORMAT_L8);
+	CHECK(grayscale->ptr()[0] == 81);
+
+	outputs[0]->update_frame();
+	CHECK(outputs[0]->get_datatype() == CameraFeed::FEED_RGB);
+	CHECK(outputs[0]->get_base_width() == 32);
+
+	feed->remove_output(outputs[0]);
+	CHECK(CameraServer::get_singleton()->get_feed_by_id(outputs[0]->get_id()).is_null());
+	CHECK(feed->get_outputs().size() == 2);
+
+	ERR_PRINT_OFF;
+	CHECK(outputs[1]->add_output(8, 8, CameraFeed::OUTPUT_FORMAT_L8).is_null());
+	ERR_PRINT_ON;
+}
+
+TEST_CASE("[SceneTree][Camera] Recording") {
+	TestCameraServer camera_server;
+	Ref<CameraFeed> feed = memnew(CameraFeed("Test"));
+	feed->set_active(true);
+	feed->wait_for_activation();
+
+	CHECK_FALSE_MESSAGE(feed->can_record(CameraFeed::RECORDING_FORMAT_MJPEG), "Only cameras that capture in MJPEG can record it.");
+	ERR_PRINT_OFF;
+	CHECK(feed->start_recording(OS::get_singleton()->get_cache_path().plus_file("camera_recording.mjpeg"), CameraFeed::RECORDING_FORMAT_MJPEG) == ERR_UNAVAILABLE);
+	ERR_PRINT_ON;
+
+	const String path = OS::get_singleton()->get_cache_path().plus_file("camera_recording.y4m");
+	REQUIRE(feed->start_recording(path, CameraFeed::RECORDING_FORMAT_Y4M) == OK);
+	CHECK(feed->is_recording());
+
+	Ref<Image> y_image = make_image(64, 48, Image::FORMAT_R8);
+	Ref<Image> cbcr_image = make_image(32, 24, Image::FORMAT_RG8);
+	uint8_t *cbcr = cbcr_image->ptrw();
+	for (int i = 0; i < 32 * 24; i++) {
+		cbcr[i * 2 + 0] = 90;
+		cbcr[i * 2 + 1] = 240;
+	}
+	for (int i = 0; i < 3; i++) {
+		CameraFeed::FrameTiming timing;
+		timing.capture_usec = 1000000 + i * 33333;
+		feed->set_frame_timing(timing);
+		feed->set_YCbCr_imgs(y_image, cbcr_image);
+	}
+	// the size of the recording can't change
+	feed->set_YCbCr_imgs(make_image(32, 24, Image::FORMAT_R8), make_image(16, 12, Image::FORMAT_RG8));
+
+	feed->stop_recording();
+	CHECK_FALSE(feed->is_recording());
+	Dictionary statistics = feed->get_statistics();
+	CHECK(int(statistics["recording_frames_written"]) == 3);
+	CHECK(int(statistics["recording_frames_dropped"]) == 1);
+
+	const String header = "YUV4MPEG2 W64 H48 F30000:1000 Ip A1:1 C420mpeg2 XCOLORRANGE=LIMITED\n";
+	const int frame_size = 6 + 64 * 48 + 32 * 24 * 2;
+	Vector<uint8_t> data = FileAccess::get_file_as_array(path);
+	REQUIRE(data.size() == header.length() + frame_size * 3);
+	CHECK(String::utf8((const char *)data.ptr(), header.length()) == header);
+	CHECK(String::utf8((const char *)data.ptr() + header.length(), 6) == "FRAME\n");
+	const uint8_t *frame = data.ptr() + header.length() + 6;
+	CHECK(frame[0] == 0x80);
+	CHECK_MESSAGE(frame[64 * 48] == 90, "The CbCr plane should be split into a Cb and a Cr plane.");
+	CHECK(frame[64 * 48 + 32 * 24] == 240);
+	CHECK(int64_t(statistics["recording_bytes_written"]) == data.size());
+
+	DirAccess::remove_file_or_error(path);
+}
+
+#ifdef MODULE_CAMERA_ENABLED
+
+// Shows frames of the feed until p_frames were drawn, or a couple of seconds went by.
+static bool wait_for_frames(Ref<CameraFeed> p_feed, int p_frames) {
+	uint64_t timeout = OS::get_singleton()->get_ticks_usec() + 2000000;
+	while (OS::get_singleton()->get_ticks_usec() < timeout) {
+		p_feed->update_frame();
+		p_feed->frame_drawn();
+		if (int(p_feed->get_statistics()["frames_drawn"]) >= p_frames) {
+			return true;
+		}
+		OS::get_singleton()->delay_usec(1000);
+	}
+	return false;
+}
+
+TEST_CASE("[SceneTree][Camera] Virtual feed") {
+	TestCameraServer camera_server;
+	Ref<CameraFeedVirtual> feed = memnew(CameraFeedVirtual("Test"));
+
+	CHECK(feed->set_format(64, 48, "NV12", 240.0));
+	feed->set_active(true);
+	feed->wait_for_activation();
+	REQUIRE(feed->is_capturing());
+	CHECK_MESSAGE(wait_for_frames(feed, 3), "The virtual feed should deliver frames.");
+	CHECK(feed->get_datatype() == CameraFeed::FEED_YCBCR_SEP);
+	CHECK(feed->get_base_width() == 64);
+
+	// changing the format restarts the capture in the background
+	MessageQueue::get_singleton()->flush();
+	SIGNAL_WATCH(feed.ptr(), "activated");
+	CHECK(feed->set_format(32, 32, "RGB3", 240.0));
+	CHECK(feed->is_capturing());
+	feed->wait_for_activation();
+	CHECK(feed->is_capturing());
+	MessageQueue::get_singleton()->flush();
+	Array signal_args;
+	signal_args.push_back(Array());
+	SIGNAL_CHECK("activated", signal_args);
+	SIGNAL_UNWATCH(feed.ptr(), "activated");
+	CHECK(wait_for_frames(feed, 6));
+	CHECK(feed->get_datatype() == CameraFeed::FEED_RGB);
+	CHECK(feed->get_base_width() == 32);
+
+	ERR_PRINT_OFF;
+	CHECK_FALSE(feed->set_format(32, 32, "XXXX"));
+	ERR_PRINT_ON;
+
+	feed->set_active(false);
+	CHECK_FALSE(feed->is_capturing());
+}
+
+#endif // MODULE_CAMERA_ENABLED
+
+// Runs p_stage for a number of frames and prints what one frame costs.
+template <class F>
+static void measure_stage(const String &p_name, int p_width, int p_height, int p_bytes, F p_stage) {
+	const int frames = 60;
+	uint64_t start = OS::get_singleton()->get_ticks_usec();
+	for (int i = 0; i < frames; i++) {
+		p_stage();
+	}
+	double msec = MAX(OS::get_singleton()->get_ticks_usec() - start, (uint64_t)1) / 1000.0 / frames;
+	String line = vformat("%s %dx%d:", p_name, p_width, p_height);
+	line += vformat(" %.3f ms, %.0f frames/sec, %d bytes copied per frame", msec, 1000.0 / msec, p_bytes);
+	MESSAGE(line);
+}
+
+// Prints the cost of every stage a frame goes through, run with `--test --no-skip --test-case="*Benchmark*"`.
+// The texture updates go to the dummy renderer, so they measure the rendering server's overhead without the GPU copy.
+TEST_CASE("[SceneTree][Camera][Benchmark] Per-stage frame cost" * doctest::skip()) {
+	TestCameraServer camera_server;
+	const Size2i sizes[] = { Size2i(640, 480), Size2i(1280, 720), Size2i(1920, 1080) };
+
+	for (const Size2i &size : sizes) {
+		int w = size.x;
+		int h = size.y;
+
+		Vector<uint8_t> yuyv;
+		yuyv.resize(w * h * 2);
+		memset(yuyv.ptrw(), 0x80, yuyv.size());
+		Vector<uint8_t> rgba;
+		rgba.resize(w * h * 4);
+		Vector<uint8_t> y_plane;
+		y_plane.resize(w * h);
+		Vector<uint8_t> cbcr_plane;
+		cbcr_plane.resize(w * h);
+
+		measure_stage("Convert YUYV to RGBA", w, h, w * h * 4, [&]() {
+			YUVConverter::Source source;
+			source.format = YUVConverter::SOURCE_YUYV;
+			source.planes[0] = yuyv.ptr();
+			source.strides[0] = w * 2;
+			source.width = w;
+			source.height = h;
+			YUVConverter::convert_to_rgba8(source, rgba.ptrw());
+		});
+
+		measure_stage("Split YUYV into planes", w, h, w * h * 2, [&]() {
+			const uint8_t *src = yuyv.ptr();
+			uint8_t *dst_y = y_plane.ptrw();
+			uint8_t *dst_c = cbcr_plane.ptrw();
+			for (int i = 0; i < w * h / 2; i++) {
+				dst_y[i * 2 + 0] = src[i * 4 + 0];
+				dst_y[i * 2 + 1] = src[i * 4 + 2];
+				dst_c[i * 2 + 0] = src[i * 4 + 1];
+				dst_c[i * 2 + 1] = src[i * 4 + 3];
+			}
+		});
+
+		// images share the data they are created with until one side writes to it
+		Ref<Image> rgba_image;
+		rgba_image.instantiate();
+		rgba_image->create(w, h, false, Image::FORMAT_RGBA8, rgba);
+		int image_bytes = rgba_image->get_data().ptr() == rgba.ptr() ? 0 : rgba.size();
+		measure_stage("Create Image", w, h, image_bytes, [&]() {
+			Ref<Image> image;
+			image.instantiate();
+			image->create(w, h, false, Image::FORMAT_RGBA8, rgba);
+		});
+
+		Ref<CameraFeed> feed = memnew(CameraFeed("Benchmark"));
+		feed->set_active(true);
+		feed->wait_for_activation();
+
+		measure_stage("set_RGB_img and texture update", w, h, 0, [&]() {
+			feed->set_RGB_img(rgba_image);
+			feed->update_frame();
+		});
+
+		Ref<Image> y_image = make_image(w, h, Image::FORMAT_R8);
+		Ref<Image> cbcr_image = make_image(w / 2, h, Image::FORMAT_RG8);
+		measure_stage("set_YCbCr_imgs and texture update", w, h, 0, [&]() {
+			feed->set_YCbCr_imgs(y_image, cbcr_image);
+			feed->update_frame();
+		});
+
+		CameraFeed::FramePlane rgb;
+		rgb.data = rgba.ptr();
+		rgb.width = w;
+		rgb.height = h;
+		rgb.row_pitch = w * 4;
+		rgb.format = Image::FORMAT_RGBA8;
+		measure_stage("set_RGB_raw and texture update", w, h, 0, [&]() {
+			feed->set_RGB_raw(rgb, nullptr, nullptr);
+			feed->update_frame();
+		});
+
+		// a full size RGBA output for recording and a small grayscale one for tracking
+		Ref<CameraFeed> outputs[2] = { feed->add_output(w, h, CameraFeed::OUTPUT_FORMAT_RGBA8), feed->add_output(w / 4, h / 4, CameraFeed::OUTPUT_FORMAT_L8) };
+		for (Ref<CameraFeed> &output : outputs) {
+			output->set_active(true);
+			output->wait_for_activation();
+		}
+		measure_stage("set_YCbCr_imgs with two outputs", w, h, w * h * 4 + w * h / 16, [&]() {
+			feed->set_YCbCr_imgs(y_image, cbcr_image);
+			feed->update_frame();
+			for (Ref<CameraFeed> &output : outputs) {
+				output->update_frame();
+			}
+		});
+		for (Ref<CameraFeed> &output : outputs) {
+			feed->remove_output(output);
+		}
+
+		feed->set_active(false);
+	}
+
+#ifdef MODULE_CAMERA_ENABLED
+	// The whole capture path with a virtual camera running as fast as it can. Its capture
+	// thread stamps when a frame was due and when it woke up for it, like a dequeue.
+	const char *pixel_formats[] = { "NV12", "YUYV", "RGB3" };
+	for (const Size2i &size : sizes) {
+		for (const char *pixel_format : pixel_formats) {
+			Ref<CameraFeedVirtual> feed = memnew(CameraFeedVirtual("Benchmark"));
+			feed->set_format(size.x, size.y, pixel_format, 1000.0);
+			feed->set_active(true);
+			feed->wait_for_activation();
+
+			uint64_t start = OS::get_singleton()->get_ticks_usec();
+			while (OS::get_singleton()->get_ticks_usec() - start < 1000000) {
+				feed->update_frame();
+				feed->frame_drawn();
+				OS::get_singleton()->delay_usec(100);
+			}
+			Dictionary statistics = feed->get_statistics();
+			feed->set_active(false);
+
+			int bytes = size.x * size.y * 2;
+			if (String(pixel_format) == "NV12") {
+				bytes = size.x * size.y * 3 / 2;
+			} else if (String(pixel_format) == "RGB3") {
+				bytes = size.x * size.y * 3;
+			}
+			String line = vformat("Virtual %s %dx%d: %d frames/sec,", pixel_format, size.x, size.y, int(statistics["fps"]));
+			line += vformat(" dequeue %.3f ms, fill %.3f ms, upload %.3f ms,", double(statistics["capture_to_dequeue_ms"]), double(statistics["dequeue_to_converted_ms"]), double(statistics["converted_to_upload_ms"]));
+			line += vformat(" %d dropped, %d underruns, %d bytes copied per frame", int(statistics["frames_dropped"]), int(statistics["underruns"]), bytes);
+			MESSAGE(line);
+		}
+	}
+#endif // MODULE_CAMERA_ENABLED
+}
+
+} // namespace TestCamera
+
+#endif // TEST_CAMERA_H
@@ -38,6 +38,7 @@
 #include "tests/core/io/test_pck_packer.h"
 #include "tests/core/io/test_resource.h"
 #include "tests/core/io/test_xml_parser.h"
+#include "tests/core/io/test_yuv_converter.h"
 #include "tests/core/math/test_aabb.h"
 #include "tests/core/math/test_astar.h"
 #include "tests/core/math/test_basis.h"
@@ -73,6 +74,7 @@
 #include "tests/scene/test_gradient.h"
 #include "tests/scene/test_gui.h"
 #include "tests/scene/test_path_3d.h"
+#include "tests/servers/test_camera.h"
 #include "tests/servers/test_physics_2d.h"
 #include "tests/servers/test_physics_3d.h"
 #include "tests/servers/test_render.h"